@@ -0,0 +1,299 @@
+#include "StdAfx.h"
+#include "BinaryEvaluationLog.h"
+
+using namespace FileHandler;
+using namespace Evaluation;
+
+namespace{
+	/** The identifier in the beginning of every binary log */
+	const char BINARY_LOG_IDENT[8] = {'N', 'O', 'V', 'A', 'C', 'B', 'E', '2'};
+
+	/** The identifier in the beginning of every block */
+	const char SCAN_MARKER[4] = {'S', 'C', 'A', 'N'};
+
+	/** Converts a time to the number of seconds since midnight */
+	int ToSeconds(const CSpectrumTime &t){
+		return 3600 * t.hr + 60 * t.m + t.sec;
+	}
+
+	/** Converts the number of seconds since midnight to a time */
+	void FromSeconds(int seconds, CSpectrumTime &t){
+		t.hr   = (unsigned short)(seconds / 3600);
+		t.m    = (unsigned short)((seconds / 60) % 60);
+		t.sec  = (unsigned short)(seconds % 60);
+		t.msec = 0;
+	}
+}
+
+bool CBinaryEvaluationLog::s_writeBinaryLogs = false;
+
+CBinaryEvaluationLog::CBinaryEvaluationLog(void)
+{
+}
+
+CBinaryEvaluationLog::~CBinaryEvaluationLog(void)
+{
+	Close();
+}
+
+CString CBinaryEvaluationLog::GetFileName(const CString &evaluationLog){
+	CString fileName;
+	fileName.Format("%s.bin", (LPCSTR)evaluationLog);
+	return fileName;
+}
+
+__int64 CBinaryEvaluationLog::BlockSize(int specNum, int specieNum){
+	__int64 size = sizeof(ScanHeader) + (__int64)specieNum * SPECIE_NAME_LENGTH +
+		4 * (__int64)specNum * (SPECTRUM_COLUMN_NUM + (__int64)specieNum * SPECIE_COLUMN_NUM);
+	return (size + 7) & ~7; // pad to a multiple of 8 bytes
+}
+
+RETURN_CODE CBinaryEvaluationLog::AppendScan(const CString &evaluationLog, const CSpectrumInfo &scanInfo, const CScanResult &result, INSTRUMENT_TYPE instrumentType, double maxIntensity){
+	int specNum   = result.GetEvaluatedNum();
+	int specieNum = (specNum > 0) ? result.GetSpecieNum(0) : 0;
+
+	// 1. Build the whole block in memory, so that it can be written in one go
+	std::vector<char> block((size_t)BlockSize(specNum, specieNum), 0);
+	ScanHeader *header = (ScanHeader*)&block[0];
+
+	memcpy(header->marker, SCAN_MARKER, sizeof(SCAN_MARKER));
+	header->blockSize      = (int)block.size();
+	header->latitude       = scanInfo.m_gps.m_latitude;
+	header->longitude      = scanInfo.m_gps.m_longitude;
+	header->altitude       = scanInfo.m_gps.m_altitude;
+	header->flux           = result.GetFlux();
+	header->compass        = scanInfo.m_compass;
+	header->coneAngle      = scanInfo.m_coneAngle;
+	header->pitch          = scanInfo.m_pitch;
+	header->batteryVoltage = result.GetBatteryVoltage();
+	header->temperature    = (float)result.GetTemperature();
+	header->specNum        = specNum;
+	header->specieNum      = specieNum;
+	header->instrumentType = (int)instrumentType;
+	header->channel        = scanInfo.m_channel;
+	header->specModel      = (int)scanInfo.m_specModel;
+	header->date[0]        = scanInfo.m_date[0];
+	header->date[1]        = scanInfo.m_date[1];
+	header->date[2]        = scanInfo.m_date[2];
+	header->startTime[0]   = scanInfo.m_startTime.hr;
+	header->startTime[1]   = scanInfo.m_startTime.m;
+	header->startTime[2]   = scanInfo.m_startTime.sec;
+	strncpy(header->serial, scanInfo.m_device, SERIAL_LENGTH - 1);
+
+	CScanView view;
+	view.m_header = header;
+
+	for(int j = 0; j < specieNum; ++j){
+		strncpy((char*)view.SpecieName(j), result.GetSpecieName(0, j), SPECIE_NAME_LENGTH - 1);
+	}
+
+	// 2. Fill in the columns
+	float *scanAngle     = (float*)view.FloatColumn(COL_SCANANGLE);
+	float *scanAngle2    = (float*)view.FloatColumn(COL_SCANANGLE2);
+	int   *startTime     = (int*)view.IntColumn(COL_STARTTIME);
+	int   *stopTime      = (int*)view.IntColumn(COL_STOPTIME);
+	float *delta         = (float*)view.FloatColumn(COL_DELTA);
+	float *chiSquare     = (float*)view.FloatColumn(COL_CHISQUARE);
+	float *peakIntensity = (float*)view.FloatColumn(COL_PEAKINTENSITY);
+	float *fitIntensity  = (float*)view.FloatColumn(COL_FITINTENSITY);
+	float *offset        = (float*)view.FloatColumn(COL_OFFSET);
+	int   *exposureTime  = (int*)view.IntColumn(COL_EXPOSURETIME);
+	int   *numSpec       = (int*)view.IntColumn(COL_NUMSPEC);
+	int   *status        = (int*)view.IntColumn(COL_STATUS);
+	int   *flag          = (int*)view.IntColumn(COL_FLAG);
+
+	for(int i = 0; i < specNum; ++i){
+		const CSpectrumInfo &info = result.GetSpectrumInfo(i);
+		const CEvaluationResult *evResult = result.GetResult(i);
+
+		scanAngle[i]     = info.m_scanAngle;
+		scanAngle2[i]    = info.m_scanAngle2;
+		startTime[i]     = ToSeconds(info.m_startTime);
+		stopTime[i]      = ToSeconds(info.m_stopTime);
+		delta[i]         = (float)evResult->m_delta;
+		chiSquare[i]     = (float)evResult->m_chiSquare;
+		// The intensities are saturation ratios, as in the text evaluation log
+		double dynamicRange = (maxIntensity > 0.0) ? maxIntensity * max(info.m_numSpec, 1L) : 1.0;
+		peakIntensity[i] = (float)(info.m_peakIntensity / dynamicRange);
+		fitIntensity[i]  = (float)(info.m_fitIntensity  / dynamicRange);
+		offset[i]        = info.m_offset;
+		exposureTime[i]  = info.m_exposureTime;
+		numSpec[i]       = info.m_numSpec;
+		status[i]        = evResult->m_evaluationStatus;
+		flag[i]          = info.m_flag;
+	}
+
+	for(int j = 0; j < specieNum; ++j){
+		float *column       = (float*)view.SpecieColumn(j, COL_COLUMN);
+		float *columnError  = (float*)view.SpecieColumn(j, COL_COLUMNERROR);
+		float *shift        = (float*)view.SpecieColumn(j, COL_SHIFT);
+		float *shiftError   = (float*)view.SpecieColumn(j, COL_SHIFTERROR);
+		float *squeeze      = (float*)view.SpecieColumn(j, COL_SQUEEZE);
+		float *squeezeError = (float*)view.SpecieColumn(j, COL_SQUEEZEERROR);
+
+		for(int i = 0; i < specNum; ++i){
+			column[i]       = (float)result.GetColumn(i, j);
+			columnError[i]  = (float)result.GetColumnError(i, j);
+			shift[i]        = (float)result.GetShift(i, j);
+			shiftError[i]   = (float)result.GetShiftError(i, j);
+			squeeze[i]      = (float)result.GetSqueeze(i, j);
+			squeezeError[i] = (float)result.GetSqueezeError(i, j);
+		}
+	}
+
+	// 3. Append the block to the file, a new file starts with the identifier
+	FILE *f = fopen(GetFileName(evaluationLog), "ab");
+	if(f == NULL)
+		return FAIL;
+
+	fseek(f, 0, SEEK_END);
+	if(ftell(f) == 0)
+		fwrite(BINARY_LOG_IDENT, sizeof(BINARY_LOG_IDENT), 1, f);
+	size_t written = fwrite(&block[0], block.size(), 1, f);
+	fclose(f);
+
+	return (written == 1) ? SUCCESS : FAIL;
+}
+
+RETURN_CODE CBinaryEvaluationLog::Open(const CString &evaluationLog){
+	Close();
+
+	if(SUCCESS != m_file.Open(GetFileName(evaluationLog)))
+		return FAIL;
+
+	const char *data = m_file.Data();
+	__int64 size = m_file.Size();
+	if(size < (__int64)sizeof(BINARY_LOG_IDENT) || 0 != memcmp(data, BINARY_LOG_IDENT, sizeof(BINARY_LOG_IDENT))){
+		Close();
+		return FAIL;
+	}
+
+	// Find the blocks, stop at the first block which is not complete
+	__int64 pos = sizeof(BINARY_LOG_IDENT);
+	while(pos + (__int64)sizeof(ScanHeader) <= size){
+		const ScanHeader *header = (const ScanHeader*)(data + pos);
+		if(0 != memcmp(header->marker, SCAN_MARKER, sizeof(SCAN_MARKER)) ||
+			header->specNum < 0 || header->specieNum < 0 || header->specieNum > MAX_N_REFERENCES ||
+			header->blockSize != BlockSize(header->specNum, header->specieNum) ||
+			pos + header->blockSize > size){
+			break;
+		}
+		m_block.push_back(header);
+		pos += header->blockSize;
+	}
+
+	return SUCCESS;
+}
+
+void CBinaryEvaluationLog::Close(){
+	m_block.clear();
+	m_file.Close();
+}
+
+RETURN_CODE CBinaryEvaluationLog::GetScan(long scanIndex, CScanView &view) const{
+	if(scanIndex < 0 || scanIndex >= (long)m_block.size())
+		return FAIL;
+
+	view.m_header = m_block[scanIndex];
+	return SUCCESS;
+}
+
+RETURN_CODE CBinaryEvaluationLog::GetScan(long scanIndex, CScanResult &result) const{
+	CScanView view;
+	if(SUCCESS != GetScan(scanIndex, view))
+		return FAIL;
+
+	view.ToScanResult(result);
+	return SUCCESS;
+}
+
+const char *CBinaryEvaluationLog::CScanView::SpecieName(int specie) const{
+	return (const char*)(m_header + 1) + specie * SPECIE_NAME_LENGTH;
+}
+
+const void *CBinaryEvaluationLog::CScanView::Column(int index) const{
+	return (const char*)(m_header + 1) + m_header->specieNum * SPECIE_NAME_LENGTH + 4 * index * m_header->specNum;
+}
+
+void CBinaryEvaluationLog::CScanView::ToScanResult(CScanResult &result) const{
+	const ScanHeader &header = *m_header;
+	CEvaluationResult evResult;
+	CSpectrumInfo info;
+
+	result = CScanResult();
+	result.InitializeArrays(header.specNum);
+
+	// The species
+	for(int j = 0; j < header.specieNum; ++j){
+		evResult.InsertSpecie(SpecieName(j));
+	}
+
+	// The information which is common to all spectra in the scan
+	info.m_gps.m_latitude  = header.latitude;
+	info.m_gps.m_longitude = header.longitude;
+	info.m_gps.m_altitude  = header.altitude;
+	info.m_compass         = header.compass;
+	info.m_coneAngle       = header.coneAngle;
+	info.m_pitch           = header.pitch;
+	info.m_batteryVoltage  = header.batteryVoltage;
+	info.m_temperature     = header.temperature;
+	info.m_channel         = (unsigned char)header.channel;
+	info.m_specModel       = (SPECTROMETER_MODEL)header.specModel;
+	info.m_date[0]         = header.date[0];
+	info.m_date[1]         = header.date[1];
+	info.m_date[2]         = header.date[2];
+	info.m_device.Format("%.*s", SERIAL_LENGTH, header.serial);
+
+	const float *scanAngle     = FloatColumn(COL_SCANANGLE);
+	const float *scanAngle2    = FloatColumn(COL_SCANANGLE2);
+	const int   *startTime     = IntColumn(COL_STARTTIME);
+	const int   *stopTime      = IntColumn(COL_STOPTIME);
+	const float *delta         = FloatColumn(COL_DELTA);
+	const float *chiSquare     = FloatColumn(COL_CHISQUARE);
+	const float *peakIntensity = FloatColumn(COL_PEAKINTENSITY);
+	const float *fitIntensity  = FloatColumn(COL_FITINTENSITY);
+	const float *offset        = FloatColumn(COL_OFFSET);
+	const int   *exposureTime  = IntColumn(COL_EXPOSURETIME);
+	const int   *numSpec       = IntColumn(COL_NUMSPEC);
+	const int   *status        = IntColumn(COL_STATUS);
+	const int   *flag          = IntColumn(COL_FLAG);
+
+	for(int i = 0; i < header.specNum; ++i){
+		info.m_scanIndex     = (short)i;
+		info.m_scanAngle     = scanAngle[i];
+		info.m_scanAngle2    = scanAngle2[i];
+		info.m_peakIntensity = peakIntensity[i];
+		info.m_fitIntensity  = fitIntensity[i];
+		info.m_offset        = offset[i];
+		info.m_exposureTime  = exposureTime[i];
+		info.m_numSpec       = numSpec[i];
+		info.m_flag          = (unsigned char)flag[i];
+		FromSeconds(startTime[i], info.m_startTime);
+		FromSeconds(stopTime[i], info.m_stopTime);
+
+		evResult.m_delta            = delta[i];
+		evResult.m_chiSquare        = chiSquare[i];
+		evResult.m_evaluationStatus = status[i];
+		for(int j = 0; j < header.specieNum; ++j){
+			CReferenceFitResult &ref = evResult.m_ref[j];
+			ref.m_column       = SpecieColumn(j, COL_COLUMN)[i];
+			ref.m_columnError  = SpecieColumn(j, COL_COLUMNERROR)[i];
+			ref.m_shift        = SpecieColumn(j, COL_SHIFT)[i];
+			ref.m_shiftError   = SpecieColumn(j, COL_SHIFTERROR)[i];
+			ref.m_squeeze      = SpecieColumn(j, COL_SQUEEZE)[i];
+			ref.m_squeezeError = SpecieColumn(j, COL_SQUEEZEERROR)[i];
+		}
+
+		result.AppendResult(evResult, info);
+
+		// Check the goodness of fit again, as when reading the text evaluation log
+		result.CheckGoodnessOfFit(info);
+	}
+
+	result.SetFlux(header.flux);
+	result.SetInstrumentType((INSTRUMENT_TYPE)header.instrumentType);
+
+	// Calculate the offset, as when reading the text evaluation log
+	if(header.specieNum > 0)
+		result.CalculateOffset(CString(SpecieName(0)));
+}
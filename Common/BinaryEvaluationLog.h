@@ -0,0 +1,180 @@
+#pragma once
+
+#include <vector>
+
+#include "Common.h"
+#include "MappedFile.h"
+#include "../Evaluation/ScanResult.h"
+
+namespace FileHandler
+{
+	/** <b>CBinaryEvaluationLog</b> handles the compact binary version of an evaluation log.
+		The binary log is written next to the ordinary (text) evaluation log and is
+		meant for fast reading of many scans, e.g. when looking at the trends over
+		several years. It holds the evaluated spectra of each scan, but not the
+		sky, dark and offset spectra nor the additional information about the scan
+		(volcano, site, wind-field...). The text evaluation log is still the archival format.
+
+		The file starts with an 8-byte identifier, followed by one block for each scan.
+		Each block starts with a 'ScanHeader', followed by the names of the species
+		and then by the columns of the scan, one array with one value per spectrum
+		for each column. The blocks are padded to a multiple of 8 bytes.
+
+		The file is read by mapping it into memory, the columns can then be
+		accessed directly through a 'CScanView' without any parsing. */
+	class CBinaryEvaluationLog
+	{
+	public:
+		CBinaryEvaluationLog(void);
+		~CBinaryEvaluationLog(void);
+
+		/** The maximum length of the name of a specie, including the terminating zero */
+		static const int SPECIE_NAME_LENGTH = 16;
+
+		/** The maximum length of the serial-number, including the terminating zero */
+		static const int SERIAL_LENGTH = 20;
+
+		/** The header of each scan in the file */
+		typedef struct ScanHeader{
+			char   marker[4];			// always 'SCAN'
+			int    blockSize;			// the size of the whole block of the scan, this header included [bytes]
+			double latitude;			// the position of the instrument
+			double longitude;
+			double altitude;
+			double flux;				// the flux of the scan [kg/s]
+			float  compass;				// the compass-direction of the instrument [deg]
+			float  coneAngle;			// the cone-angle of the instrument [deg]
+			float  pitch;				// the tilt of the instrument [deg]
+			float  batteryVoltage;		// [V]
+			float  temperature;			// [C]
+			int    specNum;				// the number of evaluated spectra in the scan
+			int    specieNum;			// the number of evaluated species
+			int    instrumentType;		// the INSTRUMENT_TYPE
+			int    channel;				// the channel of the spectrometer
+			unsigned short date[3];		// the date of the scan (year, month, day)
+			unsigned short startTime[3];// the start-time of the scan (hour, minute, second)
+			char   serial[SERIAL_LENGTH];// the serial-number of the spectrometer
+			int    specModel;			// the SPECTROMETER_MODEL, used when checking the goodness of fit
+		}ScanHeader;
+
+		/** The columns with one value for every spectrum in the scan */
+		enum SPECTRUM_COLUMN{
+			COL_SCANANGLE,		// float
+			COL_SCANANGLE2,		// float
+			COL_STARTTIME,		// int, seconds since midnight
+			COL_STOPTIME,		// int, seconds since midnight
+			COL_DELTA,			// float
+			COL_CHISQUARE,		// float
+			COL_PEAKINTENSITY,	// float, saturation ratio (as in the text log)
+			COL_FITINTENSITY,	// float, saturation ratio (as in the text log)
+			COL_OFFSET,			// float
+			COL_EXPOSURETIME,	// int
+			COL_NUMSPEC,		// int
+			COL_STATUS,			// int, the evaluation status (MARK_BAD_EVALUATION, MARK_DELETED)
+			COL_FLAG,			// int, the 'flag' of the spectrum
+			SPECTRUM_COLUMN_NUM
+		};
+
+		/** The columns with one value for every spectrum and every specie */
+		enum SPECIE_COLUMN{
+			COL_COLUMN,
+			COL_COLUMNERROR,
+			COL_SHIFT,
+			COL_SHIFTERROR,
+			COL_SQUEEZE,
+			COL_SQUEEZEERROR,
+			SPECIE_COLUMN_NUM
+		};
+
+		/** <b>CScanView</b> gives direct access to the columns of one scan in the
+			mapped file. The view is valid as long as the file is open. */
+		class CScanView
+		{
+		public:
+			CScanView(void) : m_header(NULL) {}
+
+			/** The header of the scan */
+			const ScanHeader &Header() const { return *m_header; }
+
+			/** The number of evaluated spectra in the scan */
+			int SpecNum() const { return m_header->specNum; }
+
+			/** The number of evaluated species in the scan */
+			int SpecieNum() const { return m_header->specieNum; }
+
+			/** The name of specie number 'specie' */
+			const char *SpecieName(int specie) const;
+
+			/** Returns the given column, with one value for every spectrum */
+			const float *FloatColumn(SPECTRUM_COLUMN column) const { return (const float*)Column(column); }
+			const int *IntColumn(SPECTRUM_COLUMN column) const { return (const int*)Column(column); }
+
+			/** Returns the given column of specie number 'specie', with one value for every spectrum */
+			const float *SpecieColumn(int specie, SPECIE_COLUMN column) const { return (const float*)Column(SPECTRUM_COLUMN_NUM + specie * SPECIE_COLUMN_NUM + column); }
+
+			/** Fills in 'result' with the evaluated spectra of this scan. As when
+				reading the text evaluation log, the goodness of fit of every spectrum
+				is checked again. The sky and dark spectra are not stored in the
+				binary log and are therefore not set in 'result'. */
+			void ToScanResult(Evaluation::CScanResult &result) const;
+
+		private:
+			friend class CBinaryEvaluationLog;
+
+			/** Returns column number 'index' in the block */
+			const void *Column(int index) const;
+
+			const ScanHeader *m_header;
+		};
+
+		// ----------------------------------------------------------------------
+		// --------------------- PUBLIC METHODS ---------------------------------
+		// ----------------------------------------------------------------------
+
+		/** Appends the evaluated scan 'result' to the binary log of the
+			given (text) evaluation log.
+			@param scanInfo - the information about the scan which is written to the
+				scan-information section of the text evaluation log (date, start-time,
+				position, compass, cone-angle, tilt, serial-number, spectrometer model and channel).
+			@param maxIntensity - the maximum intensity of one spectrum, the peak- and
+				fit-intensities are stored as saturation ratios, as in the text log.
+				If this is zero then the intensities are stored as they are.
+			@return SUCCESS if the scan could be written */
+		static RETURN_CODE AppendScan(const CString &evaluationLog, const CSpectrumInfo &scanInfo, const Evaluation::CScanResult &result, INSTRUMENT_TYPE instrumentType, double maxIntensity);
+
+		/** Opens the binary log of the given (text) evaluation log and finds all
+			the scans in it. A block which is not completely written is ignored.
+			@return SUCCESS if the file could be opened */
+		RETURN_CODE Open(const CString &evaluationLog);
+
+		/** Closes the file, all views into it become invalid */
+		void Close();
+
+		/** The number of scans in the opened file */
+		long GetScanNum() const { return (long)m_block.size(); }
+
+		/** Gets a view of scan number 'scanIndex' in the file (in the order
+			the scans were written). */
+		RETURN_CODE GetScan(long scanIndex, CScanView &view) const;
+
+		/** Gets scan number 'scanIndex' in the file (in the order the scans were written). */
+		RETURN_CODE GetScan(long scanIndex, Evaluation::CScanResult &result) const;
+
+		/** Returns the name of the binary log of the given evaluation log */
+		static CString GetFileName(const CString &evaluationLog);
+
+		/** If true then binary logs are written together with the
+			evaluation logs. Default is false. */
+		static bool s_writeBinaryLogs;
+
+	private:
+		/** The mapped file */
+		CMappedFile m_file;
+
+		/** The start of every complete block in the file */
+		std::vector<const ScanHeader*> m_block;
+
+		/** Returns the size of the block of a scan with the given number of spectra and species [bytes] */
+		static __int64 BlockSize(int specNum, int specieNum);
+	};
+}
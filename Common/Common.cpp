@@ -735,17 +735,19 @@ RETURN_CODE Common::GetSunPosition(const CDateTime &gmtTime, double lat, double
 }
 
 const CString &Common::GetString(const UINT uID){
-	static int index = 0;
+	// Each thread has its own strings, since this is called also from the worker threads
+	static thread_local CString strings[3];
+	static thread_local int index = 0;
 
 	index += 1;
 	index %= 3;
 
-	m_string[index].LoadString(uID);
-	return m_string[index];
+	strings[index].LoadString(uID);
+	return strings[index];
 }
 
 CString &Common::SimplifyString(const CString &in){
-	static CString str;
+	static thread_local CString str;
 
 	// Clean the string for non-printable characters
 	CleanString(in, str);
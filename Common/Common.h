@@ -504,14 +504,16 @@ public:
 	// --------------------------- STRINGS --------------------------------
 	// --------------------------------------------------------------------
 
-	/** This reformats an UINT from the string table into a CString in a convenient way */
+	/** This reformats an UINT from the string table into a CString in a convenient way.
+			The returned string is overwritten by the third next call from the same thread. */
 	const CString &GetString(const UINT uID);
 
 	/** This function takes a string and simplifies it so that it is more easily readable 
 			by a machine. changes made are: 
 			1 - Spaces are replaced with '_' (underscore)
 			2 - All characters are converted to lower-case
-			3 - accents are removed ('' -> 'o') */
+			3 - accents are removed ('' -> 'o')
+			The returned string is overwritten by the next call from the same thread. */
 	CString &SimplifyString(const CString &in);
 
 	/** This function takes a string and removes any 'special' (ASCII code < 32) 
@@ -523,8 +525,6 @@ public:
 			The algorithm is based on MergeSort (~O(NlogN)). */
 	static void Sort(CList <CString, CString&> &strings, bool files, bool ascending = true);
 private:
-	CString m_string[3];
-
 	/** Merges the two lists 'list1' and 'list2' in a sorted way and stores
 			the result in the output-list 'result' */
 	static void MergeLists(const CList <CString, CString&> &list1, const CList <CString, CString&> &list2, CList <CString, CString&> &result, bool files, bool ascending = true);
@@ -1,17 +1,99 @@
 #include "StdAfx.h"
 #include "evaluationlogfilehandler.h"
+#include "MappedFile.h"
+#include "BinaryEvaluationLog.h"
 #include "../Common/SpectrometerModel.h"
 #include "../Common/Version.h"
 
 // Include synchronization classes
 #include <afxmt.h>
 
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
 // Global variables;
 extern CCriticalSection g_evalLogCritSect; // synchronization access to evaluation-log files
 
 
 using namespace FileHandler;
 
+namespace{
+	/** The identifier in the beginning of every index-file */
+	const char INDEX_IDENT[8] = {'N', 'O', 'V', 'A', 'C', 'E', 'V', '1'};
+
+	/** Returns true if 'str' contains 'word', which must be in lower case.
+		The case of the letters in 'str' is ignored. */
+	bool ContainsNoCase(const char *str, const char *word){
+		size_t length = strlen(word);
+		for(; *str != 0; ++str){
+			if(tolower((unsigned char)*str) == word[0] && 0 == strnicmp(str, word, length))
+				return true;
+		}
+		return false;
+	}
+
+	/** Gets the size and the time stamps of the given file.
+		@return SUCCESS if the file exists */
+	RETURN_CODE GetFileStatus(const CString &fileName, __int64 &size, __time64_t &creationTime, __time64_t &modificationTime){
+		struct _stat64 status;
+		if(0 != _stat64(fileName, &status))
+			return FAIL;
+		size             = status.st_size;
+		creationTime     = status.st_ctime;
+		modificationTime = status.st_mtime;
+		return SUCCESS;
+	}
+
+	/** Counts the scans which have been written to an evaluation log, 
+		i.e. the number of '<spectraldata>' sections in it */
+	long CountWrittenScans(const char *data, __int64 size){
+		static const char spectralData[] = "<spectraldata>";
+		const __int64 length = sizeof(spectralData) - 1;
+		long scanNum = 0;
+
+		for(__int64 pos = 0; pos + length <= size; ++pos){
+			const char *pt = (const char*)memchr(data + pos, '<', (size_t)(size - length - pos + 1));
+			if(pt == NULL)
+				break;
+			pos = pt - data;
+			if(0 == memcmp(pt, spectralData, (size_t)length))
+				++scanNum;
+		}
+		return scanNum;
+	}
+}
+
+bool CEvaluationLogFileHandler::s_useIndexFiles = false;
+
+CEvaluationLogFileHandler::CLineReader::CLineReader(const char *data, __int64 begin, __int64 end)
+	: m_data(data), m_pos(begin), m_end(end)
+{
+}
+
+/** Copies the next line to 'szLine', in the same way as fgets does for a file opened in text-mode */
+bool CEvaluationLogFileHandler::CLineReader::ReadLine(char *szLine, int maxLength){
+	if(m_pos >= m_end)
+		return false;
+
+	const char *start = m_data + m_pos;
+	int maxCopy = (m_end - m_pos < maxLength - 1) ? (int)(m_end - m_pos) : maxLength - 1;
+	const char *newline = (const char*)memchr(start, '\n', maxCopy);
+	int length = (newline != NULL) ? (int)(newline - start) + 1 : maxCopy;
+	m_pos += length;
+
+	// Convert the line-ending '\r\n' to '\n'
+	if(newline != NULL && length >= 2 && start[length - 2] == '\r'){
+		memcpy(szLine, start, length - 2);
+		szLine[length - 2] = '\n';
+		szLine[length - 1] = 0;
+	}else{
+		memcpy(szLine, start, length);
+		szLine[length] = 0;
+	}
+	return true;
+}
+
 CEvaluationLogFileHandler::CEvaluationLogFileHandler(void)
 {
 	// Defining which column contains which information
@@ -266,126 +348,280 @@ void CEvaluationLogFileHandler::ParseScanHeader(const char szLine[8192]){
 }
 
 RETURN_CODE CEvaluationLogFileHandler::ReadEvaluationLog(){
-	char  expTimeStr[]        = _T("exposuretime");         // this string only exists in the header line.
-	char  scanInformation[]   = _T("<scaninformation>");    // this string only exists in the scan-information section before the scan-data
-	char  fluxInformation[]   = _T("<fluxinfo>");           // this string only exists in the flux-information section before the scan-data
-	char  spectralData[]      = _T("<spectraldata>");
-	char  endofSpectralData[] = _T("</spectraldata>");
-	CString str;
-	char szLine[8192];
-	int measNr = 0;
-	double fValue;
-	m_scanNum = -1;
-	bool fReadingScan = false;
-	double flux = 0.0;
+	std::vector<ScanLocation> locations;
+	__int64 fileSize = 0;
+	__time64_t creationTime = 0, modificationTime = 0;
 
 	// If no evaluation log selected, quit
 	if(strlen(m_evaluationLog) <= 1)
 		return FAIL;
 
-	// First count the number of scans in the file.
-	//	This to speed up the initialization of the arrays
-	CArray<CDateTime*, CDateTime*> allStartTimes;
-	CArray<unsigned int, unsigned int&> sortOrder;
-	long nScans = GetScanStartTimes(allStartTimes);
-	if(nScans > 0){
-		m_scan.SetSize(nScans);
-		m_windField.SetSize(nScans + 1);
-	}else{
-		MessageBox(NULL, "No scans found in file", "No scans", MB_OK);
-		return FAIL;
-	}
-	SortScanStartTimes(allStartTimes, sortOrder);
-	
-	// Open the evaluation log
+	// Open the evaluation log and read it in one pass
 	CSingleLock singleLock(&g_evalLogCritSect);
 	singleLock.Lock();
 	if(singleLock.IsLocked()){
-		FILE *f = fopen(m_evaluationLog, "r");
-		if(NULL == f){
+		CMappedFile file;
+		if(SUCCESS != GetFileStatus(m_evaluationLog, fileSize, creationTime, modificationTime) || SUCCESS != file.Open(m_evaluationLog)){
 			singleLock.Unlock();
 			return FAIL;
 		}
 
 		// Reset the column- and spectrum info
+		m_scan.RemoveAll();
+		m_windField.RemoveAll();
 		ResetColumns();
 		ResetScanInformation();
 
-		// Read the file, one line at a time
-		while(fgets(szLine, 8192, f)){
+		CLineReader lines(file.Data(), 0, file.Size());
+		ParseScans(lines, locations);
 
-			// ignore empty lines
-			if(strlen(szLine) < 2){
-				if(fReadingScan){
-					fReadingScan = false;
-					// Reset the column- and spectrum-information
-					ResetColumns();
-					ResetScanInformation();
-				}
-				continue;
+		if(file.Size() != fileSize)
+			fileSize = -1; // the file was changed while we opened it, the index-file cannot be trusted
+	}
+	singleLock.Unlock();
+
+	if(m_scanNum <= 0){
+		MessageBox(NULL, "No scans found in file", "No scans", MB_OK);
+		return FAIL;
+	}
+
+	// Sort the scans in order of collection
+	SortScans(locations);
+
+	// make sure that the arrays are just big enough
+	m_scan.SetSize(m_scanNum);
+	m_windField.SetSize(m_scanNum + 1);
+
+	// Remember where each scan is, for the next time
+	if(s_useIndexFiles && fileSize >= 0){
+		singleLock.Lock();
+		if(singleLock.IsLocked()){
+			WriteIndexFile(locations, fileSize, creationTime, modificationTime);
+		}
+		singleLock.Unlock();
+	}
+
+	return SUCCESS;
+}
+
+RETURN_CODE CEvaluationLogFileHandler::ReadEvaluationLog(long scanIndex){
+	std::vector<ScanLocation> index, locations;
+	__int64 fileSize = 0;
+	__time64_t creationTime = 0, modificationTime = 0;
+	char szLine[8192];
+	double flux = 0.0;
+	bool readFromIndex = false;
+
+	// If no evaluation log selected, quit
+	if(strlen(m_evaluationLog) <= 1 || scanIndex < 0)
+		return FAIL;
+
+	// If there is an index-file for this version of the evaluation log,
+	//	then parse only the part of the file which contains this scan
+	CSingleLock singleLock(&g_evalLogCritSect);
+	singleLock.Lock();
+	if(singleLock.IsLocked()){
+		CMappedFile file;
+		if(s_useIndexFiles &&
+			SUCCESS == GetFileStatus(m_evaluationLog, fileSize, creationTime, modificationTime) &&
+			SUCCESS == ReadIndexFile(index, fileSize, creationTime, modificationTime) &&
+			scanIndex < (long)index.size() &&
+			SUCCESS == file.Open(m_evaluationLog) && file.Size() == fileSize){
+
+			const ScanLocation &location = index[scanIndex];
+
+			// Reset the column- and spectrum info
+			m_scan.RemoveAll();
+			m_windField.RemoveAll();
+			ResetColumns();
+			ResetScanInformation();
+
+			// The scan-information may have been written before an earlier scan
+			if(location.info >= 0 && location.info < location.begin){
+				CLineReader info(file.Data(), location.info, location.begin);
+				info.ReadLine(szLine, 8192); // the '<scaninformation>' line
+				ParseScanInformation(m_specInfo, flux, info);
 			}
 
-			// convert the string to all lower-case letters
-			for(unsigned int it = 0; it < strlen(szLine); ++it){
-				szLine[it] = tolower(szLine[it]);
+			CLineReader lines(file.Data(), location.begin, location.end);
+			ParseScans(lines, locations);
+			readFromIndex = (m_scanNum == 1);
+		}
+	}
+	singleLock.Unlock();
+
+	if(!readFromIndex){
+		// Read the whole evaluation log (this also writes the index-file) and keep only the one scan
+		if(SUCCESS != ReadEvaluationLog() || scanIndex >= m_scanNum)
+			return FAIL;
+		if(scanIndex > 0){
+			m_scan[0]      = m_scan[scanIndex];
+			m_windField[0] = m_windField[scanIndex];
+		}
+		m_scanNum = 1;
+	}
+
+	m_scan.SetSize(1);
+	m_windField.SetSize(2);
+
+	return SUCCESS;
+}
+
+RETURN_CODE CEvaluationLogFileHandler::ReadBinaryEvaluationLog(){
+	CBinaryEvaluationLog binaryLog;
+	std::vector<ScanLocation> locations;
+	long writtenScans = -1;
+
+	// If no evaluation log selected, quit
+	if(strlen(m_evaluationLog) <= 1)
+		return FAIL;
+
+	CSingleLock singleLock(&g_evalLogCritSect);
+	singleLock.Lock();
+	if(singleLock.IsLocked()){
+		CMappedFile file;
+		if(SUCCESS == file.Open(m_evaluationLog) && SUCCESS == binaryLog.Open(m_evaluationLog)){
+			writtenScans = CountWrittenScans(file.Data(), file.Size());
+		}
+
+		// The binary log must have exactly the same scans as the evaluation log
+		if(writtenScans > 0 && writtenScans == binaryLog.GetScanNum()){
+			m_scan.RemoveAll();
+			m_windField.RemoveAll();
+			ResetColumns();
+			ResetScanInformation();
+
+			m_scanNum = writtenScans;
+			m_scan.SetSize(m_scanNum);
+			m_windField.SetSize(m_scanNum + 1);
+			locations.resize(m_scanNum);
+			for(long k = 0; k < m_scanNum; ++k){
+				binaryLog.GetScan(k, m_scan[k]);
+				m_scan[k].GetStartTime(0, locations[k].startTime);
 			}
+		}else{
+			writtenScans = -1;
+		}
+		binaryLog.Close();
+	}
+	singleLock.Unlock();
+
+	if(writtenScans <= 0)
+		return FAIL;
 
+	// Sort the scans in order of collection
+	SortScans(locations);
+
+	return SUCCESS;
+}
+
+void CEvaluationLogFileHandler::ParseScans(CLineReader &lines, std::vector<ScanLocation> &locations){
+	char  expTimeStr[]        = _T("exposuretime");         // this string only exists in the header line.
+	char  scanInformation[]   = _T("<scaninformation>");    // this string only exists in the scan-information section before the scan-data
+	char  fluxInformation[]   = _T("<fluxinfo>");           // this string only exists in the flux-information section before the scan-data
+	char  spectralData[]      = _T("<spectraldata>");
+	char  endofSpectralData[] = _T("</spectraldata>");
+	char szLine[8192];
+	char *endPtr = NULL;
+	int measNr = 0;
+	double fValue;
+	bool fReadingScan = false;
+	double flux = 0.0;
+	__int64 lineStart;
+	__int64 blockStart = -1;	// where the sections belonging to the next scan begin
+	__int64 infoStart  = -1;	// where the last scan-information section begins
+
+	m_scanNum = -1;
+	locations.clear();
+
+	// Read the file, one line at a time
+	for(lineStart = lines.Position(); lines.ReadLine(szLine, 8192); lineStart = lines.Position()){
+
+		// ignore empty lines
+		if(szLine[0] == 0 || szLine[1] == 0){
+			if(fReadingScan){
+				fReadingScan = false;
+				// Reset the column- and spectrum-information
+				ResetColumns();
+				ResetScanInformation();
+			}
+			continue;
+		}
+
+		// The section tags are the only lines which contain a '<'
+		if(NULL != strchr(szLine, '<')){
 			// find the next scan-information section
-			if(NULL != strstr(szLine, scanInformation)){
+			if(ContainsNoCase(szLine, scanInformation)){
+				if(blockStart < 0)
+					blockStart = lineStart;
+				infoStart = lineStart;
 				ResetScanInformation();
-				ParseScanInformation(m_specInfo, flux, f);
+				ParseScanInformation(m_specInfo, flux, lines);
 				continue;
 			}
 
 			// find the next flux-information section
-			if(NULL != strstr(szLine, fluxInformation)){
-				ParseFluxInformation(m_windField[sortOrder[m_scanNum+1]], flux, f);
+			if(ContainsNoCase(szLine, fluxInformation)){
+				if(blockStart < 0)
+					blockStart = lineStart;
+				if(m_scanNum + 1 >= m_windField.GetSize())
+					m_windField.SetSize(m_scanNum + 2);
+				ParseFluxInformation(m_windField[m_scanNum+1], flux, lines);
 				continue;
 			}
 
-			if(NULL != strstr(szLine, spectralData)){
+			if(ContainsNoCase(szLine, spectralData)){
 				fReadingScan = true;
 				continue;
-			}else if(NULL != strstr(szLine, endofSpectralData)){
+			}else if(ContainsNoCase(szLine, endofSpectralData)){
 				fReadingScan = false;
 				continue;
 			}
+		}
 
-			// find the next start of a scan 
-			if(NULL != strstr(szLine, expTimeStr)){
-
-				// check so that there was some information in the last scan read
-				//	if not the re-use the memory space
-				if((measNr > 0) || (measNr == 0 && m_scanNum < 0)){
+		// find the next start of a scan 
+		if(NULL != strpbrk(szLine, "xX") && ContainsNoCase(szLine, expTimeStr)){
 
-					// The current measurement position inside the scan
-					measNr = 0;
+			// check so that there was some information in the last scan read
+			//	if not the re-use the memory space
+			if((measNr > 0) || (measNr == 0 && m_scanNum < 0)){
 
-					// before we start the next scan, calculate some information about
-					// the old one
+				// The current measurement position inside the scan
+				measNr = 0;
 
-					// 1. If the sky and dark were specified, remove them from the measurement
-					if(m_scanNum >= 0 && fabs(m_scan[sortOrder[m_scanNum]].GetScanAngle(1) - 180.0) < 1){
-						m_scan[sortOrder[m_scanNum]].RemoveResult(0); // remove sky
-						m_scan[sortOrder[m_scanNum]].RemoveResult(0); // remove dark
-					}
+				// before we start the next scan, calculate some information about
+				// the old one
 
-					// 2. Calculate the offset
-					if(m_scanNum >= 0){
-						m_scan[sortOrder[m_scanNum]].CalculateOffset(m_evResult.m_ref[0].m_specieName);
-					}
+				// 1. If the sky and dark were specified, remove them from the measurement
+				if(m_scanNum >= 0 && fabs(m_scan[m_scanNum].GetScanAngle(1) - 180.0) < 1){
+					m_scan[m_scanNum].RemoveResult(0); // remove sky
+					m_scan[m_scanNum].RemoveResult(0); // remove dark
+				}
 
-					// start the next scan.
-					++m_scanNum;
-					if(m_scanNum >= m_scan.GetSize()){
-						m_scan.SetSize(m_scanNum + 1);
-						m_windField.SetSize(m_scanNum + 2);
-					}
+				// 2. Calculate the offset
+				if(m_scanNum >= 0){
+					m_scan[m_scanNum].CalculateOffset(m_evResult.m_ref[0].m_specieName);
 				}
 
+				// start the next scan.
+				++m_scanNum;
+				if(m_scanNum >= m_scan.GetSize())
+					m_scan.SetSize(m_scanNum + 1);
+				if(m_scanNum + 1 >= m_windField.GetSize())
+					m_windField.SetSize(m_scanNum + 2);
+
+				ScanLocation location;
+				location.begin = (blockStart >= 0) ? blockStart : lineStart;
+				location.end   = location.begin;
+				location.info  = infoStart;
+				locations.push_back(location);
+			}
+			blockStart = -1;
+
 			// This line is the header line which says what each column represents.
 			//  Read it and parse it to find out how to interpret the rest of the 
 			//  file. 
+			_strlwr(szLine);
 			ParseScanHeader(szLine);
 
 			// start parsing the lines
@@ -393,20 +629,20 @@ RETURN_CODE CEvaluationLogFileHandler::ReadEvaluationLog(){
 
 			// read the next line, which is the first line in the scan
 			continue; 
-			}
+		}
 
-			// ignore comment lines
-			if(szLine[0] == '#')
+		// ignore comment lines
+		if(szLine[0] == '#')
 			continue;
 
-			// if we're not reading a scan, let's read the next line
-			if(!fReadingScan)
+		// if we're not reading a scan, let's read the next line
+		if(!fReadingScan)
 			continue;
 
-			// Split the scan information up into tokens and parse them. 
-			char* szToken = (char*)(LPCSTR)szLine;
-			int curCol = -1;
-			while(szToken = strtok(szToken, " \t")){
+		// Split the scan information up into tokens and parse them. 
+		char* szToken = (char*)(LPCSTR)szLine;
+		int curCol = -1;
+		while(szToken = strtok(szToken, " \t")){
 			++curCol;
 
 			// First check the starttime
@@ -424,7 +660,7 @@ RETURN_CODE CEvaluationLogFileHandler::ReadEvaluationLog(){
 			}
 
 			// Then check the stoptime
-				if(curCol == m_col.stoptime){
+			if(curCol == m_col.stoptime){
 				int fValue1, fValue2, fValue3;
 				if(strstr(szToken, ":"))
 					sscanf(szToken, "%d:%d:%d", &fValue1, &fValue2, &fValue3);
@@ -439,13 +675,14 @@ RETURN_CODE CEvaluationLogFileHandler::ReadEvaluationLog(){
 
 			// Also check the name...
 			if(curCol == m_col.name){
-				m_specInfo.m_name.Format(szToken);
+				m_specInfo.m_name.Format(_strlwr(szToken));
 				szToken = NULL;
 				continue;
 			}
 
 			// ignore columns whose value cannot be parsed into a float
-			if(1 != sscanf(szToken, "%lf", &fValue)){
+			fValue = strtod(szToken, &endPtr);
+			if(endPtr == szToken){
 				szToken = NULL;
 				continue;
 			}
@@ -543,194 +780,66 @@ RETURN_CODE CEvaluationLogFileHandler::ReadEvaluationLog(){
 				}
 			}
 			szToken = NULL;
-			}
-
-			// start reading the next line in the evaluation log (i.e. the next
-			//  spectrum in the scan). Insert the data from this spectrum into the 
-			//  CScanResult structure
+		}
 
-			// If this is the first spectrum in the new scan, then make
-			//	an initial guess for how large the arrays are going to be...
-			if(measNr == 0 && m_scanNum > 1){
-				// If this is the first spectrum in a new scan, then initialize the 
-				//	size of the arrays, to save some time on re-allocating memory
-				m_scan[sortOrder[m_scanNum]].InitializeArrays(m_scan[m_scanNum-1].GetEvaluatedNum());
-			}
+		// start reading the next line in the evaluation log (i.e. the next
+		//  spectrum in the scan). Insert the data from this spectrum into the 
+		//  CScanResult structure
 
-			m_specInfo.m_scanIndex = measNr;
-			if(Equals(m_specInfo.m_name, "sky")){
-				m_scan[sortOrder[m_scanNum]].SetSkySpecInfo(m_specInfo);
-			}else if(Equals(m_specInfo.m_name, "dark")){
-				m_scan[sortOrder[m_scanNum]].SetDarkSpecInfo(m_specInfo);
-			}else if(Equals(m_specInfo.m_name, "offset")){
-				m_scan[sortOrder[m_scanNum]].SetOffsetSpecInfo(m_specInfo);
-			}else if(Equals(m_specInfo.m_name, "dark_cur")){
-				m_scan[sortOrder[m_scanNum]].SetDarkCurrentSpecInfo(m_specInfo);
-			}else{
-				m_scan[sortOrder[m_scanNum]].AppendResult(m_evResult, m_specInfo);
-				m_scan[sortOrder[m_scanNum]].SetFlux(flux);
-				m_scan[sortOrder[m_scanNum]].SetInstrumentType(m_instrumentType);
-			}
+		// If this is the first spectrum in the new scan, then make
+		//	an initial guess for how large the arrays are going to be...
+		if(measNr == 0 && m_scanNum > 1){
+			// If this is the first spectrum in a new scan, then initialize the 
+			//	size of the arrays, to save some time on re-allocating memory
+			m_scan[m_scanNum].InitializeArrays(m_scan[m_scanNum-1].GetEvaluatedNum());
+		}
 
-			double dynamicRange = 1.0; // <-- unknown
-			if(m_col.peakSaturation != -1){ // If the intensity is specified as a saturation ratio...
-				dynamicRange = CSpectrometerModel::GetMaxIntensity(m_specInfo.m_specModel);
-			}
-			m_scan[sortOrder[m_scanNum]].CheckGoodnessOfFit(m_specInfo);
-			++measNr;
+		m_specInfo.m_scanIndex = measNr;
+		if(Equals(m_specInfo.m_name, "sky")){
+			m_scan[m_scanNum].SetSkySpecInfo(m_specInfo);
+		}else if(Equals(m_specInfo.m_name, "dark")){
+			m_scan[m_scanNum].SetDarkSpecInfo(m_specInfo);
+		}else if(Equals(m_specInfo.m_name, "offset")){
+			m_scan[m_scanNum].SetOffsetSpecInfo(m_specInfo);
+		}else if(Equals(m_specInfo.m_name, "dark_cur")){
+			m_scan[m_scanNum].SetDarkCurrentSpecInfo(m_specInfo);
+		}else{
+			m_scan[m_scanNum].AppendResult(m_evResult, m_specInfo);
+			m_scan[m_scanNum].SetFlux(flux);
+			m_scan[m_scanNum].SetInstrumentType(m_instrumentType);
 		}
 
-		// close the evaluation log
-		fclose(f);
+		double dynamicRange = 1.0; // <-- unknown
+		if(m_col.peakSaturation != -1){ // If the intensity is specified as a saturation ratio...
+			dynamicRange = CSpectrometerModel::GetMaxIntensity(m_specInfo.m_specModel);
+		}
+		m_scan[m_scanNum].CheckGoodnessOfFit(m_specInfo);
+		++measNr;
 	}
-	singleLock.Unlock();
-
 	// If the sky and dark were specified, remove them from the measurement
-	if(m_scanNum >= 0 && fabs(m_scan[sortOrder[m_scanNum]].GetScanAngle(1) - 180.0) < 1){
-		m_scan[sortOrder[m_scanNum]].RemoveResult(0); // remove sky
-		m_scan[sortOrder[m_scanNum]].RemoveResult(0); // remove dark
+	if(m_scanNum >= 0 && fabs(m_scan[m_scanNum].GetScanAngle(1) - 180.0) < 1){
+		m_scan[m_scanNum].RemoveResult(0); // remove sky
+		m_scan[m_scanNum].RemoveResult(0); // remove dark
 	}
 
 	// Calculate the offset
 	if(m_scanNum >= 0){
-		m_scan[sortOrder[m_scanNum]].CalculateOffset(m_evResult.m_ref[0].m_specieName);
+		m_scan[m_scanNum].CalculateOffset(m_evResult.m_ref[0].m_specieName);
 	}
 
 	// make sure that scan num is correct
 	++m_scanNum;
 
-	// Sort the scans in order of collection
-//	SortScans();
-
-	return SUCCESS;
-}
-
-/** Makes a quick scan through the evaluation-log 
-	to count the number of scans in it */
-long CEvaluationLogFileHandler::CountScansInFile(){
-	char  expTimeStr[] = _T("exposuretime"); // this string only exists in the header line.
-	char szLine[8192];
-	long  nScans = 0;
-
-	// If no evaluation log selected, quit
-	if(strlen(m_evaluationLog) <= 1)
-		return 0;
-
-	CSingleLock singleLock(&g_evalLogCritSect);
-	singleLock.Lock();
-	if(singleLock.IsLocked()){
-
-		// Open the evaluation log
-		FILE *f = fopen(m_evaluationLog, "r");
-		if(NULL == f){
-			singleLock.Unlock();
-			return 0;
-		}
-
-		// Read the file, one line at a time
-		while(fgets(szLine, 8192, f)){
-			// convert the string to all lower-case letters
-			for(unsigned int it = 0; it < strlen(szLine); ++it){
-				szLine[it] = tolower(szLine[it]);
-			}
-
-			// find the next start of a scan 
-			if(NULL != strstr(szLine, expTimeStr)){
-				++nScans;
-			}
-		}
-
-		fclose(f);
-		
+	// Each scan ends where the next one begins. The scans are sorted by 
+	//	the start-time of their first spectrum
+	for(size_t k = 0; k < locations.size(); ++k){
+		locations[k].end = (k + 1 < locations.size()) ? locations[k + 1].begin : lines.Position();
+		m_scan[(int)k].GetStartTime(0, locations[k].startTime);
 	}
-	singleLock.Unlock();
-
-	// Return the number of scans found in the file
-	return nScans;
-}
-
-/** Makes a quick scan through the evaluation-log 
-	to get the start-times of each scan.
-	@return the number of scans in the file */
-long CEvaluationLogFileHandler::GetScanStartTimes(CArray<CDateTime*, CDateTime*> &array){
-	char  scanInfoStart[] = _T("<scaninformation>"); // this string indicates the beginning of a 'scanInformation' section
-	char  scanInfoStop[] = _T("</scaninformation>"); // this string indicates the beginning of a 'scanInformation' section
-	char szLine[8192];
-	long  nScans = 0;
-	char *pt = NULL;
-	bool inScanInfoSection = false;
-	CDateTime scanStartTime;
-	int tmpInt[3];
-	bool foundDate = false, foundTime = false;
-
-	// If no evaluation log selected, quit
-	if(strlen(m_evaluationLog) <= 1)
-		return 0;
-
-	CSingleLock singleLock(&g_evalLogCritSect);
-	singleLock.Lock();
-	if(singleLock.IsLocked()){
-
-		// Open the evaluation log
-		FILE *f = fopen(m_evaluationLog, "r");
-		if(NULL == f){
-			singleLock.Unlock();
-			return 0;
-		}
-
-		// Read the file, one line at a time
-		while(fgets(szLine, 8192, f)){
-			// convert the string to all lower-case letters
-			for(unsigned int it = 0; it < strlen(szLine); ++it){
-				szLine[it] = tolower(szLine[it]);
-			}
-
-			// find the next start of a scan 
-			if(NULL != strstr(szLine, scanInfoStart)){
-				inScanInfoSection = true;
-			}
-
-			if(NULL != strstr(szLine, scanInfoStop)){
-				if(foundDate && foundTime){
-					array.SetAtGrow(nScans, new CDateTime(scanStartTime));
-				}
-				inScanInfoSection = false;
-				foundDate = false;
-				foundTime = false;
-				++nScans;
-			}
-			
-			if(inScanInfoSection){
-				if(pt = strstr(szLine, "date=")){
-					if(3 == sscanf(pt+5, "%d.%d.%d", &tmpInt[0], &tmpInt[1], &tmpInt[2])){
-						scanStartTime.day   = tmpInt[0];
-						scanStartTime.month = tmpInt[1];
-						scanStartTime.year  = tmpInt[2];
-						foundDate = true;
-						continue;
-					}
-				}
-				if(pt = strstr(szLine, "starttime=")){
-					if(3 == sscanf(pt+10, "%d:%d:%d", &tmpInt[0], &tmpInt[1], &tmpInt[2])){
-						scanStartTime.hour   = tmpInt[0];
-						scanStartTime.minute = tmpInt[1];
-						scanStartTime.second = tmpInt[2];
-						foundTime = true;
-					}
-					continue;
-				}
-			}
-		}
-		fclose(f);
-	}
-	singleLock.Unlock();
-
-	// Return the number of scans found in the file
-	return nScans;
 }
 
 /** Reads and parses the 'scanInfo' header before the scan */
-void CEvaluationLogFileHandler::ParseScanInformation(CSpectrumInfo &scanInfo, double &flux, FILE *f){
+void CEvaluationLogFileHandler::ParseScanInformation(CSpectrumInfo &scanInfo, double &flux, CLineReader &lines){
 	char szLine[8192];
 	char *pt = NULL;
 	int tmpInt[3];
@@ -741,12 +850,10 @@ void CEvaluationLogFileHandler::ParseScanInformation(CSpectrumInfo &scanInfo, do
 	ResetColumns();
 
 	// read the additional scan-information, line by line
-	while(fgets(szLine, 8192, f)){
+	while(lines.ReadLine(szLine, 8192)){
 
 		// convert to lower-case
-		for(unsigned int it = 0; it < strlen(szLine); ++it){
-			szLine[it] = tolower(szLine[it]);
-		}
+		_strlwr(szLine);
 
 		if(pt = strstr(szLine, "</scaninformation>")){
 			break;
@@ -882,7 +989,7 @@ void CEvaluationLogFileHandler::ParseScanInformation(CSpectrumInfo &scanInfo, do
 	}
 }
 
-void CEvaluationLogFileHandler::ParseFluxInformation(CWindField &windField, double &flux, FILE *f){
+void CEvaluationLogFileHandler::ParseFluxInformation(CWindField &windField, double &flux, CLineReader &lines){
 	char szLine[8192];
 	char *pt = NULL;
 	double windSpeed = 10, windDirection = 0, plumeHeight = 1000;
@@ -892,7 +999,7 @@ void CEvaluationLogFileHandler::ParseFluxInformation(CWindField &windField, doub
 	char source[512];
 
 	// read the additional scan-information, line by line
-	while(fgets(szLine, 8192, f)){
+	while(lines.ReadLine(szLine, 8192)){
 		if(pt = strstr(szLine, "</fluxinfo>")){
 			// save all the values
 			windField.SetPlumeHeight(plumeHeight, plumeHeightSource);
@@ -1015,89 +1122,137 @@ bool	CEvaluationLogFileHandler::IsWindSpeedMeasurement_Heidelberg(int scanNo){
 }
 
 /** Sorts the scans in order of collection */
-void CEvaluationLogFileHandler::SortScans(){
-
-	// make sure that the array is just big enough...
-	m_scan.SetSize(m_scanNum);
+void CEvaluationLogFileHandler::SortScans(std::vector<ScanLocation> &locations){
+	std::vector<long> order(m_scanNum);
 
 	// If the scans are already in order then we don't need to sort them
 	//	or if there is only one scan then we don't need to fix it.
-	if(IsSorted() || m_scanNum <= 1){
+	if(IsSorted(locations) || m_scanNum <= 1){
 		return;
 	}
 
-	// Then sort the array
-	//	CEvaluationLogFileHandler::SortScans(m_scan);
-	CEvaluationLogFileHandler::BubbleSortScans(m_scan);
+	// Find the order of the scans, scans which started at the same time keep their order in the file
+	for(long k = 0; k < m_scanNum; ++k)
+		order[k] = k;
+	std::stable_sort(order.begin(), order.end(), [&locations](long a, long b){
+		return 0 != (locations[a].startTime < locations[b].startTime);
+	});
+
+	// Move the scans into place, following each cycle of the permutation 
+	//	so that every scan is copied only once
+	std::vector<bool> done(m_scanNum, false);
+	for(long k = 0; k < m_scanNum; ++k){
+		if(done[k] || order[k] == k)
+			continue;
 
-	return;
+		Evaluation::CScanResult scan = m_scan[k];
+		CWindField windField         = m_windField[k];
+		ScanLocation location        = locations[k];
+		long current = k;
+		while(order[current] != k){
+			long next = order[current];
+			m_scan[current]      = m_scan[next];
+			m_windField[current] = m_windField[next];
+			locations[current]   = locations[next];
+			done[current] = true;
+			current = next;
+		}
+		m_scan[current]      = scan;
+		m_windField[current] = windField;
+		locations[current]   = location;
+		done[current] = true;
+	}
 }
 
 /** Returns true if the scans are already ordered */
-bool	CEvaluationLogFileHandler::IsSorted(){
-	CDateTime time1, time2;
-
-	for(int k = 0; k < m_scanNum - 1; ++k){
-		// Get the start-times
-		m_scan[k].GetStartTime(0,		time1);
-		m_scan[k+1].GetStartTime(0, time2);
-
+bool	CEvaluationLogFileHandler::IsSorted(const std::vector<ScanLocation> &locations){
+	for(size_t k = 1; k < locations.size(); ++k){
 		// If the second scan has started before the first, 
-		//	then change the order, otherwise don't do anything
-		if(time2 < time1){
+		//	then the scans are not in order
+		if(locations[k].startTime < locations[k-1].startTime){
 			return false;
-		}else{
-			continue;
 		}
 	}
 
 	return true; // no un-ordered scans were found
 }
 
-/** Sorts the CDateTime-objects in the given array.
-		Algorithm based on bubble sort (~O(N2)) */
-void CEvaluationLogFileHandler::SortScanStartTimes(CArray<CDateTime*, CDateTime*> &allStartTimes, CArray<unsigned int, unsigned int&> &sortOrder){
-	bool change;
-	unsigned int k, tmpIndex;
-	unsigned int nElements = allStartTimes.GetSize();
-	CDateTime *tmpTime = NULL;
-	CArray<unsigned int, unsigned int&> tmpOrder;
-	
-	if(nElements == 0)
-		return;
+/** Writes the index-file of the evaluation log */
+RETURN_CODE CEvaluationLogFileHandler::WriteIndexFile(const std::vector<ScanLocation> &locations, __int64 fileSize, __time64_t creationTime, __time64_t modificationTime) const{
+	long scanNum = (long)locations.size();
 
-	// fill up the sort-order array with the original indices
-	for(k = 0; k < nElements; ++k)
-		tmpOrder.SetAtGrow(k, k);
+	FILE *f = fopen(GetIndexFileName(m_evaluationLog), "wb");
+	if(f == NULL)
+		return FAIL;
 
-	// Sort the start-times using bubble sort
-	do{
-		change = false;
-		for(k = 0; k < nElements - 1; ++k){
-			// If the second scan has started before the first, 
-			//	then change the order, otherwise don't do anything
-			if(*allStartTimes[k+1] < *allStartTimes[k]){
-				tmpTime = allStartTimes[k];
-				tmpIndex = tmpOrder[k];
+	fwrite(INDEX_IDENT, sizeof(INDEX_IDENT), 1, f);
+	fwrite(&fileSize, sizeof(fileSize), 1, f);
+	fwrite(&creationTime, sizeof(creationTime), 1, f);
+	fwrite(&modificationTime, sizeof(modificationTime), 1, f);
+	fwrite(&scanNum, sizeof(scanNum), 1, f);
+	for(long k = 0; k < scanNum; ++k){
+		const CDateTime &t = locations[k].startTime;
+		short startTime[6] = {(short)t.year, (short)t.month, (short)t.day, (short)t.hour, (short)t.minute, (short)t.second};
+
+		fwrite(&locations[k].begin, sizeof(__int64), 1, f);
+		fwrite(&locations[k].end, sizeof(__int64), 1, f);
+		fwrite(&locations[k].info, sizeof(__int64), 1, f);
+		fwrite(startTime, sizeof(startTime), 1, f);
+	}
+	fclose(f);
 
-				allStartTimes[k] = allStartTimes[k+1];
-				tmpOrder[k] = tmpOrder[k+1];
+	return SUCCESS;
+}
 
-				allStartTimes[k+1] = tmpTime;
-				tmpOrder[k+1] = tmpIndex;
+/** Reads the index-file of the evaluation log */
+RETURN_CODE CEvaluationLogFileHandler::ReadIndexFile(std::vector<ScanLocation> &locations, __int64 fileSize, __time64_t creationTime, __time64_t modificationTime) const{
+	char ident[sizeof(INDEX_IDENT)];
+	__int64 size;
+	__time64_t ctime, mtime;
+	long scanNum;
 
-				change		= true;
-			}else{
-				continue;
-			}
+	locations.clear();
+
+	FILE *f = fopen(GetIndexFileName(m_evaluationLog), "rb");
+	if(f == NULL)
+		return FAIL;
+
+	// The index must have been made from this version of the evaluation log
+	if(1 != fread(ident, sizeof(ident), 1, f) || 0 != memcmp(ident, INDEX_IDENT, sizeof(INDEX_IDENT)) ||
+		1 != fread(&size, sizeof(size), 1, f) || size != fileSize ||
+		1 != fread(&ctime, sizeof(ctime), 1, f) || ctime != creationTime ||
+		1 != fread(&mtime, sizeof(mtime), 1, f) || mtime != modificationTime ||
+		1 != fread(&scanNum, sizeof(scanNum), 1, f) || scanNum < 0){
+		fclose(f);
+		return FAIL;
+	}
+
+	locations.resize(scanNum);
+	for(long k = 0; k < scanNum; ++k){
+		ScanLocation &location = locations[k];
+		short startTime[6];
+
+		if(1 != fread(&location.begin, sizeof(__int64), 1, f) ||
+			1 != fread(&location.end, sizeof(__int64), 1, f) ||
+			1 != fread(&location.info, sizeof(__int64), 1, f) ||
+			1 != fread(startTime, sizeof(startTime), 1, f) ||
+			location.begin < 0 || location.end < location.begin || location.end > fileSize || location.info >= fileSize){
+			fclose(f);
+			locations.clear();
+			return FAIL;
 		}
-	}while(change);
-	
-	// create the array sortOrder
-	for(k = 0; k < nElements; ++k)
-		sortOrder.SetAtGrow(tmpOrder[k], k);
-	
-	return;
+		location.startTime = CDateTime(startTime[0], startTime[1], startTime[2], startTime[3], startTime[4], startTime[5]);
+	}
+	fclose(f);
+
+	return SUCCESS;
+}
+
+/** Returns the name of the index-file of the given evaluation log */
+CString CEvaluationLogFileHandler::GetIndexFileName(const CString &evaluationLog){
+	CString indexFile;
+	indexFile.Format("%s.idx", (LPCSTR)evaluationLog);
+	return indexFile;
 }
 
 
@@ -1319,167 +1474,37 @@ RETURN_CODE CEvaluationLogFileHandler::FormatEvaluationResult(const CSpectrumInf
 	return SUCCESS;
 }
 
-/** Sorts the CDateTime-objects in the given array.
-		Algorithm based on MergeSort (~O(NlogN)) */
+/** Sorts the CScanResult-objects in the given array, by their start-times.
+		Scans which started at the same time keep their order. */
 void FileHandler::CEvaluationLogFileHandler::SortScans(CArray<Evaluation::CScanResult, Evaluation::CScanResult&> &array, bool ascending){
-	unsigned long nElements = (unsigned long)array.GetSize(); // number of elements
-	unsigned long it				= 0; // <-- iterator
-	unsigned long halfSize	= nElements / 2;
-
-	if(nElements <= 1){
+	long nElements = (long)array.GetSize();
+	if(nElements <= 1)
 		return; // <-- We're actually already done
-	}else if(nElements <= 7){
-		// For small lists, its much faster to do a bubble sorting of the 
-		//	list since this does not require so much copying back and forth
-		BubbleSortScans(array, ascending);
-		return;
-	}else{
-		CArray <Evaluation::CScanResult, Evaluation::CScanResult&> left;
-		CArray <Evaluation::CScanResult, Evaluation::CScanResult&> right;
-		left.SetSize(halfSize);
-		right.SetSize(halfSize);
-
-		// Make two copies of the array, one of the first half and one of the second half
-		while(it < halfSize){
-			left.SetAtGrow(it, array.GetAt(it));
-			++it;
-		}
-		while(it < nElements){
-			right.SetAtGrow(it - halfSize, array.GetAt(it));
-			++it;
-		}
-
-		// Sort each of the two halves
-		SortScans(left,  ascending);
-		SortScans(right, ascending);
-
-		// Merge the two...
-		MergeArrays(left, right, array, ascending);
-	}
-}
-
-/** Merges the two arrays in a sorted way and stores the
-		result in the output-array 'result' */
-void FileHandler::CEvaluationLogFileHandler::MergeArrays(CArray<Evaluation::CScanResult, Evaluation::CScanResult&> &array1, CArray<Evaluation::CScanResult, Evaluation::CScanResult&> &array2, CArray<Evaluation::CScanResult, Evaluation::CScanResult&> &result, bool ascending){
-	CDateTime	time1, time2;
-	unsigned long it1 = 0; // iterator for array1
-	unsigned long it2 = 0; // iterator for array2
-	unsigned long itr = 0; // iterator for result
-	unsigned long nE1	= (unsigned long)array1.GetSize();
-	unsigned long nE2	= (unsigned long)array2.GetSize();
-
-	// Clear the output-array
-	result.RemoveAll();
-	result.SetSize(nE1 + nE2); // we can just as well set the size of the array from the start
-
-	// 1. As long as there are elements in both arrays, do this
-	while(it1 < nE1 && it2 < nE2){
-		// Get the times of the first and the second
-		array1.GetAt(it1).GetStartTime(0, time1);
-		array2.GetAt(it2).GetStartTime(0, time2);
-
-			// Compare the two start-times
-		if(time1 == time2){
-			// if equal
-			result.SetAt(itr++, array1.GetAt(it1++));
-			continue;
-		}else if(time1 < time2){
-			// time1 < time2
-			if(ascending){
-				result.SetAt(itr++, array1.GetAt(it1++));
-				continue;
-			}else{
-				result.SetAt(itr++, array2.GetAt(it2++));
-				continue;
-			}
-		}else{
-			// time1 > time2
-			if(ascending){
-				result.SetAt(itr++, array2.GetAt(it2++));
-				continue;
-			}else{
-				result.SetAt(itr++, array1.GetAt(it1++));
-				continue;
-			}
-		}
-	}
-
-	// 2. If we're out of elements in array2 but not in array1, do this
-	while(it1 < nE1){
-		result.SetAt(itr++, array1.GetAt(it1++));
-	}
-
-	// 3. If we're out of elements in array1 but not in array2, do this
-	while(it2 < nE2){
-		result.SetAt(itr++, array2.GetAt(it2++));
-	}
-}
-
-/** Sorts the CScanResult-objects in the given array.
-		Algorithm based on BubbleSort (~O(N2))
-		Quite efficient for small arrays since the elements does not have to be copied
-			and thus uses very little memory */
-void FileHandler::CEvaluationLogFileHandler::BubbleSortScans(CArray<Evaluation::CScanResult, Evaluation::CScanResult&> &array, bool ascending){
-	CDateTime time1, time2;
-	bool change;
-	unsigned long nElements = (unsigned long)array.GetSize(); // number of elements
-	unsigned int k;
-	CDateTime tmpTime;
-	int tmpIndex;
-	CArray<Evaluation::CScanResult, Evaluation::CScanResult&> copiedArray;
 
 	// 1. Find the start-time of all the scans
-	CDateTime *allStartTimes = new CDateTime[nElements];
-	unsigned int *sortOrder = new unsigned int[nElements];
-	for(k = 0; k < nElements; ++k){
-		array[k].GetStartTime(0, allStartTimes[k]);
-		sortOrder[k] = k;
+	std::vector<CDateTime> startTime(nElements);
+	std::vector<long> order(nElements);
+	for(long k = 0; k < nElements; ++k){
+		array[k].GetStartTime(0, startTime[k]);
+		order[k] = k;
 	}
 
-	// 2. Sort the start-times using bubble sort
-	do{
-		change = false;
-		for(k = 0; k < nElements - 1; ++k){
-			// If the second scan has started before the first, 
-			//	then change the order, otherwise don't do anything
-			if(allStartTimes[k+1] < allStartTimes[k]){
-				tmpTime = allStartTimes[k];
-				tmpIndex = sortOrder[k];
-
-				allStartTimes[k] = allStartTimes[k+1];
-				sortOrder[k] = sortOrder[k+1];
-
-				allStartTimes[k+1] = tmpTime;
-				sortOrder[k+1] = tmpIndex;
+	// 2. Sort the indices of the scans by their start-times
+	std::stable_sort(order.begin(), order.end(), [&startTime, ascending](long a, long b){
+		return 0 != (ascending ? (startTime[a] < startTime[b]) : (startTime[b] < startTime[a]));
+	});
 
-				change		= true;
-			}else{
-				continue;
-			}
-		}
-	}while(change);
-	
-	// 3. Sort the array using the indices found in 'sortOrder'
-	
-	// 3a. Copy all items to a backup-list
+	// 3. Sort the array using the indices found in 'order'
+	CArray<Evaluation::CScanResult, Evaluation::CScanResult&> copiedArray;
 	copiedArray.SetSize(nElements);
-	for(k = 0; k < nElements; ++k){
-		if(sortOrder[k] != k){
+	for(long k = 0; k < nElements; ++k){
+		if(order[k] != k){
 			copiedArray[k] = array[k];
 		}
 	}
-	
-	// 3b. Put the items back in the correct order
-	for(k = 0; k < nElements; ++k){
-		if(sortOrder[k] != k){
-			array[k] = copiedArray[sortOrder[k]];
+	for(long k = 0; k < nElements; ++k){
+		if(order[k] != k){
+			array[k] = copiedArray[order[k]];
 		}
 	}
-
-	// 4. Clean up!
-	copiedArray.RemoveAll();
-	delete [] allStartTimes;
-	delete [] sortOrder;
-
-	return;
-}
\ No newline at end of file
+}
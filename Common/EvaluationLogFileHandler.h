@@ -4,6 +4,8 @@
 #include "../Evaluation/ScanResult.h"
 #include "../Evaluation/EvaluationResult.h"
 
+#include <vector>
+
 namespace FileHandler
 {
 
@@ -21,9 +23,27 @@ namespace FileHandler
 
 		// ------------------- PUBLIC METHODS -------------------------
 
-		/** Reads the evaluation log */
+		/** Reads the evaluation log. The scans are sorted in order of collection.
+			The evaluation log is read in one pass, and the position of every scan in 
+			the file is saved to an index-file next to the evaluation log. */
 		RETURN_CODE ReadEvaluationLog();
 
+		/** Reads only the scan number 'scanIndex' (counted in order of collection)
+			from the evaluation log. On return, the scan is stored in m_scan[0].
+			If there is an index-file for the current version of the evaluation log
+			then only the part of the file which contains the scan is parsed, 
+			otherwise the whole file is read. */
+		RETURN_CODE ReadEvaluationLog(long scanIndex);
+
+		/** Reads the scans from the binary log of the evaluation log (see CBinaryEvaluationLog),
+			without parsing the text. This only succeeds if the binary log contains 
+			every scan in the evaluation log, i.e. if binary logs were written already 
+			when the evaluation log was started. The scans are sorted in order of collection.
+			The binary log holds no wind-fields and no sky- or dark-spectra, the 
+			wind-fields are left at their default values.
+			@return SUCCESS if all the scans could be read from the binary log */
+		RETURN_CODE ReadBinaryEvaluationLog();
+
 		/** Writes the contents of the array 'm_scan' to a new evaluation-log file */
 		RETURN_CODE WriteEvaluationLog(const CString fileName);
 
@@ -67,8 +87,45 @@ namespace FileHandler
 
 		/** The additional spectrum information of one spectrum. */
 		CSpectrumInfo m_specInfo;
+
+		/** If true then the position of every scan in the evaluation logs is 
+			saved to, and read from, index-files next to the evaluation logs. 
+			Default is false, set from the configuration at start-up. */
+		static bool s_useIndexFiles;
+
+		/** Returns the name of the index-file of the given evaluation log */
+		static CString GetIndexFileName(const CString &evaluationLog);
+
 	protected:
 
+		/** <b>CLineReader</b> reads the lines of an evaluation log which 
+			has been mapped into memory, between the positions 'begin' and 'end'. */
+		class CLineReader{
+		public:
+			CLineReader(const char *data, __int64 begin, __int64 end);
+
+			/** Copies the next line, including the newline character, to 'szLine'.
+				Lines longer than 'maxLength - 1' characters are split, as with fgets.
+				@return false if there are no more lines to read */
+			bool ReadLine(char *szLine, int maxLength);
+
+			/** The position of the next line to read */
+			__int64 Position() const { return m_pos; }
+
+		private:
+			const char *m_data;
+			__int64 m_pos;
+			__int64 m_end;
+		};
+
+		/** The position of one scan in the evaluation log */
+		typedef struct ScanLocation{
+			__int64 begin;			// the first byte of the scan, including its scan- and flux-information sections
+			__int64 end;			// the first byte after the scan
+			__int64 info;			// the beginning of the last scan-information section before the scan, -1 if none
+			CDateTime startTime;	// the start-time of the scan
+		}ScanLocation;
+
 		typedef struct LogColumns{
 			int column[MAX_N_REFERENCES];
 			int columnError[MAX_N_REFERENCES];
@@ -103,11 +160,16 @@ namespace FileHandler
 			column represents which value. */
 		void ParseScanHeader(const char szLine[8192]);
 
+		/** Parses the scans in the lines read by 'lines' and stores them in the
+			array 'm_scan', in the order in which they appear in the file. 
+			The position of each scan is returned in 'locations'. */
+		void ParseScans(CLineReader &lines, std::vector<ScanLocation> &locations);
+
 		/** Reads and parses the XML-shaped 'scanInfo' header before the scan */
-		void ParseScanInformation(CSpectrumInfo &scanInfo, double &flux, FILE *f);
+		void ParseScanInformation(CSpectrumInfo &scanInfo, double &flux, CLineReader &lines);
 
 		/** Reads and parses the XML-shaped 'fluxInfo' header before the scan */
-		void ParseFluxInformation(CWindField &windField, double &flux, FILE *f);
+		void ParseFluxInformation(CWindField &windField, double &flux, CLineReader &lines);
 
 		/** Resets the information about which column data is stored in */
 		void ResetColumns();
@@ -115,37 +177,24 @@ namespace FileHandler
 		/** Resets the old scan information */
 		void ResetScanInformation();
 
-		/** Makes a quick scan through the evaluation-log 
-			to count the number of scans in it */
-		long CountScansInFile();
-
-		/** Makes a quick scan through the evaluation-log 
-			to get the start-times of each scan.
-			@return the number of scans in the file */
-		long GetScanStartTimes(CArray<CDateTime*, CDateTime*> &array);
-
-		/** Sorts the scans in order of collection */
-		void SortScans();
+		/** Sorts the scans in 'm_scan', and their wind fields and locations, 
+				in order of collection. (~O(NlogN)) */
+		void SortScans(std::vector<ScanLocation> &locations);
 
 		/** Returns true if the scans are already ordered */
-		bool IsSorted();
-
-		/** Sorts the CDateTime-objects in the given array.
-				Algorithm based on bubble sort (~O(NlogN)) */
-		void SortScanStartTimes(CArray<CDateTime*, CDateTime*> &array, CArray<unsigned int, unsigned int&> &sortOrder);
+		bool IsSorted(const std::vector<ScanLocation> &locations);
 
 		/** Sorts the CScanResult-objects in the given array.
-				Algorithm based on MergeSort (~O(NlogN)) */
+				Algorithm based on std::stable_sort (~O(NlogN)) */
 		static void SortScans(CArray<Evaluation::CScanResult, Evaluation::CScanResult&> &array, bool ascending = true);
 
-		/** Sorts the CScanResult-objects in the given array.
-				Algorithm based on BubbleSort (~O(N2))
-				Quite efficient for small arrays since the elements does not have to be copied
-					and thus uses very little memory */
-		static void BubbleSortScans(CArray<Evaluation::CScanResult, Evaluation::CScanResult&> &array, bool ascending = true);
-
-		/** Merges the two arrays in a sorted way and stores the
-				result in the output-array 'result' */
-		static void MergeArrays(CArray<Evaluation::CScanResult, Evaluation::CScanResult&> &array1, CArray<Evaluation::CScanResult, Evaluation::CScanResult&> &array2, CArray<Evaluation::CScanResult, Evaluation::CScanResult&> &result, bool ascending = true);
+		/** Saves the locations of the scans to the index-file of the evaluation log,
+			together with the size and time stamps of the evaluation log. */
+		RETURN_CODE WriteIndexFile(const std::vector<ScanLocation> &locations, __int64 fileSize, __time64_t creationTime, __time64_t modificationTime) const;
+
+		/** Reads the locations of the scans from the index-file of the evaluation log.
+			@return FAIL if there is no index-file or if it was not made from the 
+				evaluation log with the given size and time stamps */
+		RETURN_CODE ReadIndexFile(std::vector<ScanLocation> &locations, __int64 fileSize, __time64_t creationTime, __time64_t modificationTime) const;
 	};
 }
\ No newline at end of file
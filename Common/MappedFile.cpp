@@ -0,0 +1,56 @@
+#include "StdAfx.h"
+#include "MappedFile.h"
+
+using namespace FileHandler;
+
+CMappedFile::CMappedFile(void)
+	: m_file(INVALID_HANDLE_VALUE), m_mapping(NULL), m_data(NULL), m_size(0)
+{
+}
+
+CMappedFile::~CMappedFile(void)
+{
+	Close();
+}
+
+RETURN_CODE CMappedFile::Open(const CString &fileName){
+	LARGE_INTEGER size;
+
+	Close();
+
+	m_file = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(m_file == INVALID_HANDLE_VALUE)
+		return FAIL;
+	if(!GetFileSizeEx(m_file, &size)){
+		Close();
+		return FAIL;
+	}
+	m_size = size.QuadPart;
+	if(m_size == 0)
+		return SUCCESS; // an empty file cannot be mapped, but there is nothing to read either
+
+	m_mapping = CreateFileMapping(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(m_mapping == NULL){
+		Close();
+		return FAIL;
+	}
+	m_data = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if(m_data == NULL){
+		Close();
+		return FAIL;
+	}
+	return SUCCESS;
+}
+
+void CMappedFile::Close(){
+	if(m_data != NULL)
+		UnmapViewOfFile(m_data);
+	if(m_mapping != NULL)
+		CloseHandle(m_mapping);
+	if(m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+	m_data = NULL;
+	m_size = 0;
+}
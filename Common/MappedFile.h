@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Common.h"
+
+namespace FileHandler
+{
+	/** <b>CMappedFile</b> maps a whole file into memory, for reading. 
+		The file is opened with shared read- and write-access, so that files 
+		which are being appended to by other threads can still be read. */
+	class CMappedFile
+	{
+	public:
+		CMappedFile(void);
+		~CMappedFile(void);
+
+		/** Opens and maps the given file.
+			@return SUCCESS if the file could be mapped */
+		RETURN_CODE Open(const CString &fileName);
+
+		/** Unmaps and closes the file */
+		void Close();
+
+		/** The contents of the file, NULL if the file is empty */
+		const char *Data() const { return m_data; }
+
+		/** The size of the file [bytes] */
+		__int64 Size() const { return m_size; }
+
+	private:
+		HANDLE m_file;
+		HANDLE m_mapping;
+		const char *m_data;
+		__int64 m_size;
+
+		// not copyable
+		CMappedFile(const CMappedFile &);
+		CMappedFile &operator=(const CMappedFile &);
+	};
+}
@@ -17,12 +17,17 @@ extern CConfigurationSetting g_settings; // <-- The settings
 CPakFileHandler::CPakFileHandler(void)
 {
 	m_tempIndex = 0;
+	for(int k = 0; k < MAX_CHANNEL_NUM; ++k)
+		m_scanFileHandle[k] = NULL;
 	m_initializedOutput = false;
 	m_serialNumbers.SetSize(3); // make room for 3 spectrometers
 }
 
 CPakFileHandler::~CPakFileHandler(void)
 {
+	for(int k = 0; k < MAX_CHANNEL_NUM; ++k)
+		CloseScanFile(k);
+
 	int N = m_serialNumbers.GetSize();
 	for(int k = 0; k < N; ++k){
 		CString *str = m_serialNumbers.GetAt(k);
@@ -90,12 +95,8 @@ int CPakFileHandler::FindFirstScanStart(const CString &fileName, const CString &
 		spectrum 'curSpec' will be the next first spectrum of a scan. 
 		If there is no more scan-start spectrum in the file, this function will
 		return FAIL. */
-RETURN_CODE CPakFileHandler::FindNextScanStart(FILE *pakFile, CSpectrum &curSpec){ 
-	SpectrumIO::CSpectrumIO reader;
-	SpectrumIO::CSpectrumIO writer;
+RETURN_CODE CPakFileHandler::FindNextScanStart(FILE *pakFile, SpectrumIO::CSpectrumIO &reader, CSpectrum &curSpec, char *spectrumHeader, int &specHeaderSize){ 
 	CString incompleteFileName, serialNumber, message;
-	char *spectrumHeader = (char*)calloc(HEADER_BUF_SIZE, sizeof(char)); // <-- the spectrum header, in binary format
-	int specHeaderSize = 0;
 	int originalSpectrumNumber = m_spectrumNumber;
 
 	// Get the serial-number of the spectrometer
@@ -108,18 +109,21 @@ RETURN_CODE CPakFileHandler::FindNextScanStart(FILE *pakFile, CSpectrum &curSpec
 	// Save this spectrum in a file in the 'incomplete' - folder
 	CSpectrumTime *starttid = &curSpec.m_info.m_startTime;
 	incompleteFileName.Format("%s\\%s_%02d.%02d.%02d.pak", m_incompleteDir, serialNumber, starttid->hr, starttid->m, starttid->sec);
+	FILE *incompleteFile = fopen(incompleteFileName, "ab");
 
 	// Continue reading spectra until we find one which has scan-index = 0
 	while(scanIndex > 0){
 		// write the spectrum to an incomplete-file and store it...
-		writer.AddSpectrumToFile(incompleteFileName, curSpec, spectrumHeader, specHeaderSize);
+		if(incompleteFile != NULL)
+			WriteSpectrum(incompleteFile, reader, curSpec, spectrumHeader, specHeaderSize);
 
 		// Read the next spectrum from the file and see if this is the beginning
 		//	of a scan...
 		RETURN_CODE ret = reader.ReadNextSpectrum(pakFile, curSpec, specHeaderSize, spectrumHeader, HEADER_BUF_SIZE);
 		if(ret == FAIL){
 			if(SUCCESS != HandleCorruptSpectrum(reader, pakFile)){
-				free(spectrumHeader);
+				if(incompleteFile != NULL)
+					fclose(incompleteFile);
 				return FAIL;
 			}
 		}else{
@@ -129,6 +133,10 @@ RETURN_CODE CPakFileHandler::FindNextScanStart(FILE *pakFile, CSpectrum &curSpec
 		// Get the spectrums position in the scan
 		scanIndex = curSpec.ScanIndex();
 	}
+	if(incompleteFile != NULL){
+		fclose(incompleteFile);
+		SpectrumIO::CPakFileIndex::Invalidate(incompleteFileName);
+	}
 
 	// Tell the user what just happened
 	int nSkipped = m_spectrumNumber - originalSpectrumNumber;
@@ -143,11 +151,47 @@ RETURN_CODE CPakFileHandler::FindNextScanStart(FILE *pakFile, CSpectrum &curSpec
 
 	ShowMessage(message);
 
-	free(spectrumHeader);
-
 	return SUCCESS;
 }
 
+/** Returns the scan-file of the given channel, opened for appending spectra */
+FILE *CPakFileHandler::OpenScanFile(int channel){
+	if(m_scanFileHandle[channel] == NULL){
+		m_scanFileHandle[channel] = fopen(m_scanFile[channel], "ab");
+		if(m_scanFileHandle[channel] != NULL)
+			setvbuf(m_scanFileHandle[channel], NULL, _IOFBF, SCAN_FILE_BUFFER_SIZE);
+	}
+	return m_scanFileHandle[channel];
+}
+
+/** Closes the scan-file of the given channel, if it is opened */
+void CPakFileHandler::CloseScanFile(int channel){
+	if(m_scanFileHandle[channel] != NULL){
+		fclose(m_scanFileHandle[channel]);
+		m_scanFileHandle[channel] = NULL;
+
+		// the file has changed, any index built for it is no longer valid
+		SpectrumIO::CPakFileIndex::Invalidate(m_scanFile[channel]);
+	}
+}
+
+/** Writes the spectrum 'spec', which was last read by 'reader', to the opened file 'f' */
+RETURN_CODE CPakFileHandler::WriteSpectrum(FILE *f, SpectrumIO::CSpectrumIO &reader, const CSpectrum &spec, const char *spectrumHeader, int specHeaderSize){
+	// If the spectrum was read correctly, copy it without compressing it again
+	if(specHeaderSize < HEADER_BUF_SIZE && SUCCESS == reader.CopyLastSpectrum(f, spectrumHeader, specHeaderSize))
+		return SUCCESS;
+
+	// ...otherwise write what we could read of it
+	int ret;
+	if(specHeaderSize > 0){
+		ret = reader.AddSpectrumToFile(f, spec, spectrumHeader, specHeaderSize);
+	}else{
+		ret = reader.AddSpectrumToFile(f, spec);
+	}
+
+	return (ret == 0) ? SUCCESS : FAIL;
+}
+
 /** Sends a message to the evaluation thread that this scan-file should
 		be evaluated. The file will first be moved to a temporary file
 		so that nothing */
@@ -199,6 +243,7 @@ int CPakFileHandler::ReadDownloadedFile(const CString &fileName, bool deletePakF
 	SpectrumIO::CSpectrumIO reader;
 	SpectrumIO::CSpectrumIO writer;
 	reader.m_logFileWriter = NULL; // nowhere to output the error messages
+	clock_t cStart = clock();
 	CSpectrum curSpec;
 	CSpectrum *mSpec[MAX_CHANNEL_NUM]; // <-- An array of spectra, needed if an multichannel spectrum is coming in.
 	CString lostFile[MAX_CHANNEL_NUM]; // <-- Where to move the lost spectra
@@ -210,12 +255,15 @@ int CPakFileHandler::ReadDownloadedFile(const CString &fileName, bool deletePakF
 	unsigned char channel;
 	int nEvaluatedScans = 0;
 	bool isMultiChannelSpec = false;
+	long bytesRead = 0;
 
 	char *spectrumHeader = (char*)calloc(HEADER_BUF_SIZE, sizeof(char)); // <-- the spectrum header, in binary format
 	int specHeaderSize = 0;
 
 	// 0. Reset 
 	m_spectrumNumber = 0;
+	for(i = 0; i < MAX_CHANNEL_NUM; ++i)
+		CloseScanFile(i);
 
 	// 1. Test the file, make sure that it exists and that we can read it 
 	if(!IsExistingFile(fileName)){
@@ -331,6 +379,7 @@ int CPakFileHandler::ReadDownloadedFile(const CString &fileName, bool deletePakF
 				//			than the scan-index of the spectrum before, then we've probably
 				//			started on a scan.
 				if((numSpecRead[k] > 0 && scanIndex == 0) || scanIndex < old_scanIndex[k]){
+					CloseScanFile(k);
 					if(evaluate)
 						EvaluateScan(m_scanFile[k], serialNumber);
 					else
@@ -341,22 +390,23 @@ int CPakFileHandler::ReadDownloadedFile(const CString &fileName, bool deletePakF
 					// This should be the beginning of a scan, if not so then
 					//	loop forwards until we find one sky-spectrum
 					if(scanIndex > 0){
-						if(SUCCESS != FindNextScanStart(pakFile, curSpec)) // <-- this changes the 'm_spectrumNumber' - variable
+						if(SUCCESS != FindNextScanStart(pakFile, reader, curSpec, spectrumHeader, specHeaderSize)) // <-- this changes the 'm_spectrumNumber' - variable
 							break;
 						else
 							scanIndex = 0;
 					}
 				}
 
-				// 6d3. Add the spectrum to the scan-file
-				if(isMultiChannelSpec){
-					writer.AddSpectrumToFile(m_scanFile[k], *mSpec[k]);
+				// 6d3. Add the spectrum to the scan-file. Only the multichannel spectra
+				//			need to be compressed again, the others are copied as they are.
+				FILE *scanFile = OpenScanFile(k);
+				if(scanFile == NULL){
+					message.Format("CPakFileHandler: Could not open scan-file %s", m_scanFile[k]);
+					ShowMessage(message);
+				}else if(isMultiChannelSpec){
+					writer.AddSpectrumToFile(scanFile, *mSpec[k]);
 				}else{
-					if(specHeaderSize > 0){
-						writer.AddSpectrumToFile(m_scanFile[k], curSpec, spectrumHeader, specHeaderSize);
-					}else{
-						writer.AddSpectrumToFile(m_scanFile[k], curSpec);
-					}
+					WriteSpectrum(scanFile, reader, curSpec, spectrumHeader, specHeaderSize);
 				}
 
 				// 6d4. If this measurement represents a 'new' measurement-line
@@ -371,9 +421,14 @@ int CPakFileHandler::ReadDownloadedFile(const CString &fileName, bool deletePakF
 			}
 		}
 
+		bytesRead = ftell(pakFile);
 		fclose(pakFile);
 	}//endif
 
+	// The scan-files are complete, close them before they are moved
+	for(i = 0; i < MAX_CHANNEL_NUM; ++i)
+		CloseScanFile(i);
+
 	// 7. If we've read equally many spectra as measurement-lines in the 
 	//		cfg.txt-file, then assume that this is a full scan
 	if(isMultiChannelSpec){
@@ -460,7 +515,15 @@ int CPakFileHandler::ReadDownloadedFile(const CString &fileName, bool deletePakF
 		delete(mSpec[i]);
 	free(spectrumHeader);
 
-	// 11. Before returning, delete the file
+	// 11. Tell the user how fast the file was split
+	double elapsed = (double)(clock() - cStart) / (double)CLOCKS_PER_SEC;
+	double megaBytes = (double)bytesRead / 1048576.0;
+	if(elapsed > 0){
+		message.Format("Split %d spectra (%.1lf MB) into %d scans in %.2lf seconds (%.1lf MB/s)", m_spectrumNumber, megaBytes, nEvaluatedScans, elapsed, megaBytes / elapsed);
+		ShowMessage(message);
+	}
+
+	// 12. Before returning, delete the file
 	if(deletePakFile)
 		if(0 == DeleteFile(fileName))
 			return 1;
@@ -496,15 +559,26 @@ int CPakFileHandler::GetSpectrometerIndex(const CString &serialNumber){
 /** This function checks the contents of the .pak-file 'fileName' 
 		and returns the type of measurement which is inside the file */
 MEASUREMENT_MODE CPakFileHandler::GetMeasurementMode(const CString &fileName){
-	if(CPakFileHandler::IsStratosphericMeasurement(fileName)){
+	CScanFileHandler scan;
+
+	// Read the file once, the classification is then made on the spectra in memory.
+	//	If not the whole file can be read, then the classification uses the spectra 
+	//	which could be read (and a file which cannot be read at all is a flux-measurement).
+	scan.LoadScanFile(&fileName);
+
+	return GetMeasurementMode(scan);
+}
+
+MEASUREMENT_MODE CPakFileHandler::GetMeasurementMode(const CScanFileHandler &scan){
+	if(CPakFileHandler::IsStratosphericMeasurement(scan)){
 		return MODE_STRATOSPHERE;
-	}else if(CPakFileHandler::IsDirectSunMeasurement(fileName)){
+	}else if(CPakFileHandler::IsDirectSunMeasurement(scan)){
 		return MODE_DIRECT_SUN;
-	}else if(CPakFileHandler::IsLunarMeasurement(fileName)){
+	}else if(CPakFileHandler::IsLunarMeasurement(scan)){
 		return MODE_LUNAR;
-	}else if(CPakFileHandler::IsWindSpeedMeasurement(fileName)){
+	}else if(CPakFileHandler::IsWindSpeedMeasurement(scan)){
 		return MODE_WINDSPEED;
-	}else if(CPakFileHandler::IsCompositionMeasurement(fileName)){
+	}else if(CPakFileHandler::IsCompositionMeasurement(scan)){
 		return MODE_COMPOSITION;
 	}else{
 		// if nothing else then assume that this is a flux-measurement
@@ -512,48 +586,47 @@ MEASUREMENT_MODE CPakFileHandler::GetMeasurementMode(const CString &fileName){
 	}
 }
 
-/** This function checks the contents of the file 'fileName'.
+/** This function checks the contents of the scan 'scan'.
 		@return true - if the spectra are collected in a wind speed measurement mode. 
 		@return false - if the file does not contain spectra, 
 				or contains spectra which are not collected in a wind speed measurement mode. */
-bool CPakFileHandler::IsWindSpeedMeasurement(const CString &fileName){
-	if(IsWindSpeedMeasurement_Gothenburg(fileName))
+bool CPakFileHandler::IsWindSpeedMeasurement(const CScanFileHandler &scan){
+	if(IsWindSpeedMeasurement_Gothenburg(scan))
 		return true;
-	if(IsWindSpeedMeasurement_Heidelberg(fileName))
+	if(IsWindSpeedMeasurement_Heidelberg(scan))
 		return true;
 
 	// not a wind-speed measurement file
 	return false;
 }
-/** This function checks the contents of the file 'fileName'.
+/** This function checks the contents of the scan 'scan'.
 		@return true - if the spectra are collected in a wind speed measurement mode. 
 		@return false - if the file does not contain spectra, 
 				or contains spectra which are not collected in a wind speed measurement mode. */
-bool CPakFileHandler::IsWindSpeedMeasurement_Gothenburg(const CString &fileName){
-	SpectrumIO::CSpectrumIO reader;
+bool CPakFileHandler::IsWindSpeedMeasurement_Gothenburg(const CScanFileHandler &scan){
 	double scanAngle = 0, scanAngle2 = 0;
-	CSpectrum spectrum;
+	const CSpectrum *spectrum = NULL;
 	CDateTime gpsTime;
 	double saz, sza;
 	int nRepetitions = 0; // <-- The number of repetitions at one specific scan angle
 
 	// 1. Count the number of spectra
-	int numSpec = reader.CountSpectra(fileName);
+	int numSpec = scan.GetSpectrumNumInFile();
 	if(numSpec <= 2)
 		return false; // <-- If file is not readable/empty/contains only a few spectra then return false.
 
 	// 2. Check the Solar Zenith Angle at the time when the measurement started
 	//			If this is larger than 75, then the measurement is a stratospheric measurement
 	//			and not a wind-speed measurement
-	if(SUCCESS != reader.ReadSpectrum(fileName, 0, spectrum))
+	if(NULL == (spectrum = scan.GetLoadedSpectrum(0)))
 		return false;
-	gpsTime.year   = spectrum.m_info.m_date[0];
-	gpsTime.month  = (unsigned char)spectrum.m_info.m_date[1];
-	gpsTime.day    = (unsigned char)spectrum.m_info.m_date[2];
-	gpsTime.hour   = (unsigned char)spectrum.m_info.m_startTime.hr;
-	gpsTime.minute = (unsigned char)spectrum.m_info.m_startTime.m;
-	gpsTime.second = (unsigned char)spectrum.m_info.m_startTime.sec;
-	if(SUCCESS != Common::GetSunPosition(gpsTime, spectrum.Latitude(), spectrum.Longitude(), sza, saz))
+	gpsTime.year   = spectrum->m_info.m_date[0];
+	gpsTime.month  = (unsigned char)spectrum->m_info.m_date[1];
+	gpsTime.day    = (unsigned char)spectrum->m_info.m_date[2];
+	gpsTime.hour   = (unsigned char)spectrum->m_info.m_startTime.hr;
+	gpsTime.minute = (unsigned char)spectrum->m_info.m_startTime.m;
+	gpsTime.second = (unsigned char)spectrum->m_info.m_startTime.sec;
+	if(SUCCESS != Common::GetSunPosition(gpsTime, spectrum->Latitude(), spectrum->Longitude(), sza, saz))
 		return false;
 	if(fabs(sza) > 75)
 		return false;
@@ -569,19 +642,19 @@ bool CPakFileHandler::IsWindSpeedMeasurement_Gothenburg(const CString &fileName)
 			repetitions of two scan-angles */
 
 	// 3. Go through the file, starting at the last spectrum in the file.
-	if(SUCCESS != reader.ReadSpectrum(fileName, numSpec-3, spectrum))
+	if(NULL == (spectrum = scan.GetLoadedSpectrum(numSpec-3)))
 		return false;
-	scanAngle  = spectrum.ScanAngle();
-	scanAngle2 = spectrum.ScanAngle2();
+	scanAngle  = spectrum->ScanAngle();
+	scanAngle2 = spectrum->ScanAngle2();
 
 	for(int specIndex = numSpec-4; specIndex > 0; --specIndex){
-		if(SUCCESS != reader.ReadSpectrum(fileName, specIndex, spectrum)){
+		if(NULL == (spectrum = scan.GetLoadedSpectrum(specIndex))){
 			// failed to read the spectrum
 			break;
 		}
 		// if this is the same scan angle as in the last spectrum, 
 		//	then increase the number of repetitions.
-		if((fabs(scanAngle - spectrum.ScanAngle()) < 1e-2) && (fabs(scanAngle2 - spectrum.ScanAngle2()) < 1e-2)){
+		if((fabs(scanAngle - spectrum->ScanAngle()) < 1e-2) && (fabs(scanAngle2 - spectrum->ScanAngle2()) < 1e-2)){
 			++nRepetitions;
 		}else{
 			break;
@@ -598,20 +671,19 @@ bool CPakFileHandler::IsWindSpeedMeasurement_Gothenburg(const CString &fileName)
 
 	return false;
 }
-/** This function checks the contents of the file 'fileName'.
+/** This function checks the contents of the scan 'scan'.
 	@return true - if the spectra are collected in a wind speed measurement mode. 
 	@return false - if the file does not contain spectra, 
 			or contains spectra which are not collected in a wind speed measurement mode. */
-bool CPakFileHandler::IsWindSpeedMeasurement_Heidelberg(const CString &fileName){
-	SpectrumIO::CSpectrumIO reader;
+bool CPakFileHandler::IsWindSpeedMeasurement_Heidelberg(const CScanFileHandler &scan){
 	double scanAngles[2]	= {0, 0};
 	double scanAngles2[2]	= {0, 0};
 	int		 scanIndex			= 0;
-	CSpectrum spectrum;
+	const CSpectrum *spectrum = NULL;
 	int nRepetitions = 0; // <-- The number of repetitions at one specific scan angle
 
 	// 1. Count the number of spectra
-	int numSpec = reader.CountSpectra(fileName);
+	int numSpec = scan.GetSpectrumNumInFile();
 	if(numSpec <= 2)
 		return false; // <-- If file is not readable/empty/contains only a few spectra then return false.
 
@@ -627,25 +699,25 @@ bool CPakFileHandler::IsWindSpeedMeasurement_Heidelberg(const CString &fileName)
 			repetitions of two scan-angles */
 
 	// 2. Go through the file, starting at the last spectrum in the file.
-	if(SUCCESS != reader.ReadSpectrum(fileName, numSpec-3, spectrum))
+	if(NULL == (spectrum = scan.GetLoadedSpectrum(numSpec-3)))
 		return false;
-	scanAngles[0]				= spectrum.ScanAngle();
-	scanAngles2[0]			= spectrum.ScanAngle2();
+	scanAngles[0]				= spectrum->ScanAngle();
+	scanAngles2[0]			= spectrum->ScanAngle2();
 
-	if(SUCCESS != reader.ReadSpectrum(fileName, numSpec-4, spectrum))
+	if(NULL == (spectrum = scan.GetLoadedSpectrum(numSpec-4)))
 		return false;
-	scanAngles[1]				= spectrum.ScanAngle();
-	scanAngles2[1]			= spectrum.ScanAngle2();
+	scanAngles[1]				= spectrum->ScanAngle();
+	scanAngles2[1]			= spectrum->ScanAngle2();
 
 	for(int specIndex = numSpec-5; specIndex > 0; --specIndex){
-		if(SUCCESS != reader.ReadSpectrum(fileName, specIndex, spectrum)){
+		if(NULL == (spectrum = scan.GetLoadedSpectrum(specIndex))){
 			// failed to read the spectrum
 			break;
 		}
 		// if this is the same scan angle as in the last spectrum, 
 		//	then increase the number of repetitions.
-		if(fabs(scanAngles[scanIndex] - spectrum.ScanAngle()) < 1e-2){
-			if(fabs(scanAngles2[scanIndex] - spectrum.ScanAngle2()) < 1e-2){
+		if(fabs(scanAngles[scanIndex] - spectrum->ScanAngle()) < 1e-2){
+			if(fabs(scanAngles2[scanIndex] - spectrum->ScanAngle2()) < 1e-2){
 				++nRepetitions;
 				scanIndex	= (scanIndex + 1) % 2;
 			}
@@ -665,42 +737,41 @@ bool CPakFileHandler::IsWindSpeedMeasurement_Heidelberg(const CString &fileName)
 	return false;
 }
 
-/** This function checks the contents of the file 'fileName'.
+/** This function checks the contents of the scan 'scan'.
 		@return true - if the spectra are collected in a stratospheric measurement mode. 
 		@return false - if the file does not contain spectra, 
 				or contains spectra which are not collected in a stratospheric measurement mode. */
-bool CPakFileHandler::IsStratosphericMeasurement(const CString &fileName){
-	SpectrumIO::CSpectrumIO reader;
+bool CPakFileHandler::IsStratosphericMeasurement(const CScanFileHandler &scan){
 	double scanAngle = 0;
-	CSpectrum spectrum;
+	const CSpectrum *spectrum = NULL;
 	CDateTime gpsTime;
 	double saz, sza;
 	int nRepetitions = 0; // <-- The number of repetitions at one specific scan angle
 
 	// 1. Count the number of spectra
-	int numSpec = reader.CountSpectra(fileName);
+	int numSpec = scan.GetSpectrumNumInFile();
 	if(numSpec <= 2 || numSpec > 50)
 		return false; // <-- If file is not readable/empty/contains only a few spectra then return false.
 
 	// 2. Check the Solar Zenith Angle at the time when the measurement started
 	//			If this is larger than 75, then the measurement is a stratospheric measurement
 	//			and not a wind-speed measurement
-	if(SUCCESS != reader.ReadSpectrum(fileName, 0, spectrum))
+	if(NULL == (spectrum = scan.GetLoadedSpectrum(0)))
 		return false;
-	gpsTime.year		= spectrum.m_info.m_date[0];
-	gpsTime.month		= (unsigned char)spectrum.m_info.m_date[1];
-	gpsTime.day			= (unsigned char)spectrum.m_info.m_date[2];
-	gpsTime.hour		= (unsigned char)spectrum.m_info.m_startTime.hr;
-	gpsTime.minute	= (unsigned char)spectrum.m_info.m_startTime.m;
-	gpsTime.second	= (unsigned char)spectrum.m_info.m_startTime.sec;
-	if(SUCCESS != Common::GetSunPosition(gpsTime, spectrum.Latitude(), spectrum.Longitude(), sza, saz))
+	gpsTime.year		= spectrum->m_info.m_date[0];
+	gpsTime.month		= (unsigned char)spectrum->m_info.m_date[1];
+	gpsTime.day			= (unsigned char)spectrum->m_info.m_date[2];
+	gpsTime.hour		= (unsigned char)spectrum->m_info.m_startTime.hr;
+	gpsTime.minute	= (unsigned char)spectrum->m_info.m_startTime.m;
+	gpsTime.second	= (unsigned char)spectrum->m_info.m_startTime.sec;
+	if(SUCCESS != Common::GetSunPosition(gpsTime, spectrum->Latitude(), spectrum->Longitude(), sza, saz))
 		return false;
 	if(fabs(sza) < 75)
 		return false;
 
 	// 3. Go through the file, starting at the second last spectrum in the file.
 	for(int specIndex = numSpec-2; specIndex > 0; --specIndex){
-		if(SUCCESS != reader.ReadSpectrum(fileName, specIndex, spectrum)){
+		if(NULL == (spectrum = scan.GetLoadedSpectrum(specIndex))){
 			// failed to read the spectrum
 			break;
 		}
@@ -721,91 +792,62 @@ bool CPakFileHandler::IsStratosphericMeasurement(const CString &fileName){
 	return false;
 }
 
-/** This function checks the contents of the file 'fileName'.
+/** Counts the number of spectra in the scan 'scan' with the given name.
+		@param maxNum - the counting stops when this many spectra have been found */
+static int CountNamedSpectra(const CScanFileHandler &scan, const char *name, int maxNum){
+	int nFound = 0;
+
+	for(int specIndex = 0; specIndex < scan.GetSpectrumNumInFile() && nFound < maxNum; ++specIndex){
+		const CSpectrum *spec = scan.GetLoadedSpectrum(specIndex);
+		if(spec == NULL)
+			break;
+
+		if(Equals(CString(spec->m_info.m_name), name))
+			++nFound;
+	}
+
+	return nFound;
+}
+
+/** This function checks the contents of the scan 'scan'.
 		@return true - if the spectra are collected in a direct-sun mode. 
 		@return false - if the file does not contain spectra, 
 				or contains spectra which are not collected in a direct-sun measurement mode. */
-bool CPakFileHandler::IsDirectSunMeasurement(const CString &fileName){
-	CScanFileHandler scan;
-	CSpectrum spec;
-	int nFound = 0;
-
+bool CPakFileHandler::IsDirectSunMeasurement(const CScanFileHandler &scan){
 	// It is here assumed that the measurement is a direct-sun measurment
 	//	if there is at least 5 spectrum with the name 'direct_sun'
-	if(SUCCESS != scan.CheckScanFile(&fileName)){
-		return false; // failed to check the file
-	}
-	while(scan.GetNextSpectrum(spec)){
-		CString name = CString(spec.m_info.m_name);
-		if(Equals(name, "direct_sun")){
-			++nFound;
-			if(nFound == 5)
-				return true;
-		}
-	}
-	
-	return false;
+	return (CountNamedSpectra(scan, "direct_sun", 5) == 5);
 }
-/** This function checks the contents of the file 'fileName'.
+/** This function checks the contents of the scan 'scan'.
 		@return true - if the spectra are collected in a lunar mode. 
 		@return false - if the file does not contain spectra, 
 				or contains spectra which are not collected in a lunar measurement mode. */
-bool CPakFileHandler::IsLunarMeasurement(const CString &fileName){
-	CScanFileHandler scan;
-	CSpectrum spec;
-	int nFound = 0;
-
-	// It is here assumed that the measurement is a direct-sun measurment
-	//	if there is at least 5 spectrum with the name 'direct_sun'
-	if(SUCCESS != scan.CheckScanFile(&fileName)){
-		return false; // failed to check the file
-	}
-	while(scan.GetNextSpectrum(spec)){
-		CString name = CString(spec.m_info.m_name);
-		if(Equals(name, "lunar")){
-			++nFound;
-			if(nFound == 5)
-				return true;
-		}
-	}
-	
-	return false;
+bool CPakFileHandler::IsLunarMeasurement(const CScanFileHandler &scan){
+	// It is here assumed that the measurement is a lunar measurment
+	//	if there is at least 5 spectrum with the name 'lunar'
+	return (CountNamedSpectra(scan, "lunar", 5) == 5);
 }
 
-/** This function checks the contents of the file 'fileName'.
+/** This function checks the contents of the scan 'scan'.
 		@return true - if the spectra are collected in a calibration measurment - mode.
 		@return false - if the file does not contain readable spectra,
 				or contains spectra which are not collected in a calibration measurment - mode.*/
-bool CPakFileHandler::IsCalibrationMeasurement(const CString &fileName){
+bool CPakFileHandler::IsCalibrationMeasurement(const CScanFileHandler &scan){
 
 	return false;
 }
 
-/** This function checks the contents of the file 'fileName'.
+/** This function checks the contents of the scan 'scan'.
 		@return true - if the spectra are collected in a composition measurment - mode.
 		@return false - if the file does not contain readable spectra,
 				or contains spectra which are not collected in a composition measurment - mode.*/
-bool CPakFileHandler::IsCompositionMeasurement(const CString &fileName){
-	CScanFileHandler scan;
-	CSpectrum spec;
-
+bool CPakFileHandler::IsCompositionMeasurement(const CScanFileHandler &scan){
 	// It is here assumed that the measurement is a composition measurment
 	//	if there is 
 	//		* at least 1 spectrum with the name 'offset'
 	//		* at least 1 spectrum with the name 'dark_cur'
 	//		* at least 1 spectrum with the name 'comp'
-	if(SUCCESS != scan.CheckScanFile(&fileName)){
-		return false; // failed to check the file
-	}
-	scan.ResetCounter();
-	while(scan.GetNextSpectrum(spec)){
-		CString name = CString(spec.m_info.m_name);
-		if(Equals(name, "comp")){
-			return true;
-		}
-	}
-
-	return false;
+	return (CountNamedSpectra(scan, "comp", 1) == 1);
 }
 
 /** Takes a scan file and renames it to an approprate name */
@@ -6,6 +6,8 @@
 
 namespace FileHandler
 {
+	class CScanFileHandler;
+
 	/** The <b>CPakFileHandler</b> takes care of the downloaded pak-files from the scanning instrument
 		and splits them up into several pak-files, each containing the data from one single scan. */
 
@@ -44,6 +46,11 @@ namespace FileHandler
 				and returns the type of measurement which is inside the file */
 		static MEASUREMENT_MODE GetMeasurementMode(const CString &fileName);
 
+		/** This function checks the contents of the scan 'scan', which must have been
+				read in with 'CScanFileHandler::LoadScanFile', and returns the type of 
+				measurement which is inside it. Nothing is read from the file. */
+		static MEASUREMENT_MODE GetMeasurementMode(const CScanFileHandler &scan);
+
 		/** Adjusts the channel number to be in the range 0 - MAX_CHANNEL_NUM 
 				@return true if the spectrum is a multichannel spectrum and should be split. */
 		static bool CorrectChannelNumber(unsigned char &channel);
@@ -71,6 +78,13 @@ namespace FileHandler
 		/** Where to temporarily copy the spectra while the pak-file is being splitted. */
 		CString m_scanFile[MAX_CHANNEL_NUM];
 
+		/** The files in 'm_scanFile', kept open while the spectra of one scan are written
+				to them. NULL if the file is not opened. */
+		FILE *m_scanFileHandle[MAX_CHANNEL_NUM];
+
+		/** The size of the write-buffer of each opened scan-file */
+		static const int SCAN_FILE_BUFFER_SIZE = 262144;
+
 		/** The number of spectra that we've read so far in the checked file.
 				When 'ReadDownloadedFile' returns, this is the number of spectra
 				there were in that file. */
@@ -106,8 +120,22 @@ namespace FileHandler
 				spectrum 'curSpec' will be the next first spectrum of a scan. 
 				If there is no more scan-start spectrum in the file, this function will
 				return FAIL. 
+				The spectra are read with 'reader' and their binary headers into 'spectrumHeader'.
 				This function alters the member variable 'm_spectrumNumber' */
-		RETURN_CODE FindNextScanStart(FILE *file, CSpectrum &curSpec);
+		RETURN_CODE FindNextScanStart(FILE *file, SpectrumIO::CSpectrumIO &reader, CSpectrum &curSpec, char *spectrumHeader, int &specHeaderSize);
+
+		/** Returns the scan-file of the given channel, opened for appending spectra.
+				The file stays open until 'CloseScanFile' is called.
+				@return NULL if the file could not be opened */
+		FILE *OpenScanFile(int channel);
+
+		/** Closes the scan-file of the given channel, if it is opened */
+		void CloseScanFile(int channel);
+
+		/** Writes the spectrum 'spec', which was last read by 'reader', to the opened file 'f'.
+				If the spectrum was read correctly then the header and the compressed data are
+				copied as they were in the downloaded file, otherwise the spectrum is compressed again. */
+		RETURN_CODE WriteSpectrum(FILE *f, SpectrumIO::CSpectrumIO &reader, const CSpectrum &spec, const char *spectrumHeader, int specHeaderSize);
 
 		/** Sends a message to the evaluation thread that this scan-file should
 				be evaluated. The file will first be moved to a temporary file
@@ -129,55 +157,55 @@ namespace FileHandler
 		RETURN_CODE SaveCorruptSpectrum(const CSpectrum &curSpec, int specHeaderSie, const char *spectrumHeader);
 
 
-		/** This function checks the contents of the file 'fileName'.
+		/** This function checks the contents of the scan 'scan'.
 				@return true - if the spectra are collected in a wind speed measurement mode. 
 				@return false - if the file does not contain spectra, 
 						or contains spectra which are not collected in a wind speed measurement mode. */
-		static bool IsWindSpeedMeasurement(const CString &fileName);
+		static bool IsWindSpeedMeasurement(const CScanFileHandler &scan);
 
-		/** This function checks the contents of the file 'fileName'.
+		/** This function checks the contents of the scan 'scan'.
 				@return true - if the spectra are collected in a stratospheric measurement mode. 
 				@return false - if the file does not contain spectra, 
 						or contains spectra which are not collected in a stratospheric measurement mode. */
-		static bool IsStratosphericMeasurement(const CString &fileName);
+		static bool IsStratosphericMeasurement(const CScanFileHandler &scan);
 
-		/** This function checks the contents of the file 'fileName'.
+		/** This function checks the contents of the scan 'scan'.
 				@return true - if the spectra are collected in a direct-sun mode. 
 				@return false - if the file does not contain spectra, 
 						or contains spectra which are not collected in a direct-sun measurement mode. */
-		static bool IsDirectSunMeasurement(const CString &fileName);
+		static bool IsDirectSunMeasurement(const CScanFileHandler &scan);
 
-		/** This function checks the contents of the file 'fileName'.
+		/** This function checks the contents of the scan 'scan'.
 				@return true - if the spectra are collected in a lunar mode. 
 				@return false - if the file does not contain spectra, 
 						or contains spectra which are not collected in a lunar measurement mode. */
-		static bool IsLunarMeasurement(const CString &fileName);
+		static bool IsLunarMeasurement(const CScanFileHandler &scan);
 
-		/** This function checks the contents of the file 'fileName'.
+		/** This function checks the contents of the scan 'scan'.
 				@return true - if the spectra are collected in a calibration measurment - mode.
 				@return false - if the file does not contain readable spectra,
 						or contains spectra which are not collected in a calibration measurment - mode.*/
-		static bool IsCalibrationMeasurement(const CString &fileName);
+		static bool IsCalibrationMeasurement(const CScanFileHandler &scan);
 
-		/** This function checks the contents of the file 'fileName'.
+		/** This function checks the contents of the scan 'scan'.
 				@return true - if the spectra are collected in a composition measurment - mode.
 				@return false - if the file does not contain readable spectra,
 						or contains spectra which are not collected in a composition measurment - mode.*/
-		static bool IsCompositionMeasurement(const CString &fileName);
+		static bool IsCompositionMeasurement(const CScanFileHandler &scan);
 
-		/** This function checks the contents of the file 'fileName'.
+		/** This function checks the contents of the scan 'scan'.
 				@return true - if the spectra are collected in a wind speed measurement mode using
 					the gothenburg type of instrument.
 				@return false - if the file does not contain spectra, 
 						or contains spectra which are not collected in a wind speed measurement mode. */
-		static bool IsWindSpeedMeasurement_Gothenburg(const CString &fileName);
+		static bool IsWindSpeedMeasurement_Gothenburg(const CScanFileHandler &scan);
 
-		/** This function checks the contents of the file 'fileName'.
+		/** This function checks the contents of the scan 'scan'.
 				@return true - if the spectra are collected in a wind speed measurement mode using
 					the heidelberg type of instrument.
 				@return false - if the file does not contain spectra, 
 						or contains spectra which are not collected in a wind speed measurement mode. */
-		static bool IsWindSpeedMeasurement_Heidelberg(const CString &fileName);
+		static bool IsWindSpeedMeasurement_Heidelberg(const CScanFileHandler &scan);
 
 
 	};
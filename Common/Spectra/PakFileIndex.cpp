@@ -0,0 +1,175 @@
+#include "StdAfx.h"
+#include "PakFileIndex.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace SpectrumIO;
+
+// the identifier written in the beginning of every sidecar-file
+static const char SIDECAR_IDENT[8] = {'M', 'K', 'Z', 'Y', 'I', 'D', 'X', '1'};
+
+// the length of the spectrum-names saved in the sidecar-file
+static const int SIDECAR_NAME_LENGTH = 16;
+
+bool CPakFileIndex::s_useSidecarFiles = false;
+std::map<CString, CPakFileIndex::CacheEntry> CPakFileIndex::s_cache;
+unsigned long CPakFileIndex::s_useCounter = 0;
+std::mutex CPakFileIndex::s_cacheMutex;
+
+CPakFileIndex::CPakFileIndex(void)
+{
+	m_fileSize         = 0;
+	m_creationTime     = 0;
+	m_modificationTime = 0;
+}
+
+CPakFileIndex::~CPakFileIndex(void)
+{
+}
+
+void CPakFileIndex::Append(long offset, const CString &name){
+	m_offset.push_back(offset);
+	m_name.push_back(name);
+}
+
+RETURN_CODE CPakFileIndex::SetFileStatus(FILE *f){
+	struct _stat64 status;
+
+	if(f == NULL || 0 != _fstat64(_fileno(f), &status))
+		return FAIL;
+
+	m_fileSize         = status.st_size;
+	m_creationTime     = status.st_ctime;
+	m_modificationTime = status.st_mtime;
+
+	return SUCCESS;
+}
+
+bool CPakFileIndex::IsValidFor(FILE *f) const{
+	struct _stat64 status;
+
+	if(f == NULL || 0 != _fstat64(_fileno(f), &status))
+		return false;
+
+	return (status.st_size == m_fileSize && status.st_ctime == m_creationTime && status.st_mtime == m_modificationTime);
+}
+
+CString CPakFileIndex::GetSidecarFileName(const CString &pakFileName){
+	CString sidecar;
+	sidecar.Format("%s.idx", pakFileName);
+	return sidecar;
+}
+
+RETURN_CODE CPakFileIndex::WriteSidecarFile(const CString &pakFileName) const{
+	char name[SIDECAR_NAME_LENGTH];
+	long specNum = (long)m_offset.size();
+
+	FILE *f = fopen(GetSidecarFileName(pakFileName), "wb");
+	if(f == NULL)
+		return FAIL;
+
+	fwrite(SIDECAR_IDENT, sizeof(SIDECAR_IDENT), 1, f);
+	fwrite(&m_fileSize, sizeof(m_fileSize), 1, f);
+	fwrite(&m_creationTime, sizeof(m_creationTime), 1, f);
+	fwrite(&m_modificationTime, sizeof(m_modificationTime), 1, f);
+	fwrite(&specNum, sizeof(specNum), 1, f);
+
+	for(long k = 0; k < specNum; ++k){
+		memset(name, 0, SIDECAR_NAME_LENGTH);
+		strncpy(name, m_name[k], SIDECAR_NAME_LENGTH - 1);
+
+		fwrite(&m_offset[k], sizeof(long), 1, f);
+		fwrite(name, SIDECAR_NAME_LENGTH, 1, f);
+	}
+
+	bool error = (0 != ferror(f));
+	fclose(f);
+
+	return (error) ? FAIL : SUCCESS;
+}
+
+RETURN_CODE CPakFileIndex::ReadSidecarFile(const CString &pakFileName){
+	char ident[sizeof(SIDECAR_IDENT)];
+	char name[SIDECAR_NAME_LENGTH];
+	long specNum = 0;
+	long offset;
+
+	FILE *f = fopen(GetSidecarFileName(pakFileName), "rb");
+	if(f == NULL)
+		return FAIL;
+
+	if(1 != fread(ident, sizeof(ident), 1, f) || 0 != memcmp(ident, SIDECAR_IDENT, sizeof(SIDECAR_IDENT)) ||
+		1 != fread(&m_fileSize, sizeof(m_fileSize), 1, f) ||
+		1 != fread(&m_creationTime, sizeof(m_creationTime), 1, f) ||
+		1 != fread(&m_modificationTime, sizeof(m_modificationTime), 1, f) ||
+		1 != fread(&specNum, sizeof(specNum), 1, f) || specNum < 0){
+		fclose(f);
+		return FAIL;
+	}
+
+	m_offset.clear();
+	m_name.clear();
+	m_offset.reserve(specNum);
+	m_name.reserve(specNum);
+
+	for(long k = 0; k < specNum; ++k){
+		if(1 != fread(&offset, sizeof(long), 1, f) || 1 != fread(name, SIDECAR_NAME_LENGTH, 1, f)){
+			fclose(f);
+			return FAIL;
+		}
+		name[SIDECAR_NAME_LENGTH - 1] = 0;
+		Append(offset, CString(name));
+	}
+
+	fclose(f);
+	return SUCCESS;
+}
+
+CString CPakFileIndex::GetCacheKey(const CString &fileName){
+	CString key(fileName);
+	key.Replace('/', '\\');
+	key.MakeLower();
+	return key;
+}
+
+std::shared_ptr<const CPakFileIndex> CPakFileIndex::Lookup(const CString &fileName, FILE *f){
+	std::lock_guard<std::mutex> lock{ s_cacheMutex };
+
+	auto it = s_cache.find(GetCacheKey(fileName));
+	if(it == s_cache.end())
+		return nullptr;
+
+	if(!it->second.index->IsValidFor(f)){
+		// the file has changed since the index was built
+		s_cache.erase(it);
+		return nullptr;
+	}
+
+	it->second.lastUse = ++s_useCounter;
+	return it->second.index;
+}
+
+void CPakFileIndex::Store(const CString &fileName, std::shared_ptr<const CPakFileIndex> index){
+	std::lock_guard<std::mutex> lock{ s_cacheMutex };
+
+	// Make room for the new index by throwing out the least recently used one
+	if(s_cache.size() >= MAX_CACHED_FILES){
+		auto oldest = s_cache.begin();
+		for(auto it = s_cache.begin(); it != s_cache.end(); ++it){
+			if(it->second.lastUse < oldest->second.lastUse)
+				oldest = it;
+		}
+		s_cache.erase(oldest);
+	}
+
+	CacheEntry &entry = s_cache[GetCacheKey(fileName)];
+	entry.index   = index;
+	entry.lastUse = ++s_useCounter;
+}
+
+void CPakFileIndex::Invalidate(const CString &fileName){
+	std::lock_guard<std::mutex> lock{ s_cacheMutex };
+
+	s_cache.erase(GetCacheKey(fileName));
+}
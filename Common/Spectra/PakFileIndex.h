@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <map>
+
+#include "../Common.h"
+
+namespace SpectrumIO
+{
+	/** <b>CPakFileIndex</b> holds the position of every spectrum inside one .pak-file.
+		The index is built by CSpectrumIO in one single pass over the file and lets
+		any spectrum be read with one seek instead of walking through all the headers
+		before it.
+		Built indices are kept in a process-wide cache, keyed by the name of the file
+		and validated against the size and time stamps of the file, and can optionally
+		be saved to a small sidecar-file next to the .pak-file. */
+	class CPakFileIndex
+	{
+	public:
+		/** Default constructor */
+		CPakFileIndex(void);
+
+		/** Default destructor */
+		~CPakFileIndex(void);
+
+		// ----------------------------------------------------------------------
+		// ---------------------- PUBLIC DATA -----------------------------------
+		// ----------------------------------------------------------------------
+
+		/** The position in the file of the 'MKZY' header of each spectrum */
+		std::vector<long> m_offset;
+
+		/** The name of each spectrum (e.g. 'sky', 'dark', 'offset'), cleaned from
+			special characters and with leading and trailing white-spaces removed. */
+		std::vector<CString> m_name;
+
+		/** The size of the file when the index was built [bytes] */
+		__int64 m_fileSize;
+
+		/** The time of creation of the file when the index was built */
+		__time64_t m_creationTime;
+
+		/** The time of last modification of the file when the index was built */
+		__time64_t m_modificationTime;
+
+		/** If true then the indices will be saved to, and read from, sidecar-files
+			next to the .pak-files. Default is false, set from the <pakIndexFiles>
+			option in the configuration file at start-up. */
+		static bool s_useSidecarFiles;
+
+		// ----------------------------------------------------------------------
+		// --------------------- PUBLIC METHODS ---------------------------------
+		// ----------------------------------------------------------------------
+
+		/** Returns the number of spectra in the indexed file */
+		int SpectrumNum() const { return (int)m_offset.size(); }
+
+		/** Adds a spectrum, starting at the given position in the file, to the index */
+		void Append(long offset, const CString &name);
+
+		/** Sets the size and time stamps of the indexed file, read from the file
+			which is opened as 'f' */
+		RETURN_CODE SetFileStatus(FILE *f);
+
+		/** Returns true if this index was built from the same version of the
+			file as the one which is opened as 'f' */
+		bool IsValidFor(FILE *f) const;
+
+		/** Saves this index to the sidecar-file of the given .pak-file.
+			@return SUCCESS if the file could be written */
+		RETURN_CODE WriteSidecarFile(const CString &pakFileName) const;
+
+		/** Reads the index from the sidecar-file of the given .pak-file.
+			The caller must check with 'IsValidFor' that the read index
+			corresponds to the current version of the .pak-file.
+			@return SUCCESS if the file could be read */
+		RETURN_CODE ReadSidecarFile(const CString &pakFileName);
+
+		/** Returns the name of the sidecar-file for the given .pak-file */
+		static CString GetSidecarFileName(const CString &pakFileName);
+
+		// ----------------------------------------------------------------------
+		// --------------------- THE SHARED CACHE -------------------------------
+		// ----------------------------------------------------------------------
+
+		/** Looks up the cached index of the file 'fileName', which is opened as 'f'.
+			@return the index if it is cached and still valid, otherwise nullptr */
+		static std::shared_ptr<const CPakFileIndex> Lookup(const CString &fileName, FILE *f);
+
+		/** Stores the given index in the cache, replacing any previous index of the file */
+		static void Store(const CString &fileName, std::shared_ptr<const CPakFileIndex> index);
+
+		/** Removes the index of the given file from the cache. This should be called
+			whenever the file is changed by this program. */
+		static void Invalidate(const CString &fileName);
+
+	private:
+		/** The maximum number of files for which the index is kept in memory */
+		static const int MAX_CACHED_FILES = 512;
+
+		/** One entry in the cache */
+		struct CacheEntry
+		{
+			std::shared_ptr<const CPakFileIndex> index;
+			unsigned long lastUse;
+		};
+
+		/** Returns the key into the cache for the given file */
+		static CString GetCacheKey(const CString &fileName);
+
+		/** The cached indices, keyed by the (lower case) name of the file */
+		static std::map<CString, CacheEntry> s_cache;
+
+		/** Incremented every time the cache is used, to find the least recently used entry */
+		static unsigned long s_useCounter;
+
+		/** Protects the cache from being changed from two threads simultaneously */
+		static std::mutex s_cacheMutex;
+	};
+}
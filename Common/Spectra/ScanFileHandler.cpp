@@ -13,6 +13,7 @@ CScanFileHandler::CScanFileHandler(void)
 	m_device.Format("");
 	m_specNum = 0;
 	
+	m_spectrumBufferStart = 0;
 	m_spectrumBufferNum = 0;
 }
 
@@ -24,69 +25,89 @@ CScanFileHandler::CScanFileHandler(FileHandler::CLogFileWriter &log){
 	this->m_initialized = false;
 	this->m_specNum = 0;
 	
+	m_spectrumBufferStart = 0;
 	m_spectrumBufferNum = 0;
 }
 
 CScanFileHandler::~CScanFileHandler(void)
 {
 	m_spectrumBuffer.RemoveAll();
+	m_spectrumBufferError.RemoveAll();
 }
 
 /** Checks the scan saved in the given filename
     @param fileName - the name of the file in which the spectra of the scan are saved */
 RETURN_CODE CScanFileHandler::CheckScanFile(const CString *fileName){
+	return OpenScanFile(fileName, false);
+}
+
+/** Checks the scan saved in the given filename and keeps all its spectra in memory
+    @param fileName - the name of the file in which the spectra of the scan are saved */
+RETURN_CODE CScanFileHandler::LoadScanFile(const CString *fileName){
+	return OpenScanFile(fileName, true);
+}
+
+/** Opens the scan-file and reads the spectra of the scan from it */
+RETURN_CODE CScanFileHandler::OpenScanFile(const CString *fileName, bool bufferAll){
 	CSpectrumIO reader;
 	reader.m_logFileWriter = this->m_logFileWriter;
 	CString errMsg;
+
+	m_fileName.Format("%s", *fileName);
+
+	// The whole file is read through this one file handle
+	FILE *f = fopen(m_fileName, "rb");
+	if(f == NULL){
+		errMsg.Format("Could not open spectrum file: %s", *fileName);
+		ShowMessage(errMsg);
+		this->m_lastError = CSpectrumIO::ERROR_COULD_NOT_OPEN_FILE;
+		return FAIL;
+	}
+
+	RETURN_CODE ret = ReadScanFile(f, reader, bufferAll);
+
+	fclose(f);
+
+	return ret;
+}
+
+/** Reads the spectra of the scan from the opened scan-file */
+RETURN_CODE CScanFileHandler::ReadScanFile(FILE *f, SpectrumIO::CSpectrumIO &reader, bool bufferAll){
+	CString errMsg;
 	CString strings[] = {CString("sky"), CString("zenith"), CString("dark"), CString("offset"), CString("dark_cur"), CString("darkcur")};
 	int indices[] = {-1, -1, -1, -1, -1, -1};
 	bool error = false;
 	CSpectrum tempSpec;
 
-	m_fileName.Format("%s", *fileName);
+	// Count the number of spectra in the .pak-file and find the named spectra
+	m_specNum = reader.ScanSpectrumFile(m_fileName, f, strings, 6, indices);
 
-	// Count the number of spectra in the .pak-file
-	m_specNum = reader.ScanSpectrumFile(m_fileName, strings, 6, indices);
-
-	// Read in the spectra into the buffer, if the file is not too long
-	if(m_specNum < 200){
-		m_spectrumBuffer.SetSize(m_specNum);
-		FILE *f = fopen(m_fileName, "rb");
-		if(f != NULL){
-			for(int k = 0; k < m_specNum; ++k){
-				if(SUCCESS == reader.ReadNextSpectrum(f, tempSpec)){
-					m_spectrumBuffer.SetAtGrow(k, tempSpec);
-				}else{
-					errMsg.Format("Could not read spectrum from file: %s", *fileName);
-					ShowMessage(errMsg);
-					this->m_lastError = reader.m_lastError;
-					fclose(f);
-					return FAIL;
-				}
-			}
-			fclose(f);
-		}
-		m_spectrumBufferNum = m_specNum;
-	}else{
-		// The file's too large, don't store it in memory!
-		m_spectrumBufferNum = 0;
-		m_spectrumBuffer.RemoveAll();
+	// Read in the spectra into the buffer. If the file is too long then only
+	//	the first spectra are read, the rest are read when they are asked for
+	m_spectrumBufferStart = 0;
+	m_spectrumBufferNum   = 0;
+	int bufferNum = (bufferAll || m_specNum < MAX_BUFFERED_SPECTRA) ? m_specNum : SPECTRUM_WINDOW_SIZE;
+	if(SUCCESS != FillSpectrumBuffer(f, reader, 0, bufferNum)){
+		errMsg.Format("Could not read spectrum from file: %s", m_fileName);
+		ShowMessage(errMsg);
+		this->m_lastError = reader.m_lastError;
+		return FAIL;
 	}
 
 	// --------------- read the sky spectrum ----------------------
 	if(indices[0] != -1){
-		if(SUCCESS != reader.ReadSpectrum(m_fileName, indices[0], m_sky)){
+		if(SUCCESS != ReadBufferedSpectrum(f, reader, indices[0], m_sky)){
 			error = true;
 		}
 	}else if(indices[1] != -1){
-		if(SUCCESS != reader.ReadSpectrum(m_fileName, indices[1], m_sky)){
+		if(SUCCESS != ReadBufferedSpectrum(f, reader, indices[1], m_sky)){
 			error = true;
 		}
-	}else if(SUCCESS != reader.ReadSpectrum(m_fileName, 0, m_sky)){
+	}else if(SUCCESS != ReadBufferedSpectrum(f, reader, 0, m_sky)){
 		error = true;
 	}
 	if(error){
-		errMsg.Format("Could not read sky-spectrum in file: %s", *fileName);
+		errMsg.Format("Could not read sky-spectrum in file: %s", m_fileName);
 		ShowMessage(errMsg);
 		this->m_lastError = reader.m_lastError;
 		return FAIL;
@@ -95,19 +116,19 @@ RETURN_CODE CScanFileHandler::CheckScanFile(const CString *fileName){
 	// --------------- read the dark spectrum ----------------------
 	if(indices[2] != -1){
 		// If there is a dark-spectrum specified, then read it!
-		if(SUCCESS != reader.ReadSpectrum(m_fileName, indices[2], m_dark)){
+		if(SUCCESS != ReadBufferedSpectrum(f, reader, indices[2], m_dark)){
 			error = true;
 	}
 	}else if(indices[3] == -1 && indices[4] == -1){
 		// If there's no spectrum called 'dark' and no spectrum called 'dark_cur'
 		//	and also no spectrum called 'offset', then we assume that something is wrong
 		//	in the names and use the second spectrum in the scan as dark
-		if(SUCCESS != reader.ReadSpectrum(m_fileName, 1, m_dark)){
+		if(SUCCESS != ReadBufferedSpectrum(f, reader, 1, m_dark)){
 			error = true;
 		}
 	}
 	if(error){
-		errMsg.Format("Could not read dark-spectrum in file: %s", *fileName);
+		errMsg.Format("Could not read dark-spectrum in file: %s", m_fileName);
 		ShowMessage(errMsg);
 		this->m_lastError = reader.m_lastError;
 		return FAIL;
@@ -115,8 +136,8 @@ RETURN_CODE CScanFileHandler::CheckScanFile(const CString *fileName){
 
 	// --------------- read the offset spectrum (if any) ----------------------
 	if(indices[3] != -1){
-		if(SUCCESS != reader.ReadSpectrum(m_fileName, indices[3], m_offset)){
-			errMsg.Format("Could not read offset-spectrum in file: %s", *fileName);
+		if(SUCCESS != ReadBufferedSpectrum(f, reader, indices[3], m_offset)){
+			errMsg.Format("Could not read offset-spectrum in file: %s", m_fileName);
 			ShowMessage(errMsg);
 			this->m_lastError = reader.m_lastError;
 			return FAIL;
@@ -125,23 +146,23 @@ RETURN_CODE CScanFileHandler::CheckScanFile(const CString *fileName){
 
 	// --------------- read the dark-current spectrum (if any) ----------------------
 	if(indices[4] != -1){
-		if(SUCCESS != reader.ReadSpectrum(m_fileName, indices[4], m_darkCurrent)){
-			errMsg.Format("Could not read offset-spectrum in file: %s", *fileName);
+		if(SUCCESS != ReadBufferedSpectrum(f, reader, indices[4], m_darkCurrent)){
+			errMsg.Format("Could not read offset-spectrum in file: %s", m_fileName);
 			ShowMessage(errMsg);
 			this->m_lastError = reader.m_lastError;
 			return FAIL;
 		}
 	}
 	if(indices[5] != -1){
-		if(SUCCESS != reader.ReadSpectrum(m_fileName, indices[5], m_darkCurrent)){
-			errMsg.Format("Could not read offset-spectrum in file: %s", *fileName);
+		if(SUCCESS != ReadBufferedSpectrum(f, reader, indices[5], m_darkCurrent)){
+			errMsg.Format("Could not read offset-spectrum in file: %s", m_fileName);
 			ShowMessage(errMsg);
 			this->m_lastError = reader.m_lastError;
 			return FAIL;
 		}
 	}
 	// set the start and stop time of the measurement
-	if(SUCCESS == reader.ReadSpectrum(m_fileName, 0, tempSpec)){
+	if(SUCCESS == ReadBufferedSpectrum(f, reader, 0, tempSpec)){
 		this->m_startTime = tempSpec.m_info.m_startTime;
 		this->m_stopTime  = tempSpec.m_info.m_stopTime;
 
@@ -169,31 +190,113 @@ RETURN_CODE CScanFileHandler::CheckScanFile(const CString *fileName){
 	return SUCCESS;
 }
 
-/** Returns the next spectrum in the scan */
-int CScanFileHandler::GetNextSpectrum(CSpectrum &spec){
+/** Reads 'number' spectra, starting at spectrum number 'first', from the 
+		opened scan-file into the spectrum buffer */
+RETURN_CODE CScanFileHandler::FillSpectrumBuffer(FILE *f, SpectrumIO::CSpectrumIO &reader, long first, long number){
+	m_spectrumBufferStart = first;
+	m_spectrumBufferNum   = 0;
+
+	number = min(number, m_specNum - first);
+	if(number <= 0)
+		return SUCCESS;
+
+	if(SUCCESS != reader.FindSpectrumNumber(m_fileName, f, first))
+		return FAIL;
+
+	// read the spectra directly into the buffer, each buffered spectrum 
+	//	only allocates as many pixels as it has
+	m_spectrumBuffer.SetSize(number);
+	m_spectrumBufferError.SetSize(number);
+	for(int k = 0; k < number; ++k){
+		if(SUCCESS == reader.ReadNextSpectrum(f, m_spectrumBuffer[k])){
+			m_spectrumBufferError[k] = CSpectrumIO::ERROR_NO_ERROR;
+			continue;
+		}
+
+		// A spectrum which cannot be read is marked as such, the other spectra are still kept.
+		//	The position in the file is not known after a failed read, so find the next spectrum again.
+		m_spectrumBufferError[k] = (reader.m_lastError != CSpectrumIO::ERROR_NO_ERROR) ? reader.m_lastError : CSpectrumIO::ERROR_SPECTRUM_NOT_COMPLETE;
+		if(k + 1 < number && SUCCESS != reader.FindSpectrumNumber(m_fileName, f, first + k + 1)){
+			for(int j = k + 1; j < number; ++j)
+				m_spectrumBufferError[j] = CSpectrumIO::ERROR_COULD_NOT_CHANGE_POS;
+			break;
+		}
+	}
+	m_spectrumBufferNum = number;
+
+	return SUCCESS;
+}
+
+/** Reads the spectra starting at spectrum number 'first' into the spectrum buffer */
+RETURN_CODE CScanFileHandler::FillSpectrumBuffer(long first){
 	CSpectrumIO reader;
 	reader.m_logFileWriter = NULL;	// nowhere to output the error messages
 
-	if(m_spectrumBufferNum == m_specNum){
-		// We've read in the spectra into the buffer, just read it from there
-		// instead of reading from the file itself.
-		if(m_specReadSoFarNum >= m_spectrumBufferNum){
-			this->m_lastError = SpectrumIO::CSpectrumIO::ERROR_SPECTRUM_NOT_FOUND;
-			++m_specReadSoFarNum; // <-- go to the next spectum
-			return 0;
-		}else{
-			spec = m_spectrumBuffer.GetAt(m_specReadSoFarNum);
-		}
-	}else{
-		// read the next spectrum in the file
-		if(SUCCESS != reader.ReadSpectrum(m_fileName, m_specReadSoFarNum, spec)){
-			// if there was an error reading the spectrum, set the error-flag
-			this->m_lastError = reader.m_lastError;
-			++m_specReadSoFarNum; // <-- go to the next spectum
-			return 0;
+	FILE *f = fopen(m_fileName, "rb");
+	if(f == NULL){
+		this->m_lastError = CSpectrumIO::ERROR_COULD_NOT_OPEN_FILE;
+		return FAIL;
+	}
+
+	RETURN_CODE ret = FillSpectrumBuffer(f, reader, first, SPECTRUM_WINDOW_SIZE);
+	if(ret != SUCCESS)
+		this->m_lastError = reader.m_lastError;
+
+	fclose(f);
+
+	return ret;
+}
+
+/** Gets spectrum number 'specNo' from the buffer, or from the opened scan-file if it is not in the buffer */
+RETURN_CODE CScanFileHandler::ReadBufferedSpectrum(FILE *f, SpectrumIO::CSpectrumIO &reader, long specNo, CSpectrum &spec){
+	if(IsBuffered(specNo)){
+		if(GetBufferedError(specNo) != CSpectrumIO::ERROR_NO_ERROR){
+			reader.m_lastError = GetBufferedError(specNo);
+			return FAIL;
 		}
+		spec = m_spectrumBuffer.GetAt(specNo - m_spectrumBufferStart);
+		return SUCCESS;
+	}
+
+	if(SUCCESS != reader.FindSpectrumNumber(m_fileName, f, specNo))
+		return FAIL;
+
+	return reader.ReadNextSpectrum(f, spec);
+}
+
+/** Returns true if spectrum number 'specNo' is in the spectrum buffer */
+bool CScanFileHandler::IsBuffered(long specNo) const{
+	return (specNo >= m_spectrumBufferStart && specNo < m_spectrumBufferStart + m_spectrumBufferNum);
+}
+
+/** Returns the error from reading the buffered spectrum number 'specNo' */
+int CScanFileHandler::GetBufferedError(long specNo) const{
+	return m_spectrumBufferError.GetAt(specNo - m_spectrumBufferStart);
+}
+
+/** Returns the next spectrum in the scan */
+int CScanFileHandler::GetNextSpectrum(CSpectrum &spec){
+	if(m_specReadSoFarNum >= (unsigned int)m_specNum){
+		this->m_lastError = SpectrumIO::CSpectrumIO::ERROR_SPECTRUM_NOT_FOUND;
+		++m_specReadSoFarNum; // <-- go to the next spectum
+		return 0;
 	}
 
+	// If the spectrum is not in the buffer, then read in the next 
+	//	part of the file into the buffer.
+	if(!IsBuffered(m_specReadSoFarNum) && SUCCESS != FillSpectrumBuffer(m_specReadSoFarNum)){
+		// if there was an error reading the spectrum, the error-flag is set
+		++m_specReadSoFarNum; // <-- go to the next spectum
+		return 0;
+	}
+	if(GetBufferedError(m_specReadSoFarNum) != CSpectrumIO::ERROR_NO_ERROR){
+		// only this spectrum is corrupt, the following ones can still be read
+		this->m_lastError = GetBufferedError(m_specReadSoFarNum);
+		++m_specReadSoFarNum; // <-- go to the next spectum
+		return 0;
+	}
+	spec = m_spectrumBuffer.GetAt(m_specReadSoFarNum - m_spectrumBufferStart);
+
 	++m_specReadSoFarNum;
 
 	// set the start and stop time of the measurement
@@ -226,26 +329,20 @@ int CScanFileHandler::GetNextSpectrum(CSpectrum &spec){
 
 /** Returns the desired spectrum in the scan */
 int CScanFileHandler::GetSpectrum(CSpectrum &spec, long specNo){
-	CSpectrumIO reader;
-	reader.m_logFileWriter = NULL;	// nowhere to output the error messages
+	if(specNo < 0 || specNo >= m_specNum){
+		this->m_lastError = SpectrumIO::CSpectrumIO::ERROR_SPECTRUM_NOT_FOUND;
+		return 0;
+	}
 
-	if(m_spectrumBufferNum == m_specNum){
-		// We've read in the spectra into the buffer, just read it from there
-		// instead of reading from the file itself.
-		if(m_specReadSoFarNum >= m_spectrumBufferNum){
-			this->m_lastError = SpectrumIO::CSpectrumIO::ERROR_SPECTRUM_NOT_FOUND;
-			++m_specReadSoFarNum; // <-- go to the next spectum
-			return 0;
-		}else{
-			spec = m_spectrumBuffer.GetAt(m_specReadSoFarNum);
-		}
-	}else{
-		// read the sky and the dark spectra
-		if(SUCCESS != reader.ReadSpectrum(m_fileName, specNo, spec)){
-			this->m_lastError = reader.m_lastError;
-			return 0;
-		}
+	// If the spectrum is not in the buffer, then read in the part of the file around it
+	if(!IsBuffered(specNo) && SUCCESS != FillSpectrumBuffer(specNo)){
+		return 0;
 	}
+	if(GetBufferedError(specNo) != CSpectrumIO::ERROR_NO_ERROR){
+		this->m_lastError = GetBufferedError(specNo);
+		return 0;
+	}
+	spec = m_spectrumBuffer.GetAt(specNo - m_spectrumBufferStart);
 
 	// set the start and stop time of the measurement
 	if(this->m_stopTime < spec.m_info.m_stopTime)
@@ -255,6 +352,35 @@ int CScanFileHandler::GetSpectrum(CSpectrum &spec, long specNo){
 
 	return 1;
 }
+
+/** Returns the desired spectrum in the scan if it is held in memory */
+const CSpectrum *CScanFileHandler::GetLoadedSpectrum(long specNo) const{
+	if(!IsBuffered(specNo) || GetBufferedError(specNo) != CSpectrumIO::ERROR_NO_ERROR)
+		return NULL;
+
+	return &m_spectrumBuffer.GetAt(specNo - m_spectrumBufferStart);
+}
+
+/** Returns the memory used by the spectra held in memory */
+size_t CScanFileHandler::GetLoadedSize() const{
+	size_t size = 0;
+	for(int k = 0; k < m_spectrumBufferNum; ++k)
+		size += m_spectrumBuffer.GetAt(k).m_length * sizeof(SpecData);
+
+	return size;
+}
+
+/** Frees the spectra held in memory, except for the first spectrum in the file */
+void CScanFileHandler::ReleaseSpectra(){
+	int keepNum = (m_spectrumBufferStart == 0) ? min(m_spectrumBufferNum, 1) : 0;
+
+	m_spectrumBuffer.SetSize(keepNum);
+	m_spectrumBuffer.FreeExtra();
+	m_spectrumBufferError.SetSize(keepNum);
+	m_spectrumBufferError.FreeExtra();
+	m_spectrumBufferNum = keepNum;
+}
+
 /** Gets the dark spectrum of the scan */
 int CScanFileHandler::GetDark(CSpectrum &spec) const{
 	spec = m_dark;
@@ -307,7 +433,7 @@ void  CScanFileHandler::ResetCounter(){
 		m_specReadSoFarNum += 1;
 }
 
-int CScanFileHandler::GetSpectrumNumInFile(){
+int CScanFileHandler::GetSpectrumNumInFile() const{
 	return 	m_specNum;
 }
 /** Returns the interlace steps for the spectra in this scan-file.
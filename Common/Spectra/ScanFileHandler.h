@@ -67,6 +67,14 @@ namespace FileHandler
 			@return SUCCESS on success. @return FAIL if any error occurs */
 		RETURN_CODE CheckScanFile(const CString *fileName);
 
+		/** Checks the scan saved in the given filename, just as 'CheckScanFile', but
+			keeps all the spectra of the scan in memory no matter how long the file is. 
+			The file is read once and all following calls to 'GetSpectrum', 'GetNextSpectrum'
+			and 'GetLoadedSpectrum' are served from memory.
+			@param fileName - the name of the file in which the spectra of the scan are saved.
+			@return SUCCESS on success. @return FAIL if any error occurs */
+		RETURN_CODE LoadScanFile(const CString *fileName);
+
 		/** Gets the next spectrum in the scan. 
 			If any file-error occurs the parameter 'm_lastError' will be set.
 			@param spec - will on successful return be filled with the newly read spectrum.
@@ -80,6 +88,20 @@ namespace FileHandler
 			@return the number of spectra read.*/
 		int GetSpectrum(CSpectrum &spec, long specNo);
 
+		/** Returns the desired spectrum in the scan, without reading anything from the file.
+			@param specNo - The zero-based index into the scan-file.
+			@return a pointer to the spectrum if it is held in memory (which all spectra are
+				after a call to 'LoadScanFile'). @return NULL otherwise. */
+		const CSpectrum *GetLoadedSpectrum(long specNo) const;
+
+		/** Returns the memory used by the spectra held in memory [bytes] */
+		size_t GetLoadedSize() const;
+
+		/** Frees the memory used by the spectra held in memory, except for the
+			first spectrum in the file. After this, 'GetLoadedSpectrum' returns NULL
+			for all the other spectra, 'GetSpectrum' reads them from the file again. */
+		void ReleaseSpectra();
+
 		/** Gets the dark spectrum of the scan */
 		int GetDark(CSpectrum &spec) const;
 
@@ -122,7 +144,7 @@ namespace FileHandler
 		void  ResetCounter();
 
 		/** Retrieves the total number of spectra in the .pak-file (including sky and dark) */
-		int GetSpectrumNumInFile();
+		int GetSpectrumNumInFile() const;
 
 	private:
 		// ----------------------------------------------------------------------
@@ -158,12 +180,30 @@ namespace FileHandler
 		/** The total number of spectra in the current .pak-file */
 		int m_specNum;
 
+		/** Scan-files with fewer spectra than this are read into the buffer
+			completely when 'CheckScanFile' is called */
+		static const int MAX_BUFFERED_SPECTRA = 200;
+
+		/** The number of spectra which are read into the buffer at a time
+			from scan-files with more than 'MAX_BUFFERED_SPECTRA' spectra */
+		static const int SPECTRUM_WINDOW_SIZE = 64;
+
 		/** An array containing the spectra in the current spectrum file.
 			These are read in when 'CheckScanFile' is called and retrieved
 			by GetSpectrum(...)
-			The buffer is introduced to save some read/writes from hard-disk */
+			The buffer is introduced to save some read/writes from hard-disk.
+			For long scan-files this holds only the 'SPECTRUM_WINDOW_SIZE' spectra
+			starting at 'm_spectrumBufferStart' and is refilled when needed. */
 		CArray <CSpectrum, CSpectrum&> m_spectrumBuffer;
+
+		/** The result of reading each of the spectra in m_spectrumBuffer. This is 
+			CSpectrumIO::ERROR_NO_ERROR for the spectra which could be read and
+			the error from CSpectrumIO for the spectra which could not be read. */
+		CArray <int, int> m_spectrumBufferError;
 		
+		/** The (zero-based) index into the file of the first spectrum in m_spectrumBuffer */
+		int m_spectrumBufferStart;
+
 		/** The number of spectra read in to the m_spectrumBuffer 
 			This might not be the same as 'm_specNum' */
 		int m_spectrumBufferNum;
@@ -171,6 +211,34 @@ namespace FileHandler
 		// --------------------- PRIVATE METHODS --------------------------------
 		// ----------------------------------------------------------------------
 
+		/** Opens the given scan-file and reads the spectra of the scan from it.
+			@param bufferAll - if true then all the spectra are kept in the buffer, 
+				otherwise only the first ones in long scan-files. */
+		RETURN_CODE OpenScanFile(const CString *fileName, bool bufferAll);
+
+		/** Reads the spectra of the scan from the scan-file 'm_fileName', which is opened as 'f'.
+			The file is read through once, without being opened again. */
+		RETURN_CODE ReadScanFile(FILE *f, SpectrumIO::CSpectrumIO &reader, bool bufferAll);
+
+		/** Reads 'number' spectra, starting at spectrum number 'first', from the 
+			scan-file 'm_fileName', which is opened as 'f', into the spectrum buffer. */
+		RETURN_CODE FillSpectrumBuffer(FILE *f, SpectrumIO::CSpectrumIO &reader, long first, long number);
+
+		/** Opens the scan-file and reads the 'SPECTRUM_WINDOW_SIZE' spectra starting
+			at spectrum number 'first' into the spectrum buffer. */
+		RETURN_CODE FillSpectrumBuffer(long first);
+
+		/** Gets spectrum number 'specNo' from the buffer if it is there, 
+			otherwise reads it from the scan-file which is opened as 'f' */
+		RETURN_CODE ReadBufferedSpectrum(FILE *f, SpectrumIO::CSpectrumIO &reader, long specNo, CSpectrum &spec);
+
+		/** Returns true if spectrum number 'specNo' is in the spectrum buffer */
+		bool IsBuffered(long specNo) const;
+
+		/** Returns the error from reading the buffered spectrum number 'specNo',
+			CSpectrumIO::ERROR_NO_ERROR if it could be read. 
+			'specNo' must be in the buffer. */
+		int GetBufferedError(long specNo) const;
 
 
 	};
@@ -1,23 +1,71 @@
 #include "StdAfx.h"
 #include "spectrum.h"
+#include "../VectorKernels.h"
 
 #include <cstdarg>
+#include <malloc.h>
 
 CSpectrum::CSpectrum(void)
 {
 	// reset everything 
-	memset(m_data, 0, sizeof(SpecData) * MAX_SPECTRUM_LENGTH);
+	m_data          = NULL;
 	m_length        = 0;
+	m_capacity      = 0;
 }
 
 CSpectrum::CSpectrum(const CSpectrum &spec){
+	m_data          = NULL;
+	m_length        = 0;
+	m_capacity      = 0;
+
+	*this = spec;
+}
+
+CSpectrum::CSpectrum(CSpectrum &&spec){
 	this->m_info    = spec.m_info;
+	this->m_data    = spec.m_data;
 	this->m_length  = spec.m_length;
-	memcpy(this->m_data, &spec.m_data, sizeof(SpecData) * MAX_SPECTRUM_LENGTH);
+	this->m_capacity= spec.m_capacity;
+
+	spec.m_data     = NULL;
+	spec.m_length   = 0;
+	spec.m_capacity = 0;
 }
 
 CSpectrum::~CSpectrum(void)
 {
+	_aligned_free(m_data);
+}
+
+void CSpectrum::Reserve(long capacity){
+	if(capacity <= m_capacity)
+		return;
+
+	// Allocate whole cache-lines, so that the vectorized loops never have 
+	//	to handle a partial line at the end of the spectrum
+	const long pixelsPerLine = SPECTRUM_ALIGNMENT / sizeof(SpecData);
+	capacity = ((capacity + pixelsPerLine - 1) / pixelsPerLine) * pixelsPerLine;
+
+	SpecData *data = (SpecData *)_aligned_malloc(capacity * sizeof(SpecData), SPECTRUM_ALIGNMENT);
+	if(data == NULL)
+		AfxThrowMemoryException();
+
+	if(m_length > 0)
+		memcpy(data, m_data, m_length * sizeof(SpecData));
+
+	_aligned_free(m_data);
+	m_data     = data;
+	m_capacity = capacity;
+}
+
+void CSpectrum::SetLength(long length){
+	length = max(min(length, MAX_SPECTRUM_LENGTH), 0);
+
+	Reserve(length);
+	if(length > m_length)
+		memset(m_data + m_length, 0, (length - m_length) * sizeof(SpecData));
+
+	m_length = length;
 }
 
 
@@ -34,33 +82,28 @@ int CSpectrum::AssertRange(long &fromPixel, long &toPixel) const{
 SpecData CSpectrum::MaxValue(long fromPixel, long toPixel) const{
 	/* Check the input */
 	AssertRange(fromPixel, toPixel);
+	if(fromPixel < 0 || fromPixel > toPixel)
+		return 0;
 
-	SpecData maxv = m_data[fromPixel];
-	for(long i = fromPixel+1; i <= toPixel; ++i){
-		maxv = max(maxv, m_data[i]);
-	}
-	return maxv;
+	return CVectorKernels::Max(m_data + fromPixel, toPixel - fromPixel + 1);
 }
 
 SpecData CSpectrum::MinValue(long fromPixel, long toPixel) const{
 	/* Check the input */
 	AssertRange(fromPixel, toPixel);
+	if(fromPixel < 0 || fromPixel > toPixel)
+		return 0;
 	  
-	SpecData minv = m_data[fromPixel];
-	for(long i = fromPixel+1; i <= toPixel; ++i){
-		minv = min(minv, m_data[i]);
-	}
-	return minv;
+	return CVectorKernels::Min(m_data + fromPixel, toPixel - fromPixel + 1);
 }
 
 SpecData CSpectrum::AverageValue(long fromPixel, long toPixel) const{
 	/* Check the input */
 	AssertRange(fromPixel, toPixel);
+	if(fromPixel < 0 || fromPixel > toPixel)
+		return 0;
 
-	SpecData avg = m_data[fromPixel];
-	for(long i = fromPixel+1; i <= toPixel; ++i){
-		avg += m_data[i];
-	}
+	SpecData avg = CVectorKernels::Sum(m_data + fromPixel, toPixel - fromPixel + 1);
 	return (avg / (SpecData)(toPixel - fromPixel + 1));
 }
 
@@ -80,63 +123,86 @@ int CSpectrum::Add(const CSpectrum &spec){
 	if(m_info.m_stopTime < localCopy)
 		m_info.m_stopTime = localCopy;
 
-	return PixelwiseOperation(spec, &CSpectrum::Plus);
+	CVectorKernels::Add(m_data, spec.m_data, m_length);
+	return 0;
 }
 int CSpectrum::Add(const SpecData value){
-	return PixelwiseOperation(value, &CSpectrum::Plus);
+	CVectorKernels::Add(m_data, m_length, value);
+	return 0;
 }
 
 // Subtraction
 int CSpectrum::Sub(const CSpectrum &spec){
-	return PixelwiseOperation(spec, &CSpectrum::Minus);
+	if(m_length != spec.m_length)
+		return 1;
+
+	CVectorKernels::Sub(m_data, spec.m_data, m_length);
+	return 0;
 }
 
 int CSpectrum::Sub(const SpecData value){
-	return PixelwiseOperation(value, &CSpectrum::Minus);
+	CVectorKernels::Sub(m_data, m_length, value);
+	return 0;
 }
 
 // Multiplication
 int CSpectrum::Mult(const CSpectrum &spec){
-	return PixelwiseOperation(spec, &CSpectrum::Multiply);
+	if(m_length != spec.m_length)
+		return 1;
+
+	CVectorKernels::Mul(m_data, spec.m_data, m_length);
+	return 0;
 }
 
 int CSpectrum::Mult(const SpecData value){
-	return PixelwiseOperation(value, &CSpectrum::Multiply);
+	CVectorKernels::Mul(m_data, m_length, value);
+	return 0;
 }
 
 // Division
 int CSpectrum::Div(const CSpectrum &spec){
-	return PixelwiseOperation(spec, &CSpectrum::Divide);
-}
-int CSpectrum::Div(const SpecData value){
-	return PixelwiseOperation(value, &CSpectrum::Divide);
-}
-
-// performe the supplied operation on all pixels in the two spectra
-int CSpectrum::PixelwiseOperation(const CSpectrum &spec, SpecData f(SpecData, SpecData)){
-	if(spec.m_length != m_length)
+	if(m_length != spec.m_length)
 		return 1;
 
-	for(long i = 0; i < m_length; ++i){
-		m_data[i] = f(m_data[i], spec.m_data[i]);
-	}
-
+	CVectorKernels::Div(m_data, spec.m_data, m_length);
 	return 0;
 }
-//  Performs the supplied function to every pixel in the current spectrum with the supplied constant 
-int CSpectrum::PixelwiseOperation(const SpecData value, SpecData f(SpecData, SpecData)){
-	for(long i = 0; i < m_length; ++i){
-		m_data[i] = f(m_data[i], value);
-	}
-
+int CSpectrum::Div(const SpecData value){
+	CVectorKernels::Div(m_data, m_length, value);
 	return 0;
 }
 
 CSpectrum &CSpectrum::operator =(const CSpectrum &s2){
-	this->m_length = min(s2.m_length, MAX_SPECTRUM_LENGTH);
-	this->m_length = max(this->m_length, 0);
+	if(this == &s2)
+		return *this;
+
+	long length = max(min(s2.m_length, MAX_SPECTRUM_LENGTH), 0);
+
+	// the old data does not need to be kept when growing the storage
+	this->m_length = 0;
+	Reserve(length);
+
+	this->m_length = length;
 	this->m_info = s2.m_info;
-	memcpy(m_data, s2.m_data, sizeof(SpecData) * m_length);
+	if(m_length > 0)
+		memcpy(m_data, s2.m_data, sizeof(SpecData) * m_length);
+	return *this;
+}
+
+CSpectrum &CSpectrum::operator =(CSpectrum &&s2){
+	if(this == &s2)
+		return *this;
+
+	_aligned_free(m_data);
+
+	this->m_info    = s2.m_info;
+	this->m_data    = s2.m_data;
+	this->m_length  = s2.m_length;
+	this->m_capacity= s2.m_capacity;
+
+	s2.m_data       = NULL;
+	s2.m_length     = 0;
+	s2.m_capacity   = 0;
 	return *this;
 }
 
@@ -194,8 +260,7 @@ bool CSpectrum::IsDark() const{
 }
 
 void CSpectrum::Clear(){
-	memset(m_data, 0, MAX_SPECTRUM_LENGTH*sizeof(SpecData));
-	
+	// the storage is kept, the pixels are zeroed by 'SetLength' when the spectrum grows again
 	m_length = 0;
 	// uchar
 	m_info.m_channel = m_info.m_flag = 0;
@@ -240,6 +305,7 @@ int	CSpectrum::Split(CSpectrum *spec[MAX_CHANNEL_NUM]) const{
 		spec[i]->m_info.m_interlaceStep = NSpectra;
 		spec[i]->m_info.m_channel       = i + 16 * (spec[i]->m_info.m_interlaceStep - 1);
 		spec[i]->m_length               = 0;
+		spec[i]->Reserve(m_length / NSpectra + 1);
 	}
 		
 	// Which spectrum to start with, the master or the slave channel
@@ -308,8 +374,8 @@ RETURN_CODE CSpectrum::InterpolateSpectrum(){
 	}
 
 	// Get the data back
-	memcpy(m_data, data, newLength*sizeof(SpecData));
-	m_length = m_length * step;
+	SetLength(newLength);
+	memcpy(m_data, data, m_length*sizeof(SpecData));
 
 	// Correct the channel number
 	switch(m_info.m_channel){
@@ -359,8 +425,8 @@ RETURN_CODE CSpectrum::InterpolateSpectrum(CSpectrum &spec) const{
 
 	// Get the data back
 	spec						= *this;
-	spec.m_length				= m_length * step;
-	memcpy(spec.m_data,			data,	newLength*sizeof(SpecData));
+	spec.SetLength(newLength);
+	memcpy(spec.m_data,			data,	spec.m_length*sizeof(SpecData));
 
 	// Correct the channel number
 	switch(m_info.m_channel){
@@ -15,9 +15,14 @@ public:
 	/** Default constructor. */
 	CSpectrum(void);
 
-	/** Copies the contents of 'spec' into this (new) spectrum. */
+	/** Copies the contents of 'spec' into this (new) spectrum. 
+		Only the first 'm_length' pixels of 'spec' are allocated and copied. */
 	CSpectrum(const CSpectrum &spec);
 
+	/** Moves the contents of 'spec' into this (new) spectrum. 
+		'spec' is left as an empty spectrum. */
+	CSpectrum(CSpectrum &&spec);
+
 	/** Default destructor */
 	~CSpectrum(void);
 
@@ -25,8 +30,11 @@ public:
 	// ------------------------ PUBLIC DATA ---------------------------------
 	// ----------------------------------------------------------------------
 
-	/** The spectral data */
-	SpecData  m_data[MAX_SPECTRUM_LENGTH];
+	/** The spectral data. This points to 'm_capacity' pixels, aligned to
+		SPECTRUM_ALIGNMENT bytes, of which the first 'm_length' are used.
+		Use 'SetLength' to change the length of the spectrum. 
+		This is NULL for a spectrum which has never been given any length. */
+	SpecData  *m_data;
 
 	/** The length of the spectrum */
 	long    m_length;
@@ -50,6 +58,10 @@ public:
 	/** Clears the supplied spectrum. This erases all data in the spectrum */
 	void  Clear();
 
+	/** Changes the length of the spectrum to 'length' pixels (at most MAX_SPECTRUM_LENGTH).
+		The storage is grown if necessary, the pixels beyond the old length are set to zero. */
+	void  SetLength(long length);
+
 	/** Adds the provided spectrum to the current. This spectrum will afterwards
 		contain the sum of the two spectra. Both spectra must have the same length. 
 		@return 1 if the spectra have different length. */
@@ -157,22 +169,24 @@ public:
 	/** Assignment operator */
 	CSpectrum &operator=(const CSpectrum &s2);
 
+	/** Move assignment operator, 's2' is left as an empty spectrum. */
+	CSpectrum &operator=(CSpectrum &&s2);
+
 	/** Returns true if this spectrum is dark */
 	bool  IsDark() const;
 
-private:
-	/** Asserts that the range [fromPixel, toPixel] (inclusive) is a valid range for this spectrum. */
-	int AssertRange(long &fromPixel, long &toPixel) const;
+	/** The alignment of the spectral data, in bytes */
+	static const int SPECTRUM_ALIGNMENT = 64;
 
-	/** Performs the supplied function to every pixel in the two spectra */
-	int PixelwiseOperation(const CSpectrum &spec, SpecData f(SpecData, SpecData));
+private:
+	/** The number of pixels allocated in 'm_data' */
+	long    m_capacity;
 
-	/** Performs the supplied function to every pixel in the current spectrum with the supplied constant */
-	int PixelwiseOperation(const SpecData value, SpecData f(SpecData, SpecData));
+	/** Makes sure that 'm_data' can hold at least 'capacity' pixels, 
+		the first 'm_length' pixels are kept. */
+	void  Reserve(long capacity);
 
-	static SpecData Plus(SpecData a, SpecData b){return a+b;}
-	static SpecData Minus(SpecData a, SpecData b){return a-b;}
-	static SpecData Divide(SpecData a, SpecData b){return a/b;}
-	static SpecData Multiply(SpecData a, SpecData b){return a*b;}
+	/** Asserts that the range [fromPixel, toPixel] (inclusive) is a valid range for this spectrum. */
+	int AssertRange(long &fromPixel, long &toPixel) const;
 
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "StdAfx.h"
+#include "SpectrumCache.h"
+
+#include "SpectrumIO.h"
+#include "../SpectrumFormat/STDFile.h"
+#include "../SpectrumFormat/TXTFile.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace SpectrumIO;
+
+std::map<CString, CSpectrumCache::CacheEntry> CSpectrumCache::s_cache;
+unsigned long CSpectrumCache::s_useCounter = 0;
+unsigned long CSpectrumCache::s_hitNum = 0;
+unsigned long CSpectrumCache::s_missNum = 0;
+std::mutex CSpectrumCache::s_cacheMutex;
+
+std::shared_ptr<const CSpectrum> CSpectrumCache::GetSpectrum(const CString &fileName){
+	struct _stat64 status;
+	CString message;
+
+	if(0 != _stat64(fileName, &status))
+		return nullptr; // the file does not exist
+
+	std::lock_guard<std::mutex> lock{ s_cacheMutex };
+
+	// 1. Look in the cache
+	CString key = GetCacheKey(fileName);
+	auto it = s_cache.find(key);
+	if(it != s_cache.end()){
+		if(it->second.fileSize == status.st_size && it->second.modificationTime == status.st_mtime){
+			it->second.lastUse = ++s_useCounter;
+			++s_hitNum;
+			return it->second.spectrum;
+		}
+
+		// the file has changed since it was read
+		s_cache.erase(it);
+	}
+
+	// 2. Read the file
+	std::shared_ptr<CSpectrum> spec = std::make_shared<CSpectrum>();
+	if(SUCCESS != ReadFile(fileName, *spec))
+		return nullptr;
+	++s_missNum;
+
+	message.Format("Read spectrum %s (spectrum cache: %lu hits, %lu misses)", fileName, s_hitNum, s_missNum);
+	ShowMessage(message);
+
+	// 3. Make room for the new spectrum by throwing out the least recently used one
+	if(s_cache.size() >= MAX_CACHED_SPECTRA){
+		auto oldest = s_cache.begin();
+		for(auto it = s_cache.begin(); it != s_cache.end(); ++it){
+			if(it->second.lastUse < oldest->second.lastUse)
+				oldest = it;
+		}
+		s_cache.erase(oldest);
+	}
+
+	CacheEntry &entry				= s_cache[key];
+	entry.spectrum					= spec;
+	entry.fileSize					= status.st_size;
+	entry.modificationTime	= status.st_mtime;
+	entry.lastUse						= ++s_useCounter;
+
+	return spec;
+}
+
+void CSpectrumCache::Invalidate(const CString &fileName){
+	std::lock_guard<std::mutex> lock{ s_cacheMutex };
+
+	s_cache.erase(GetCacheKey(fileName));
+}
+
+void CSpectrumCache::GetStatistics(unsigned long &hitNum, unsigned long &missNum){
+	std::lock_guard<std::mutex> lock{ s_cacheMutex };
+
+	hitNum	= s_hitNum;
+	missNum	= s_missNum;
+}
+
+RETURN_CODE CSpectrumCache::ReadFile(const CString &fileName, CSpectrum &spec){
+	if(Equals(fileName.Right(4), ".pak", 4)){
+		CSpectrumIO reader;
+		return reader.ReadSpectrum(fileName, 0, spec);
+	}
+
+	if(SUCCESS == CSTDFile::ReadSpectrum(spec, fileName))
+		return SUCCESS;
+
+	return CTXTFile::ReadSpectrum(spec, fileName);
+}
+
+CString CSpectrumCache::GetCacheKey(const CString &fileName){
+	CString key(fileName);
+	key.Replace('/', '\\');
+	key.MakeLower();
+	return key;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <map>
+
+#include "Spectrum.h"
+
+namespace SpectrumIO
+{
+	/** <b>CSpectrumCache</b> is a process-wide cache of spectra read from files
+		supplied by the user, such as dark, offset, dark-current and sky spectra.
+		These are used for every spectrum in every scan, the cache makes sure that
+		each file is only read once as long as it is not changed.
+		The cached spectra are shared and must not be changed, copy them if needed. 
+		The entries are keyed by the name of the file and validated against the 
+		size and the time of last modification of the file. */
+	class CSpectrumCache
+	{
+	public:
+		/** Returns the spectrum in the file 'fileName'. If the file is not in the
+			cache, or has changed since it was read, then it is read again.
+			.pak-files are read with CSpectrumIO (the first spectrum in the file is
+			returned), all other files are read as .std-files and, if that fails, 
+			as .txt-files. 
+			@return the spectrum, or nullptr if the file could not be read */
+		static std::shared_ptr<const CSpectrum> GetSpectrum(const CString &fileName);
+
+		/** Removes the spectrum in the given file from the cache */
+		static void Invalidate(const CString &fileName);
+
+		/** Retrieves the number of times a spectrum was found in the cache
+			and the number of times it had to be read from file */
+		static void GetStatistics(unsigned long &hitNum, unsigned long &missNum);
+
+	private:
+		/** The maximum number of spectra which are kept in memory */
+		static const int MAX_CACHED_SPECTRA = 32;
+
+		/** One entry in the cache */
+		struct CacheEntry
+		{
+			std::shared_ptr<const CSpectrum> spectrum;
+			__int64 fileSize;
+			__time64_t modificationTime;
+			unsigned long lastUse;
+		};
+
+		/** Reads the spectrum in the given file.
+			@return SUCCESS if the file could be read */
+		static RETURN_CODE ReadFile(const CString &fileName, CSpectrum &spec);
+
+		/** Returns the key into the cache for the given file */
+		static CString GetCacheKey(const CString &fileName);
+
+		/** The cached spectra, keyed by the (lower case) name of the file */
+		static std::map<CString, CacheEntry> s_cache;
+
+		/** Incremented every time the cache is used, to find the least recently used entry */
+		static unsigned long s_useCounter;
+
+		/** The number of times a spectrum was found in the cache */
+		static unsigned long s_hitNum;
+
+		/** The number of times a spectrum had to be read from file */
+		static unsigned long s_missNum;
+
+		/** Protects the cache from being changed from two threads simultaneously */
+		static std::mutex s_cacheMutex;
+	};
+}
@@ -7,6 +7,7 @@ CSpectrumIO::CSpectrumIO(void)
 {
 	this->m_lastError = ERROR_NO_ERROR;
 	this->m_logFileWriter = NULL;
+	this->m_lastCompressedSize = 0;
 }
 
 CSpectrumIO::~CSpectrumIO(void)
@@ -15,11 +16,7 @@ CSpectrumIO::~CSpectrumIO(void)
 
 int CSpectrumIO::CountSpectra(const CString &fileName){
 	CString errorMessage; // a string used for error messages
-	unsigned long specNum = 0;
-	int headerSize;
 
-	unsigned short *p = NULL;
-	
 	FILE *f = fopen(fileName, "rb");
 
 	if(f == NULL){
@@ -29,52 +26,19 @@ int CSpectrumIO::CountSpectra(const CString &fileName){
 		return(1);
 	}
 
-	while(1)
-	{
-		int ret = ReadNextSpectrumHeader(f, headerSize);
-		if(ret == 1)
-			break;
-		if(ret == 2)
-			continue;
-
-		char textBuffer[4];
-
-		// Seek our way into the next spectrum...
-		if(0 != fseek(f, min(MKZY.size, 4*MAX_SPECTRUM_LENGTH), SEEK_CUR))
-			break;
-
-		// Make sure we're at the right place, if not rewind again and search for the next
-		// occurence of the "MKZY" string, which signals the start of a 'new' spectrum.
-		fread(textBuffer, 1, 4, f);
-		if(NULL == strstr(textBuffer, "MKZY")){
-			// rewind
-			if(0 != fseek(f, -min(MKZY.size, 4*MAX_SPECTRUM_LENGTH), SEEK_CUR))
-				break;
-		}else{
-			if(0 != fseek(f, -4, SEEK_CUR))
-				break;
-		}
-
-		++specNum;
-		continue;
-	}
+	std::shared_ptr<const CPakFileIndex> index = GetIndex(fileName, f);
 
 	// signals that there's no error in the file.
 	m_lastError = ERROR_SPECTRUM_NOT_FOUND;
 
 	fclose(f);
 
-	return specNum;
+	return index->SpectrumNum();
 }
 
 int CSpectrumIO::ScanSpectrumFile(const CString &fileName, const CString *specNamesToLookFor, int numSpecNames, int *indices){
 	CString errorMessage; // a string used for error messages
-	CString specName;
-	Common common;
-	unsigned long specNum = 0;
-	int headerSize, nameIndex;
 
-	unsigned short *p = NULL;
 	FILE *f = fopen(fileName, "rb");
 
 	if(f == NULL){
@@ -84,18 +48,22 @@ int CSpectrumIO::ScanSpectrumFile(const CString &fileName, const CString *specNa
 		return(1);
 	}
 
-	while(1)
-	{
-		int ret = ReadNextSpectrumHeader(f, headerSize);
-		if(ret == 1)
-			break;
-		if(ret == 2)
-			continue;
+	int specNum = ScanSpectrumFile(fileName, f, specNamesToLookFor, numSpecNames, indices);
+	fclose(f);
+
+	return specNum;
+}
+
+int CSpectrumIO::ScanSpectrumFile(const CString &fileName, FILE *f, const CString *specNamesToLookFor, int numSpecNames, int *indices){
+	int nameIndex;
+
+	std::shared_ptr<const CPakFileIndex> index = GetIndex(fileName, f);
+
+	const int specNum = index->SpectrumNum();
+	for(int k = 0; k < specNum; ++k){
+		const CString &specName = index->m_name[k];
 
 		/** Look in the buffer */
-		// 1. Clean the spectrum name from special characters...
-		Common::CleanString(MKZY.name, specName);
-		specName.Trim(" \t");
 		size_t size1 = strlen(specName);
 		for(nameIndex = 0; nameIndex < numSpecNames; ++nameIndex){
 			// first of all, the strings must have equal size to be equal...
@@ -104,54 +72,22 @@ int CSpectrumIO::ScanSpectrumFile(const CString &fileName, const CString *specNa
 				continue;
 
 			if(Equals(specNamesToLookFor[nameIndex], specName)){
-				indices[nameIndex] = specNum;
+				indices[nameIndex] = k;
 				continue;
 			}
 		}
-
-		char textBuffer[4];
-
-		// Seek our way into the next spectrum...
-		if(0 != fseek(f, min(MKZY.size, 4*MAX_SPECTRUM_LENGTH), SEEK_CUR))
-			break;
-
-		// Make sure we're at the right place, if not rewind again and search for the next
-		// occurence of the "MKZY" string, which signals the start of a 'new' spectrum.
-		fread(textBuffer, 1, 4, f);
-		if(NULL == strstr(textBuffer, "MKZY")){
-			// rewind
-			if(0 != fseek(f, -min(MKZY.size, 4*MAX_SPECTRUM_LENGTH), SEEK_CUR))
-				break;
-		}else{
-			if(0 != fseek(f, -4, SEEK_CUR))
-				break;
-		}
-
-		++specNum;
-		continue;
 	}
 
 	// signals that there's no error in the file.
 	this->m_lastError = ERROR_SPECTRUM_NOT_FOUND;
 
-	fclose(f);
-
 	return specNum;
 }
 
 RETURN_CODE CSpectrumIO::ReadSpectrum(const CString &fileName, const int spectrumNumber, CSpectrum &spec, char *headerBuffer /* = NULL*/, int headerBufferSize /* = 0*/, int *headerSize /* = NULL*/){
 	CString errorMessage; // a string used for error messages
-	MKPack mkPack;
-
-	long i,j;
-	long outlen;
-	unsigned long chk;
-	unsigned short checksum;
 	int hdrSize;
 
-	unsigned short *p = NULL;
-
-	i = 0;
 	FILE *f = fopen(fileName, "rb");
 
 	if(f == NULL){
@@ -161,122 +97,115 @@ RETURN_CODE CSpectrumIO::ReadSpectrum(const CString &fileName, const int spectru
 		return FAIL;
 	}
 
-	while(1)
-	{
-		int ret;
-		if(headerBuffer != NULL)
-			ret = ReadNextSpectrumHeader(f, *headerSize, &spec, headerBuffer, headerBufferSize);
-		else
-			ret = ReadNextSpectrumHeader(f, hdrSize, &spec);
-		if(ret == 1)
-			break;
-		if(ret == 2)
-			continue;
+	// Go directly to the desired spectrum using the index of the file
+	if(SUCCESS != FindSpectrumNumber(fileName, f, spectrumNumber)){
+		fclose(f);
+		return FAIL;
+	}
 
-		if(i != spectrumNumber){
-			char textBuffer[4];
+	// Read the spectrum
+	m_lastError = ERROR_NO_ERROR;
+	RETURN_CODE ret = ReadNextSpectrum(f, spec, (headerSize != NULL) ? *headerSize : hdrSize, headerBuffer, headerBufferSize);
+	if(ret != SUCCESS && m_lastError == ERROR_NO_ERROR){
+		// there was no spectrum header where the index said there would be one
+		m_lastError = ERROR_SPECTRUM_NOT_FOUND;
+	}
 
-			// Seek our way into the next spectrum...
-			if(0 != fseek(f, min(MKZY.size, 4*MAX_SPECTRUM_LENGTH), SEEK_CUR))
-				break;
+	fclose(f);
 
-			// Make sure we're at the right place, if not rewind again and search for the next
-			// occurence of the "MKZY" string, which signals the start of a 'new' spectrum.
-			if(fread(textBuffer, 1, 4, f) < 4)
-				break;
-			if(NULL == strstr(textBuffer, "MKZY")){
-				// rewind
-				if(0 != fseek(f, -min(MKZY.size, 4*MAX_SPECTRUM_LENGTH), SEEK_CUR))
-					break;
-			}else{
-				if(0 != fseek(f, -4, SEEK_CUR))
-					break;
-			}
+	return ret;
+}
 
-			++i;
-			continue;
-		}
-		else
-		{
-			// read the spectrum from the file
-
-			if(MKZY.size > sizeof(buffer)){
-				// compressed data is too long. We cannot read the full spectrum.
-				m_lastError = ERROR_SPECTRUM_TOO_LARGE;
-				fclose(f);
-				return FAIL;
-			}
+RETURN_CODE CSpectrumIO::FindSpectrumNumber(const CString &fileName, FILE *f, int spectrumNumber){
+	if(f == NULL)
+		return FAIL;
 
-			if(fread(buffer,1,MKZY.size,f) < MKZY.size) //read compressed info
-			{
-				errorMessage.Format("Error EOF! in %s", fileName);
-				ShowMessage(errorMessage);
-				fclose(f);
-				m_lastError = ERROR_EOF;
-				return FAIL;
-			}
+	std::shared_ptr<const CPakFileIndex> index = GetIndex(fileName, f);
+	multisize = index->SpectrumNum();
 
-			if(MKZY.pixels > sizeof(outbuf)*sizeof(long)){
-				// The spectrum is longer than what the buffer can handle. Trying to
-				// uncompress the whole spectrum will result in a buffer overflow.
-				// this spectrum cannot be read - return.
-				m_lastError = ERROR_SPECTRUM_TOO_LARGE;
-				fclose(f);
-				return FAIL;
-			}
+	if(spectrumNumber < 0 || spectrumNumber >= index->SpectrumNum()){
+		m_lastError = ERROR_SPECTRUM_NOT_FOUND;
+		return FAIL; // spectrum not found
+	}
 
-			outlen = mkPack.UnPack(buffer,MKZY.pixels, outbuf); //uncompress info(compressed buffer,num of sampling points, uncompressedinfo)
+	if(0 != fseek(f, index->m_offset[spectrumNumber], SEEK_SET)){
+		m_lastError = ERROR_COULD_NOT_CHANGE_POS;
+		return FAIL;
+	}
 
-			// validate that the decompression was ok - Added 2006.02.13 by MJ
-			if(outlen < 0){
-				m_lastError  = ERROR_DECOMPRESS;
-				fclose(f);
-				return FAIL;
-			}
-		
-			// validate that the spectrum is not too large - Added 2006.02.13 by MJ
-			if(outlen > MAX_SPECTRUM_LENGTH){
-				m_lastError = ERROR_SPECTRUM_TOO_LARGE;
-				fclose(f);
-				return FAIL;
-			}
+	return SUCCESS;
+}
 
-			// calculate the checksum
-		chk = 0;
-		for(j = 0; j < outlen && j < MAX_SPECTRUM_LENGTH; j++)
-		{
-			chk += outbuf[j];
-			spec.m_data[j] = outbuf[j];
-		}
-		p = (unsigned short *)&chk;
-		checksum = p[0] + p[1];
-		if(checksum != MKZY.checksum){
-			errorMessage.Format("Checksum mismatch %04x!=x%04x\n",checksum,MKZY.checksum);
-			ShowMessage(errorMessage);
-
-			m_lastError = ERROR_CHECKSUM_MISMATCH;
-			fclose(f);
-			return FAIL;
-		}else{
-			printf("Checksum is correct 0x%04x=0x%04x\n",checksum,MKZY.checksum);
+std::shared_ptr<const CPakFileIndex> CSpectrumIO::GetIndex(const CString &fileName, FILE *f){
+	// 1. Look in the cache
+	std::shared_ptr<const CPakFileIndex> index = CPakFileIndex::Lookup(fileName, f);
+	if(index != nullptr)
+		return index;
+
+	// 2. Look for a sidecar-file with the index
+	std::shared_ptr<CPakFileIndex> newIndex = std::make_shared<CPakFileIndex>();
+	if(CPakFileIndex::s_useSidecarFiles){
+		if(SUCCESS == newIndex->ReadSidecarFile(fileName) && newIndex->IsValidFor(f)){
+			CPakFileIndex::Store(fileName, newIndex);
+			return newIndex;
 		}
+		newIndex = std::make_shared<CPakFileIndex>();
+	}
 
-			// Get the maximum intensity
-			if(MKZY.pixels > 0){
-				spec.m_info.m_peakIntensity = (float)spec.MaxValue();
-				spec.m_info.m_offset        = (float)spec.GetOffset();
-			}
+	// 3. Build the index by going through the file
+	BuildIndex(f, *newIndex);
+	CPakFileIndex::Store(fileName, newIndex);
 
-		fclose(f);
+	if(CPakFileIndex::s_useSidecarFiles)
+		newIndex->WriteSidecarFile(fileName);
+
+	return newIndex;
+}
+
+void CSpectrumIO::BuildIndex(FILE *f, CPakFileIndex &index){
+	CString specName;
+	char textBuffer[4];
+	int headerSize;
+
+	index.SetFileStatus(f);
+
+	rewind(f);
 
-		return SUCCESS;
+	while(1)
+	{
+		long position = ftell(f);
+
+		int ret = ReadNextSpectrumHeader(f, headerSize);
+		if(ret == 1)
+			break;
+		if(ret == 2)
+			continue;
+
+		// Clean the spectrum name from special characters...
+		Common::CleanString(MKZY.name, specName);
+		specName.Trim(" \t");
+
+		index.Append(position, specName);
+
+		// Seek our way into the next spectrum...
+		if(0 != fseek(f, min(MKZY.size, 4*MAX_SPECTRUM_LENGTH), SEEK_CUR))
+			break;
+
+		// Make sure we're at the right place, if not rewind again and search for the next
+		// occurence of the "MKZY" string, which signals the start of a 'new' spectrum.
+		if(fread(textBuffer, 1, 4, f) < 4)
+			break;
+		if(0 != strncmp(textBuffer, "MKZY", 4)){
+			// rewind
+			if(0 != fseek(f, -min(MKZY.size, 4*MAX_SPECTRUM_LENGTH), SEEK_CUR))
+				break;
+		}else{
+			if(0 != fseek(f, -4, SEEK_CUR))
+				break;
 		}
 	}
-	multisize = i;
-	fclose(f);
 
-	this->m_lastError = ERROR_SPECTRUM_NOT_FOUND;
-	return FAIL; // spectrum not found
+	rewind(f);
 }
 
 /** Rewinds the gien file to the beginning and forwards the current position 
@@ -348,6 +277,9 @@ RETURN_CODE CSpectrumIO::ReadNextSpectrum(FILE *f, CSpectrum &spec, int &headerS
 
 	unsigned short *p = NULL;
 
+	// nothing can be copied from the buffer until the whole spectrum has been read and checked
+	m_lastCompressedSize = 0;
+
 	int ret = ReadNextSpectrumHeader(f, headerSize, &spec, headerBuffer, headerBufferSize);
 	if(ret != 0)
 		return FAIL;
@@ -414,8 +346,15 @@ RETURN_CODE CSpectrumIO::ReadNextSpectrum(FILE *f, CSpectrum &spec, int &headerS
 		printf("Checksum is correct 0x%04x=0x%04x\n",checksum,MKZY.checksum);
 	}
 
+	// the spectrum is only allocated for the number of pixels given in the header,
+	//	a corrupt file may decompress into more (or less) values than that
+	if(outlen != MKZY.pixels){
+		this->m_lastError = ERROR_DECOMPRESS;
+		return FAIL;
+	}
+
 	// copy the spectrum
-	for(j = 0; j < outlen && j < MAX_SPECTRUM_LENGTH; j++)
+	for(j = 0; j < outlen && j < spec.m_length; j++)
 		spec.m_data[j] = outbuf[j];
 
 
@@ -425,6 +364,23 @@ RETURN_CODE CSpectrumIO::ReadNextSpectrum(FILE *f, CSpectrum &spec, int &headerS
 		spec.m_info.m_offset        = (float)spec.GetOffset();
 	}
 
+	// the compressed data in 'buffer' is now known to be correct
+	m_lastCompressedSize = MKZY.size;
+
+	return SUCCESS;
+}
+
+/** Writes the spectrum last read by 'ReadNextSpectrum' to the opened file 'f', 
+		exactly as it was stored in the file it was read from. */
+RETURN_CODE CSpectrumIO::CopyLastSpectrum(FILE *f, const char *headerBuffer, int headerSize){
+	if(f == NULL || headerBuffer == NULL || headerSize <= 0 || m_lastCompressedSize == 0)
+		return FAIL;
+
+	if(1 != fwrite(headerBuffer, headerSize, 1, f))
+		return FAIL;
+	if(1 != fwrite(buffer, m_lastCompressedSize, 1, f))
+		return FAIL;
+
 	return SUCCESS;
 }
 
@@ -457,6 +413,26 @@ void CSpectrumIO::WriteDate(unsigned long &d, const unsigned short day[3]) const
 }
 
 int CSpectrumIO::AddSpectrumToFile(const CString &fileName, const CSpectrum &spectrum, const char *headerBuffer, int headerSize){
+	FILE *f = fopen(fileName,"r+b");
+	if(f == NULL) // this will happen if the file does not exist...
+		f = fopen(fileName,"w+b");
+	if(f == NULL){
+		return 1;
+	}
+
+	int ret = 1;
+	if(0 == fseek(f,0,SEEK_END)){
+		ret = AddSpectrumToFile(f, spectrum, headerBuffer, headerSize);
+	}
+	fclose(f);
+
+	// the file has changed, any index built for it is no longer valid
+	CPakFileIndex::Invalidate(fileName);
+
+	return ret;
+}
+
+int CSpectrumIO::AddSpectrumToFile(FILE *f, const CSpectrum &spectrum, const char *headerBuffer, int headerSize){
 
 	long last,tmp;
 	int i;
@@ -469,10 +445,9 @@ int CSpectrumIO::AddSpectrumToFile(const CString &fileName, const CSpectrum &spe
 	if(spectrum.m_length <= 0 || spectrum.m_length > MAX_SPECTRUM_LENGTH)
 		return 1;
 
-	// ---- start by converting the spectrum into 'long'
-	long *spec = new long[MAX_SPECTRUM_LENGTH];
-	if(spec == NULL)
-		return 1; // failure!
+	// ---- start by converting the spectrum into 'long'. 
+	//	'outbuf' is only used when reading spectra, use it here to save an allocation
+	long *spec = outbuf;
 	for(i = 0; i < spectrum.m_length; ++i)
 		spec[i] = (long)spectrum.m_data[i];
 
@@ -540,30 +515,17 @@ int CSpectrumIO::AddSpectrumToFile(const CString &fileName, const CSpectrum &spe
 	MKZY.viewangle      = (unsigned short)info.m_scanAngle;
 	MKZY.viewangle2     = (unsigned short)info.m_scanAngle2;
 
-	FILE *f = fopen(fileName,"r+b");
-	if(f == NULL) // this will happen if the file does not exist...
-		f = fopen(fileName,"w+b");
-	if(f == NULL){
-		delete sbuf;
-		delete spec;
-		return 1;
-	}
-
-	if(0 == fseek(f,0,SEEK_END)){
-		// Write the header
-		if(headerBuffer != NULL && headerSize != 0){
-			fwrite(headerBuffer, headerSize, 1, f);
-		}else{
-			fwrite(&MKZY,sizeof(struct MKZYhdr),1,f);
-		}
-		
-		// Write the spectrum data
-		fwrite(sbuf,outsiz,1,f);
+	// Write the header
+	if(headerBuffer != NULL && headerSize != 0){
+		fwrite(headerBuffer, headerSize, 1, f);
+	}else{
+		fwrite(&MKZY,sizeof(struct MKZYhdr),1,f);
 	}
-	fclose(f);
+	
+	// Write the spectrum data
+	fwrite(sbuf,outsiz,1,f);
 
-	delete sbuf;
-	delete spec;
+	delete[] sbuf;
 
 	return 0;
 }
@@ -613,9 +575,10 @@ int CSpectrumIO::ReadNextSpectrumHeader(FILE *f, int &headerSize, CSpectrum *spe
 	{
 		// If the user want the whole header, read it. Otherwise jump formwards
 		if(headerBuffer != NULL && headerBufferSize > MKZY.hdrsize){
-			if(fread(headerBuffer+local_headersize, 1, sizdiff, f) < sizdiff)
+			if(fread(headerBuffer+local_headersize, 1, sizdiff, f) < sizdiff){
 				m_lastError = ERROR_SPECTRUM_NOT_FOUND;
 				return FAIL;
+			}
 		}else{
 			fseek(f,sizdiff,SEEK_CUR);       // NOTE -- BUG CORRECTED 2006.02.14 BY MJ - was "fseek(f,sizdiff-8,SEEK_CUR);"
 		}
@@ -623,11 +586,11 @@ int CSpectrumIO::ReadNextSpectrumHeader(FILE *f, int &headerSize, CSpectrum *spe
 
 	if(spec != NULL){
 		// clear the spectrum
-		memset(spec->m_data, 0, MAX_SPECTRUM_LENGTH*sizeof(SpecData));
+		spec->m_length = 0;
+		spec->SetLength(MKZY.pixels);
 
 		CSpectrumInfo *info = &spec->m_info;
 		// save the spectrum information in the CSpectrum data structure
-		spec->m_length           = max(min(MKZY.pixels, MAX_SPECTRUM_LENGTH), 0);
 		info->m_startChannel     = MKZY.startc;
 		info->m_numSpec          = MKZY.scans;
 		info->m_exposureTime     = (MKZY.exptime > 0) ? MKZY.exptime : -MKZY.exptime;
@@ -3,6 +3,9 @@
 #include "Spectrum.h"
 #include "../LogFileWriter.h"
 #include "../SpectrumFormat/MKPack.h"
+#include "PakFileIndex.h"
+
+#include <memory>
 
 namespace SpectrumIO
 {
@@ -47,6 +50,15 @@ namespace SpectrumIO
 					way or the spectrum number 'spectrumNumber' does not exist in this file. */
 		RETURN_CODE FindSpectrumNumber(FILE *f, int spectrumNumber);
 
+		/** Forwards the current position in the given file to the beginning of spectrum
+				number 'spectrumNumber' (zero-based index), using the index of the file 'fileName'
+				which is opened as 'f'. The index is built on first use.
+				Unlike the function above this does not search the file for the 'MKZY' string,
+				the numbering of the spectra is the same as in 'ReadSpectrum'.
+				Return SUCCESS if all is ok, return FAIL if the spectrum number 'spectrumNumber'
+					does not exist in this file. */
+		RETURN_CODE FindSpectrumNumber(const CString &fileName, FILE *f, int spectrumNumber);
+
 		/** Reads the next spectrum in the provided spectrum file.
 				The spectrum file (which must be in the .pak format) must be opened for reading
 				in binary mode. File will not be closed by this routine.
@@ -70,6 +82,21 @@ namespace SpectrumIO
 			*/
 		int AddSpectrumToFile(const CString &fileName, const CSpectrum &spec, const char *headerBuffer = NULL, int headerSize = 0);
 
+		/** Adds a new spectrum at the current position of the given file, which must be opened 
+			for writing in binary mode. File will not be closed by this routine.
+			The parameters are the same as above. */
+		int AddSpectrumToFile(FILE *f, const CSpectrum &spec, const char *headerBuffer = NULL, int headerSize = 0);
+
+		/** Writes the spectrum which was last read by 'ReadNextSpectrum' to the given file,
+			exactly as it was stored in the file it was read from: the binary header followed
+			by the compressed spectrum data. The spectrum is not compressed again.
+			@param f - the file to write to, opened for writing in binary mode.
+			@param headerBuffer - the binary header of the spectrum, as returned by 'ReadNextSpectrum'.
+			@param headerSize - the size of the binary header, as returned by 'ReadNextSpectrum'.
+			@return SUCCESS if the spectrum was written. 
+			@return FAIL if the last read spectrum could not be read correctly, or the writing failed. */
+		RETURN_CODE CopyLastSpectrum(FILE *f, const char *headerBuffer, int headerSize);
+
 		/** Opens The spectrum file and counts how many spectra there are in the file. 
 				@param fileName - the name and path of the .pak-file to open
 				@return - The number of spectra in the spectrum file. */
@@ -94,6 +121,10 @@ namespace SpectrumIO
 			@return - The number of spectra in the spectrum file */
 		int ScanSpectrumFile(const CString &fileName, const CString *specNamesToLookFor, int numSpecNames, int *indices);
 
+		/** Same as above but uses the spectrum file 'fileName' which is already opened 
+			for reading as 'f'. Use 'FindSpectrumNumber' to position the file afterwards. */
+		int ScanSpectrumFile(const CString &fileName, FILE *f, const CString *specNamesToLookFor, int numSpecNames, int *indices);
+
 		/** A log file handler. If this is not-null the error output will be directed to this log file */
 		FileHandler::CLogFileWriter *m_logFileWriter;
 
@@ -117,6 +148,10 @@ namespace SpectrumIO
 		/** ?? */
 		long multisize;
 
+		/** The size of the compressed data in 'buffer' of the last spectrum which was
+			successfully read by 'ReadNextSpectrum', zero if the last read failed. */
+		long m_lastCompressedSize;
+
 		/** Reads a spectrum header from the supplied file. The result
 				will be saved to the member-variable 'MKZY'. If a CSpectrum
 				is provided, the header information will also be saved in the spectrum. 
@@ -129,6 +164,15 @@ namespace SpectrumIO
 				@return 1 - ...*/
 		int ReadNextSpectrumHeader(FILE *f, int &headerSize, CSpectrum *spec = NULL, char *headerBuffer = NULL, int headerBufferSize = 0);
 
+		/** Returns the index of the spectrum file 'fileName', which is opened as 'f'.
+				The index is taken from the shared cache if it is there and still valid, 
+				otherwise it is read from the sidecar-file or built by going through the file once. */
+		std::shared_ptr<const CPakFileIndex> GetIndex(const CString &fileName, FILE *f);
+
+		/** Goes through the opened spectrum file 'f' once and fills in the position and
+				name of each spectrum into 'index'. */
+		void BuildIndex(FILE *f, CPakFileIndex &index);
+
 		/** Converts a time from unsigned long to CSpectrumTime */
 		void ParseTime(const unsigned long t, CSpectrumTime &time) const;
 
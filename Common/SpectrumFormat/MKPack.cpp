@@ -163,11 +163,15 @@ unsigned short MKPack::mk_compress(long *in,unsigned char *ut,unsigned short siz
 long MKPack::UnPack(unsigned char *inpek, long kvar, long *ut )
 {
 	long *utpek = NULL;
-	short len,curr;
-	short j,jj;
-	long a;
+	long len, curr;
+	long jj;
+	unsigned long sum = 0;
 	unsigned short lentofile=0;
-	long bit = 0;
+
+	// the bits read from 'inpek' but not yet used, the last 'nBits' bits of 'bits'
+	//	are the next bits in the compressed data
+	unsigned __int64 bits = 0;
+	long nBits = 0;
 
 	// validate the input data - Added 2006.02.13 by MJ
 	if(kvar > MAX_SPECTRUM_LENGTH)
@@ -180,49 +184,43 @@ long MKPack::UnPack(unsigned char *inpek, long kvar, long *ut )
 	lentofile = 0;
 	while(kvar > 0)
 	{
-		len = 0;
-		for(j = 0; j < 7; j++)
-		{
-			len += len;
-			len |= inpek[(bit>>3)]>>(7-(bit&0x7))&1;
-			bit++;
-		}
-		curr = 0;
-		for(j = 0; j < 5; j++)
-		{
-			curr += curr;
-			curr |= inpek[(bit>>3)]>>(7-(bit&0x7))&1;
-			bit++;
+		// the header of the segment: 7 bits for the number of values 
+		//	and 5 bits for the number of bits per value
+		while(nBits < headsiz){
+			bits = (bits << 8) | *inpek++;
+			nBits += 8;
 		}
+		nBits -= headsiz;
+		len  = (long)(bits >> (nBits + 5)) & 0x7f;
+		curr = (long)(bits >> nBits) & 0x1f;
+
 		if(curr)
 		{
+			const unsigned long mask = (1UL << curr) - 1;
+			const unsigned long sign = 1UL << (curr - 1);
+
 			for(jj = 0; jj < len; jj++)
 			{
-				a = inpek[(bit>>3)]>>(7-(bit&0x7))&1;
-				if(a)
-					a = -1;
-				bit++;
-				for(j = 1; j < curr; j++)
-				{
-					a += a;
-					a |= inpek[(bit>>3)]>>(7-(bit&0x7))&1;
-					bit++;
+				while(nBits < curr){
+					bits = (bits << 8) | *inpek++;
+					nBits += 8;
 				}
-				*utpek++ = a;
+				nBits -= curr;
+
+				// the values are stored as 'curr'-bit two's complement numbers
+				//	and are the differences between consecutive pixels
+				unsigned long a = (unsigned long)(bits >> nBits) & mask;
+				sum += (a ^ sign) - sign;
+				*utpek++ = (long)sum;
 			}
 		 }
 		 else 
 			 for(jj = 0;jj < len; jj++)
-				 *utpek++=0;
+				 *utpek++ = (long)sum;
 
 		kvar -= len;			
-		lentofile += len;
-	}
-	for(jj=1;jj<lentofile;jj++)
-	{
-		ut[jj] += ut[jj-1];
+		lentofile += (unsigned short)len;
 	}
-//	fclose(f);
 
 	return(lentofile);
 }
@@ -44,7 +44,7 @@ RETURN_CODE CSTDFile::ReadSpectrum(CSpectrum &spec, const CString &fileName){
 	if(1 > sscanf(buffer, "%d", &tmpInt)){
 		fclose(f); return FAIL;
 	}
-	spec.m_length = min(tmpInt, MAX_SPECTRUM_LENGTH);
+	spec.SetLength(min(tmpInt, MAX_SPECTRUM_LENGTH));
 
 	// 4. The spectrum data
 	for(int i = 0; i < spec.m_length; ++i){
@@ -22,6 +22,7 @@ RETURN_CODE CTXTFile::ReadSpectrum(CSpectrum &spec, const CString &fileName){
 
 	// Clear all the information in the spectrum
 	spec.Clear();
+	spec.SetLength(MAX_SPECTRUM_LENGTH);
 
 	// Simply read the spectrum, one pixel at a time
 	int length = 0;
@@ -36,7 +37,7 @@ RETURN_CODE CTXTFile::ReadSpectrum(CSpectrum &spec, const CString &fileName){
 
 		++length;
 	}
-	spec.m_length = length;
+	spec.SetLength(length);
 
 	// close the file before we return
 	fclose(f);
@@ -0,0 +1,442 @@
+#include "StdAfx.h"
+#include "VectorKernels.h"
+
+#include <math.h>
+#include <float.h>
+#include <intrin.h>
+#include <immintrin.h>
+
+// The kernels are written once, as templates over the instruction set.
+//	Each template processes as many whole vectors as fits in the array and
+//	returns the index of the first pixel which was not processed, the remaining
+//	pixels are then handled by the scalar loop in the public function.
+//	With INSTRUCTION_SET_SCALAR the scalar loop handles the whole array.
+
+CVectorKernels::INSTRUCTION_SET CVectorKernels::s_instructionSet = CVectorKernels::GetSupportedInstructionSet();
+
+namespace
+{
+	/** The SSE2 implementation of the vector operations, two pixels at a time */
+	struct Sse2
+	{
+		typedef __m128d V;
+		static const long N = 2;
+		static const int ALL = 0x3;
+
+		static V Load(const double *p){ return _mm_loadu_pd(p); }
+		static void Store(double *p, V v){ _mm_storeu_pd(p, v); }
+		static V Set(double v){ return _mm_set1_pd(v); }
+
+		static V Add(V a, V b){ return _mm_add_pd(a, b); }
+		static V Sub(V a, V b){ return _mm_sub_pd(a, b); }
+		static V Mul(V a, V b){ return _mm_mul_pd(a, b); }
+		static V Div(V a, V b){ return _mm_div_pd(a, b); }
+		static V Max(V a, V b){ return _mm_max_pd(a, b); }
+		static V Min(V a, V b){ return _mm_min_pd(a, b); }
+
+		static V And(V a, V b){ return _mm_and_pd(a, b); }
+		static V AndNot(V a, V b){ return _mm_andnot_pd(a, b); }
+		static V Equal(V a, V b){ return _mm_cmpeq_pd(a, b); }
+		static V Greater(V a, V b){ return _mm_cmpgt_pd(a, b); }
+		static V GreaterEqual(V a, V b){ return _mm_cmpge_pd(a, b); }
+		static V LessEqual(V a, V b){ return _mm_cmple_pd(a, b); }
+		static int MoveMask(V a){ return _mm_movemask_pd(a); }
+
+		/** The unbiased exponent of each (positive, normal) value */
+		static V Exponent(V x){
+			__m128i e = _mm_srli_epi64(_mm_castpd_si128(x), 52);
+			e = _mm_shuffle_epi32(e, _MM_SHUFFLE(3, 3, 2, 0));
+			return _mm_sub_pd(_mm_cvtepi32_pd(e), _mm_set1_pd(1023.0));
+		}
+
+		/** The mantissa of each (positive, normal) value, in the range [1, 2) */
+		static V Mantissa(V x){
+			__m128i bits = _mm_and_si128(_mm_castpd_si128(x), _mm_set1_epi64x(0x000FFFFFFFFFFFFFLL));
+			bits = _mm_or_si128(bits, _mm_set1_epi64x(0x3FF0000000000000LL));
+			return _mm_castsi128_pd(bits);
+		}
+
+		static void Lanes(V v, double *lanes){ _mm_storeu_pd(lanes, v); }
+	};
+
+	/** The AVX2 implementation of the vector operations, four pixels at a time */
+	struct Avx2
+	{
+		typedef __m256d V;
+		static const long N = 4;
+		static const int ALL = 0xF;
+
+		static V Load(const double *p){ return _mm256_loadu_pd(p); }
+		static void Store(double *p, V v){ _mm256_storeu_pd(p, v); }
+		static V Set(double v){ return _mm256_set1_pd(v); }
+
+		static V Add(V a, V b){ return _mm256_add_pd(a, b); }
+		static V Sub(V a, V b){ return _mm256_sub_pd(a, b); }
+		static V Mul(V a, V b){ return _mm256_mul_pd(a, b); }
+		static V Div(V a, V b){ return _mm256_div_pd(a, b); }
+		static V Max(V a, V b){ return _mm256_max_pd(a, b); }
+		static V Min(V a, V b){ return _mm256_min_pd(a, b); }
+
+		static V And(V a, V b){ return _mm256_and_pd(a, b); }
+		static V AndNot(V a, V b){ return _mm256_andnot_pd(a, b); }
+		static V Equal(V a, V b){ return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+		static V Greater(V a, V b){ return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+		static V GreaterEqual(V a, V b){ return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+		static V LessEqual(V a, V b){ return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+		static int MoveMask(V a){ return _mm256_movemask_pd(a); }
+
+		/** The unbiased exponent of each (positive, normal) value */
+		static V Exponent(V x){
+			__m256i e = _mm256_srli_epi64(_mm256_castpd_si256(x), 52);
+			e = _mm256_permutevar8x32_epi32(e, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+			return _mm256_sub_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(e)), _mm256_set1_pd(1023.0));
+		}
+
+		/** The mantissa of each (positive, normal) value, in the range [1, 2) */
+		static V Mantissa(V x){
+			__m256i bits = _mm256_and_si256(_mm256_castpd_si256(x), _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL));
+			bits = _mm256_or_si256(bits, _mm256_set1_epi64x(0x3FF0000000000000LL));
+			return _mm256_castsi256_pd(bits);
+		}
+
+		static void Lanes(V v, double *lanes){ _mm256_storeu_pd(lanes, v); }
+	};
+
+	template <class S> long AddKernel(double *a, const double *b, long n, double factor){
+		const typename S::V f = S::Set(factor);
+		long i = 0;
+		for(; i + S::N <= n; i += S::N)
+			S::Store(a + i, S::Add(S::Load(a + i), S::Mul(f, S::Load(b + i))));
+		return i;
+	}
+
+	template <class S> long SubKernel(double *a, const double *b, long n, double factor){
+		const typename S::V f = S::Set(factor);
+		long i = 0;
+		for(; i + S::N <= n; i += S::N)
+			S::Store(a + i, S::Sub(S::Load(a + i), S::Mul(f, S::Load(b + i))));
+		return i;
+	}
+
+	template <class S> long MulKernel(double *a, const double *b, long n, double factor){
+		const typename S::V f = S::Set(factor);
+		long i = 0;
+		for(; i + S::N <= n; i += S::N)
+			S::Store(a + i, S::Mul(S::Load(a + i), S::Mul(f, S::Load(b + i))));
+		return i;
+	}
+
+	template <class S> long DivKernel(double *a, const double *b, long n){
+		long i = 0;
+		for(; i + S::N <= n; i += S::N)
+			S::Store(a + i, S::Div(S::Load(a + i), S::Load(b + i)));
+		return i;
+	}
+
+	template <class S> long DivNonZeroKernel(double *a, const double *b, long n, double factor){
+		const typename S::V f    = S::Set(factor);
+		const typename S::V zero = S::Set(0.0);
+		long i = 0;
+		for(; i + S::N <= n; i += S::N){
+			typename S::V divisor = S::Load(b + i);
+			typename S::V quotient = S::Div(S::Load(a + i), S::Mul(f, divisor));
+			S::Store(a + i, S::AndNot(S::Equal(divisor, zero), quotient));
+		}
+		return i;
+	}
+
+	template <class S> long AddConstantKernel(double *a, long n, double value){
+		const typename S::V v = S::Set(value);
+		long i = 0;
+		for(; i + S::N <= n; i += S::N)
+			S::Store(a + i, S::Add(S::Load(a + i), v));
+		return i;
+	}
+
+	template <class S> long SubConstantKernel(double *a, long n, double value){
+		const typename S::V v = S::Set(value);
+		long i = 0;
+		for(; i + S::N <= n; i += S::N)
+			S::Store(a + i, S::Sub(S::Load(a + i), v));
+		return i;
+	}
+
+	template <class S> long MulConstantKernel(double *a, long n, double value){
+		const typename S::V v = S::Set(value);
+		long i = 0;
+		for(; i + S::N <= n; i += S::N)
+			S::Store(a + i, S::Mul(S::Load(a + i), v));
+		return i;
+	}
+
+	template <class S> long DivConstantKernel(double *a, long n, double value){
+		const typename S::V v = S::Set(value);
+		long i = 0;
+		for(; i + S::N <= n; i += S::N)
+			S::Store(a + i, S::Div(S::Load(a + i), v));
+		return i;
+	}
+
+	// The reductions start with 'result' set to a[0] and with the scalar loop
+	//	continuing at pixel 1, if the array is shorter than one vector
+	template <class S> long MaxKernel(const double *a, long n, double &result){
+		if(n < S::N)
+			return 1;
+
+		double lanes[S::N];
+		typename S::V m = S::Load(a);
+		long i = S::N;
+		for(; i + S::N <= n; i += S::N)
+			m = S::Max(m, S::Load(a + i));
+
+		S::Lanes(m, lanes);
+		result = lanes[0];
+		for(long k = 1; k < S::N; ++k)
+			result = (lanes[k] > result) ? lanes[k] : result;
+		return i;
+	}
+
+	template <class S> long MinKernel(const double *a, long n, double &result){
+		if(n < S::N)
+			return 1;
+
+		double lanes[S::N];
+		typename S::V m = S::Load(a);
+		long i = S::N;
+		for(; i + S::N <= n; i += S::N)
+			m = S::Min(m, S::Load(a + i));
+
+		S::Lanes(m, lanes);
+		result = lanes[0];
+		for(long k = 1; k < S::N; ++k)
+			result = (lanes[k] < result) ? lanes[k] : result;
+		return i;
+	}
+
+	template <class S> long SumKernel(const double *a, long n, double &result){
+		if(n < S::N)
+			return 1;
+
+		// two accumulators, to not wait for the latency of every addition
+		double lanes[S::N];
+		typename S::V sum1 = S::Load(a);
+		typename S::V sum2 = S::Set(0.0);
+		long i = S::N;
+		for(; i + 2 * S::N <= n; i += 2 * S::N){
+			sum1 = S::Add(sum1, S::Load(a + i));
+			sum2 = S::Add(sum2, S::Load(a + i + S::N));
+		}
+		for(; i + S::N <= n; i += S::N)
+			sum1 = S::Add(sum1, S::Load(a + i));
+
+		S::Lanes(S::Add(sum1, sum2), lanes);
+		result = lanes[0];
+		for(long k = 1; k < S::N; ++k)
+			result += lanes[k];
+		return i;
+	}
+
+	/** The logarithm as it has always been calculated for spectra, zero for non-positive values */
+	inline double LogScalar(double x){
+		return (x <= 0) ? 0.0 : log(x);
+	}
+
+	/** The natural logarithm of positive, normal, finite values.
+		This is the algorithm of the fdlibm 'log', the value is split into
+		x = 2^k * (1 + f) with sqrt(2)/2 <= 1 + f < sqrt(2) and log(1 + f) is
+		calculated from a minimax polynomial in s = f / (2 + f). */
+	template <class S> typename S::V LogApproximation(typename S::V x){
+		typedef typename S::V V;
+
+		const V ln2_hi = S::Set(6.93147180369123816490e-01);
+		const V ln2_lo = S::Set(1.90821492927058770002e-10);
+		const V Lg1 = S::Set(6.666666666666735130e-01);
+		const V Lg2 = S::Set(3.999999999940941908e-01);
+		const V Lg3 = S::Set(2.857142874366239149e-01);
+		const V Lg4 = S::Set(2.222219843214978396e-01);
+		const V Lg5 = S::Set(1.818357216161805012e-01);
+		const V Lg6 = S::Set(1.531383769920937332e-01);
+		const V Lg7 = S::Set(1.479819860511658591e-01);
+		const V one = S::Set(1.0);
+		const V half = S::Set(0.5);
+
+		// split x into exponent and mantissa, with the mantissa in [sqrt(2)/2, sqrt(2))
+		V k = S::Exponent(x);
+		V m = S::Mantissa(x);
+		V big = S::Greater(m, S::Set(1.41421356237309504880));
+		m = S::Mul(m, S::Sub(one, S::And(big, half)));
+		k = S::Add(k, S::And(big, one));
+
+		V f = S::Sub(m, one);
+		V s = S::Div(f, S::Add(S::Set(2.0), f));
+		V z = S::Mul(s, s);
+		V w = S::Mul(z, z);
+		V t1 = S::Mul(w, S::Add(Lg2, S::Mul(w, S::Add(Lg4, S::Mul(w, Lg6)))));
+		V t2 = S::Mul(z, S::Add(Lg1, S::Mul(w, S::Add(Lg3, S::Mul(w, S::Add(Lg5, S::Mul(w, Lg7)))))));
+		V R = S::Add(t1, t2);
+		V hfsq = S::Mul(half, S::Mul(f, f));
+
+		// k*ln2_hi - ((hfsq - (s*(hfsq+R) + k*ln2_lo)) - f)
+		V tail = S::Add(S::Mul(s, S::Add(hfsq, R)), S::Mul(k, ln2_lo));
+		return S::Sub(S::Mul(k, ln2_hi), S::Sub(S::Sub(hfsq, tail), f));
+	}
+
+	template <class S> long LogKernel(double *a, long n){
+		const typename S::V smallest = S::Set(DBL_MIN);
+		const typename S::V largest  = S::Set(DBL_MAX);
+		long i = 0;
+		for(; i + S::N <= n; i += S::N){
+			typename S::V x = S::Load(a + i);
+			typename S::V normal = S::And(S::GreaterEqual(x, smallest), S::LessEqual(x, largest));
+
+			if(S::MoveMask(normal) == S::ALL){
+				S::Store(a + i, LogApproximation<S>(x));
+			}else{
+				// zero, negative, denormal, infinite or NaN values are left to the library
+				for(long k = i; k < i + S::N; ++k)
+					a[k] = LogScalar(a[k]);
+			}
+		}
+		return i;
+	}
+}
+
+// Selects the kernel for the current instruction set. The kernel returns the index of the first
+//	pixel which it did not process, which is stored in 'i'.
+#define RUN_KERNEL(i, kernel, args) \
+	switch(s_instructionSet){ \
+		case INSTRUCTION_SET_AVX2: i = kernel<Avx2> args; break; \
+		case INSTRUCTION_SET_SSE2: i = kernel<Sse2> args; break; \
+		default: break; \
+	}
+
+CVectorKernels::INSTRUCTION_SET CVectorKernels::GetInstructionSet(){
+	return s_instructionSet;
+}
+
+CVectorKernels::INSTRUCTION_SET CVectorKernels::GetSupportedInstructionSet(){
+	int info[4];
+
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool sse2    = (info[3] & (1 << 26)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx     = (info[2] & (1 << 28)) != 0;
+
+	// AVX2 can only be used if the operating system saves the ymm-registers
+	if(avx && osxsave && maxLeaf >= 7 && (_xgetbv(0) & 6) == 6){
+		__cpuidex(info, 7, 0);
+		if(info[1] & (1 << 5))
+			return INSTRUCTION_SET_AVX2;
+	}
+
+	return (sse2) ? INSTRUCTION_SET_SSE2 : INSTRUCTION_SET_SCALAR;
+}
+
+void CVectorKernels::SetInstructionSet(INSTRUCTION_SET set){
+	INSTRUCTION_SET supported = GetSupportedInstructionSet();
+
+	s_instructionSet = (set < supported) ? set : supported;
+}
+
+void CVectorKernels::Add(double *a, const double *b, long n, double factor){
+	long i = 0;
+	RUN_KERNEL(i, AddKernel, (a, b, n, factor));
+	for(; i < n; ++i)
+		a[i] += factor * b[i];
+}
+
+void CVectorKernels::Sub(double *a, const double *b, long n, double factor){
+	long i = 0;
+	RUN_KERNEL(i, SubKernel, (a, b, n, factor));
+	for(; i < n; ++i)
+		a[i] -= factor * b[i];
+}
+
+void CVectorKernels::Mul(double *a, const double *b, long n, double factor){
+	long i = 0;
+	RUN_KERNEL(i, MulKernel, (a, b, n, factor));
+	for(; i < n; ++i)
+		a[i] *= factor * b[i];
+}
+
+void CVectorKernels::Div(double *a, const double *b, long n){
+	long i = 0;
+	RUN_KERNEL(i, DivKernel, (a, b, n));
+	for(; i < n; ++i)
+		a[i] /= b[i];
+}
+
+void CVectorKernels::DivNonZero(double *a, const double *b, long n, double factor){
+	long i = 0;
+	RUN_KERNEL(i, DivNonZeroKernel, (a, b, n, factor));
+	for(; i < n; ++i)
+		a[i] = (b[i] != 0) ? a[i] / (factor * b[i]) : 0.0;
+}
+
+void CVectorKernels::Add(double *a, long n, double value){
+	long i = 0;
+	RUN_KERNEL(i, AddConstantKernel, (a, n, value));
+	for(; i < n; ++i)
+		a[i] += value;
+}
+
+void CVectorKernels::Sub(double *a, long n, double value){
+	long i = 0;
+	RUN_KERNEL(i, SubConstantKernel, (a, n, value));
+	for(; i < n; ++i)
+		a[i] -= value;
+}
+
+void CVectorKernels::Mul(double *a, long n, double value){
+	long i = 0;
+	RUN_KERNEL(i, MulConstantKernel, (a, n, value));
+	for(; i < n; ++i)
+		a[i] *= value;
+}
+
+void CVectorKernels::Div(double *a, long n, double value){
+	long i = 0;
+	RUN_KERNEL(i, DivConstantKernel, (a, n, value));
+	for(; i < n; ++i)
+		a[i] /= value;
+}
+
+double CVectorKernels::Max(const double *a, long n){
+	double result = a[0];
+	long i = 1;
+	RUN_KERNEL(i, MaxKernel, (a, n, result));
+	for(; i < n; ++i)
+		result = (a[i] > result) ? a[i] : result;
+	return result;
+}
+
+double CVectorKernels::Min(const double *a, long n){
+	double result = a[0];
+	long i = 1;
+	RUN_KERNEL(i, MinKernel, (a, n, result));
+	for(; i < n; ++i)
+		result = (a[i] < result) ? a[i] : result;
+	return result;
+}
+
+double CVectorKernels::Sum(const double *a, long n){
+	if(n <= 0)
+		return 0.0;
+
+	double result = a[0];
+	long i = 1;
+	RUN_KERNEL(i, SumKernel, (a, n, result));
+	for(; i < n; ++i)
+		result += a[i];
+	return result;
+}
+
+void CVectorKernels::Log(double *a, long n){
+	long i = 0;
+	RUN_KERNEL(i, LogKernel, (a, n));
+	for(; i < n; ++i)
+		a[i] = LogScalar(a[i]);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+/** <b>CVectorKernels</b> contains the pixel-wise loops which are run on every
+	spectrum, e.g. the dark subtraction, the normalisation of co-added spectra,
+	the division with the sky spectrum and the logarithm. These are used by
+	CSpectrum and by CBasicMath.
+
+	Every kernel is implemented with AVX2, with SSE2 and as plain scalar code.
+	The fastest instruction set which is supported by the processor (and the
+	operating system) is selected at start-up.
+
+	The arithmetic kernels give exactly the same result as the scalar loops,
+	'Sum' may differ in the last bits since the pixels are added in another order.
+	'Log' uses a polynomial approximation of the logarithm which differs from
+	std::log by at most one unit in the last place. */
+class CVectorKernels
+{
+public:
+	/** The instruction sets which the kernels are implemented with */
+	enum INSTRUCTION_SET{
+		INSTRUCTION_SET_SCALAR,
+		INSTRUCTION_SET_SSE2,
+		INSTRUCTION_SET_AVX2
+	};
+
+	/** Returns the instruction set which is currently used */
+	static INSTRUCTION_SET GetInstructionSet();
+
+	/** Returns the best instruction set which is supported by this computer */
+	static INSTRUCTION_SET GetSupportedInstructionSet();
+
+	/** Selects the instruction set to use. If 'set' is not supported by
+		this computer then the best supported instruction set is used instead. */
+	static void SetInstructionSet(INSTRUCTION_SET set);
+
+	// ----------------------------------------------------------------------
+	// -------------------- SPECTRUM WITH SPECTRUM --------------------------
+	// ----------------------------------------------------------------------
+
+	/** a[i] += factor * b[i], for i = 0 .. n-1 */
+	static void Add(double *a, const double *b, long n, double factor = 1.0);
+
+	/** a[i] -= factor * b[i], for i = 0 .. n-1 */
+	static void Sub(double *a, const double *b, long n, double factor = 1.0);
+
+	/** a[i] *= factor * b[i], for i = 0 .. n-1 */
+	static void Mul(double *a, const double *b, long n, double factor = 1.0);
+
+	/** a[i] /= b[i], for i = 0 .. n-1 */
+	static void Div(double *a, const double *b, long n);
+
+	/** a[i] /= factor * b[i] if b[i] is not zero, otherwise a[i] = 0, for i = 0 .. n-1 */
+	static void DivNonZero(double *a, const double *b, long n, double factor = 1.0);
+
+	// ----------------------------------------------------------------------
+	// -------------------- SPECTRUM WITH CONSTANT --------------------------
+	// ----------------------------------------------------------------------
+
+	/** a[i] += value, for i = 0 .. n-1 */
+	static void Add(double *a, long n, double value);
+
+	/** a[i] -= value, for i = 0 .. n-1 */
+	static void Sub(double *a, long n, double value);
+
+	/** a[i] *= value, for i = 0 .. n-1 */
+	static void Mul(double *a, long n, double value);
+
+	/** a[i] /= value, for i = 0 .. n-1 */
+	static void Div(double *a, long n, double value);
+
+	// ----------------------------------------------------------------------
+	// -------------------------- REDUCTIONS --------------------------------
+	// ----------------------------------------------------------------------
+
+	/** Returns the largest of a[0] .. a[n-1], n must be at least one */
+	static double Max(const double *a, long n);
+
+	/** Returns the smallest of a[0] .. a[n-1], n must be at least one */
+	static double Min(const double *a, long n);
+
+	/** Returns the sum of a[0] .. a[n-1] */
+	static double Sum(const double *a, long n);
+
+	// ----------------------------------------------------------------------
+	// ------------------------- LOGARITHM ----------------------------------
+	// ----------------------------------------------------------------------
+
+	/** a[i] = log(a[i]) if a[i] is positive, otherwise a[i] = 0, for i = 0 .. n-1 */
+	static void Log(double *a, long n);
+
+private:
+	/** The instruction set which is currently used */
+	static INSTRUCTION_SET s_instructionSet;
+};
@@ -3,33 +3,53 @@
 
 CWindFieldRecord::CWindFieldRecord(void)
 {
-	m_windFieldNum = 0;
-
-	m_windField.SetSize(ORIGINAL_ARRAY_LENGTH);
-
 }
 
 CWindFieldRecord::~CWindFieldRecord(void)
 {
-	m_windFieldNum = 0;
-	m_windField.RemoveAll();
+	m_windField.clear();
 }
 
 /** Inserts a given wind-field into the record */
 void CWindFieldRecord::InsertWindField(const CWindField &wind){
 
-	// Add the new wind-field to the end
-	m_windField.SetAt(m_windFieldNum++, CWindField(wind));
+	// The wind-fields normally come in time order, then just add the new wind-field to the end
+	if(m_windField.empty() || !(wind.GetTimeAndDate() < m_windField.back().GetTimeAndDate())){
+		m_windField.push_back(wind);
+		return;
+	}
 
-	// If necessary, increase the size of the array
-	if(m_windFieldNum >= ORIGINAL_ARRAY_LENGTH - 1){
-		m_windField.SetSize(m_windFieldNum + 1);
+	// Otherwise insert it after all wind-fields which are not later than the new one
+	size_t first = 0, count = m_windField.size();
+	while(count > 0){
+		size_t step = count / 2;
+		if(wind.GetTimeAndDate() < m_windField[first + step].GetTimeAndDate()){
+			count = step;
+		}else{
+			first += step + 1;
+			count -= step + 1;
+		}
 	}
+	m_windField.insert(m_windField.begin() + first, wind);
 }
 
 /** Returns the number of points in the database */
-long CWindFieldRecord::GetRecordNum(){
-	return this->m_windFieldNum;
+long CWindFieldRecord::GetRecordNum() const{
+	return (long)this->m_windField.size();
+}
+
+size_t CWindFieldRecord::LowerBound(const CDateTime &desiredTime) const{
+	size_t first = 0, count = m_windField.size();
+	while(count > 0){
+		size_t step = count / 2;
+		if(m_windField[first + step].GetTimeAndDate() < desiredTime){
+			first += step + 1;
+			count -= step + 1;
+		}else{
+			count = step;
+		}
+	}
+	return first;
 }
 
 /** Searches through the read-in data and looks for the wind-field at the
@@ -47,65 +67,62 @@ long CWindFieldRecord::GetRecordNum(){
 		@return SUCCESS - if the wind could be interpolated
 		@return FAIL - if the wind lies outside of the time-range of the 'database',
 				or the distance between the two data-points to interpolate is larger than 24 hours. */
-RETURN_CODE CWindFieldRecord::InterpolateWindField(const CDateTime desiredTime, CWindField &desiredWindField){
-	// First check if there's any records at all in the database
-	if(m_windFieldNum == 0)
-		return FAIL;
+RETURN_CODE CWindFieldRecord::InterpolateWindField(const CDateTime desiredTime, CWindField &desiredWindField) const{
+	return InterpolateAt(LowerBound(desiredTime), desiredTime, desiredWindField);
+}
 
-	// Loop through all wind-fields in the database and see if we can find an exact match
-	//	otherwise extract the wind-fields which are the closest records before and after
-	//	the desired one.
-	CWindField closestBefore, closestAfter;
-	bool foundClosestBefore = false;	// <-- if no wind-field was found before the desired one then return false
-	bool foundClosestAfter	= false;	// <-- if no wind-field was found after the desired one then return false
-	for(int i = 0; i < m_windFieldNum; ++i){
-		CWindField &currentRecord = m_windField.GetAt(i); // <-- the current record in the database
-
-		// First check if we've found an exact match, if so
-		//	then return the current wind-field
-		if(currentRecord.GetTimeAndDate() == desiredTime){
-			desiredWindField = currentRecord;
-			return SUCCESS; // we're done!
-		}
+long CWindFieldRecord::InterpolateWindFields(const std::vector<CDateTime> &desiredTimes, std::vector<CWindField> &desiredWindFields, std::vector<bool> &success) const{
+	long nFound = 0;
+	size_t index = 0;
+
+	desiredWindFields.resize(desiredTimes.size());
+	success.resize(desiredTimes.size());
 
-		// Then check if this is earlier than the desired one
-		if(currentRecord.GetTimeAndDate() < desiredTime){
-			// currentRecord is valid before the desired time
-			if(foundClosestBefore){
-				// We have already found another record which is valid before the desired time
-				//	compare if the currentRecord is collected after the previously found
-				//	record, if it is then use the currentRecord as the closest one before
-				if(closestBefore.GetTimeAndDate() < currentRecord.GetTimeAndDate()){
-					closestBefore	= currentRecord;
-				}
-				continue;
-			}else{
-				// We have found the first record in the database which is collected
-				//	before the desired time, remember this and then continue the search
-				foundClosestBefore	= true;
-				closestBefore		= currentRecord;
-				continue;
-			}
+	for(size_t k = 0; k < desiredTimes.size(); ++k){
+		const CDateTime &desiredTime = desiredTimes[k];
 
+		if(k > 0 && desiredTime < desiredTimes[k - 1]){
+			// the times are not sorted, search for this one from the beginning
+			index = LowerBound(desiredTime);
 		}else{
-			// currentRecord is valid after the desired time
-			if(foundClosestAfter){
-				// We have already found another record which is valid after the desired time
-				//	compare if the currentRecord is collected before the previously found
-				//	record, if it is then use the currentRecord as the closest one after
-				if(currentRecord.GetTimeAndDate() < closestAfter.GetTimeAndDate()){
-					closestAfter	= currentRecord;
-				}
-				continue;
-			}else{
-				// We have found the first record in the database which is collected
-				//	before the desired time, remember this and then continue the search
-				foundClosestAfter	= true;
-				closestAfter		= currentRecord;
-				continue;
-			}
+			// continue from where the previous time was found
+			while(index < m_windField.size() && m_windField[index].GetTimeAndDate() < desiredTime)
+				++index;
 		}
-	} // end for...
+
+		success[k] = (SUCCESS == InterpolateAt(index, desiredTime, desiredWindFields[k]));
+		if(success[k])
+			++nFound;
+	}
+
+	return nFound;
+}
+
+RETURN_CODE CWindFieldRecord::InterpolateAt(size_t index, const CDateTime &desiredTime, CWindField &desiredWindField) const{
+	// First check if there's any records at all in the database
+	if(m_windField.empty())
+		return FAIL;
+
+	// 'index' is the first record which is not earlier than the desired time. 
+	//	If this is an exact match then return this wind-field, otherwise it is 
+	//	the closest record after the desired time.
+	bool foundClosestAfter	= (index < m_windField.size());	// <-- if no wind-field was found after the desired one then return false
+	if(foundClosestAfter && m_windField[index].GetTimeAndDate() == desiredTime){
+		desiredWindField = m_windField[index];
+		return SUCCESS; // we're done!
+	}
+
+	// The closest record before the desired time is the one before 'index'. If several 
+	//	records have this time, then take the first one of them.
+	bool foundClosestBefore = (index > 0);	// <-- if no wind-field was found before the desired one then return false
+	size_t before = index;
+	if(foundClosestBefore){
+		--before;
+		while(before > 0 && m_windField[before - 1].GetTimeAndDate() == m_windField[before].GetTimeAndDate())
+			--before;
+	}
+	const CWindField &closestBefore = m_windField[foundClosestBefore ? before : 0];
+	const CWindField &closestAfter  = m_windField[foundClosestAfter ? index : 0];
 
 	// If the desired time is not in between any two wind-fields in the database,
 	//	then we can not interpolate. If the time difference between the desried time
@@ -3,15 +3,16 @@
 #ifndef WINDFIELDRECORD_H
 #define WINDFIELDRECORD_H
 #include <afxtempl.h>
+#include <vector>
 
 #include "Common.h"
 #include "WindField.h"
 
+/** <b>CWindFieldRecord</b> is a time-series of wind-fields, e.g. read from a 
+	wind-field file. The wind-fields are kept sorted in time, so that the wind-field
+	at any given time can be found with a binary search. */
 class CWindFieldRecord
 {
-	/** The original length of the array */
-	static const int ORIGINAL_ARRAY_LENGTH = 10;
-
 public:
 
 	/** Default constructor */
@@ -23,7 +24,9 @@ public:
 
 	// ------------------- PUBLIC METHODS -------------------------
 
-	/** Inserts a given wind-field into the record */
+	/** Inserts a given wind-field into the record. 
+		Wind-fields are normally inserted in time order, in which case this is an append. 
+		Wind-fields with the same time are kept in the order they were inserted. */
 	void	InsertWindField(const CWindField &wind);
 
 	/** Searches through the read-in data and looks for the wind-field at the
@@ -41,10 +44,20 @@ public:
 			@return SUCCESS - if the wind could be interpolated
 			@return FAIL - if the wind lies outside of the time-range of the 'database',
 					or the distance between the two data-points to interpolate is larger than 24 hours. */
-	RETURN_CODE InterpolateWindField(const CDateTime desiredTime, CWindField &desiredWindField);
+	RETURN_CODE InterpolateWindField(const CDateTime desiredTime, CWindField &desiredWindField) const;
+
+	/** Interpolates the wind-field at each of the given times, in the same way as 
+			'InterpolateWindField'. If the times are sorted in increasing order then
+			this is done in one single pass through the record.
+		@param desiredTimes - the times and dates at which the wind-fields are to be extracted
+		@param desiredWindFields - will on return have one wind-field for each time in 'desiredTimes'
+		@param success - will on return have one value for each time in 'desiredTimes', true if the 
+			corresponding wind-field could be interpolated.
+		@return the number of wind-fields which could be interpolated */
+	long InterpolateWindFields(const std::vector<CDateTime> &desiredTimes, std::vector<CWindField> &desiredWindFields, std::vector<bool> &success) const;
 
 	/** Returns the number of points in the database */
-	long	GetRecordNum();
+	long	GetRecordNum() const;
 
 	// ------------------- PUBLIC DATA -------------------------
 
@@ -52,13 +65,18 @@ public:
 protected:
 	// ------------------- PROTECTED METHODS -------------------------
 
-	// ------------------- PROTECTED DATA -------------------------
+	/** Returns the index of the first wind-field which is not earlier than 'desiredTime',
+		this is GetRecordNum() if all wind-fields are earlier. */
+	size_t LowerBound(const CDateTime &desiredTime) const;
 
-	/** Information about the wind */
-	CArray <CWindField, CWindField&> m_windField;
+	/** Interpolates the wind-field at the time 'desiredTime' from the 
+		wind-fields around the index 'index', as returned by 'LowerBound'. */
+	RETURN_CODE InterpolateAt(size_t index, const CDateTime &desiredTime, CWindField &desiredWindField) const;
+
+	// ------------------- PROTECTED DATA -------------------------
 
-	/** How many wind-fields have been read in? */
-	long		m_windFieldNum;
+	/** Information about the wind, sorted in increasing time */
+	std::vector<CWindField> m_windField;
 
 };
 
@@ -180,6 +180,28 @@ RETURN_CODE CWindFileReader::InterpolateWindField(const CDateTime desiredTime, C
 	return ret;
 }
 
+/** Returns an interpolation from the most recently read in
+		wind-field at each of the given times */
+long CWindFileReader::InterpolateWindFields(const std::vector<CDateTime> &desiredTimes, std::vector<CWindField> &desiredWindFields, std::vector<bool> &success){
+	long nFound = 0;
+
+	// Lock this object to make sure that we are not reading in data
+	//	and interpolating the wind-fields at the same time
+	CSingleLock singleLock(&m_critSect);
+	singleLock.Lock();
+
+	if(singleLock.IsLocked()){
+	
+		// Get the interpolated wind-fields
+		nFound = m_windRecord.InterpolateWindFields(desiredTimes, desiredWindFields, success);
+
+		// Remember to open up this object again
+		singleLock.Unlock();
+	}
+
+	return nFound;
+}
+
 /** Writes the contents of this object to a new wind file */
 RETURN_CODE CWindFileReader::WriteWindFile(const CString fileName){
 
@@ -30,6 +30,13 @@ namespace FileHandler{
 				wind-field */
 		RETURN_CODE InterpolateWindField(const CDateTime desiredTime, CWindField &desiredWindField);
 
+		/** Returns an interpolation from the most recently read in
+				wind-field at each of the given times. If the times are sorted
+				in increasing order then this is done in one pass through the wind-fields.
+			@return the number of wind-fields which could be interpolated.
+			@see CWindFieldRecord::InterpolateWindFields */
+		long InterpolateWindFields(const std::vector<CDateTime> &desiredTimes, std::vector<CWindField> &desiredWindFields, std::vector<bool> &success);
+
 		/** Returns the number of points in the database */
 		long GetRecordNum();
 
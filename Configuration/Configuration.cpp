@@ -41,6 +41,9 @@ CConfigurationSetting::CommunicationSetting::CommunicationSetting(){
 	// Freewave radio modems
 	radioID.Format("0");
 
+	// Request up to four chunks at a time when downloading files
+	transferWindow = 4;
+
 	// FTP - Settings
 	ftpIP[0]= 192;
 	ftpIP[1]= 168;
@@ -77,6 +80,9 @@ void CConfigurationSetting::CommunicationSetting::Clear(){
 	// Freewave radio modems
 	radioID.Format("0");
 
+	// Request up to four chunks at a time when downloading files
+	transferWindow = 4;
+
 	// FTP - Settings
 	ftpIP[0]= 192;
 	ftpIP[1]= 168;
@@ -268,6 +274,7 @@ CConfigurationSetting::CommunicationSetting &CConfigurationSetting::Communicatio
 
 	// Freewave radio modems
 	radioID.Format("%s", comm2.radioID);
+	transferWindow				= comm2.transferWindow;
 
 	// FTP - Settings
 	ftpIP[0] = comm2.ftpIP[0];
@@ -294,6 +301,7 @@ CConfigurationSetting::CFTPSetting::CFTPSetting()
 	password.Format("iht-1inks.");
 	ftpStartTime = 0;
 	ftpStopTime	 = 86400;
+	maxDownloads = 0;
 }
 CConfigurationSetting::CFTPSetting::~CFTPSetting()
 {
@@ -324,6 +332,22 @@ CConfigurationSetting::CExternalCallSettings::~CExternalCallSettings(){
 	imageScript.Format("");
 }
 
+CConfigurationSetting::CEvaluationSettings::CEvaluationSettings(){
+	// by default, only the text evaluation logs are written
+	writeBinaryLogs = 0;
+
+	// by default, the standard fit is used and every fit starts from scratch
+	variableProjection = 0;
+	warmStart = 0;
+
+	// by default, no index-files are written next to the evaluation logs or the .pak-files
+	indexFiles = 0;
+	pakIndexFiles = 0;
+}
+
+CConfigurationSetting::CEvaluationSettings::~CEvaluationSettings(){
+}
+
 CConfigurationSetting::CWindFieldDataSettings::CWindFieldDataSettings(){
 	Common common;
 	common.GetExePath();
@@ -51,6 +51,11 @@ public:
 		/** The RadioID OR callbook number */
 		CString radioID;
 
+		/** The largest number of chunks of a file which are requested from the
+			instrument before waiting for the replies. 1 gives the stop-and-wait 
+			transfer of the old tx-protocol. */
+		int transferWindow;
+
 		// ----------- The settings for FTP communication --------------
 
 		/** The IP-number of the scanning instrument */
@@ -329,6 +334,7 @@ public:
 		int     ftpStatus;      // not used?
 		int     ftpStartTime;   // the time of day when to start uploading (seconds since midnight)
 		int     ftpStopTime;    // the time of day when to stop uploading (seconds since midnight)
+		int     maxDownloads;   // the largest number of files downloaded from the FTP-instruments at the same time, 0 means no limit
 	};
 
 	/** Settings for publishing the results on a web - page */
@@ -360,6 +366,18 @@ public:
 		int		enabled;					// 1 if enabled; 0 if not
 	};
 
+	/** Options for the evaluation of the spectra, common to all instruments */
+	class CEvaluationSettings{
+	public:
+		CEvaluationSettings();
+		~CEvaluationSettings();
+		int		writeBinaryLogs;			// 1 if binary evaluation logs should be written next to the evaluation logs; 0 if not
+		int		variableProjection;			// 1 if the fits should use the variable projection method; 0 for the standard fit
+		int		warmStart;					// 1 if the fit of each spectrum in a scan should start from the result of the previous spectrum; 0 if not
+		int		indexFiles;					// 1 if the position of every scan in the evaluation logs should be saved to index-files next to the logs; 0 if not
+		int		pakIndexFiles;				// 1 if the position of every spectrum in the .pak-files should be saved to index-files next to the .pak-files; 0 if not
+	};
+
 public:
 	CConfigurationSetting(void);
 	~CConfigurationSetting(void);
@@ -403,6 +421,9 @@ public:
 
 	/** The settings for retrieving the wind-field from external sources */
 	CWindFieldDataSettings windSourceSettings;
+
+	/** The options for the evaluation */
+	CEvaluationSettings evaluationSettings;
 };
 
 #endif
\ No newline at end of file
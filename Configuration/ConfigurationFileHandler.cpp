@@ -118,6 +118,11 @@ int CConfigurationFileHandler::WriteConfigurationFile(CConfigurationSetting &con
 	fprintf(f, str);
 	str.Format("\t<ftpStopTime>%d</ftpStopTime>\n", conf->ftpSetting.ftpStopTime);
 	fprintf(f, str);
+	// 4e3. The largest number of files to download from the instruments at the same time
+	if(conf->ftpSetting.maxDownloads > 0){
+		str.Format("\t<ftpMaxDownloads>%d</ftpMaxDownloads>\n", conf->ftpSetting.maxDownloads);
+		fprintf(f, str);
+	}
 	
 
 	// 4f. Write if we should publish results
@@ -151,6 +156,18 @@ int CConfigurationFileHandler::WriteConfigurationFile(CConfigurationSetting &con
 		fprintf(f, str);
 	}
 
+	// 4i. The options for the evaluation
+	if(conf->evaluationSettings.writeBinaryLogs || conf->evaluationSettings.variableProjection || conf->evaluationSettings.warmStart || conf->evaluationSettings.indexFiles || conf->evaluationSettings.pakIndexFiles){
+		str.Format("\t<evaluationOptions>\n");
+		str.AppendFormat("\t\t<binaryLogs>%d</binaryLogs>\n",	conf->evaluationSettings.writeBinaryLogs);
+		str.AppendFormat("\t\t<variableProjection>%d</variableProjection>\n",	conf->evaluationSettings.variableProjection);
+		str.AppendFormat("\t\t<warmStart>%d</warmStart>\n",	conf->evaluationSettings.warmStart);
+		str.AppendFormat("\t\t<indexFiles>%d</indexFiles>\n",	conf->evaluationSettings.indexFiles);
+		str.AppendFormat("\t\t<pakIndexFiles>%d</pakIndexFiles>\n",	conf->evaluationSettings.pakIndexFiles);
+		str.AppendFormat("\t</evaluationOptions>\n");
+		fprintf(f, str);
+	}
+
 	// 5. Begin the device list
 	fprintf(f, TEXT("\t<deviceList>\n"));
 
@@ -339,6 +356,10 @@ int CConfigurationFileHandler::WriteConfigurationFile(CConfigurationSetting &con
 				str.Format("%s<radioID>%s</radioID>\n", indent, comm.radioID);
 				fprintf(f, str);
 
+				// the number of chunks requested at a time when downloading files
+				str.Format("%s<transferWindow>%d</transferWindow>\n", indent, comm.transferWindow);
+				fprintf(f, str);
+
 			}
 			if(comm.connectionType == FTP_CONNECTION){
 				// IP-address of the scanning system
@@ -516,6 +537,11 @@ int CConfigurationFileHandler::Parse(){
 			conf->ftpSetting.ftpStopTime = abs(conf->ftpSetting.ftpStopTime);
 			continue;
 		}
+		if(Equals(szToken,"ftpMaxDownloads")){
+			Parse_IntItem(TEXT("/ftpMaxDownloads"),conf->ftpSetting.maxDownloads);
+			conf->ftpSetting.maxDownloads = max(0, conf->ftpSetting.maxDownloads);
+			continue;
+		}
 
 		if(Equals(szToken, "publishFormat")){
 			Parse_StringItem(TEXT("/publishFormat"), conf->webSettings.imageFormat);
@@ -544,6 +570,10 @@ int CConfigurationFileHandler::Parse(){
 			this->Parse_WindImport();
 		}
 
+		if(Equals(szToken, "evaluationOptions")){
+			this->Parse_EvaluationOptions();
+		}
+
 		// -----------------------------------------------------
 		// ------------- Scanning Instrument Settings ----------
 		// -----------------------------------------------------
@@ -720,6 +750,12 @@ int CConfigurationFileHandler::Parse_Communication(){
 			continue;
 		}
 
+	 if(Equals(szToken, "transferWindow")){
+		 Parse_IntItem(TEXT("/transferWindow"),curComm->transferWindow);
+		 curComm->transferWindow = max(curComm->transferWindow, 1);
+			continue;
+		}
+
 	 if(Equals(szToken, "IP")){
 		 Parse_IPNumber(TEXT("/IP"),curComm->ftpIP[0], curComm->ftpIP[1], curComm->ftpIP[2], curComm->ftpIP[3]);
 			continue;
@@ -1361,6 +1397,58 @@ int CConfigurationFileHandler::Parse_WindImport(){
 	return 0;
 }
 
+/** Parses the 'evaluationOptions' - section */
+int CConfigurationFileHandler::Parse_EvaluationOptions(){
+	// the actual reading loop
+	while(szToken = NextToken()){
+
+		// no use to parse empty lines
+		if(strlen(szToken) < 3)
+			continue;
+
+		// ignore comments
+		if(Equals(szToken, "!--", 3)){
+			continue;
+		}
+
+		// the end of the evaluationOptions section
+		if(Equals(szToken, "/evaluationOptions")){
+			return 0;
+		}
+
+		// found the flag for writing binary evaluation logs
+		if(Equals(szToken, "binaryLogs")){
+			Parse_IntItem("/binaryLogs", conf->evaluationSettings.writeBinaryLogs);
+			continue;
+		}
+
+		// found the flag for using the variable projection fit
+		if(Equals(szToken, "variableProjection")){
+			Parse_IntItem("/variableProjection", conf->evaluationSettings.variableProjection);
+			continue;
+		}
+
+		// found the flag for starting the fits from the previous spectrum in the scan
+		if(Equals(szToken, "warmStart")){
+			Parse_IntItem("/warmStart", conf->evaluationSettings.warmStart);
+			continue;
+		}
+
+		// found the flag for writing index-files next to the evaluation logs
+		if(Equals(szToken, "indexFiles")){
+			Parse_IntItem("/indexFiles", conf->evaluationSettings.indexFiles);
+			continue;
+		}
+
+		// found the flag for writing index-files next to the .pak-files
+		if(Equals(szToken, "pakIndexFiles")){
+			Parse_IntItem("/pakIndexFiles", conf->evaluationSettings.pakIndexFiles);
+			continue;
+		}
+	}
+	return 0;
+}
+
 int CConfigurationFileHandler::CheckSettings(){
 
 	// -------- FTP - SETTINGS -------------------
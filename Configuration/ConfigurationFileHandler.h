@@ -82,6 +82,9 @@ namespace FileHandler
 		/** Parses the 'windImport' - section */
 		int Parse_WindImport();
 
+		/** Parses the 'evaluationOptions' - section */
+		int Parse_EvaluationOptions();
+
 		/** Parses the 'motor' - section */
 		int Parse_Motor();
 
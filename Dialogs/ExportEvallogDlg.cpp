@@ -103,8 +103,8 @@ void CExportEvallogDlg::OnExportLog()
   if(strlen(m_evaluationLog) == 0 || strlen(exportFile) == 0)
     return;
 
-  // Read the evaluation log
-  if(SUCCESS != ReadEvaluationLog()){
+  // Read the evaluation log, from its binary log if there is a complete one
+  if(SUCCESS != ReadBinaryEvaluationLog() && SUCCESS != ReadEvaluationLog()){
     MessageBox("Could not parse evaluation logfile.");
   }
 
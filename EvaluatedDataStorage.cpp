@@ -4,6 +4,8 @@
 #include "VolcanoInfo.h"
 #include "UserSettings.h"
 
+#include <algorithm>
+
 extern CConfigurationSetting g_settings;   // <-- The settings
 extern CVolcanoInfo g_volcanoes;           // <-- The global database of volcanoes
 extern CUserSettings g_userSettings;       // <-- The users preferences
@@ -96,12 +98,11 @@ CEvaluatedDataStorage::CEvaluatedDataStorage(void)
 	memset(m_temperatureRange[0], 999, MAX_NUMBER_OF_SCANNING_INSTRUMENTS * sizeof(double));
 	memset(m_temperatureRange[1], -999, MAX_NUMBER_OF_SCANNING_INSTRUMENTS * sizeof(double));
 
-	memset(m_fluxIndex, 0, MAX_NUMBER_OF_SCANNING_INSTRUMENTS * sizeof(int));
-
 	for(int i = 0; i < MAX_NUMBER_OF_SCANNING_INSTRUMENTS; ++i)
 		this->m_serials[i].Format("");
 
 	m_serialNum = 0;
+	m_lastPurgeDate = -1;
 }
 
 CEvaluatedDataStorage::~CEvaluatedDataStorage(void)
@@ -114,48 +115,12 @@ int CEvaluatedDataStorage::AddData(const CString &serial, Evaluation::CScanResul
 	CDateTime tid;
 	Common common;
 
-	// get the scanner index
-	int scannerIndex = GetScannerIndex(serial);
+	std::unique_lock<std::shared_timed_mutex> lock{ m_mutex };
 
-	if((scannerIndex < 0)){
-		if(m_serialNum < MAX_NUMBER_OF_SCANNING_INSTRUMENTS){
-			// if the scanner is not in the list then insert it
-			scannerIndex = m_serialNum;
-			m_serials[m_serialNum].Format("%s", serial);
-			
-			// find the serial-number in the global configuration, to find the spectrometer-model
-			bool found = false;
-			for(unsigned int k = 0; k < g_settings.scannerNum; ++k){
-				if(found)	break;
-
-				for(unsigned int j = 0; j < g_settings.scanner[k].specNum; ++j){
-					if(Equals(g_settings.scanner[k].spec[j].serialNumber, serial)){
-						m_models[m_serialNum] = g_settings.scanner[k].spec[j].model;
-
-						// Get the distance to GMT...
-						m_hoursToGMT[m_serialNum] = 0;
-						CString volcano;
-						volcano.Format(g_settings.scanner[k].volcano);
-						for(unsigned int it = 0; it < g_volcanoes.m_volcanoNum; ++it){
-							if(Equals(volcano, g_volcanoes.m_name[it])){
-								m_hoursToGMT[m_serialNum] = g_volcanoes.m_hoursToGMT[it];
-								break;
-							}
-						}
-						found = true;
-						break;
-					}
-				}
-			}
-			if(!found)
-				m_models[m_serialNum] = UNKNOWN_SPECTROMETER;
-
-			++m_serialNum;
-		}else{
-			// could not insert the serial number
-			return -1;
-		}
-	}
+	// get the scanner index, insert the scanner if it is not in the list
+	int scannerIndex = InsertSerial(serial);
+	if(scannerIndex < 0)
+		return -1; // could not insert the serial number
 
 	if(result == NULL)
 		return 0;
@@ -165,12 +130,12 @@ int CEvaluatedDataStorage::AddData(const CString &serial, Evaluation::CScanResul
 		CDateTime scanTime;
 		result->GetStopTime(0, scanTime);
 		if(scanTime.day == common.GetDay() && scanTime.month == common.GetMonth() && scanTime.year == common.GetYear()){
-			AppendFluxResult(scannerIndex, scanTime, result->GetFlux(), result->IsFluxOk(), result->GetBatteryVoltage(), result->GetTemperature(), result->GetSkySpectrumInfo().m_exposureTime);
+			AppendFluxResultUnlocked(scannerIndex, scanTime, result->GetFlux(), result->IsFluxOk(), result->GetBatteryVoltage(), result->GetTemperature(), result->GetSkySpectrumInfo().m_exposureTime);
 		}
 	}
 
 	// Find the maximum intensity for this spectrometer
-	double maxIntensity = GetDynamicRange(serial);
+	double maxIntensity = GetDynamicRangeUnlocked(scannerIndex);
 	if(fabs(maxIntensity) < 1e-5)
 		maxIntensity = 1;
 
@@ -210,15 +175,8 @@ int CEvaluatedDataStorage::AddData(const CString &serial, Evaluation::CScanResul
 	// add the offset
 	m_offset[scannerIndex] = result->GetOffset();
 
-	// add the temperature
-	double curTemp = result->GetTemperature();
-	m_data[scannerIndex][m_fluxIndex[scannerIndex]].m_temp = curTemp;
-
-	// add the exposure-time
-	long curExpTime	= result->GetExposureTime(0);
-	m_data[scannerIndex][m_fluxIndex[scannerIndex]].m_expTime = curExpTime;
-
 	// if this is the highest or the lowest temperature today, then remember it
+	double curTemp = result->GetTemperature();
 	if(fabs(curTemp) < 100.0){
 		m_temperatureRange[0][scannerIndex] = min(curTemp, m_temperatureRange[0][scannerIndex]);
 		m_temperatureRange[1][scannerIndex] = max(curTemp, m_temperatureRange[1][scannerIndex]);
@@ -237,48 +195,12 @@ int CEvaluatedDataStorage::AddWindData(const CString &serial, WindSpeedMeasureme
 	CDateTime tid;
 	Common common;
 
-	// get the scanner index
-	int scannerIndex = GetScannerIndex(serial);
+	std::unique_lock<std::shared_timed_mutex> lock{ m_mutex };
 
-	if((scannerIndex < 0)){
-		if(m_serialNum < MAX_NUMBER_OF_SCANNING_INSTRUMENTS){
-			// if the scanner is not in the list then insert it
-			scannerIndex = m_serialNum;
-			m_serials[m_serialNum].Format("%s", serial);
-			
-			// find the serial-number in the global configuration, to find the spectrometer-model
-			bool found = false;
-			for(unsigned int k = 0; k < g_settings.scannerNum; ++k){
-				if(found)	break;
-
-				for(unsigned int j = 0; j < g_settings.scanner[k].specNum; ++j){
-					if(Equals(g_settings.scanner[k].spec[j].serialNumber, serial)){
-						m_models[m_serialNum] = g_settings.scanner[k].spec[j].model;
-
-						// Get the distance to GMT...
-						m_hoursToGMT[m_serialNum] = 0;
-						CString volcano;
-						volcano.Format(g_settings.scanner[k].volcano);
-						for(unsigned int it = 0; it < g_volcanoes.m_volcanoNum; ++it){
-							if(Equals(volcano, g_volcanoes.m_name[it])){
-								m_hoursToGMT[m_serialNum] = g_volcanoes.m_hoursToGMT[it];
-								break;
-							}
-						}
-						found = true;
-						break;
-					}
-				}
-			}
-			if(!found)
-				m_models[m_serialNum] = UNKNOWN_SPECTROMETER;
-
-			++m_serialNum;
-		}else{
-			// could not insert the serial number
-			return -1;
-		}
-	}
+	// get the scanner index, insert the scanner if it is not in the list
+	int scannerIndex = InsertSerial(serial);
+	if(scannerIndex < 0)
+		return -1; // could not insert the serial number
 
 	if(result == NULL)
 		return 0;
@@ -302,6 +224,8 @@ int CEvaluatedDataStorage::AddWindData(const CString &serial, WindSpeedMeasureme
 
 /** Returns the smallest and the largest flux in the data bank */
 void CEvaluatedDataStorage::GetFluxRange(const CString &serial, double &minFlux, double &maxFlux){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	// get the scanner index
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0){
@@ -317,12 +241,17 @@ void CEvaluatedDataStorage::GetFluxRange(const CString &serial, double &minFlux,
 		unitConversionFactor = 3.6 * 24.0;
 
 	// find the maximum flux
-	maxFlux = m_data[scannerIndex][0].m_flux;
-	minFlux = m_data[scannerIndex][0].m_flux;
+	const std::deque<CScanData> &history = m_data[scannerIndex];
+	if(history.size() == 0){
+		minFlux = maxFlux = 0;
+		return;
+	}
+	maxFlux = history.front().m_flux;
+	minFlux = history.front().m_flux;
 
-	for(int i = 0; i < m_fluxIndex[scannerIndex]; ++i){
-		maxFlux = max(maxFlux, m_data[scannerIndex][i].m_flux);
-		minFlux = min(minFlux, m_data[scannerIndex][i].m_flux);
+	for(std::deque<CScanData>::const_iterator it = history.begin(); it != history.end(); ++it){
+		maxFlux = max(maxFlux, it->m_flux);
+		minFlux = min(minFlux, it->m_flux);
 	}
 
 	// convert to the correct unit
@@ -332,6 +261,8 @@ void CEvaluatedDataStorage::GetFluxRange(const CString &serial, double &minFlux,
 
 /** Returns the smallest and the largest columns in the data bank */
 void CEvaluatedDataStorage::GetColumnRange(const CString &serial, double &minColumn, double &maxColumn){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	// get the scanner index
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0){
@@ -363,6 +294,8 @@ void CEvaluatedDataStorage::GetColumnRange(const CString &serial, double &minCol
 
 /** Returns the smallest and the largest angle in the data bank */
 void CEvaluatedDataStorage::GetAngleRange(const CString &serial, double &minAngle, double &maxAngle){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	// get the scanner index
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0){
@@ -380,53 +313,54 @@ void CEvaluatedDataStorage::GetAngleRange(const CString &serial, double &minAngl
 }
 
 void CEvaluatedDataStorage::AppendFluxResult(int scannerIndex, const CDateTime &time, double fluxValue, bool fluxOk, double batteryVoltage, double temp, long expTime){
-	// If there are any old values in the array then remove them before appending more data.
+	std::unique_lock<std::shared_timed_mutex> lock{ m_mutex };
+
+	AppendFluxResultUnlocked(scannerIndex, time, fluxValue, fluxOk, batteryVoltage, temp, expTime);
+}
+
+void CEvaluatedDataStorage::AppendFluxResultUnlocked(int scannerIndex, const CDateTime &time, double fluxValue, bool fluxOk, double batteryVoltage, double temp, long expTime){
+	if(scannerIndex < 0 || scannerIndex >= MAX_NUMBER_OF_SCANNING_INSTRUMENTS)
+		return;
+
+	// If there are any old values in the history then remove them before appending more data.
 	RemoveOldFluxResults();
 
-	// m_fluxIndex[scannerIndex] is the number of data-points there are in
-	//	the array of flux-values
-	if(m_fluxIndex[scannerIndex] < MAX_HISTORY){
-		// insert the datapoint into the array
-		int index = m_fluxIndex[scannerIndex];
-		m_data[scannerIndex][index].m_flux      = fluxValue;
-		m_data[scannerIndex][index].m_fluxOk    = fluxOk;
-		m_data[scannerIndex][index].m_time      = (time.hour + m_hoursToGMT[scannerIndex])* 3600 + time.minute * 60 + time.second;
-		m_data[scannerIndex][index].m_date      = time.day;
-		m_data[scannerIndex][index].m_battery   = batteryVoltage;
-		m_data[scannerIndex][index].m_temp      = temp;
-		m_data[scannerIndex][index].m_expTime   = expTime;
-		++m_fluxIndex[scannerIndex];
-	}
+	CScanData data;
+	data.m_flux      = fluxValue;
+	data.m_fluxOk    = fluxOk;
+	data.m_time      = (time.hour + m_hoursToGMT[scannerIndex])* 3600 + time.minute * 60 + time.second;
+	data.m_date      = time.day;
+	data.m_battery   = batteryVoltage;
+	data.m_temp      = temp;
+	data.m_expTime   = expTime;
+	m_data[scannerIndex].push_back(data);
+
+	// keep the history bounded, the oldest scans are at the front
+	while(m_data[scannerIndex].size() > MAX_HISTORY)
+		m_data[scannerIndex].pop_front();
 }
 
 /** Removes old flux results */
 void  CEvaluatedDataStorage::RemoveOldFluxResults(){
-	static int lastDate; // the day of month when this function was last called
 	Common common;
 
 	// todays date
 	int today = common.GetDay();
 
 	// don't check this several times every day
-	if(lastDate == today)
+	if(m_lastPurgeDate == today)
 		return;
 
-	// Clear flux-results
+	// Clear flux-results. The results are (almost always) appended in time order, 
+	//	so the old results are at the front of the history
 	for(unsigned int scannerIndex = 0; scannerIndex < m_serialNum; ++scannerIndex){
-		int k = 0;
-		int nRecords = m_fluxIndex[scannerIndex];
+		std::deque<CScanData> &history = m_data[scannerIndex];
+		while(history.size() > 0 && history.front().m_date != today)
+			history.pop_front();
 
-		while(k < m_fluxIndex[scannerIndex]){
-			if(m_data[scannerIndex][k].m_date == today){
-				++k;
-			}else{
-				// if this measurement is not from today, then remove it
-				for(int j = k; j < m_fluxIndex[scannerIndex]-1; ++j){
-					m_data[scannerIndex][j]	= m_data[scannerIndex][j+1];
-				}
-				--m_fluxIndex[scannerIndex];
-			}
-		}
+		// remove any remaining results which are not from today
+		std::deque<CScanData>::iterator newEnd = std::remove_if(history.begin(), history.end(), [today](const CScanData &data){ return data.m_date != today; });
+		history.erase(newEnd, history.end());
 
 		// also clear the minimum and maximum temperatures
 		m_temperatureRange[0][scannerIndex] = 999.0;
@@ -442,12 +376,10 @@ void  CEvaluatedDataStorage::RemoveOldFluxResults(){
 		// if the result is not from today, then remove it...
 		if(wd.m_date != today){
 			m_windData.RemoveAt(oldPos);
-			pos	= m_windData.GetHeadPosition(); // restart the search - not very efficient but easy and safe
 		}
-
 	}
 
-	lastDate = today;
+	m_lastPurgeDate = today;
 }
 
 /** Get Column data. 
@@ -457,6 +389,8 @@ void  CEvaluatedDataStorage::RemoveOldFluxResults(){
     @param bufferSize - the maximum number of data points that the buffer can handle.
     @return the number of data points copied into the dataBuffer*/
 long CEvaluatedDataStorage::GetColumnData(const CString &serial, double *dataBuffer, double *dataErrorBuffer, long bufferSize){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	// get the scanner index
 	int scannerIndex = GetScannerIndex(serial);
 
@@ -485,6 +419,8 @@ long CEvaluatedDataStorage::GetColumnData(const CString &serial, double *dataBuf
     @param bufferSize - the maximum number of data points that the buffer can handle.
     @return the number of data points copied into the dataBuffer*/
 long CEvaluatedDataStorage::GetTimeData(const CString &serial, double *dataBuffer, long bufferSize){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	// get the scanner index
 	int scannerIndex = GetScannerIndex(serial);
 
@@ -505,6 +441,8 @@ long CEvaluatedDataStorage::GetTimeData(const CString &serial, double *dataBuffe
     @param bufferSize - the maximum number of data points that the buffer can handle.
     @return the number of data points copied into the dataBuffer*/
 long CEvaluatedDataStorage::GetBadColumnData(const CString &serial, double *dataBuffer, long bufferSize){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	// get the scanner index
 	int scannerIndex = GetScannerIndex(serial);
 
@@ -536,6 +474,8 @@ long CEvaluatedDataStorage::GetBadColumnData(const CString &serial, double *data
     @param bufferSize - the maximum number of data points that the buffer can handle.
     @return the number of data points copied into the dataBuffer*/
 long CEvaluatedDataStorage::GetIntensityData(const CString &serial, double *peakSat, double *fitSat, long bufferSize){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	// get the scanner index
 	int scannerIndex = GetScannerIndex(serial);
 
@@ -557,6 +497,8 @@ long CEvaluatedDataStorage::GetIntensityData(const CString &serial, double *peak
     @param bufferSize - the maximum number of data points that the buffer can handle.
     @return the number of data points copied into the dataBuffer*/
 long CEvaluatedDataStorage::GetAngleData(const CString &serial, double *dataBuffer, long bufferSize){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	// get the scanner index
 	int scannerIndex = GetScannerIndex(serial);
 
@@ -580,6 +522,8 @@ long CEvaluatedDataStorage::GetAngleData(const CString &serial, double *dataBuff
     @param bufferSize - the maximum number of data points that the buffer can handle.
     @return the number of data points copied into the dataBuffer*/
 long CEvaluatedDataStorage::GetFluxData(const CString &serial, double *timeBuffer, double *dataBuffer, int *qualityBuffer, long bufferSize){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	// get the scanner index
 	int scannerIndex = GetScannerIndex(serial);
 
@@ -593,12 +537,14 @@ long CEvaluatedDataStorage::GetFluxData(const CString &serial, double *timeBuffe
 	else if(g_userSettings.m_fluxUnit == UNIT_TONDAY)
 		unitConversionFactor = 3.6 * 24.0;
 
-	// Copy the flux data
-	int nCopy = min(bufferSize, m_fluxIndex[scannerIndex]);
-	for(int i = 0; i < nCopy; ++i){
-		dataBuffer[i]     = m_data[scannerIndex][i].m_flux * unitConversionFactor;
-		qualityBuffer[i]  = (m_data[scannerIndex][i].m_fluxOk) ? 1 : 0;
-		timeBuffer[i]     = m_data[scannerIndex][i].m_time;
+	// Copy the flux data, the newest data points if the buffer is too small
+	const std::deque<CScanData> &history = m_data[scannerIndex];
+	long nCopy = min(bufferSize, (long)history.size());
+	std::deque<CScanData>::const_iterator it = history.end() - nCopy;
+	for(int i = 0; i < nCopy; ++i, ++it){
+		dataBuffer[i]     = it->m_flux * unitConversionFactor;
+		qualityBuffer[i]  = (it->m_fluxOk) ? 1 : 0;
+		timeBuffer[i]     = it->m_time;
 	}
 
 	return nCopy;
@@ -660,6 +606,8 @@ long CEvaluatedDataStorage::GetFluxStat(const CString &serial, double &average,
 		@param bufferSize - the maximum number of data points that the buffers can handle.
 		@return the number of datapoints copied into the buffers. */
 long	CEvaluatedDataStorage::GetWindMeasurementData(const CString &serial, double *timeBuffer, double *wsBuffer, double *wseBuffer, long bufferSize){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	// get the scanner index
 	int scannerIndex = GetScannerIndex(serial);
 
@@ -693,6 +641,8 @@ long	CEvaluatedDataStorage::GetWindMeasurementData(const CString &serial, double
 
 /** Get the offset of the last scan */
 double CEvaluatedDataStorage::GetOffset(const CString &serial){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	// get the scanner index
 	int scannerIndex = GetScannerIndex(serial);
 
@@ -711,6 +661,8 @@ double CEvaluatedDataStorage::GetOffset(const CString &serial){
 
 /** Get the calculated plume-centre of the last scan */
 double CEvaluatedDataStorage::GetPlumeCentre(const CString &serial){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	// get the scanner index
 	int scannerIndex = GetScannerIndex(serial);
 
@@ -723,6 +675,8 @@ double CEvaluatedDataStorage::GetPlumeCentre(const CString &serial){
 /** Set the status of the spectrometer 
     @param serial - the serial number of the spectrometer which status should be updated */
 int CEvaluatedDataStorage::SetStatus(const CString &serial, SPECTROMETER_STATUS status){
+	std::unique_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0)
 		return 1;
@@ -735,6 +689,8 @@ int CEvaluatedDataStorage::SetStatus(const CString &serial, SPECTROMETER_STATUS
 /** Get the status of the spectrometer 
     @param serial - the serial number of the spectrometer which status should be updated */
 int CEvaluatedDataStorage::GetStatus(const CString &serial, SPECTROMETER_STATUS &status){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0)
 		return -1;
@@ -746,10 +702,16 @@ int CEvaluatedDataStorage::GetStatus(const CString &serial, SPECTROMETER_STATUS
 
 /** Gets the dynamic range for the spectrometer. Returns 0 if unknown */
 double CEvaluatedDataStorage::GetDynamicRange(const CString &serial){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0)
 		return -1;
 
+	return GetDynamicRangeUnlocked(scannerIndex);
+}
+
+double CEvaluatedDataStorage::GetDynamicRangeUnlocked(int scannerIndex) const{
 	if(m_models[scannerIndex] == UNKNOWN_SPECTROMETER)
 		return 0;
 
@@ -758,14 +720,16 @@ double CEvaluatedDataStorage::GetDynamicRange(const CString &serial){
 
 /** Gets the temperature of the last scan */
 double CEvaluatedDataStorage::GetTemperature(const CString &serial){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0)
 		return -1;
 
-	if(m_fluxIndex[scannerIndex] == 0)
+	if(m_data[scannerIndex].size() == 0)
 		return 0.0;
 	else
-		return m_data[scannerIndex][m_fluxIndex[scannerIndex]-1].m_temp;
+		return m_data[scannerIndex].back().m_temp;
 }
 
 /** Gets the temperature of saved scans.
@@ -775,14 +739,19 @@ double CEvaluatedDataStorage::GetTemperature(const CString &serial){
     @param bufferSize - the maximum number of data points that the buffer can handle.
     @return the number of data points copied into the dataBuffer*/
 long CEvaluatedDataStorage::GetTemperatureData(const CString &serial, double *timeBuffer, double *dataBuffer, long bufferSize){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0)
 		return -1;
 
-	long nCopy = min(m_fluxIndex[scannerIndex], bufferSize);
-	for(int i = 0; i < nCopy; ++i){
-		timeBuffer[i]	= m_data[scannerIndex][i].m_time;
-		dataBuffer[i]	=	m_data[scannerIndex][i].m_temp;
+	// the newest data points if the buffer is too small
+	const std::deque<CScanData> &history = m_data[scannerIndex];
+	long nCopy = min((long)history.size(), bufferSize);
+	std::deque<CScanData>::const_iterator it = history.end() - nCopy;
+	for(int i = 0; i < nCopy; ++i, ++it){
+		timeBuffer[i] = it->m_time;
+		dataBuffer[i] = it->m_temp;
 	}
 
 	return nCopy;
@@ -790,14 +759,16 @@ long CEvaluatedDataStorage::GetTemperatureData(const CString &serial, double *ti
 
 /** Gets the battery voltage of the last scan */
 double CEvaluatedDataStorage::GetBatteryVoltage(const CString &serial){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0)
 		return -1;
 
-	if(m_fluxIndex[scannerIndex] <= 0)
+	if(m_data[scannerIndex].size() == 0)
 		return 0.0;
 	else
-		return m_data[scannerIndex][m_fluxIndex[scannerIndex]-1].m_battery;
+		return m_data[scannerIndex].back().m_battery;
 }
 
 /** Gets the battery-voltage of saved scans.
@@ -807,14 +778,19 @@ double CEvaluatedDataStorage::GetBatteryVoltage(const CString &serial){
     @param bufferSize - the maximum number of data points that the buffer can handle.
     @return the number of data points copied into the dataBuffer*/
 long CEvaluatedDataStorage::GetBatteryVoltageData(const CString &serial, double *timeBuffer, double *dataBuffer, long bufferSize){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0)
 		return -1;
 
-	long nCopy = min(m_fluxIndex[scannerIndex], bufferSize);
-	for(int i = 0; i < nCopy; ++i){
-		timeBuffer[i] = m_data[scannerIndex][i].m_time;
-		dataBuffer[i] = m_data[scannerIndex][i].m_battery;
+	// the newest data points if the buffer is too small
+	const std::deque<CScanData> &history = m_data[scannerIndex];
+	long nCopy = min((long)history.size(), bufferSize);
+	std::deque<CScanData>::const_iterator it = history.end() - nCopy;
+	for(int i = 0; i < nCopy; ++i, ++it){
+		timeBuffer[i] = it->m_time;
+		dataBuffer[i] = it->m_battery;
 	}
 
 	return nCopy;
@@ -827,14 +803,19 @@ long CEvaluatedDataStorage::GetBatteryVoltageData(const CString &serial, double
     @param bufferSize - the maximum number of data points that the buffer can handle.
     @return the number of data points copied into the dataBuffer*/
 long CEvaluatedDataStorage::GetExposureTimeData(const CString &serial, double *timeBuffer, double *dataBuffer, long bufferSize){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0)
 		return -1;
 
-	long nCopy = min(m_fluxIndex[scannerIndex], bufferSize);
-	for(int i = 0; i < nCopy; ++i){
-		timeBuffer[i] = m_data[scannerIndex][i].m_time;
-		dataBuffer[i] = m_data[scannerIndex][i].m_expTime;
+	// the newest data points if the buffer is too small
+	const std::deque<CScanData> &history = m_data[scannerIndex];
+	long nCopy = min((long)history.size(), bufferSize);
+	std::deque<CScanData>::const_iterator it = history.end() - nCopy;
+	for(int i = 0; i < nCopy; ++i, ++it){
+		timeBuffer[i] = it->m_time;
+		dataBuffer[i] = it->m_expTime;
 	}
 
 	return nCopy;
@@ -843,6 +824,8 @@ long CEvaluatedDataStorage::GetExposureTimeData(const CString &serial, double *t
 
 /** Gets the lowest recorded temperature for the given spectrometer */
 double	CEvaluatedDataStorage::GetMinTemperature(const CString &serial){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0)
 		return -1;
@@ -852,6 +835,8 @@ double	CEvaluatedDataStorage::GetMinTemperature(const CString &serial){
 
 /** Gets the highest recorded temperature for the given spectrometer */
 double	CEvaluatedDataStorage::GetMaxTemperature(const CString &serial){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0)
 		return -1;
@@ -862,44 +847,97 @@ double	CEvaluatedDataStorage::GetMaxTemperature(const CString &serial){
 
 /** Gets the lowest recorded battery voltage for the given spectrometer */
 double	CEvaluatedDataStorage::GetMinBatteryVoltage(const CString &serial){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0)
 		return -1;
 
 	double minVoltage = 999;
-	for(int i = 0; i < m_fluxIndex[scannerIndex]; ++i){
-		if(m_data[scannerIndex][i].m_battery > -990)
-			minVoltage = min(minVoltage, m_data[scannerIndex][i].m_battery);
+	for(std::deque<CScanData>::const_iterator it = m_data[scannerIndex].begin(); it != m_data[scannerIndex].end(); ++it){
+		if(it->m_battery > -990)
+			minVoltage = min(minVoltage, it->m_battery);
 	}
 	return minVoltage;
 }
 	
 /** Gets the highest recorded battery voltage for the given spectrometer */
 double	CEvaluatedDataStorage::GetMaxBatteryVoltage(const CString &serial){
+	std::shared_lock<std::shared_timed_mutex> lock{ m_mutex };
+
 	int scannerIndex = GetScannerIndex(serial);
 	if(scannerIndex < 0)
 		return -1;
 
 	double maxVoltage = -999;
-	for(int i = 0; i < m_fluxIndex[scannerIndex]; ++i){
-		if(m_data[scannerIndex][i].m_battery < 1000)
-			maxVoltage = max(maxVoltage, m_data[scannerIndex][i].m_battery);
+	for(std::deque<CScanData>::const_iterator it = m_data[scannerIndex].begin(); it != m_data[scannerIndex].end(); ++it){
+		if(it->m_battery < 1000)
+			maxVoltage = max(maxVoltage, it->m_battery);
 	}
 	return maxVoltage;
 }
 
 
 /** Returns the spectrometer index given a serial number */
-int CEvaluatedDataStorage::GetScannerIndex(const CString &serial){
-	unsigned int i;
+int CEvaluatedDataStorage::GetScannerIndex(const CString &serial) const{
+	std::unordered_map<std::string, int>::const_iterator it = m_serialIndex.find(GetSerialKey(serial));
+	if(it == m_serialIndex.end())
+		return -1; // not found
 
-	// Search for the serial-number
-	for(i = 0; i < m_serialNum; ++i){
-		if(Equals(serial, m_serials[i])){
-			return (int)i;
+	return it->second;
+}
+
+/** Returns the spectrometer index given a serial number, 
+	inserts the serial number if it is not already in the list. */
+int CEvaluatedDataStorage::InsertSerial(const CString &serial){
+	int scannerIndex = GetScannerIndex(serial);
+	if(scannerIndex >= 0)
+		return scannerIndex;
+
+	if(m_serialNum >= MAX_NUMBER_OF_SCANNING_INSTRUMENTS)
+		return -1; // could not insert the serial number
+
+	// the scanner is not in the list, insert it
+	scannerIndex = m_serialNum;
+	m_serials[m_serialNum].Format("%s", serial);
+	m_serialIndex[GetSerialKey(serial)] = scannerIndex;
+	
+	// find the serial-number in the global configuration, to find the spectrometer-model
+	bool found = false;
+	for(unsigned int k = 0; k < g_settings.scannerNum; ++k){
+		if(found)	break;
+
+		for(unsigned int j = 0; j < g_settings.scanner[k].specNum; ++j){
+			if(Equals(g_settings.scanner[k].spec[j].serialNumber, serial)){
+				m_models[m_serialNum] = g_settings.scanner[k].spec[j].model;
+
+				// Get the distance to GMT...
+				m_hoursToGMT[m_serialNum] = 0;
+				CString volcano;
+				volcano.Format(g_settings.scanner[k].volcano);
+				for(unsigned int it = 0; it < g_volcanoes.m_volcanoNum; ++it){
+					if(Equals(volcano, g_volcanoes.m_name[it])){
+						m_hoursToGMT[m_serialNum] = g_volcanoes.m_hoursToGMT[it];
+						break;
+					}
+				}
+				found = true;
+				break;
+			}
 		}
 	}
+	if(!found)
+		m_models[m_serialNum] = UNKNOWN_SPECTROMETER;
+
+	++m_serialNum;
+
+	return scannerIndex;
+}
 
-	// not found
-	return -1;
+/** Returns the key of the serial number in m_serialIndex, 
+	the serial numbers are compared without regard to case. */
+std::string CEvaluatedDataStorage::GetSerialKey(const CString &serial){
+	CString key(serial);
+	key.MakeUpper();
+	return std::string((LPCTSTR)key);
 }
@@ -1,11 +1,24 @@
 #pragma once
 
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
 #include "Common/Common.h"
 #include "Evaluation/ScanResult.h"
 #include "WindMeasurement/WindSpeedResult.h"
 
 /** <b>CEvaluatedDataStorage</b> is a class for holding evaluated data for 
-    later plotting. */
+    later plotting. 
+    The history of each instrument holds todays scans, at most MAX_HISTORY
+    of them, the methods which copy the history into a buffer return the
+    newest data points if the buffer is too small.
+    All public methods may be called from any thread, the data is copied
+    out of the storage so that the caller gets a consistent snapshot.
+    The plotting reads the storage much more often than the evaluation
+    writes to it, so the readers share the lock. */
 
 const enum SPECTROMETER_STATUS {STATUS_GREEN, STATUS_YELLOW, STATUS_RED};
 
@@ -64,12 +77,6 @@ public:
 	CEvaluatedDataStorage(void);
 	~CEvaluatedDataStorage(void);
 
-	// ----------------------------------------------------------------------
-	// ---------------------- PUBLIC DATA -----------------------------------
-	// ----------------------------------------------------------------------
-
-	static const int MAX_HISTORY = 1000;
-
 	// ----------------------------------------------------------------------
 	// ---------------------- PUBLIC METHODS --------------------------------
 	// ----------------------------------------------------------------------
@@ -243,9 +250,16 @@ private:
 	/** The maximum [1] and mimimum [0] temperature measured for each scanning instrument */
 	double m_temperatureRange[2][MAX_NUMBER_OF_SCANNING_INSTRUMENTS];
 
-	/** The 'scan-memory' */
-	CScanData m_data[MAX_NUMBER_OF_SCANNING_INSTRUMENTS][MAX_HISTORY];
-	int m_fluxIndex[MAX_NUMBER_OF_SCANNING_INSTRUMENTS];
+	/** The maximum number of scans in the history of each instrument,
+		one scan every 30 seconds during a whole day */
+	static const size_t MAX_HISTORY = 2880;
+
+	/** The 'scan-memory', todays scans from each instrument in the order they were added.
+		The oldest scans are removed when there are more than MAX_HISTORY */
+	std::deque<CScanData> m_data[MAX_NUMBER_OF_SCANNING_INSTRUMENTS];
+
+	/** The day of month when the old flux results were last removed */
+	int m_lastPurgeDate;
 
 	/** The list of wind-speed measurements made.
 	    This is impplemented as a list for simplicity, the number of wind-speed
@@ -264,6 +278,15 @@ private:
 	/** How many serial numbers have been inserted */
 	unsigned int m_serialNum;
 
+	/** The index of each serial number in 'm_serials', the key is given by 'GetSerialKey' */
+	std::unordered_map<std::string, int> m_serialIndex;
+
+	/** Protects all the data in the storage. The methods which only read
+		the data take a shared lock, the methods which change it take an
+		exclusive lock. The locked methods must not call each other, they
+		use the private methods below which assume that the lock is held. */
+	mutable std::shared_timed_mutex m_mutex;
+
 	// ----------------------------------------------------------------------
 	// -------------------- PRIVATE METHODS ---------------------------------
 	// ----------------------------------------------------------------------
@@ -271,6 +294,20 @@ private:
 	/** Removes old flux results */
 	void RemoveOldFluxResults();
 
+	/** Appends a flux result to the history, the caller must hold the exclusive lock */
+	void AppendFluxResultUnlocked(int scannerIndex, const CDateTime &time, double fluxValue, bool fluxOk, double batteryVoltage, double temp, long expTime);
+
+	/** Returns the dynamic range of the spectrometer, the caller must hold the lock */
+	double GetDynamicRangeUnlocked(int scannerIndex) const;
+
 	/** Returns the spectrometer index given a serial number */
-	int GetScannerIndex(const CString &serial);
+	int GetScannerIndex(const CString &serial) const;
+
+	/** Returns the spectrometer index given a serial number, 
+		inserts the serial number if it is not already in the list.
+		@return -1 if the serial number could not be inserted */
+	int InsertSerial(const CString &serial);
+
+	/** Returns the key of the serial number in m_serialIndex */
+	static std::string GetSerialKey(const CString &serial);
 };
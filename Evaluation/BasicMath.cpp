@@ -5,6 +5,7 @@
 #include "stdafx.h"
 #include "../resource.h"
 #include "BasicMath.h"
+#include "../Common/VectorKernels.h"
 //#include "MFCTools.h"
 //#include "MathHistory.h"
 #include "../Fit/GaussFunction.h"
@@ -34,6 +35,7 @@ using namespace MathFit;
 //////////////////////////////////////////////////////////////////////
 
 bool CBasicMath::mDoNotUseMathLimits = false;
+CBasicMath::HIGHPASS_METHOD CBasicMath::mHighPassMethod = CBasicMath::HIGHPASS_FOURIER;
 
 CBasicMath::CBasicMath()
 {
@@ -84,6 +86,63 @@ double* CBasicMath::LowPassBinomial(double *fData, int iSize, int iNIterations)
 	return(fData);
 }
 
+// Returns the index into an array of length 'iSize' which corresponds to the index 'i'
+//	when the array is mirrored around both its end points (e.g. -1 -> 0, iSize -> iSize - 1)
+static int MirrorIndex(int i, int iSize)
+{
+	int iPeriod = 2 * iSize;
+	i %= iPeriod;
+	if(i < 0)
+		i += iPeriod;
+	return (i < iSize) ? i : iPeriod - 1 - i;
+}
+
+double* CBasicMath::LowPassBinomial_Fourier(double *fData, int iSize, int iNIterations)
+{
+	if(iSize <= 1 || iNIterations <= 0)
+		return(fData);
+
+	// iNIterations passes of the [1/4 1/2 1/4] filter is the same as one convolution
+	//	with the binomial kernel of 2*iNIterations+1 points, with the data mirrored
+	//	around the end points. The kernel is a gaussian with sigma = sqrt(iNIterations/2)
+	//	and the part further out than 20 sigma is below the double precision.
+	int iHalfWidth = (int)ceil(20.0 * sqrt(0.5 * iNIterations)) + 1;
+	if(iHalfWidth > iNIterations)
+		iHalfWidth = iNIterations;
+
+	// the transform must hold the data and the mirrored data on both sides without wrapping around
+	int iLength = 1;
+	while(iLength < iSize + 2 * iHalfWidth)
+		iLength <<= 1;
+
+	// the data as complex numbers, the mirrored data to the left is put in the end of the buffer
+	std::vector<double> fBuffer(2 * iLength, 0.0);
+	for(int i = -iHalfWidth; i < iSize + iHalfWidth; i++)
+	{
+		int iPos = (i < 0) ? i + iLength : i;
+		fBuffer[2 * iPos] = fData[MirrorIndex(i, iSize)];
+	}
+
+	DFourier(fBuffer.data() - 1, iLength, 1);
+
+	// the transfer function of one pass is (1 + cos(w)) / 2 = cos(w/2)^2
+	const double fPi = 3.14159265358979323846;
+	for(int k = 0; k < iLength; k++)
+	{
+		double fCos = cos(fPi * k / iLength);
+		double fGain = pow(fCos * fCos, iNIterations);
+		fBuffer[2 * k]     *= fGain;
+		fBuffer[2 * k + 1] *= fGain;
+	}
+
+	DFourier(fBuffer.data() - 1, iLength, -1);
+
+	for(int i = 0; i < iSize; i++)
+		fData[i] = fBuffer[2 * i] / (double)iLength;
+
+	return(fData);
+}
+
 /*void CBasicMath::LowPassBinomial(ISpectrum& dispData, int iNIterations)
 {
 	CDoubleMonitoredArrayData dmadData(dispData.Data);
@@ -109,8 +168,11 @@ double* CBasicMath::HighPassBinomial(double *fData, int iSize, int iNIterations)
 	// create copy of original data
 	memcpy(fBuffer, fData, sizeof(double) * iSize);
 
-	// create low pass filtered data
-	LowPassBinomial(fBuffer, iSize, iNIterations);
+	// create low pass filtered data. For only a few iterations the direct filter is faster
+	if(mHighPassMethod == HIGHPASS_FOURIER && iNIterations > 50)
+		LowPassBinomial_Fourier(fBuffer, iSize, iNIterations);
+	else
+		LowPassBinomial(fBuffer, iSize, iNIterations);
 
 	// remove low pass part from data
 	for(i = 0; i < iSize; i++)
@@ -146,10 +208,7 @@ double* CBasicMath::HighPassBinomial(double *fData, int iSize, int iNIterations)
 
 double* CBasicMath::Log(double *fData, int iSize)
 {
-	int i;
-
-	for(i = 0; i < iSize; i++)
-		fData[i] = fData[i] <= 0 ? 0.0 : log(fData[i]);
+	CVectorKernels::Log(fData, iSize);
 	return(fData);
 }
 
@@ -593,18 +652,7 @@ void CBasicMath::Reverse(double *fData, int iSize)
 
 void CBasicMath::Add(double *fFirst, double *fSec, int iSize, double fFactor)
 {
-	if(fFactor != 0)
-	{
-		int i;
-		for(i = 0; i < iSize; i++)
-			fFirst[i] += fFactor * fSec[i];
-	}
-	else
-	{
-		int i;
-		for(i = 0; i < iSize; i++)
-			fFirst[i] += fSec[i];
-	}
+	CVectorKernels::Add(fFirst, fSec, iSize, (fFactor != 0) ? fFactor : 1.0);
 }
 
 /*void CBasicMath::Add(ISpectrum &dispFirst, ISpectrum &dispSec, int iMode)
@@ -631,9 +679,7 @@ void CBasicMath::Add(double *fFirst, double *fSec, int iSize, double fFactor)
 
 void CBasicMath::Add(double *fFirst, int iSize, double fConst)
 {
-	int i;
-	for(i = 0; i < iSize; i++)
-		fFirst[i] += fConst;
+	CVectorKernels::Add(fFirst, iSize, fConst);
 }
 
 /*void CBasicMath::Add(ISpectrum &dispFirst, double fConst)
@@ -655,18 +701,7 @@ void CBasicMath::Add(double *fFirst, int iSize, double fConst)
 
 void CBasicMath::Sub(double *fFirst, double *fSec, int iSize, double fFactor)
 {
-	if(fFactor != 0)
-	{
-		int i;
-		for(i = 0; i < iSize; i++)
-			fFirst[i] -= fFactor * fSec[i];
-	}
-	else
-	{
-		int i;
-		for(i = 0; i < iSize; i++)
-			fFirst[i] -= fSec[i];
-	}
+	CVectorKernels::Sub(fFirst, fSec, iSize, (fFactor != 0) ? fFactor : 1.0);
 }
 
 /*void CBasicMath::Sub(ISpectrum &dispFirst, ISpectrum &dispSec, int iMode)
@@ -693,9 +728,7 @@ void CBasicMath::Sub(double *fFirst, double *fSec, int iSize, double fFactor)
 */
 void CBasicMath::Sub(double *fFirst, int iSize, double fConst)
 {
-	int i;
-	for(i = 0; i < iSize; i++)
-		fFirst[i] -= fConst;
+	CVectorKernels::Sub(fFirst, iSize, fConst);
 }
 
 /*void CBasicMath::Sub(ISpectrum &dispFirst, double fConst)
@@ -717,18 +750,7 @@ void CBasicMath::Sub(double *fFirst, int iSize, double fConst)
 */
 void CBasicMath::Mul(double *fFirst, double *fSec, int iSize, double fFactor)
 {
-	if(fFactor != 0)
-	{
-		int i;
-		for(i = 0; i < iSize; i++)
-			fFirst[i] *= fFactor * fSec[i];
-	}
-	else
-	{
-		int i;
-		for(i = 0; i < iSize; i++)
-			fFirst[i] *= fSec[i];
-	}
+	CVectorKernels::Mul(fFirst, fSec, iSize, (fFactor != 0) ? fFactor : 1.0);
 }
 
 /*void CBasicMath::Mul(ISpectrum &dispFirst, ISpectrum &dispSec, int iMode)
@@ -755,9 +777,7 @@ void CBasicMath::Mul(double *fFirst, double *fSec, int iSize, double fFactor)
 
 void CBasicMath::Mul(double *fFirst, int iSize, double fConst)
 {
-	int i;
-	for(i = 0; i < iSize; i++)
-		fFirst[i] *= fConst;
+	CVectorKernels::Mul(fFirst, iSize, fConst);
 }
 
 /*void CBasicMath::Mul(ISpectrum &dispFirst, double fConst)
@@ -779,24 +799,8 @@ void CBasicMath::Mul(double *fFirst, int iSize, double fConst)
 
 void CBasicMath::Div(double *fFirst, double *fSec, int iSize, double fFactor)
 {
-	if(fFactor != 0)
-	{
-		int i;
-		for(i = 0; i < iSize; i++)
-			if(fSec[i] != 0)
-				fFirst[i] /= fFactor * fSec[i];
-			else
-				fFirst[i] = 0;
-	}
-	else
-	{
-		int i;
-		for(i = 0; i < iSize; i++)
-			if(fSec[i] != 0)
-				fFirst[i] /= fSec[i];
-			else
-				fFirst[i] = 0;
-	}
+	// pixels where 'fSec' is zero are set to zero
+	CVectorKernels::DivNonZero(fFirst, fSec, iSize, (fFactor != 0) ? fFactor : 1.0);
 }
 
 /*void CBasicMath::Div(ISpectrum &dispFirst, ISpectrum &dispSec, int iMode)
@@ -826,9 +830,7 @@ void CBasicMath::Div(double *fFirst, int iSize, double fConst)
 	if(fConst == 0)
 		return;
 
-	int i;
-	for(i = 0; i < iSize; i++)
-		fFirst[i] /= fConst;
+	CVectorKernels::Div(fFirst, iSize, fConst);
 }
 
 /*void CBasicMath::Div(ISpectrum &dispFirst, double fConst)
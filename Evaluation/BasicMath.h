@@ -36,6 +36,16 @@ public:
 //	void FillRandom(ISpectrum& dispSpec, double fVariance);
 	enum{ NOWEIGHT = 0, SCANWEIGHT, TIMEWEIGHT };
 
+	/** The methods available for the low pass filtering in HighPassBinomial.
+		HIGHPASS_ITERATIVE runs the binomial filter once for every iteration.
+		HIGHPASS_FOURIER applies all the iterations at once in the frequency domain,
+			which gives the same result (to within rounding errors) in a time which
+			does not grow with the number of iterations. */
+	enum HIGHPASS_METHOD{ HIGHPASS_ITERATIVE = 0, HIGHPASS_FOURIER };
+
+	/** The method used by HighPassBinomial. Default is HIGHPASS_FOURIER */
+	static HIGHPASS_METHOD mHighPassMethod;
+
 //	void PolyFill(ISpectrum& dispSpec, int iStartChannel, int iNumChannels, double* fPolyCoeff, int iPolyDegree);
 	double FitRes2MicroGrammPerCubicMeter(double fFitResult, double fLightPathLength, double fMolecularWeight);
 	double FitRes2ppb(double fFitResult, double fLightPathLength, double fTemperature, double fPreasure);
@@ -85,6 +95,7 @@ public:
 	double* Delog(double* fData, int iSize);
 	double* HighPassBinomial(double* fData, int iSize, int iNIterations);
 	double* LowPassBinomial(double* fData, int iSize, int iNIterations);
+	double* LowPassBinomial_Fourier(double* fData, int iSize, int iNIterations);
 //	static int CheckLimits(ISpectrum& dispSpec, int& iLowLimit, int& iHighLimit);
 	CBasicMath();
 	virtual ~CBasicMath();
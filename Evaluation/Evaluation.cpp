@@ -12,6 +12,7 @@
 #include "../Fit/SimpleDOASFunction.h"
 #include "../Fit/StandardMetricFunction.h"
 #include "../Fit/StandardFit.h"
+#include "../Fit/VariableProjectionFit.h"
 #include "../Fit/ExpFunction.h"
 #include "../Fit/LnFunction.h"
 #include "../Fit/PolynomialFunction.h"
@@ -35,6 +36,8 @@ using namespace Evaluation;
 
 using namespace std;
 
+bool CEvaluation::s_useVariableProjection = false;
+
 
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
@@ -44,25 +47,39 @@ CEvaluation::CEvaluation()
 {
 	m_referenceNum = 1;
 
-	for(int i = 0; i < MAX_N_REFERENCES; ++i)
+	for(int i = 0; i < MAX_N_REFERENCES; ++i){
 		ref[i] = NULL;
+		m_splinePrepared[i] = false;
+	}
 
 	solarSpec = NULL;
 	m_numberOfReferencesToUse = 0;
+
+	m_lastLambda = 0.0;
+	m_lastFitConverged = false;
+	ColdStart();
 }
 
 CEvaluation::CEvaluation(const CEvaluation &eval2){
 	this->m_referenceNum = eval2.m_referenceNum;
 	this->m_numberOfReferencesToUse = eval2.m_numberOfReferencesToUse;
+	this->m_window = eval2.m_window;
 
 	this->m_result = eval2.m_result;
 
 	for(int i = 0; i < MAX_N_REFERENCES; ++i){
 		m_crossSection[i] = eval2.m_crossSection[i];
+		ref[i] = NULL;
+		m_splinePrepared[i] = false;
 	}
+	solarSpec = NULL;
 	
 	m_solarSpectrumData = eval2.m_solarSpectrumData;
 	this->vXData.Copy(eval2.vXData);
+
+	m_lastLambda = 0.0;
+	m_lastFitConverged = false;
+	ColdStart();
 }
 
 CEvaluation::~CEvaluation()
@@ -81,6 +98,8 @@ int CEvaluation::Evaluate(const CSpectrum &sky, const CSpectrum &meas, const CFi
 	int fitLow	= window.fitLow;
 	int fitHigh	= window.fitHigh;
 
+	m_lastFitConverged = false;
+
 	// Check the fit region
 	if(fitHigh < fitLow){
 		int tmp = fitLow;
@@ -181,8 +200,13 @@ int CEvaluation::Evaluate(const CSpectrum &sky, const CSpectrum &meas, const CFi
 	/////////////////////////////////////////////////////////////////
 	// Now its time to create the fit object. The CStandardFit object will 
 	// provide a combination of a linear Least Square Fit and a nonlinear Levenberg-Marquardt Fit, which
-	// should be sufficient for most needs.
-	CStandardFit cFirstFit(cDiff);
+	// should be sufficient for most needs. The CVariableProjectionFit object instead solves the linear
+	// parameters again for every step of the nonlinear (shift and squeeze) fit.
+	// The model functions and the fit objects are built for every spectrum, so their
+	// buffers are reused in every step of the fit but not from one spectrum to the next.
+	CStandardFit cStandardFit(cDiff);
+	CVariableProjectionFit cProjectionFit(cDiff);
+	IMinimizer &cFirstFit = s_useVariableProjection ? (IMinimizer &)cProjectionFit : (IMinimizer &)cStandardFit;
 
 	// don't forget to the the already extracted fit range to the fit object!
 	// without a valid fit range you'll get an exception.
@@ -190,8 +214,12 @@ int CEvaluation::Evaluate(const CSpectrum &sky, const CSpectrum &meas, const CFi
 
 	// limit the number of fit iteration to 5000. This can still take a long time! More convinient values are
 	// between 100 and 1000
-	cFirstFit.GetNonlinearMinimizer().SetMaxFitSteps(numSteps);
-	cFirstFit.GetNonlinearMinimizer().SetMinChiSquare(0.0001);
+	cFirstFit.SetMaxFitSteps(numSteps);
+	cFirstFit.SetMinChiSquare(0.0001);
+
+	// a warm started fit continues with the damping of the last accepted fit
+	if(m_warmStart)
+		cFirstFit.SetStartLambda((TFitData)m_startLambda);
 
 	try
 	{
@@ -215,6 +243,8 @@ int CEvaluation::Evaluate(const CSpectrum &sky, const CSpectrum &meas, const CFi
 			// get the basic fit results
 		m_result.m_stepNum    = (long)cFirstFit.GetFitSteps();
 		m_result.m_chiSquare  = (double)cFirstFit.GetChiSquare();
+		m_lastLambda          = (double)cFirstFit.GetLambda();
+		m_lastFitConverged    = (m_result.m_stepNum < numSteps && m_lastLambda < MAXLAMBDA);
 		m_result.m_speciesNum = (unsigned long)window.nRef;
 		m_result.m_ref.SetSize(window.nRef);
 
@@ -304,7 +334,6 @@ int CEvaluation::EvaluateShift(const CSpectrum &measured, const CFitWindow &wind
 	CString message;
 	int i;
 	CVector vMeas;
-	CVector yValues;
 	int fitLow	= window.fitLow;
 	int fitHigh	= window.fitHigh;
 
@@ -438,14 +467,9 @@ int CEvaluation::EvaluateShift(const CSpectrum &measured, const CFitWindow &wind
 		// problems during fitting.
 		ref[i]->SetNormalize(true);
 
-		// set the spectral data of the reference spectrum to the object. This also causes an internal
-		// transformation of the spectral data into a B-Spline that will be used to interpolate the 
+		// use the B-Spline of the cross section, that will be used to interpolate the
 		// reference spectrum during shift and squeeze operations
-		yValues.SetSize(m_crossSection[i].GetSize());
-		for(int k = 0; k < m_crossSection[i].GetSize(); ++k){
-			yValues.SetAt(k, m_crossSection[i].GetAt(k));
-		}
-		if(!ref[i]->SetData(vXData.SubVector(0, m_crossSection[i].GetSize()), yValues))
+		if(!SetCrossSectionSpline(i))
 		{
 			Error0("Error initializing spline object!");
 			free(measArray);
@@ -476,16 +500,19 @@ int CEvaluation::EvaluateShift(const CSpectrum &measured, const CFitWindow &wind
 	/////////////////////////////////////////////////////////////////
 	// Now its time to create the fit object. The CStandardFit object will 
 	// provide a combination of a linear Least Square Fit and a nonlinear Levenberg-Marquardt Fit, which
-	// should be sufficient for most needs.
-	CStandardFit cFirstFit(cDiff);
+	// should be sufficient for most needs. The CVariableProjectionFit object instead solves the linear
+	// parameters again for every step of the nonlinear (shift and squeeze) fit.
+	CStandardFit cStandardFit(cDiff);
+	CVariableProjectionFit cProjectionFit(cDiff);
+	IMinimizer &cFirstFit = s_useVariableProjection ? (IMinimizer &)cProjectionFit : (IMinimizer &)cStandardFit;
 
 	// don't forget to the the already extracted fit range to the fit object!
 	// without a valid fit range you'll get an exception.
 	cFirstFit.SetFitRange(vXSec);
 
 	// limit the number of fit iteration to 5000.
-	cFirstFit.GetNonlinearMinimizer().SetMaxFitSteps(500);
-	cFirstFit.GetNonlinearMinimizer().SetMinChiSquare(0.0001);
+	cFirstFit.SetMaxFitSteps(500);
+	cFirstFit.SetMinChiSquare(0.0001);
 
 	try
 	{
@@ -599,6 +626,31 @@ int CEvaluation::EvaluateShift(const CSpectrum &measured, const CFitWindow &wind
 		}
 }
 
+/** Lets the following fits start from the result of the last fit */
+bool CEvaluation::WarmStartFromLastFit(){
+	if(!m_lastFitConverged){
+		ColdStart();
+		return false;
+	}
+
+	m_startRefNum = min((int)m_result.m_ref.GetSize(), MAX_N_REFERENCES);
+	for(int i = 0; i < m_startRefNum; ++i){
+		m_startShift[i]   = m_result.m_ref[i].m_shift;
+		m_startSqueeze[i] = m_result.m_ref[i].m_squeeze;
+	}
+	m_startLambda = m_lastLambda;
+	m_warmStart   = true;
+
+	return true;
+}
+
+/** Lets the following fits start from the default values again */
+void CEvaluation::ColdStart(){
+	m_warmStart   = false;
+	m_startRefNum = 0;
+	m_startLambda = 0.0;
+}
+
 /** Returns the evaluation result for the last spectrum
   @return a reference to the evaluation result */
 const CEvaluationResult& CEvaluation::GetEvaluationResult() const{
@@ -618,6 +670,7 @@ BOOL CEvaluation::ReadReferences(){
 
 	// read in the cross sections to use
 	for(int k = 0; k < m_window.nRef; ++k){
+		m_splinePrepared[k] = false;
 		if(m_crossSection[k].ReadCrossSectionFile(m_window.ref[k].m_path))
 			return FALSE;
 	}
@@ -649,6 +702,7 @@ BOOL CEvaluation::IncludeAsReference(double *array, int sumChn, int refNum){
 		//for(int index = 0; index < sumChn; ++index)
 		//	m_referenceData[index].SetAt(index, (TFitData)array[index]);
 		m_crossSection[m_referenceNum].Set(array, (unsigned long)sumChn);
+		m_splinePrepared[m_referenceNum] = false;
 
 		++m_referenceNum;
 	}else{
@@ -659,6 +713,7 @@ BOOL CEvaluation::IncludeAsReference(double *array, int sumChn, int refNum){
 		//for(int index = 0; index < sumChn; ++index)
 		//	m_referenceData[refNum].SetAt(index, (TFitData)array[index]);
 		m_crossSection[refNum].Set(array, (unsigned long)sumChn);
+		m_splinePrepared[refNum] = false;
 	}
 	return TRUE;
 }
@@ -742,9 +797,40 @@ CEvaluation &CEvaluation::operator = (const CEvaluation &e2){
 	return *this;
 }
 
+bool CEvaluation::PrepareCrossSectionSpline(int index){
+	if(m_splinePrepared[index])
+		return true;
+
+	CVector yValues;
+	CReferenceSpectrumFunction &spline = m_crossSectionSpline[index];
+
+	// enable amplitude normalization. This should normally be done in order to avoid numerical
+	// problems during fitting.
+	spline.SetNormalize(true);
+
+	// set the spectral data of the reference spectrum to the object. This also causes an internal
+	// transformation of the spectral data into a B-Spline.
+	yValues.SetSize(m_crossSection[index].GetSize());
+	for(unsigned int k = 0; k < m_crossSection[index].GetSize(); ++k){
+		yValues.SetAt(k, m_crossSection[index].GetAt(k));
+	}
+	if(!spline.SetData(vXData.SubVector(0, m_crossSection[index].GetSize()), yValues))
+		return false;
+
+	m_splinePrepared[index] = true;
+	return true;
+}
+
+bool CEvaluation::SetCrossSectionSpline(int index){
+	if(!PrepareCrossSectionSpline(index))
+		return false;
+
+	ref[index]->SetPreparedBasisFunction(m_crossSectionSpline[index].GetBasisFunction(), m_crossSectionSpline[index].GetAmplitudeScale());
+	return true;
+}
+
 // Creates the appropriate CReferenceSpectrumFunction for the fitting
 int CEvaluation::CreateReferenceSpectrum(const CFitWindow &window, int startChannel){
-	CVector yValues;
 
 	for(int i = 0; i < window.nRef; i++)
 	{
@@ -756,15 +842,10 @@ int CEvaluation::CreateReferenceSpectrum(const CFitWindow &window, int startChan
 		// problems during fitting.
 		ref[i]->SetNormalize(true);
 
-		// set the spectral data of the reference spectrum to the object. This also causes an internal
-		// transformation of the spectral data into a B-Spline that will be used to interpolate the 
-		// reference spectrum during shift and squeeze operations
-		//if(!ref[i]->SetData(vXData.SubVector(0, m_referenceData[i].GetSize()), m_referenceData[i]))
-		yValues.SetSize(m_crossSection[i].GetSize());
-		for(unsigned int k = 0; k < m_crossSection[i].GetSize(); ++k){
-			yValues.SetAt(k, m_crossSection[i].GetAt(k));
-		}
-		if(!ref[i]->SetData(vXData.SubVector(0, m_crossSection[i].GetSize()), yValues))
+		// use the B-Spline of the cross section, that will be used to interpolate the
+		// reference spectrum during shift and squeeze operations. The spline is only built
+		// the first time the cross section is used.
+		if(!SetCrossSectionSpline(i))
 		{
 			Error0("Error initializing spline object!");
 			return(1);
@@ -793,6 +874,15 @@ int CEvaluation::CreateReferenceSpectrum(const CFitWindow &window, int startChan
 			default:			ref[i]->SetDefaultParameter(CReferenceSpectrumFunction::SQUEEZE, (TFitData)1.0); 
 								ref[i]->SetParameterLimits(CReferenceSpectrumFunction::SQUEEZE,	(TFitData)0.98, (TFitData)1.02, (TFitData)1e0);break;
 		}
+
+		// A warm started fit begins at the shift and squeeze of the last accepted fit.
+		//	The column is a linear parameter and is solved directly, so it needs no start value.
+		if(m_warmStart && i < m_startRefNum){
+			if(window.ref[i].m_shiftOption != SHIFT_FIX && window.ref[i].m_shiftOption != SHIFT_LINK)
+				ref[i]->SetDefaultParameter(CReferenceSpectrumFunction::SHIFT, (TFitData)m_startShift[i]);
+			if(window.ref[i].m_squeezeOption != SHIFT_FIX && window.ref[i].m_squeezeOption != SHIFT_LINK)
+				ref[i]->SetDefaultParameter(CReferenceSpectrumFunction::SQUEEZE, (TFitData)m_startSqueeze[i]);
+		}
 	}
 
 	return 0;
@@ -113,6 +113,23 @@ namespace Evaluation
 		/** Assignment operator */
 		CEvaluation &operator = (const CEvaluation &e2);
 
+		/** If true then the fits are done with the variable projection method
+			(CVariableProjectionFit), which solves the columns and the polynomial
+			for every step of the shift and squeeze fit. Default is false, which
+			uses the alternating linear and nonlinear fit of CStandardFit. */
+		static bool s_useVariableProjection;
+
+		/** Lets the following fits start from the shift and squeeze of the last fit,
+			and from the damping (lambda) the Levenberg-Marquardt iteration ended with,
+			instead of from the defaults. Only shifts and squeezes which are free
+			or limited are affected, fixed and linked values are kept.
+			If the last fit failed or did not converge, then this is the same as 'ColdStart'.
+			@return true if the following fits will be warm started. */
+		bool WarmStartFromLastFit();
+
+		/** Lets the following fits start from the default shift, squeeze and lambda again */
+		void ColdStart();
+
 	private:
 		/** The result */
 		CEvaluationResult m_result;
@@ -132,6 +149,20 @@ namespace Evaluation
 		/** Simple vector for holding the channel number information */
 		CVector vXData;
 
+		/** True if the fits start from 'm_startShift', 'm_startSqueeze' and 'm_startLambda' */
+		bool m_warmStart;
+
+		/** The start values of a warm started fit, 'm_startRefNum' references are valid */
+		double m_startShift[MAX_N_REFERENCES];
+		double m_startSqueeze[MAX_N_REFERENCES];
+		int m_startRefNum;
+		double m_startLambda;
+
+		/** The lambda of the Levenberg-Marquardt iteration at the end of the last fit,
+			and true if the last fit converged before the maximum number of steps */
+		double m_lastLambda;
+		bool m_lastFitConverged;
+
 		/** Simple function for initializing the vectors used in the evaluation */
 		void InitializeVectors(int sumChn);
 
@@ -152,6 +183,20 @@ namespace Evaluation
 		CReferenceSpectrumFunction *ref[MAX_N_REFERENCES];
 		CReferenceSpectrumFunction *solarSpec;
 
+		// The splines of the cross sections, built once and shared by the 'ref'-functions
+		//	of every evaluated spectrum. 'm_splinePrepared[i]' is true if 'm_crossSectionSpline[i]'
+		//	is up to date with 'm_crossSection[i]'.
+		CReferenceSpectrumFunction m_crossSectionSpline[MAX_N_REFERENCES];
+		bool m_splinePrepared[MAX_N_REFERENCES];
+
+		// Builds the spline of the cross section 'index', if it is not already built
+		//	@return false if the spline could not be built
+		bool PrepareCrossSectionSpline(int index);
+
+		// Lets the reference function 'ref[index]' use the spline of the cross section 'index'
+		//	@return false if the spline could not be built
+		bool SetCrossSectionSpline(int index);
+
 		// Creates the appropriate CReferenceSpectrumFunction for the fitting
 		int CreateReferenceSpectrum(const CFitWindow &window, int startChannel);
 
@@ -2,6 +2,8 @@
 #include "evaluationcontroller.h"
 #include "ScanEvaluation.h"
 
+#include <algorithm>
+
 // we also need the meterological data
 #include "../MeteorologicalData.h"
 
@@ -19,6 +21,7 @@
 
 // ... support for handling the evaluation-log files...
 #include "../Common/EvaluationLogFileHandler.h"
+#include "../Common/BinaryEvaluationLog.h"
 
 // For the moment we also need the geometry calculator and the list of volcanoes...
 //	THIS IS ONLY USED FOR THE HEIDELBEG GEOMETRY CALCULATIONS AND SHOULD BE MOVED LATER ...
@@ -54,10 +57,15 @@ CEvaluationController::CEvaluationController(void)
 	m_realTime = false;
 	m_date[0] = m_date[1] = m_date[2] = 0;
 	m_lastResult = nullptr;
+	m_queuedScanNum = 0;
+	m_queuedScanBytes = 0;
+	m_stopPipeline = false;
 }
 
 CEvaluationController::~CEvaluationController(void)
 {
+	StopPipeline();
+
 	for(int i = 0; i < m_spectrometer.GetSize(); ++i){
 		if(m_spectrometer[i] != NULL){
 			delete m_spectrometer[i];
@@ -68,6 +76,9 @@ CEvaluationController::~CEvaluationController(void)
 
 /** Quits the thread */
 void CEvaluationController::OnQuit(WPARAM wp, LPARAM lp){
+	// finish the scans which are being evaluated before the spectrometers are removed
+	StopPipeline();
+
 	for(int i = 0; i < m_spectrometer.GetSize(); ++i){
 		if(m_spectrometer[i] != NULL){
 			delete m_spectrometer[i];
@@ -101,52 +112,97 @@ void CEvaluationController::OnTestEvaluation(WPARAM wp, LPARAM lp){
 	EvaluateScan(*fileName, -1);
 }
 
-/** This function takes care of newly arrived scan files,
-		evaluates the spectra and stores the scan-file in the archives. */
+/** This function takes care of newly arrived scan files.
+		The scan-file is read and the spectrometer identified here, the 
+		evaluation and the archiving of the scan is then done by the 
+		worker threads of the pipeline. */
 void CEvaluationController::OnArrivedSpectra(WPARAM wp, LPARAM lp){
 	// The filename of the newly arrived file is the first parameter 
 	CString *fileName = (CString *)wp;
-	CString errorMessage, message;
-	CString serialNumber;
-	CString storeFileName_pak, storeFileName_txt;
-	CString str;
-	SpectrumIO::CSpectrumIO reader;
-	CSpectrum spec;
-	bool isFullScan = true;
-	MEASUREMENT_MODE measurementMode = MODE_FLUX;
-	int nSpectra = 0;
+	CString errorMessage;
+	clock_t cStart = clock();
 
 	// 1. Check if the file exists
 	if(!IsExistingFile(*fileName)){
-		errorMessage.Format("EvaluationController recieved filename with erroneous filePath: %s ", fileName);
+		errorMessage.Format("EvaluationController recieved filename with erroneous filePath: %s ", *fileName);
 		m_logFileWriter.WriteErrorMessage(errorMessage);
 		ShowMessage(errorMessage);
 		delete fileName;
 		return;
 	}
 
-	// 2. Find the serial number of the spectrometer and the channel that was used
-	reader.ReadSpectrum(*fileName, 0, spec); // TODO: check for errors!!
-	serialNumber.Format("%s", spec.m_info.m_device);
-	int specPerScan				= spec.SpectraPerScan();
-
-	// 3. Find the volcano that the spectrometer with this serial-number monitors
-	int volcanoIndex = Common::GetMonitoredVolcano(serialNumber);
+	std::unique_ptr<ArrivedScan> arrived(new ArrivedScan());
+	arrived->fileName.Format("%s", *fileName);
+	arrived->spectrometer		= NULL;
+	arrived->isFullScan			= true;
+	arrived->measurementMode	= MODE_FLUX;
+	arrived->classificationTime	= 0.0;
+	arrived->evaluationTime		= 0.0;
+	arrived->loadedSize			= 0;
+	delete fileName;   // signals that we are done with the message
+
+	// 2. Read the whole scan-file into memory. This is the only time the file is read,
+	//		the classification, evaluation and archiving all use the spectra in memory.
+	//		If the scan cannot be evaluated, the spectra which could be read are still
+	//		used to classify it.
+	arrived->scan.reset(new CScanFileHandler());
+	bool loaded = (SUCCESS == arrived->scan->LoadScanFile(&arrived->fileName));
+	arrived->readTime = (double)(clock() - cStart) / (double)CLOCKS_PER_SEC;
+
+	// 3. Find the serial number of the spectrometer and the volcano that it monitors.
+	//		If the first spectrum is not in memory then read it on its own.
+	CSpectrum spectrum0;
+	const CSpectrum *firstSpectrum = arrived->scan->GetLoadedSpectrum(0);
+	if(firstSpectrum == NULL){
+		CSpectrumIO reader;
+		reader.ReadSpectrum(arrived->fileName, 0, spectrum0); // the header is used even if the data is corrupt
+		firstSpectrum = &spectrum0;
+	}
+	arrived->serialNumber.Format("%s", firstSpectrum->m_info.m_device);
+	arrived->volcanoIndex = Common::GetMonitoredVolcano(arrived->serialNumber);
 
 	// 4. Check so that this file contains one full scan
-	measurementMode = CPakFileHandler::GetMeasurementMode(*fileName);
+	cStart = clock();
+	arrived->measurementMode = CPakFileHandler::GetMeasurementMode(*arrived->scan);
 
-	if(measurementMode == MODE_FLUX){
-		nSpectra		= reader.CountSpectra(*fileName);
-		isFullScan	= (specPerScan == nSpectra); // TODO: will this work if there are repetitions??
+	if(arrived->measurementMode == MODE_FLUX){
+		arrived->isFullScan	= (firstSpectrum->SpectraPerScan() == arrived->scan->GetSpectrumNumInFile()); // TODO: will this work if there are repetitions??
 	}
+	arrived->classificationTime = (double)(clock() - cStart) / (double)CLOCKS_PER_SEC;
 
-	// 5. Evaluate the scan
-	EvaluateScan(*fileName, volcanoIndex); // TODO: Check for errors
+	if(loaded){
+		arrived->loadedSize = arrived->scan->GetLoadedSize();
+	}else{
+		arrived->scan.reset();
+	}
+
+	// 5. Check if the output directories needs to be updated
+	UpdateOutputDirectories();
+
+	// 6. Identify the spectrometer which generated the scan and hand 
+	//		the scan over to the evaluation. Scans which cannot be evaluated
+	//		are archived directly.
+	if(SUCCESS == IdentifyScan(*arrived)){
+		QueueForEvaluation(std::move(arrived));
+	}else{
+		QueueForArchiving(std::move(arrived));
+	}
+}
 
-	// 6. Move the file to the archive
-	GetArchivingfileName(storeFileName_pak, storeFileName_txt, *fileName); 
-	if(0 == MoveFileEx(*fileName, storeFileName_pak, MOVEFILE_REPLACE_EXISTING)){// after evaluation, move the file to the archive
+/** Moves the evaluated scan to the archive, uploads it to the data-server
+		and tells the rest of the program about it */
+void CEvaluationController::ArchiveScan(ArrivedScan &arrived){
+	CString message, str;
+	CString storeFileName_pak, storeFileName_txt;
+	const CString &serialNumber				= arrived.serialNumber;
+	const MEASUREMENT_MODE measurementMode	= arrived.measurementMode;
+	const int volcanoIndex					= arrived.volcanoIndex;
+	clock_t cStart = clock();
+
+	// 1. Move the file to the archive
+	storeFileName_pak = arrived.archivePakFile;
+	storeFileName_txt = arrived.archiveTxtFile;
+	if(0 == MoveFileEx(arrived.fileName, storeFileName_pak, MOVEFILE_REPLACE_EXISTING)){// after evaluation, move the file to the archive
 		DWORD errorCode = GetLastError();
 		message.Format("Could not move file");
 		if(Common::FormatErrorCode(errorCode, str))
@@ -155,14 +211,14 @@ void CEvaluationController::OnArrivedSpectra(WPARAM wp, LPARAM lp){
 			message.AppendFormat("Reason - unknown");
 		ShowMessage(message);
 		// Try to copy the file instead...
-		CopyFile(*fileName, storeFileName_pak, TRUE);
+		CopyFile(arrived.fileName, storeFileName_pak, TRUE);
 	}
 
-	// 7. Upload the file(s) to the data-server
+	// 2. Upload the file(s) to the data-server
 	UploadToNOVACServer(storeFileName_pak, volcanoIndex);
 	UploadToNOVACServer(storeFileName_txt, volcanoIndex);
 
-	// 8. If this is a wind-speed measurement, tell the wind-evaluation thread about it
+	// 3. If this is a wind-speed measurement, tell the wind-evaluation thread about it
 	if(measurementMode == MODE_WINDSPEED){
 		MakeWindMeasurement(storeFileName_txt, volcanoIndex);
 	}else if(measurementMode == MODE_STRATOSPHERE){
@@ -177,7 +233,7 @@ void CEvaluationController::OnArrivedSpectra(WPARAM wp, LPARAM lp){
 		MakeGeometryCalculations(storeFileName_txt, volcanoIndex);
 	}
 
-	// 9. Tell the user...
+	// 4. Tell the user...
 	if(MODE_WINDSPEED == measurementMode){
 		message.Format("Recieved wind measurement from %s. Scan evaluated and stored as %s.", serialNumber, storeFileName_pak);
 	}else if(MODE_STRATOSPHERE == measurementMode){
@@ -189,7 +245,7 @@ void CEvaluationController::OnArrivedSpectra(WPARAM wp, LPARAM lp){
 	}else if(MODE_COMPOSITION == measurementMode){
 		message.Format("Recieved composition measurement from %s. Scan evaluated and stored as %s.", serialNumber, storeFileName_pak);
 	}else{
-		if(isFullScan){
+		if(arrived.isFullScan){
 			message.Format("Recieved full scan from %s. Scan evaluated and stored as %s.", serialNumber, storeFileName_pak);
 		}else{
 			message.Format("Recieved incomplete scan from %s. Scan evaluated and stored.", serialNumber);
@@ -197,13 +253,231 @@ void CEvaluationController::OnArrivedSpectra(WPARAM wp, LPARAM lp){
 	}
 	ShowMessage(message);
 
-	// 10. If the user wants to execute a script, do that!
+	// 5. If the user wants to execute a script, do that!
 	if(strlen(g_settings.externalSetting.fullScanScript) > 2)
 		ExecuteScript_FullScan(storeFileName_pak, storeFileName_txt);
 
-	// 11. Clean Up
-	DeleteFile(*fileName);   // If the file still exists, try to delete it.
-	delete fileName;   // signals that we are done with this file
+	// 6. Clean Up
+	DeleteFile(arrived.fileName);   // If the file still exists, try to delete it.
+	arrived.scan.reset();
+
+	// 7. Tell the user how long time the different parts took
+	Output_TimingOfArrivedScan(arrived, (double)(clock() - cStart) / (double)CLOCKS_PER_SEC);
+}
+
+/** Starts the worker threads of the evaluation pipeline */
+void CEvaluationController::StartPipeline(){
+	std::lock_guard<std::mutex> lock{ m_pipelineMutex };
+
+	if(m_archivingWorker.joinable())
+		return; // already started
+
+	m_stopPipeline = false;
+
+	// one evaluation thread for every processor, no more than there are spectrometers
+	long workerNum = (long)std::thread::hardware_concurrency();
+	workerNum = min(workerNum, (long)m_spectrometer.GetSize());
+	workerNum = max(workerNum, 1);
+
+	for(long k = 0; k < workerNum; ++k){
+		m_evaluationWorkers.push_back(std::thread(&CEvaluationController::RunEvaluationWorker, this));
+	}
+	m_archivingWorker = std::thread(&CEvaluationController::RunArchivingWorker, this);
+}
+
+/** Stops the worker threads of the evaluation pipeline */
+void CEvaluationController::StopPipeline(){
+	{
+		std::lock_guard<std::mutex> lock{ m_pipelineMutex };
+		m_stopPipeline = true;
+	}
+	m_scanQueued.notify_all();
+	m_archivingQueued.notify_all();
+	m_pipelineProgress.notify_all();
+
+	for(std::thread &worker : m_evaluationWorkers){
+		if(worker.joinable())
+			worker.join();
+	}
+	m_evaluationWorkers.clear();
+
+	if(m_archivingWorker.joinable())
+		m_archivingWorker.join();
+
+	// the scans which were never evaluated stay in the temporary directory,
+	//	log their names so that they can be evaluated later
+	std::lock_guard<std::mutex> lock{ m_pipelineMutex };
+	if(m_queuedScanNum > 0){
+		for(auto &entry : m_evaluationQueue){
+			for(const std::unique_ptr<ArrivedScan> &arrived : entry.second)
+				LogDroppedScan(*arrived);
+		}
+		CString message;
+		message.Format("Evaluation stopped, %d queued scans were not evaluated. See the error logs for their file names", (int)m_queuedScanNum);
+		ShowMessage(message);
+	}
+	m_evaluationQueue.clear();
+	m_queuedScanNum = 0;
+	m_queuedScanBytes = 0;
+}
+
+/** Writes the name of a scan which will not be evaluated to the error log of its spectrometer */
+void CEvaluationController::LogDroppedScan(const ArrivedScan &arrived){
+	CString message;
+	message.Format("Evaluation stopped, scan not evaluated: %s", (LPCTSTR)arrived.fileName);
+	arrived.spectrometer->m_logFileHandler.WriteErrorMessage(message);
+}
+
+/** Adds the given scan to the evaluation queue of its spectrometer */
+void CEvaluationController::QueueForEvaluation(std::unique_ptr<ArrivedScan> arrived){
+	CString serial = arrived->spectrometer->SerialNumber();
+
+	std::unique_lock<std::mutex> lock{ m_pipelineMutex };
+	if(m_evaluationWorkers.empty()){
+		// the pipeline is not running, evaluate the scan in this thread instead
+		lock.unlock();
+		EvaluateArrivedScan(*arrived);
+		QueueForArchiving(std::move(arrived));
+		return;
+	}
+
+	// the spectra of the queued scans are held in memory, so the queue is limited by both the 
+	//	number of scans and their size. A scan is always accepted by an empty queue.
+	const size_t scanBytes = arrived->loadedSize;
+	m_pipelineProgress.wait(lock, [&]{ 
+		return m_stopPipeline || (m_queuedScanNum < MAX_QUEUED_SCANS && (m_queuedScanNum == 0 || m_queuedScanBytes + scanBytes <= MAX_QUEUED_BYTES));
+	});
+	if(m_stopPipeline){
+		LogDroppedScan(*arrived);
+		return;
+	}
+
+	m_evaluationQueue[serial].push_back(std::move(arrived));
+	++m_queuedScanNum;
+	m_queuedScanBytes += scanBytes;
+	lock.unlock();
+
+	m_scanQueued.notify_one();
+}
+
+/** Adds the given scan to the archiving queue */
+void CEvaluationController::QueueForArchiving(std::unique_ptr<ArrivedScan> arrived){
+	// Find the names in the archive while the spectra are still in memory,
+	//	they may be taken from any spectrum in the scan. Then free the spectra.
+	if(arrived->scan != nullptr){
+		GetArchivingfileName(arrived->archivePakFile, arrived->archiveTxtFile, *arrived->scan);
+		arrived->scan->ReleaseSpectra();
+	}else{
+		GetArchivingfileName(arrived->archivePakFile, arrived->archiveTxtFile, arrived->fileName);
+	}
+
+	std::unique_lock<std::mutex> lock{ m_pipelineMutex };
+	if(!m_archivingWorker.joinable()){
+		// the pipeline is not running, archive the scan in this thread instead
+		lock.unlock();
+		ArchiveScan(*arrived);
+		return;
+	}
+
+	// the archiving thread empties its queue also when the pipeline is stopped
+	m_pipelineProgress.wait(lock, [&]{ return m_stopPipeline || m_archivingQueue.size() < MAX_QUEUED_ARCHIVING; });
+
+	m_archivingQueue.push_back(std::move(arrived));
+	lock.unlock();
+
+	m_archivingQueued.notify_one();
+}
+
+/** Waits until all queued scans have been evaluated */
+void CEvaluationController::WaitUntilEvaluationIsIdle(){
+	std::unique_lock<std::mutex> lock{ m_pipelineMutex };
+	m_pipelineProgress.wait(lock, [&]{ return m_stopPipeline || (m_queuedScanNum == 0 && m_busySpectrometers.empty()); });
+}
+
+/** The main loop of one evaluation worker thread */
+void CEvaluationController::RunEvaluationWorker(){
+	::SetThreadLocale(MAKELCID(MAKELANGID(primaryLanguage, subLanguage),SORT_DEFAULT));
+
+	while(1){
+		std::unique_ptr<ArrivedScan> arrived;
+		CString serial;
+
+		// 1. Wait for a scan from a spectrometer which is not already being evaluated.
+		//		The spectrometers are served in turn, starting after the one served last.
+		{
+			std::unique_lock<std::mutex> lock{ m_pipelineMutex };
+			auto IsAvailable = [&](const std::pair<const CString, std::deque<std::unique_ptr<ArrivedScan>>> &entry) -> bool{
+				return !entry.second.empty() && m_busySpectrometers.end() == std::find(m_busySpectrometers.begin(), m_busySpectrometers.end(), entry.first);
+			};
+			auto FindNextScan = [&]() -> bool{
+				auto start = m_evaluationQueue.upper_bound(m_lastServedSpectrometer);
+				for(auto it = start; it != m_evaluationQueue.end(); ++it){
+					if(IsAvailable(*it)){
+						serial = it->first;
+						return true;
+					}
+				}
+				for(auto it = m_evaluationQueue.begin(); it != start; ++it){
+					if(IsAvailable(*it)){
+						serial = it->first;
+						return true;
+					}
+				}
+				return false;
+			};
+			m_scanQueued.wait(lock, [&]{ return m_stopPipeline || FindNextScan(); });
+			if(m_stopPipeline)
+				return;
+
+			std::deque<std::unique_ptr<ArrivedScan>> &queue = m_evaluationQueue[serial];
+			arrived = std::move(queue.front());
+			queue.pop_front();
+			--m_queuedScanNum;
+			m_queuedScanBytes -= arrived->loadedSize;
+			m_busySpectrometers.push_back(serial);
+			m_lastServedSpectrometer = serial;
+		}
+		m_pipelineProgress.notify_all(); // there's room for one more scan in the queue
+
+		// 2. Evaluate the scan
+		EvaluateArrivedScan(*arrived);
+
+		// 3. Hand the scan over to the archiving. This is done before the spectrometer is 
+		//		released so that the scans from one spectrometer are archived in order.
+		QueueForArchiving(std::move(arrived));
+
+		// 4. Let the next scan from this spectrometer be evaluated
+		{
+			std::lock_guard<std::mutex> lock{ m_pipelineMutex };
+			m_busySpectrometers.erase(std::find(m_busySpectrometers.begin(), m_busySpectrometers.end(), serial));
+		}
+		m_scanQueued.notify_all();
+		m_pipelineProgress.notify_all();
+		m_archivingQueued.notify_all();
+	}
+}
+
+/** The main loop of the archiving thread */
+void CEvaluationController::RunArchivingWorker(){
+	::SetThreadLocale(MAKELCID(MAKELANGID(primaryLanguage, subLanguage),SORT_DEFAULT));
+
+	while(1){
+		std::unique_ptr<ArrivedScan> arrived;
+		{
+			std::unique_lock<std::mutex> lock{ m_pipelineMutex };
+			m_archivingQueued.wait(lock, [&]{ return (m_stopPipeline && m_busySpectrometers.empty()) || !m_archivingQueue.empty(); });
+
+			// all the evaluated scans are archived before quitting
+			if(m_archivingQueue.empty())
+				return;
+
+			arrived = std::move(m_archivingQueue.front());
+			m_archivingQueue.pop_front();
+		}
+		m_pipelineProgress.notify_all();
+
+		ArchiveScan(*arrived);
+	}
 }
 
 /** This function takes a scan-file and evaluates one of the spectra inside it */
@@ -214,94 +488,130 @@ RETURN_CODE CEvaluationController::EvaluateSpectrum(const CString &fileName, int
 
 /** This function takes care of the evaluation of one scan.	*/
 RETURN_CODE CEvaluationController::EvaluateScan(const CString &fileName, int volcanoIndex){
-	clock_t cStart, cFinish;
-	CString message;
-	CWindField windField;
-	CDateTime startTime;
-
-	// The CScanFileHandler is a structure for reading the 
-	//		spectral information from the scan-file
-	CScanFileHandler *scan = new CScanFileHandler();	//TODO: Check if failure
-
-	// sucess is true if the evaluation is sucessful
-	bool sucess = true;
+	ArrivedScan arrived;
+	arrived.fileName.Format("%s", fileName);
+	arrived.volcanoIndex		= volcanoIndex;
+	arrived.measurementMode		= MODE_FLUX;
+	arrived.isFullScan			= true;
+	arrived.spectrometer		= NULL;
+	arrived.readTime			= 0.0;
+	arrived.classificationTime	= 0.0;
+	arrived.evaluationTime		= 0.0;
+	arrived.loadedSize			= 0;
+
+	// The evaluators of the spectrometers are shared with the worker threads, 
+	//	wait until these are done
+	WaitUntilEvaluationIsIdle();
 
 	// Check if the output directories needs to be updated
 	UpdateOutputDirectories();
 
-	// clock the time it takes to treat one scan
-	cStart = clock();
+	if(SUCCESS != IdentifyScan(arrived))
+		return FAIL;
 
-	/** ------------- The process to evaluate a scan --------------- */
+	return EvaluateArrivedScan(arrived);
+}
+
+/** Reads the scan-file of the arrived scan, unless this has already been done, 
+		and identifies the spectrometer which generated it. */
+RETURN_CODE CEvaluationController::IdentifyScan(ArrivedScan &arrived){
 
 	// 1. Assert that the scan-file exists
-	if(!IsExistingFile(fileName)){
+	if(!IsExistingFile(arrived.fileName)){
 		m_logFileWriter.WriteErrorMessage(TEXT("Recieved scan with illegal path. Could not evaluate."));
-		delete scan;
 		return FAIL;
 	}
 
-	// 2. Read the scan file
-	if(SUCCESS != scan->CheckScanFile(&fileName)){
+	// 2. Read the scan file, if it was not read on arrival
+	if(arrived.scan == nullptr){
+		clock_t cStart = clock();
+		arrived.scan.reset(new CScanFileHandler());
+		if(SUCCESS != arrived.scan->CheckScanFile(&arrived.fileName)){
+			arrived.scan.reset();
+		}
+		arrived.readTime += (double)(clock() - cStart) / (double)CLOCKS_PER_SEC;
+	}
+	if(arrived.scan == nullptr){
 		m_logFileWriter.WriteErrorMessage(TEXT("Could not read recieved scan"));
-		delete scan;
 		return FAIL;
 	}
 
 	// 3. Identify which spectrometer has generated this scan
-	CSpectrometer *spectrometer = IdentifySpectrometer(scan);
-	if(NULL == spectrometer){
+	arrived.spectrometer = IdentifySpectrometer(arrived.scan.get());
+	if(NULL == arrived.spectrometer){
 		Output_SpectrometerNotIdentified();
-		delete scan;
 		return FAIL;
 	}
-	Output_ArrivedScan(spectrometer); // output
+	Output_ArrivedScan(arrived.spectrometer); // output
+
+	return SUCCESS;
+}
+
+/** Evaluates the identified scan, calculates the flux and writes the results */
+RETURN_CODE CEvaluationController::EvaluateArrivedScan(ArrivedScan &arrived){
+	clock_t cStart, cFinish;
+	CWindField windField;
+	CDateTime startTime;
+	CSpectrometer *spectrometer = arrived.spectrometer;
+	std::unique_ptr<CScanResult> result;
+
+	// sucess is true if the evaluation is sucessful
+	bool sucess = true;
 
-	// 4. Get information about the spectra, like compass direction, gps, etc...
-	GetSpectrumInformation(spectrometer, fileName);
+	// clock the time it takes to treat one scan
+	cStart = clock();
 
-	// 5. Evaluate the scan
-	CScanEvaluation *ev = new CScanEvaluation(); // TODO: Check for errors
-	ev->m_pause = NULL;
+	/** ------------- The process to evaluate a scan --------------- */
+
+	// 1. Evaluate the scan. This is the time-consuming part and is done 
+	//		in parallel for scans from different spectrometers.
+	CScanEvaluation ev;
+	ev.m_pause = NULL;
+	ev.SetOption_WarmStart(g_settings.evaluationSettings.warmStart != 0);
 	CConfigurationSetting::DarkSettings *darkSettings = &spectrometer->m_settings.channel[0].m_darkSettings;
-	long spectrumNum = ev->EvaluateScan(fileName, spectrometer->m_evaluator[0], NULL, darkSettings);
+	long spectrumNum = ev.EvaluateScan(*arrived.scan, spectrometer->m_evaluator[0], NULL, darkSettings);
 
-	// 6. Get the result from the evaluation
-	if(ev != nullptr && ev->HasResult()){
-		m_lastResult = ev->GetResult();
-		m_lastResult->SetInstrumentType(spectrometer->m_scanner.instrumentType);
+	// 2. Get the result from the evaluation
+	if(ev.HasResult()){
+		result = ev.GetResult();
+		result->SetInstrumentType(spectrometer->m_scanner.instrumentType);
 	}
 
-	// 7. Get the mode of the evaluation
-	m_lastResult->CheckMeasurementMode();
+	// The rest uses the wind field and the common log-files, 
+	//	treat the results from one scan at a time.
+	std::lock_guard<std::mutex> lock{ m_resultMutex };
+
+	// 3. Get information about the spectra, like compass direction, gps, etc...
+	GetSpectrumInformation(spectrometer, *arrived.scan);
 
-	// 8. Check the reasonability of the evaluation
-	if(spectrumNum == 0){
+	// 4. Check the reasonability of the evaluation
+	if(spectrumNum == 0 || result == nullptr){
 		Output_EmptyScan(spectrometer);
-		sucess = false;
-		delete scan;
-		delete ev;
+		arrived.evaluationTime = (double)(clock() - cStart) / (double)CLOCKS_PER_SEC;
 		return SUCCESS;
 	}
 
-	m_lastResult->GetStartTime(0, startTime);
+	// 5. Get the mode of the evaluation
+	result->CheckMeasurementMode();
 
-	// 9. Get the local wind field when the scan was taken
+	result->GetStartTime(0, startTime);
+
+	// 6. Get the local wind field when the scan was taken
 	if(SUCCESS != GetWind(windField, *spectrometer, startTime)){
 		spectrometer->m_logFileHandler.WriteErrorMessage(m_common.GetString(ERROR_WIND_NOT_FOUND));
 	}
-	// 10. Calculate the flux. The spectrometer is needed to identify the geometry.
-	if(!m_lastResult->IsWindMeasurement() && !m_lastResult->IsStratosphereMeasurement() && !m_lastResult->IsDirectSunMeasurement() && !m_lastResult->IsLunarMeasurement() && !m_lastResult->IsCompositionMeasurement()){
+	// 7. Calculate the flux. The spectrometer is needed to identify the geometry.
+	if(!result->IsWindMeasurement() && !result->IsStratosphereMeasurement() && !result->IsDirectSunMeasurement() && !result->IsLunarMeasurement() && !result->IsCompositionMeasurement()){
 
-		// 10a. Calculate the centre of the plume
-		bool inplume = m_lastResult->CalculatePlumeCentre("SO2");
+		// 7a. Calculate the centre of the plume
+		bool inplume = result->CalculatePlumeCentre("SO2");
 
-		// 10b. If this is a Heidelberg-instrument then we can use it
+		// 7b. If this is a Heidelberg-instrument then we can use it
 		//	alone to calculate the wind-direction/plume height 
 		//	this value can then also be used in the flux-calculation later...
 		if(spectrometer->m_scanner.instrumentType == INSTR_HEIDELBERG){
 			// Use this measurement to calculate the wind-direction or plume height?
-			MakeGeometryCalculations_Heidelberg(spectrometer);
+			MakeGeometryCalculations_Heidelberg(spectrometer, result.get());
 			
 			// Retrieve the new wind-field...
 			if(SUCCESS != GetWind(windField, *spectrometer, startTime)){
@@ -309,25 +619,25 @@ RETURN_CODE CEvaluationController::EvaluateScan(const CString &fileName, int vol
 			}
 		}
 
-		// 10c. Calculate the flux...
-		if(SUCCESS != CalculateFlux(m_lastResult.get(), spectrometer, volcanoIndex, windField)){
-			Output_FluxFailure(m_lastResult.get(), spectrometer);
+		// 7c. Calculate the flux...
+		if(SUCCESS != CalculateFlux(result.get(), spectrometer, arrived.volcanoIndex, windField)){
+			Output_FluxFailure(result.get(), spectrometer);
 			sucess = false;
 		}
 	}
 
-	// 11. Append the result to the log file of the corresponding scanningInstrument
-	if(SUCCESS != WriteEvaluationResult(m_lastResult.get(), scan, *spectrometer, windField)){
+	// 8. Append the result to the log file of the corresponding scanningInstrument
+	if(SUCCESS != WriteEvaluationResult(result.get(), arrived.scan.get(), *spectrometer, windField)){
 		spectrometer->m_logFileHandler.WriteErrorMessage(TEXT("Could not write result to file"));
 	}
 
-	// 12. Remember the result from the last scan
-	spectrometer->RememberResult(*m_lastResult);
+	// 9. Remember the result from the last scan
+	spectrometer->RememberResult(*result);
 
-	// 13. Check if we should do a wind-measurement or a composition mode measurement now
+	// 10. Check if we should do a wind-measurement or a composition mode measurement now
 	InitiateSpecialModeMeasurement(spectrometer, windField);
 
-	// 14. Check if we should change the cfg.txt file inside the instrument
+	// 11. Check if we should change the cfg.txt file inside the instrument
 	if(spectrometer->m_scanner.instrumentType == INSTR_HEIDELBERG){
 		double alpha_min, alpha_max, phi_source, beta;
 		bool flat;
@@ -338,19 +648,17 @@ RETURN_CODE CEvaluationController::EvaluateScan(const CString &fileName, int vol
 		}
 	}
 
-	// 15. Calculate the time spent in this function
+	// 12. Calculate the time spent in this function
 	cFinish = clock();
-	Output_TimingOfScanEvaluation(spectrumNum, spectrometer->SerialNumber(), ((double)(cFinish - cStart) / (double)CLOCKS_PER_SEC));
+	arrived.evaluationTime = (double)(cFinish - cStart) / (double)CLOCKS_PER_SEC;
+	Output_TimingOfScanEvaluation(spectrumNum, spectrometer->SerialNumber(), arrived.evaluationTime);
 
-	// 16. Share the results with the rest of the program
+	// 13. Share the results with the rest of the program
 	if(sucess){
-		CScanResult *newResult = new CScanResult(*m_lastResult);
+		CScanResult *newResult = new CScanResult(*result);
 		pView->PostMessage(WM_EVAL_SUCCESS, (WPARAM)&(spectrometer->SerialNumber()), (LPARAM)newResult);
 	}
-
-	// 17. Clean up
-	delete scan;
-	delete ev;
+	m_lastResult = std::move(result);
 
 	return SUCCESS;
 }
@@ -563,7 +871,7 @@ RETURN_CODE CEvaluationController::WriteEvaluationResult(const CScanResult *resu
 	CString pakFile, txtFile, specModel, evalLogFile;
 	CString wsSrc, wdSrc, phSrc;
 	CDateTime dateTime;
-	GetArchivingfileName(pakFile, txtFile, scan->GetFileName());
+	GetArchivingfileName(pakFile, txtFile, *scan);
 	CSpectrometerModel::ToString(spectrometer.m_settings.model, specModel);
 
 	// 1. Get the name of the evaluation-log file to write to...
@@ -791,7 +1099,24 @@ RETURN_CODE CEvaluationController::WriteEvaluationResult(const CScanResult *resu
 		fclose(eF);
 	}
 
-	// 3c. Write it all to the additional evaluation log file
+	// 3c. Write the scan to the binary evaluation log as well
+	if(CBinaryEvaluationLog::s_writeBinaryLogs){
+		CSpectrumInfo scanInfo;
+		scanInfo.m_date[0]   = scan->m_date[0];
+		scanInfo.m_date[1]   = scan->m_date[1];
+		scanInfo.m_date[2]   = scan->m_date[2];
+		scanInfo.m_startTime = scan->m_startTime;
+		scanInfo.m_gps       = spectrometer.m_scanner.gps;
+		scanInfo.m_compass   = (float)spectrometer.m_scanner.compass;
+		scanInfo.m_coneAngle = (float)spectrometer.m_scanner.coneAngle;
+		scanInfo.m_pitch     = (float)spectrometer.m_scanner.tilt;
+		scanInfo.m_device    = settings.serialNumber;
+		scanInfo.m_specModel = spectrometer.m_settings.model;
+		scanInfo.m_channel   = spectrometer.m_channel;
+		CBinaryEvaluationLog::AppendScan(evalLogFile, scanInfo, *result, spectrometer.m_scanner.instrumentType, maxIntensity);
+	}
+
+	// 3d. Write it all to the additional evaluation log file
 	FILE *f = fopen(txtFile, "w");
 	if(f != NULL){
 		fprintf(f, string);
@@ -826,7 +1151,11 @@ CSpectrometer *CEvaluationController::HandleUnIdentifiedSpectrometer(const CStri
 
 	spec->m_logFileHandler.SetErrorLogFile(filePath, "ErrorLog.txt");
 
-	// 4. Configure the evaluation (here we don't know anything, just guess what could be an ok evaluator)
+	// 4. Configure the evaluation (here we don't know anything, just guess what could be an ok evaluator).
+	//		The evaluators of the first spectrometer may be in use by the worker threads, and the
+	//		list of spectrometers is changed below, so wait until the workers are done.
+	//		No new scans are queued while this thread is waiting.
+	WaitUntilEvaluationIsIdle();
 	CSpectrometer *spec0 = m_spectrometer[0];
 	for(int i = 0; i < spec0->m_fitWindowNum; ++i){
 		*spec->m_evaluator[i] = *spec0->m_evaluator[i];
@@ -864,6 +1193,9 @@ BOOL Evaluation::CEvaluationController::InitInstance()
 	// 3. Initialize the output files
 	InitializeOutput();
 
+	// 4. Start the threads which evaluates and archives the arriving scans
+	StartPipeline();
+
 	return 1;
 }
 
@@ -1013,10 +1345,6 @@ void CEvaluationController::Output_FitFailure(const CSpectrum &spec){
 void CEvaluationController::Output_FluxFailure(const CScanResult *result, const CSpectrometer *spec){
 	spec->m_logFileHandler.WriteErrorMessage(TEXT("Could not calculate the flux"));
 
-	if(result != m_lastResult.get()) {
-		*m_lastResult = *result;
-	}
-
 	CScanResult* copiedResult = (nullptr != result) ? new CScanResult(*result) : nullptr;
 
 	pView->PostMessage(WM_EVAL_FAILURE, (WPARAM)&(spec->m_settings.serialNumber), (LPARAM)copiedResult);
@@ -1029,6 +1357,14 @@ void CEvaluationController::Output_TimingOfScanEvaluation(int spectrumNum, const
 	ShowMessage(timingMessage);
 }
 
+void CEvaluationController::Output_TimingOfArrivedScan(const ArrivedScan &arrived, double archivingTime){
+	CString timingMessage;
+	timingMessage.Format("Treated scan from %s in %lf seconds (reading %lf, classification %lf, evaluation %lf, archiving %lf seconds)", 
+		arrived.serialNumber, arrived.readTime + arrived.classificationTime + arrived.evaluationTime + archivingTime,
+		arrived.readTime, arrived.classificationTime, arrived.evaluationTime, archivingTime);
+	ShowMessage(timingMessage);
+}
+
 void CEvaluationController::Output_EmptyScan(const CSpectrometer *spectrometer){
 	CString message;
 	message.Format("Recieved empty scan from %s", spectrometer->m_settings.serialNumber);
@@ -1041,7 +1377,6 @@ RETURN_CODE CEvaluationController::GetArchivingfileName(CString &pakFile, CStrin
 	reader.m_logFileWriter = NULL;	// nowhere to output the error messages
 
 	CSpectrum tmpSpec;
-	CString serialNumber, dateStr, timeStr, dateStr2;
 
 	// 0. Make an initial assumption of the file-names
 	int i = 0;
@@ -1055,8 +1390,8 @@ RETURN_CODE CEvaluationController::GetArchivingfileName(CString &pakFile, CStrin
 	// 1. Read the first spectrum in the scan
 	if(SUCCESS != reader.ReadSpectrum(temporaryScanFile, 0, tmpSpec))
 		return FAIL;
-	CSpectrumInfo &info	= tmpSpec.m_info;
-	int channel = info.m_channel;
+	CSpectrumInfo info	= tmpSpec.m_info;
+	unsigned char channel = info.m_channel;
 
 	// 1a. If the GPS had no connection with the satelites when collecting the sky-spectrum,
 	//			then try to find a spectrum in the file for which it had connection...
@@ -1066,6 +1401,37 @@ RETURN_CODE CEvaluationController::GetArchivingfileName(CString &pakFile, CStrin
 			break;
 		info	= tmpSpec.m_info;
 	}
+	info.m_channel = channel; // the channel is always taken from the first spectrum
+
+	return GetArchivingfileName(pakFile, txtFile, info);
+}
+
+RETURN_CODE CEvaluationController::GetArchivingfileName(CString &pakFile, CString &txtFile, const FileHandler::CScanFileHandler &scan){
+	const CSpectrum *spec = scan.GetLoadedSpectrum(0);
+
+	// If the spectra are not in memory then read them from the file
+	if(spec == NULL)
+		return GetArchivingfileName(pakFile, txtFile, scan.GetFileName());
+
+	CSpectrumInfo info = spec->m_info;
+	unsigned char channel = info.m_channel;
+
+	// If the GPS had no connection with the satelites when collecting the sky-spectrum,
+	//	then try to find a spectrum in the scan for which it had connection...
+	int i = 1;
+	while(info.m_date[0] == 2004 && info.m_date[1] == 3 && info.m_date[2] == 22){
+		if(NULL == (spec = scan.GetLoadedSpectrum(i++)))
+			break;
+		info	= spec->m_info;
+	}
+	info.m_channel = channel; // the channel is always taken from the first spectrum
+
+	return GetArchivingfileName(pakFile, txtFile, info);
+}
+
+RETURN_CODE CEvaluationController::GetArchivingfileName(CString &pakFile, CString &txtFile, const CSpectrumInfo &info){
+	CString serialNumber, dateStr, timeStr, dateStr2;
+	int channel = info.m_channel;
 
 	// 2. Get the serialNumber of the spectrometer
 	serialNumber.Format("%s", info.m_device);
@@ -1102,22 +1468,20 @@ void CEvaluationController::UpdateOutputDirectories(){
 	//	date when the output directories were last initialized, then
 	//	initialize them again.
 	if((m_date[0] != m_common.GetYear()) || (m_date[1] != m_common.GetMonth()) || (m_date[2] != m_common.GetDay())){
+		// the log-files are changed, let the queued scans be written to the old ones first
+		WaitUntilEvaluationIsIdle();
 		InitializeOutput();
 	}
 }
 
 /** Collects some of the information that is saved in the */
-void CEvaluationController::GetSpectrumInformation(CSpectrometer *spectrometer, const CString &fileName){
+void CEvaluationController::GetSpectrumInformation(CSpectrometer *spectrometer, const FileHandler::CScanFileHandler &scan){
 	CSpectrum skySpec, darkSpec;
 	double lat, lon, alt;
 
-	// 1. Open the file for reading
-	CScanFileHandler *scan = new CScanFileHandler();
-	if(scan == NULL)
-		return;
-	scan->CheckScanFile(&fileName);
-	scan->GetDark(darkSpec);
-	scan->GetSky(skySpec);
+	// 1. Get the sky and dark spectra of the scan
+	scan.GetDark(darkSpec);
+	scan.GetSky(skySpec);
 
 	if(fabs(skySpec.Latitude()) > 0.01 && fabs(skySpec.Longitude()) > 0.01){
 		double	N = spectrometer->m_gpsReadingsNum;
@@ -1161,8 +1525,6 @@ void CEvaluationController::GetSpectrumInformation(CSpectrometer *spectrometer,
 	if(spectrometer->m_gpsReadingsNum > 0 && (fmod(spectrometer->m_gpsReadingsNum, 10.0) == 0)){
 		pView->PostMessage(WM_REWRITE_CONFIGURATION, NULL, NULL);
 	}
-
-	delete scan;
 }
 
 /** Sends a command to the windspeed thread to consider the given wind-speed measurement evaluation log */
@@ -1235,8 +1597,8 @@ void CEvaluationController::ExecuteScript_FullScan(const CString &param1, const
 }
 
 /** Makes calculations of the geometrical setup using the given
-		Heidelberg (V-II) instrument and the last evaluation result */
-RETURN_CODE CEvaluationController::MakeGeometryCalculations_Heidelberg(CSpectrometer *spectrometer){
+		Heidelberg (V-II) instrument and the given evaluation result */
+RETURN_CODE CEvaluationController::MakeGeometryCalculations_Heidelberg(CSpectrometer *spectrometer, const CScanResult *result){
 	CDateTime startTime;
 	CWindField wind;
 	double alpha_center_of_mass, phi_center_of_mass;
@@ -1248,14 +1610,14 @@ RETURN_CODE CEvaluationController::MakeGeometryCalculations_Heidelberg(CSpectrom
 
 	// if we don't see any plume at all in the last measurement, then there's no
 	//	point in trying to calculate anything
-	alpha_center_of_mass	= m_lastResult->GetCalculatedPlumeCentre(0);
-	phi_center_of_mass		= m_lastResult->GetCalculatedPlumeCentre(1);
+	alpha_center_of_mass	= result->GetCalculatedPlumeCentre(0);
+	phi_center_of_mass		= result->GetCalculatedPlumeCentre(1);
 	if(alpha_center_of_mass < -900){
 		return FAIL;
 	}
 
 	// Get the user supplied wind field at the time of the last measurement
-	m_lastResult->GetStartTime(0, startTime);
+	result->GetStartTime(0, startTime);
 	GetWind(wind, *spectrometer, startTime);
 
 	// Get the position of the scanner
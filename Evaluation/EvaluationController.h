@@ -2,6 +2,12 @@
 
 #include "../resource.h"
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <map>
+#include <vector>
 
 #include "Spectrometer.h"
 #include "ScanResult.h"
@@ -21,6 +27,10 @@ namespace Evaluation
 		of the spectra. The class is run as a separate thread and
 		recives messages on incoming spectra that should be evaluated
 		and dispatches the spectra to the correct evaluator. 
+		The arrived scans are treated in a pipeline of three stages: the scan-file
+		is read and the spectrometer identified in this thread, the scans are then
+		evaluated by a pool of worker threads, one scan per spectrometer at a time, 
+		and finally archived and uploaded by one archiving thread. 
 		*/
 
 	class CEvaluationController : CWinThread
@@ -49,9 +59,24 @@ namespace Evaluation
 		// ----------------------------------------------------------------------
 
 		/** A scan-result, for sharing evaluated data with the rest of the
-			program. This is updated after every evaluation of a full scan. */
+			program. This is updated after every evaluation of a full scan. 
+			Protected by 'm_resultMutex'. */
 		std::unique_ptr<CScanResult> m_lastResult;
 
+		/** The maximum number of scans which may wait for evaluation. When this 
+			many scans are queued then the reading of new scans waits until one
+			of the queued scans has been evaluated. */
+		static const size_t MAX_QUEUED_SCANS = 64;
+
+		/** The maximum memory which the spectra of the scans waiting for evaluation 
+			may use [bytes]. When this is reached then the reading of new scans waits,
+			but a single scan is always queued however large it is. */
+		static const size_t MAX_QUEUED_BYTES = 128 * 1024 * 1024;
+
+		/** The maximum number of evaluated scans which may wait for archiving.
+			The spectra of these are released after the evaluation. */
+		static const size_t MAX_QUEUED_ARCHIVING = 16;
+
 		// ----------------------------------------------------------------------
 		// --------------------- PUBLIC METHODS ---------------------------------
 		// ----------------------------------------------------------------------
@@ -134,10 +159,119 @@ namespace Evaluation
 			(m_date[0] is the year, m_date[1] is the month (1-12), and m_date[2] is the day (1-31) */
 		unsigned short m_date[3];
 
+		/** One arrived scan, on its way through the evaluation pipeline */
+		struct ArrivedScan{
+			CString fileName;								// the name of the (temporary) scan-file
+			CString serialNumber;							// the serial number of the spectrometer, as read from the file
+			int volcanoIndex;								// the volcano which the spectrometer monitors
+			MEASUREMENT_MODE measurementMode;				// the mode of the measurement
+			bool isFullScan;								// false if the file does not contain a full scan
+			CSpectrometer *spectrometer;					// the identified spectrometer, NULL if not identified
+			std::unique_ptr<FileHandler::CScanFileHandler> scan;	// the scan-file, read into memory once on arrival. NULL if it could not be read
+			size_t loadedSize;								// the memory used by the spectra of the scan when it was queued for evaluation [bytes]
+			CString archivePakFile;							// the name of the scan-file in the archive, set when the scan is queued for archiving
+			CString archiveTxtFile;							// the name of the evaluation log of the scan in the archive
+			double readTime;								// the time spent reading the scan-file [s]
+			double classificationTime;						// the time spent finding the measurement mode [s]
+			double evaluationTime;							// the time spent evaluating the scan and writing the results [s]
+		};
+
+		/** The scans waiting for evaluation, one queue for every spectrometer
+			(identified by its serial number). The scans from one spectrometer are 
+			evaluated one at a time and in the order they arrived, since the 
+			evaluation of a scan depends on the history of the spectrometer. */
+		std::map<CString, std::deque<std::unique_ptr<ArrivedScan>>> m_evaluationQueue;
+
+		/** The serial numbers of the spectrometers whose scan is currently being evaluated */
+		std::vector<CString> m_busySpectrometers;
+
+		/** The serial number of the spectrometer whose scan was last picked up by a
+			worker thread. Used to serve the spectrometers in turn. */
+		CString m_lastServedSpectrometer;
+
+		/** The total number of scans in 'm_evaluationQueue' */
+		size_t m_queuedScanNum;
+
+		/** The total memory used by the spectra of the scans in 'm_evaluationQueue' [bytes] */
+		size_t m_queuedScanBytes;
+
+		/** The evaluated scans waiting to be archived, in the order they were evaluated */
+		std::deque<std::unique_ptr<ArrivedScan>> m_archivingQueue;
+
+		/** True when the worker threads should quit */
+		bool m_stopPipeline;
+
+		/** Protects the queues above and 'm_stopPipeline' */
+		std::mutex m_pipelineMutex;
+
+		/** Signalled when a scan is added to 'm_evaluationQueue' or when 'm_stopPipeline' is set */
+		std::condition_variable m_scanQueued;
+
+		/** Signalled when a scan has been evaluated or archived */
+		std::condition_variable m_pipelineProgress;
+
+		/** Signalled when a scan is added to 'm_archivingQueue' or when 'm_stopPipeline' is set */
+		std::condition_variable m_archivingQueued;
+
+		/** The threads which evaluates the scans */
+		std::vector<std::thread> m_evaluationWorkers;
+
+		/** The thread which archives the evaluated scans */
+		std::thread m_archivingWorker;
+
+		/** Makes sure that the flux calculation and the writing of the results, which uses
+			the common log-files and the wind field, is done for one scan at a time.
+			This also protects 'm_lastResult'. */
+		std::mutex m_resultMutex;
+
 		// ----------------------------------------------------------------------
 		// --------------------- PRIVATE METHODS --------------------------------
 		// ----------------------------------------------------------------------
 
+		/** Starts the worker threads of the evaluation pipeline */
+		void StartPipeline();
+
+		/** Stops the worker threads of the evaluation pipeline. The scans which are
+			already evaluated are archived before the function returns, the scans
+			which are still waiting for evaluation are left in the temporary directory
+			and their names are written to the error logs. */
+		void StopPipeline();
+
+		/** Writes the name of a scan which will not be evaluated to the error log of its spectrometer */
+		void LogDroppedScan(const ArrivedScan &arrived);
+
+		/** The main loop of one evaluation worker thread */
+		void RunEvaluationWorker();
+
+		/** The main loop of the archiving thread */
+		void RunArchivingWorker();
+
+		/** Waits until all queued scans have been evaluated */
+		void WaitUntilEvaluationIsIdle();
+
+		/** Adds the given scan to the evaluation queue of its spectrometer,
+			waiting if there are already 'MAX_QUEUED_SCANS' scans, or 'MAX_QUEUED_BYTES'
+			of spectra, in the queue */
+		void QueueForEvaluation(std::unique_ptr<ArrivedScan> arrived);
+
+		/** Finds the names of the given scan in the archive, releases its spectra and
+			adds it to the archiving queue, waiting if there are already 
+			'MAX_QUEUED_ARCHIVING' scans in the queue */
+		void QueueForArchiving(std::unique_ptr<ArrivedScan> arrived);
+
+		/** Reads the scan-file of the arrived scan and identifies the spectrometer which generated it.
+			@return SUCCESS if the spectrometer could be identified */
+		RETURN_CODE IdentifyScan(ArrivedScan &arrived);
+
+		/** Evaluates the identified scan, calculates the flux and writes the results
+			to the log-files of the spectrometer. 
+			@return SUCCESS if the evaluation is sucessful */
+		RETURN_CODE EvaluateArrivedScan(ArrivedScan &arrived);
+
+		/** Moves the evaluated scan to the archive, uploads it to the data-server
+			and tells the rest of the program about it */
+		void ArchiveScan(ArrivedScan &arrived);
+
 		/** Indentifies the scanning instrument from which this scan was generated. 
 			@param scan a reference to a scan that should be identified. 
 			@return a pointer to the spectrometer. @return NULL if no spectrometer found */
@@ -193,6 +327,16 @@ namespace Evaluation
 			@return SUCCESS if a filename is found. */
 		RETURN_CODE GetArchivingfileName(CString &pakFile, CString &txtFile, const CString &temporaryScanFile);
 
+		/** Gets the filename under which the scan-file should be stored, using the 
+			spectra of the scan which are already in memory if possible.
+			@return SUCCESS if a filename is found. */
+		RETURN_CODE GetArchivingfileName(CString &pakFile, CString &txtFile, const FileHandler::CScanFileHandler &scan);
+
+		/** Writes the filename under which a scan-file should be stored, 
+			from the information in the first spectrum of the scan.
+			@return SUCCESS if a filename is found. */
+		RETURN_CODE GetArchivingfileName(CString &pakFile, CString &txtFile, const CSpectrumInfo &info);
+
 		/** Sends a command to the WindEvaluator thread to use the supplied
 			evaluation-log file for correlation. */
 		RETURN_CODE MakeWindMeasurement(const CString &fileName, int volcanoIndex);
@@ -202,11 +346,11 @@ namespace Evaluation
 		RETURN_CODE MakeGeometryCalculations(const CString &fileName, int volcanoIndex);
 
 		/** Makes calculations of the geometrical setup using the given
-			Heidelberg (V-II) instrument and the last evaluation result */
-		RETURN_CODE MakeGeometryCalculations_Heidelberg(CSpectrometer *spectrometer);
+			Heidelberg (V-II) instrument and the given evaluation result */
+		RETURN_CODE MakeGeometryCalculations_Heidelberg(CSpectrometer *spectrometer, const CScanResult *result);
 
 		/** Retrieves information from the spectrum-file and saves it */
-		void GetSpectrumInformation(CSpectrometer *spectrometer, const CString &fileName);
+		void GetSpectrumInformation(CSpectrometer *spectrometer, const FileHandler::CScanFileHandler &scan);
 
 		/** Executes a shell-command with the defined parameters */
 		void ExecuteScript_FullScan(const CString &param1, const CString &param2);
@@ -229,6 +373,9 @@ namespace Evaluation
 		/** Shows the timing information from evaluating a scan */
 		void Output_TimingOfScanEvaluation(int spectrumNum, const CString &serial, double timeElapsed);
 
+		/** Shows the time spent in each stage of the treatment of an arrived scan */
+		void Output_TimingOfArrivedScan(const ArrivedScan &arrived, double archivingTime);
+
 		/** Shows information about an arrival of a scan without any spectra in it */
 		void Output_EmptyScan(const CSpectrometer *spectrometer); 
 };
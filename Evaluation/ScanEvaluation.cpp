@@ -3,8 +3,7 @@
 
 #include "../Common/Spectra/Spectrum.h"
 #include "../Common/Spectra/SpectrumIO.h"
-#include "../Common/SpectrumFormat/STDFile.h"
-#include "../Common/SpectrumFormat/TXTFile.h"
+#include "../Common/Spectra/SpectrumCache.h"
 
 using namespace Evaluation;
 
@@ -16,6 +15,7 @@ CScanEvaluation::CScanEvaluation(void)
 	m_skyIndex  = 0;
 	m_pause     = NULL;
 	m_sleeping  = NULL;
+	m_maxViewUpdatesPerSecond = 25;
 
 	// In real-time, nothing should be ignored
 	m_ignore_Lower.m_type = IGNORE_NOTHING;
@@ -23,6 +23,9 @@ CScanEvaluation::CScanEvaluation(void)
 
 	// default is that the spectra are summed, not averaged
 	m_averagedSpectra = false;
+
+	// default is that every fit starts from the default shift and squeeze
+	m_warmStart = false;
 }
 
 CScanEvaluation::~CScanEvaluation(void)
@@ -66,6 +69,27 @@ bool CScanEvaluation::HasResult()
 
 /** Called to evaluate one scan */
 long CScanEvaluation::EvaluateScan(const CString &scanfile, CEvaluation *eval, bool *fRun, const CConfigurationSetting::DarkSettings *darkSettings){
+
+	// Check so that the file exists
+	if(!IsExistingFile(scanfile)) {
+		return 0;
+	}
+
+	// The CScanFileHandler is a structure for reading the spectral information 
+	//  from the scan-file
+	FileHandler::CScanFileHandler scan;  
+
+	// Check the scan file, make sure it's correct and that the file
+	//	actually contains spectra
+	if(SUCCESS != scan.CheckScanFile(&scanfile)) {
+		return 0;
+	}
+
+	return EvaluateScan(scan, eval, fRun, darkSettings);
+}
+
+/** Called to evaluate one scan which has already been read in */
+long CScanEvaluation::EvaluateScan(FileHandler::CScanFileHandler &scan, CEvaluation *eval, bool *fRun, const CConfigurationSetting::DarkSettings *darkSettings){
 	
 #ifdef _DEBUG
 	// this is for searching for memory leaks
@@ -78,6 +102,9 @@ long CScanEvaluation::EvaluateScan(const CString &scanfile, CEvaluation *eval, b
 	double highestColumn = 0.0;	// the highest column-value in the evaluation
 	bool success = true;
 
+	// the first spectrum is always fitted from the default values
+	eval->ColdStart();
+
 	// variables for storing the sky, dark and the measured spectra
 	CSpectrum sky, dark, current;
 
@@ -85,21 +112,6 @@ long CScanEvaluation::EvaluateScan(const CString &scanfile, CEvaluation *eval, b
 	m_fitLow  = eval->m_window.fitLow;
 	m_fitHigh = eval->m_window.fitHigh;
 
-	// Check so that the file exists
-	if(!IsExistingFile(scanfile)) {
-		return 0;
-	}
-
-	// The CScanFileHandler is a structure for reading the spectral information 
-	//  from the scan-file
-	FileHandler::CScanFileHandler scan;  
-
-	// Check the scan file, make sure it's correct and that the file
-	//	actually contains spectra
-	if(SUCCESS != scan.CheckScanFile(&scanfile)) {
-		return 0;
-	}
-
 	// make a backup of the fit window (this function may make some changes to the
 	//  fit window, and we should be able to restore the old values on return).
 	CFitWindow backupWindow = eval->m_window;
@@ -163,6 +175,9 @@ long CScanEvaluation::EvaluateScan(const CString &scanfile, CEvaluation *eval, b
 	// Check weather we are to find an optimal shift and squeeze
 	int nIt = (eval->m_window.findOptimalShift == FALSE) ? 1 : 2;
 
+	// The time when the evaluated spectra were last shown on the screen
+	DWORD lastViewUpdate = 0;
+
 	// Evaluate the scan (one or two times, depending on the settings)
 	for(int iteration = 0; iteration < nIt; ++iteration){
 
@@ -198,7 +213,7 @@ long CScanEvaluation::EvaluateScan(const CString &scanfile, CEvaluation *eval, b
 					break;
 				}else{
 					CString errMsg;
-					errMsg.Format("Faulty spectrum found in %s", scanfile);
+					errMsg.Format("Faulty spectrum found in %s", scan.GetFileName());
 					switch(scan.m_lastError){
 						case SpectrumIO::CSpectrumIO::ERROR_CHECKSUM_MISMATCH:
 							errMsg.AppendFormat(", Checksum mismatch. Spectrum ignored"); break;
@@ -247,6 +262,7 @@ long CScanEvaluation::EvaluateScan(const CString &scanfile, CEvaluation *eval, b
 			if(Ignore(current, eval->m_window)) {
 				message.Format("Ignoring spectrum %d in scan %s.", current.ScanIndex(), scan.GetFileName());
 				ShowMessage(message);
+				eval->ColdStart();
 				continue;
 			}
 
@@ -279,11 +295,25 @@ long CScanEvaluation::EvaluateScan(const CString &scanfile, CEvaluation *eval, b
 				m_indexOfMostAbsorbingSpectrum	= index;
 			}
 
-			// h. Update the screen (if any)
+			// g2. If wanted, let the next fit start from this one. A failed, not converged or
+			//		not ok fit is not a good starting point, then the next fit starts from the defaults
+			if(m_warmStart && success && newResult->IsOk(newResult->GetEvaluatedNum()-1)) {
+				eval->WarmStartFromLastFit();
+			}else{
+				eval->ColdStart();
+			}
+
+			// h. Update the screen (if any), but not more often than it can be redrawn
 			if(success && pView != nullptr) {
 				UpdateResult(newResult);
 
-				ShowResult(current, eval, index, scan.GetSpectrumNumInFile());
+				DWORD now = GetTickCount();
+				bool paused = (m_pause != nullptr && *m_pause == 1);
+				bool lastSpectrum = (index >= scan.GetSpectrumNumInFile() - 1);
+				if(paused || lastSpectrum || m_maxViewUpdatesPerSecond <= 0 || (now - lastViewUpdate) >= (DWORD)(1000 / m_maxViewUpdatesPerSecond)) {
+					ShowResult(current, eval, index, scan.GetSpectrumNumInFile());
+					lastViewUpdate = now;
+				}
 			}
 
 			// i. If the user wants us to sleep between each evaluation. Do so...
@@ -296,11 +326,11 @@ long CScanEvaluation::EvaluateScan(const CString &scanfile, CEvaluation *eval, b
 				thread->SuspendThread();
 				*m_sleeping = false;
 			}
-			else {
-				Sleep(20);
-			}
 		} // end while(1)
 
+		// the next iteration, and any other use of the evaluation object, starts from the defaults again
+		eval->ColdStart();
+
 		// end of scan...
 		if((iteration == 0) && (eval->m_window.findOptimalShift == TRUE)){
 			FindOptimumShiftAndSqueeze(eval, &scan, newResult.get());
@@ -308,6 +338,9 @@ long CScanEvaluation::EvaluateScan(const CString &scanfile, CEvaluation *eval, b
 
 	}//
 
+	// Save the result, also when the spectra were not shown on the screen
+	UpdateResult(newResult);
+
 	// restore the fit window
 	eval->m_window = backupWindow;
 
@@ -395,6 +428,9 @@ void CScanEvaluation::ShowResult(const CSpectrum &spec, const CEvaluation *eval,
 	CSpectrum* spectra = new CSpectrum[eval->m_window.nRef + 3];
 
 	spectra[0] = spec;
+	for(int k = 1; k < eval->m_window.nRef + 3; ++k) {
+		spectra[k].SetLength(max(spec.m_length, (long)fitHigh));
+	}
 
 	// copy the residual and the polynomial
 	for(int i = fitLow; i < fitHigh; ++i) {
@@ -458,7 +494,7 @@ RETURN_CODE CScanEvaluation::GetDark(FileHandler::CScanFileHandler *scan, const
 
 				// 3d. Make the dark-spectrum
 				dark.Clear();
-				dark.m_length = offset.m_length;
+				dark.SetLength(offset.m_length);
 				dark.Add(offset);
 				dark.Add(darkCurrent);
 
@@ -496,10 +532,10 @@ RETURN_CODE CScanEvaluation::GetDark(FileHandler::CScanFileHandler *scan, const
 		if(darkSettings->m_offsetOption == USER_SUPPLIED){
 			if(strlen(darkSettings->m_offsetSpec) < 3)
 				return FAIL;
-			if(FAIL == SpectrumIO::CSTDFile::ReadSpectrum(offset, darkSettings->m_offsetSpec)){
-				if(FAIL == SpectrumIO::CTXTFile::ReadSpectrum(offset, darkSettings->m_offsetSpec))
-					return FAIL;
-			}
+			std::shared_ptr<const CSpectrum> userOffset = SpectrumIO::CSpectrumCache::GetSpectrum(darkSettings->m_offsetSpec);
+			if(userOffset == nullptr)
+				return FAIL;
+			offset = *userOffset;
 		}else{
 			scan->GetOffset(offset);
 		}
@@ -509,10 +545,10 @@ RETURN_CODE CScanEvaluation::GetDark(FileHandler::CScanFileHandler *scan, const
 		if(darkSettings->m_darkCurrentOption == USER_SUPPLIED){
 			if(strlen(darkSettings->m_darkCurrentSpec) < 3)
 				return FAIL;
-			if(FAIL == SpectrumIO::CSTDFile::ReadSpectrum(darkCurrent, darkSettings->m_darkCurrentSpec)){
-				if(FAIL == SpectrumIO::CTXTFile::ReadSpectrum(darkCurrent, darkSettings->m_darkCurrentSpec))
-					return FAIL;
-			}
+			std::shared_ptr<const CSpectrum> userDarkCurrent = SpectrumIO::CSpectrumCache::GetSpectrum(darkSettings->m_darkCurrentSpec);
+			if(userDarkCurrent == nullptr)
+				return FAIL;
+			darkCurrent = *userDarkCurrent;
 			offsetCorrectDC = false;
 		}else{
 			scan->GetDarkCurrent(darkCurrent);
@@ -534,7 +570,7 @@ RETURN_CODE CScanEvaluation::GetDark(FileHandler::CScanFileHandler *scan, const
 
 		// 3d. Make the dark-spectrum
 		dark.Clear();
-		dark.m_length								= offset.m_length;
+		dark.SetLength(offset.m_length);
 		dark.m_info.m_interlaceStep = offset.m_info.m_interlaceStep;
 		dark.m_info.m_channel				= offset.m_info.m_channel;
 		dark.Add(offset);
@@ -553,10 +589,10 @@ RETURN_CODE CScanEvaluation::GetDark(FileHandler::CScanFileHandler *scan, const
 		// Try to read the spectrum
 		if(strlen(darkSettings->m_offsetSpec) < 3)
 			return FAIL;
-		if(FAIL == SpectrumIO::CSTDFile::ReadSpectrum(dark, darkSettings->m_offsetSpec)){
-			if(FAIL == SpectrumIO::CTXTFile::ReadSpectrum(dark, darkSettings->m_offsetSpec))
-				return FAIL;
-		}
+		std::shared_ptr<const CSpectrum> userDark = SpectrumIO::CSpectrumCache::GetSpectrum(darkSettings->m_offsetSpec);
+		if(userDark == nullptr)
+			return FAIL;
+		dark = *userDark;
 
 		// If the dark-spectrum is read out in an interlaced way then interpolate it back to it's original state
 		if(dark.m_info.m_interlaceStep > 1){
@@ -625,13 +661,13 @@ RETURN_CODE CScanEvaluation::GetSky(FileHandler::CScanFileHandler *scan, CSpectr
 
 	// If the user has supplied a special sky-spectrum to use
 	if(m_skyOption == SKY_USER){
-		if(Equals(m_userSkySpectrum.Right(4), ".pak", 4)){
-			// If the spectrum is in .pak format
-			SpectrumIO::CSpectrumIO reader;
-			return reader.ReadSpectrum(m_userSkySpectrum, 0, sky);
-		}else if(Equals(m_userSkySpectrum.Right(4), ".std", 4)){
-			// If the spectrum is in .std format
-			return SpectrumIO::CSTDFile::ReadSpectrum(sky, m_userSkySpectrum);
+		if(Equals(m_userSkySpectrum.Right(4), ".pak", 4) || Equals(m_userSkySpectrum.Right(4), ".std", 4)){
+			// If the spectrum is in .pak or .std format
+			std::shared_ptr<const CSpectrum> userSky = SpectrumIO::CSpectrumCache::GetSpectrum(m_userSkySpectrum);
+			if(userSky == nullptr)
+				return FAIL;
+			sky = *userSky;
+			return SUCCESS;
 		}else{
 			// If we don't recognize the sky-spectrum format
 			errorMsg.Format("Unknown format for sky spectrum. Please use .pak or .std");
@@ -667,6 +703,11 @@ void	CScanEvaluation::SetOption_AveragedSpectra(bool averaged){
 	this->m_averagedSpectra = averaged;
 }
 
+/** Setting the option for wheather the fits are warm started or not. */
+void	CScanEvaluation::SetOption_WarmStart(bool warmStart){
+	this->m_warmStart = warmStart;
+}
+
 /** Returns true if the spectrum should be ignored */
 bool CScanEvaluation::Ignore(const CSpectrum &spec, const CFitWindow window){
 	bool ret = false;
@@ -40,10 +40,22 @@ namespace Evaluation
 			message will be sent to pView. */
 		CWnd *pView;
 
+		/** The largest number of times per second that the evaluated spectra are sent
+			to 'pView'. Spectra evaluated in between are not shown, but the last spectrum
+			in the scan always is. If this is zero then every evaluated spectrum is shown.
+			Without a 'pView' (real-time or headless evaluation) the spectra are evaluated
+			without any delay. */
+		int m_maxViewUpdatesPerSecond;
+
 		/** Called to evaluate one scan.
 				@return the number of spectra evaluated. */
 		long EvaluateScan(const CString &scanfile, CEvaluation *evaluator, bool *fRun = NULL, const CConfigurationSetting::DarkSettings *darkSettings = NULL);
 
+		/** Called to evaluate one scan which has already been checked, or loaded, 
+				by the given scan-file handler. This saves reading the file once more.
+				@return the number of spectra evaluated. */
+		long EvaluateScan(FileHandler::CScanFileHandler &scan, CEvaluation *evaluator, bool *fRun = NULL, const CConfigurationSetting::DarkSettings *darkSettings = NULL);
+
 		/** Setting the option for how to get the sky spectrum.
 			@param skySpecPath - if not null and skyOption == SKY_USER, then this string will be used
 				as sky-spectrum. 
@@ -57,6 +69,11 @@ namespace Evaluation
 		/** Setting the option for wheather the spectra are averaged or not. */
 		void SetOption_AveragedSpectra(bool averaged);
 
+		/** Setting the option for wheather the fit of each spectrum starts from the
+			shift, squeeze and Levenberg-Marquardt damping of the previous spectrum
+			in the scan. Default is false. */
+		void SetOption_WarmStart(bool warmStart);
+
 		/** @return a copy of the scan result */
 		std::unique_ptr<CScanResult> GetResult();
 
@@ -131,6 +148,10 @@ namespace Evaluation
 		/** True if the spectra are averaged, not summed */
 		bool m_averagedSpectra;
 
+		/** True if each fit starts from the result of the previous spectrum,
+			as long as that one was evaluated and found ok */
+		bool m_warmStart;
+
 		/** Remember the index of the spectrum with the highest absorption, to be able to
 			adjust the shift and squeeze with it later */
 		int m_indexOfMostAbsorbingSpectrum;
@@ -0,0 +1,255 @@
+/**
+	FitBenchmark - a micro-benchmark of the fit engine in the 'Fit' directory.
+
+	The program fits a synthetic spectrum with two references and a polynomial,
+	the same model as CEvaluation::Evaluate builds, and reports the number of
+	fits per second and the number of heap allocations per fit in two cases:
+
+		rebuilt - the functions and the fit object are created for every
+					spectrum, as CEvaluation::Evaluate does.
+		reused  - the functions and the fit object are created once and
+					used for all spectra.
+
+	The program is not a part of the NovacMasterProgram project. Build it as a
+	console program with the 'Fit' directory in the include path, e.g.
+
+		cl /EHsc /O2 /I.. FitBenchmark.cpp
+
+	Compare the fit engine before and after a change by building the program
+	against the two versions of the 'Fit' directory.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+#include <chrono>
+#include <iostream>
+
+// the fit engine uses the 'max', 'min' and '_finite' of the Windows headers
+#ifdef _WIN32
+#include <windows.h>
+#include <float.h>
+#else
+#define max(a,b) (((a) > (b)) ? (a) : (b))
+#define min(a,b) (((a) < (b)) ? (a) : (b))
+#define TRUE 1
+#define _finite std::isfinite
+#endif
+
+#include "FitBasic.h"
+#include "Vector.h"
+#include "Matrix.h"
+#include "ReferenceSpectrumFunction.h"
+#include "SimpleDOASFunction.h"
+#include "StandardMetricFunction.h"
+#include "StandardFit.h"
+#include "VariableProjectionFit.h"
+#include "PolynomialFunction.h"
+#include "DiscreteFunction.h"
+
+using namespace MathFit;
+
+// ----------------------------------------------------------------------
+// --------------------- COUNTING THE ALLOCATIONS -----------------------
+// ----------------------------------------------------------------------
+
+/** The number of calls to operator new since the program started */
+static long s_allocationNum = 0;
+
+void *operator new(size_t size){
+	++s_allocationNum;
+	void *p = malloc(size > 0 ? size : 1);
+	if(p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+void *operator new[](size_t size){
+	return operator new(size);
+}
+void operator delete(void *p) throw(){
+	free(p);
+}
+void operator delete[](void *p) throw(){
+	free(p);
+}
+
+// ----------------------------------------------------------------------
+// --------------------- THE SYNTHETIC SPECTRA --------------------------
+// ----------------------------------------------------------------------
+
+/** The number of pixels in the spectra */
+static const int SPECTRUM_LENGTH = 300;
+
+/** The first pixel and the number of pixels in the fit region */
+static const int FIT_LOW = 20;
+static const int FIT_LENGTH = SPECTRUM_LENGTH - 40;
+
+/** The number of spectra to fit in every case */
+static const int SPECTRUM_NUM = 2000;
+
+/** The two references, the first one is allowed to shift and squeeze */
+static double Reference1(double x){ return sin(x / 7.0) + 0.3 * cos(x / 3.1); }
+static double Reference2(double x){ return exp(-(x - 150) * (x - 150) / 800.0) + 0.2 * sin(x / 11.0); }
+
+/** Fills in the measured spectrum number 'index', the columns and the shift
+	of the first reference change slightly from one spectrum to the next */
+static void MakeMeasurement(int index, CVector &vMeas){
+	double column1 = 0.7 + 0.001 * (index % 50);
+	double column2 = 1.5 - 0.002 * (index % 30);
+	double shift   = 0.4 + 0.01 * (index % 20);
+
+	for(int i = 0; i < SPECTRUM_LENGTH; ++i){
+		double x = i;
+		vMeas.SetAt(i, column1 * Reference1(x + shift) + column2 * Reference2(x) + 0.01 * x - 2e-5 * x * x + 0.3 + 0.001 * sin(x * 1.7));
+	}
+}
+
+// ----------------------------------------------------------------------
+// --------------------- THE TWO CASES ----------------------------------
+// ----------------------------------------------------------------------
+
+/** The result of one case */
+typedef struct BenchmarkResult{
+	double fitsPerSecond;
+	double allocationsPerFit;
+	double lastColumn;
+}BenchmarkResult;
+
+/** Sets up the references in the same way as CEvaluation::CreateReferenceSpectrum */
+static void SetupReferences(CReferenceSpectrumFunction &ref1, CReferenceSpectrumFunction &ref2, CVector &vX, CVector &vRef1, CVector &vRef2){
+	ref1.SetData(vX, vRef1);
+	ref2.SetData(vX, vRef2);
+	ref1.SetParameterLimits(CReferenceSpectrumFunction::SHIFT, (TFitData)-10.0, (TFitData)10.0, (TFitData)1e0);
+	ref1.SetDefaultParameter(CReferenceSpectrumFunction::SHIFT, (TFitData)0.0);
+	ref1.SetDefaultParameter(CReferenceSpectrumFunction::SQUEEZE, (TFitData)1.0);
+	ref1.SetParameterLimits(CReferenceSpectrumFunction::SQUEEZE, (TFitData)0.98, (TFitData)1.02, (TFitData)1e0);
+	ref2.FixParameter(CReferenceSpectrumFunction::SHIFT, (TFitData)0.0);
+	ref2.FixParameter(CReferenceSpectrumFunction::SQUEEZE, (TFitData)1.0);
+}
+
+/** Fits all the spectra, building the model and the fit object for every spectrum */
+template<class TFit> static BenchmarkResult RunRebuilt(CVector &vX, CVector &vRef1, CVector &vRef2){
+	BenchmarkResult result;
+	CVector vMeas(SPECTRUM_LENGTH);
+	CVector vXSec(FIT_LENGTH);
+	vXSec.Copy(vX.SubVector(FIT_LOW, FIT_LENGTH));
+
+	long allocationNum = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for(int k = 0; k < SPECTRUM_NUM; ++k){
+		MakeMeasurement(k, vMeas);
+
+		long allocationsBefore = s_allocationNum;
+		{
+			CDiscreteFunction dataTarget;
+			dataTarget.SetData(vX, vMeas);
+
+			CReferenceSpectrumFunction ref1, ref2;
+			SetupReferences(ref1, ref2, vX, vRef1, vRef2);
+
+			CSimpleDOASFunction cRefSum;
+			cRefSum.AddReference(ref1);
+			cRefSum.AddReference(ref2);
+			CPolynomialFunction cPoly(2);
+			cRefSum.AddReference(cPoly);
+
+			CStandardMetricFunction cDiff(dataTarget, cRefSum);
+			TFit cFit(cDiff);
+			cFit.SetFitRange(vXSec);
+			cFit.SetMaxFitSteps(500);
+			cFit.SetMinChiSquare(0.0001);
+
+			cFit.PrepareMinimize();
+			cFit.Minimize();
+			cFit.FinishMinimize();
+
+			result.lastColumn = (double)ref1.GetModelParameter(CReferenceSpectrumFunction::CONCENTRATION);
+		}
+		allocationNum += s_allocationNum - allocationsBefore;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.fitsPerSecond     = SPECTRUM_NUM / seconds;
+	result.allocationsPerFit = (double)allocationNum / SPECTRUM_NUM;
+	return result;
+}
+
+/** Fits all the spectra with the same model and fit object. The allocations of
+	the first fit, which sizes all the buffers, are not counted. */
+template<class TFit> static BenchmarkResult RunReused(CVector &vX, CVector &vRef1, CVector &vRef2){
+	BenchmarkResult result;
+	CVector vMeas(SPECTRUM_LENGTH);
+	CVector vXSec(FIT_LENGTH);
+	vXSec.Copy(vX.SubVector(FIT_LOW, FIT_LENGTH));
+
+	CDiscreteFunction dataTarget;
+	dataTarget.SetData(vX, vMeas);
+
+	CReferenceSpectrumFunction ref1, ref2;
+	SetupReferences(ref1, ref2, vX, vRef1, vRef2);
+
+	CSimpleDOASFunction cRefSum;
+	cRefSum.AddReference(ref1);
+	cRefSum.AddReference(ref2);
+	CPolynomialFunction cPoly(2);
+	cRefSum.AddReference(cPoly);
+
+	CStandardMetricFunction cDiff(dataTarget, cRefSum);
+	TFit cFit(cDiff);
+	cFit.SetFitRange(vXSec);
+	cFit.SetMaxFitSteps(500);
+	cFit.SetMinChiSquare(0.0001);
+
+	long allocationNum = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for(int k = 0; k < SPECTRUM_NUM; ++k){
+		MakeMeasurement(k, vMeas);
+		dataTarget.SetData(vX, vMeas);
+		ref1.ResetLinearParameter();
+		ref1.ResetNonlinearParameter();
+		ref2.ResetLinearParameter();
+		cPoly.ResetLinearParameter();
+
+		long allocationsBefore = s_allocationNum;
+		cFit.PrepareMinimize();
+		cFit.Minimize();
+		cFit.FinishMinimize();
+		if(k > 0)
+			allocationNum += s_allocationNum - allocationsBefore;
+
+		result.lastColumn = (double)ref1.GetModelParameter(CReferenceSpectrumFunction::CONCENTRATION);
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.fitsPerSecond     = SPECTRUM_NUM / seconds;
+	result.allocationsPerFit = (double)allocationNum / (SPECTRUM_NUM - 1);
+	return result;
+}
+
+static void PrintResult(const char *name, const BenchmarkResult &result){
+	printf("%-28s %10.0lf fits/s %10.1lf allocations/fit   (column %.6lf)\n", name, result.fitsPerSecond, result.allocationsPerFit, result.lastColumn);
+}
+
+int main(){
+	CVector vX(SPECTRUM_LENGTH), vRef1(SPECTRUM_LENGTH), vRef2(SPECTRUM_LENGTH);
+	for(int i = 0; i < SPECTRUM_LENGTH; ++i){
+		vX.SetAt(i, (TFitData)i);
+		vRef1.SetAt(i, Reference1(i));
+		vRef2.SetAt(i, Reference2(i));
+	}
+
+	try{
+		PrintResult("standard fit, rebuilt",            RunRebuilt<CStandardFit>(vX, vRef1, vRef2));
+		PrintResult("standard fit, reused",             RunReused<CStandardFit>(vX, vRef1, vRef2));
+		PrintResult("variable projection, rebuilt",     RunRebuilt<CVariableProjectionFit>(vX, vRef1, vRef2));
+		PrintResult("variable projection, reused",      RunReused<CVariableProjectionFit>(vX, vRef1, vRef2));
+	}catch(CFitException e){
+		printf("A fit exception occurred\n");
+		return 1;
+	}
+
+	return 0;
+}
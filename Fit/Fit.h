@@ -160,6 +160,16 @@ namespace MathFit
 			mLinearMinimizer.SetMinChiSquare(fMinChiSquare);
 		}
 
+		virtual void SetStartLambda(TFitData fStartLambda)
+		{
+			mMinimizer.SetStartLambda(fStartLambda);
+		}
+
+		virtual TFitData GetLambda()
+		{
+			return mMinimizer.GetLambda();
+		}
+
 	private:
 		/**
 		* The nonlinear minimizer object.
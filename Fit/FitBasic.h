@@ -211,10 +211,21 @@ namespace MathFit
 
 #define MATHFIT_PI			3.14159265358979323846
 
-	// enable to use LU decomposition. if disabled Gauss Jordan Elimination is used
+	// select the method used to solve the equations of the linear and nonlinear fits.
+	// if none of them is enabled Gauss Jordan Elimination is used.
+	// enable to use LU decomposition.
 //#define MATHFIT_USELUDECOMPOSITION
+	// enable to use the Cholesky decomposition of the normal equations, which is the fastest method.
+//#define MATHFIT_USECHOLESKYDECOMPOSITION
+	// enable to use the Householder QR decomposition, which is slower but more robust for strongly correlated
+	// references. The linear fit then decomposes the model matrix itself instead of the normal equations.
+//#define MATHFIT_USEQRDECOMPOSITION
 //#define MATHFIT_IMPROVEEQSSOLVE
 
+#if defined(MATHFIT_USELUDECOMPOSITION) + defined(MATHFIT_USECHOLESKYDECOMPOSITION) + defined(MATHFIT_USEQRDECOMPOSITION) > 1
+#error Only one method to solve the equations of the fits may be enabled
+#endif
+
 	class CAssertFailedException : public CFitException
 	{
 	public:
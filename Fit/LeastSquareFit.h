@@ -71,16 +71,25 @@ namespace MathFit
 			mModel.GetLinearAMatrix(mFitRange, mA, mB);
 
 			// add data errors to model matrix
-			CVector vError(mFitRange.GetSize());
-			mModel.GetFunctionErrors(mFitRange, vError);
+			mError.SetSize(mFitRange.GetSize());
+			mModel.GetFunctionErrors(mFitRange, mError);
 			const int iBSize = mB.GetSize();
-			int i;
+			const int iParams = mA.GetNoColumns();
+			int i, j;
 			for(i = 0; i < iBSize; i++)
 			{
-				mA.GetRow(i).Div(vError.GetAt(i));
-				mB.SetAt(i, mB.GetAt(i) / vError.GetAt(i));
+				for(j = 0; j < iParams; j++)
+					mA.SetAt(i, j, mA.GetAt(i, j) / mError.GetAt(i));
+				mB.SetAt(i, mB.GetAt(i) / mError.GetAt(i));
 			}
 
+#if defined(MATHFIT_USEQRDECOMPOSITION)
+			// decompose the weighted A matrix itself instead of the normal equations (At*A), since building
+			// At*A squares the condition of the problem. No iterative improvement is needed in this case.
+			mA.QRDecomposition();
+			mA.QRBacksubstitution(mB, mSolution);
+			mB.Copy(mSolution);
+#else
 			// build transposed A matrix
 			// At
 			mTranspose.Copy(mA);
@@ -97,8 +106,8 @@ namespace MathFit
 #if defined(MATHFIT_IMPROVEEQSSOLVE)
 			// to apply the iterative solution improvement, we need backups of the original
 			// result vector and EQS matrix
-			CVector vBackupB(mB);
-			CMatrix mBackupA(mA);
+			mBackupB.Copy(mB);
+			mBackupA.Copy(mA);
 #endif
 
 			// Solve linear equations
@@ -111,18 +120,40 @@ namespace MathFit
 			// the 'iterative solution improvement' as described in Numerical Recipes.
 
 			// Use the solution to calculate once again the result vector of the EQS
-			CVector vSolutionError(mB);
-			mBackupA.Mul(vSolutionError);
+			mSolutionError.Copy(mB);
+			mBackupA.Mul(mSolutionError);
+
+			// subtract the old result vector from the one calculated using the EQS result
+			// (the result should be nearly zero at all)
+			mSolutionError.Sub(mBackupB);
+
+			// solve the EQS once again but use the solution error as result vector
+			mA.LUBacksubstitution(mSolutionError);
+
+			// subtract the solution error from the original solution
+			mB.Sub(mSolutionError);
+#endif
+#elif defined(MATHFIT_USECHOLESKYDECOMPOSITION)
+			mA.CholeskyDecomposition();
+			mA.CholeskyBacksubstitution(mB);
+
+#if defined(MATHFIT_IMPROVEEQSSOLVE)
+			// we want to correct the numerical errors by applying
+			// the 'iterative solution improvement' as described in Numerical Recipes.
+
+			// Use the solution to calculate once again the result vector of the EQS
+			mSolutionError.Copy(mB);
+			mBackupA.Mul(mSolutionError);
 
 			// subtract the old result vector from the one calculated using the EQS result
 			// (the result should be nearly zero at all)
-			vSolutionError.Sub(vBackupB);
+			mSolutionError.Sub(mBackupB);
 
 			// solve the EQS once again but use the solution error as result vector
-			mA.LUBacksubstitution(vSolutionError);
+			mA.CholeskyBacksubstitution(mSolutionError);
 
 			// subtract the solution error from the original solution
-			mB.Sub(vSolutionError);
+			mB.Sub(mSolutionError);
 #endif
 #else
 			mA.GaussJordanSolve(mB);
@@ -132,18 +163,19 @@ namespace MathFit
 			// the 'iterative solution improvement' as described in Numerical Recipes.
 
 			// Use the solution to calculate once again the result vector of the EQS
-			CVector vSolutionError(mB);
-			mBackupA.Mul(vSolutionError);
+			mSolutionError.Copy(mB);
+			mBackupA.Mul(mSolutionError);
 
 			// subtract the old result vector from the one calculated using the EQS result
 			// (the result should be nearly zero at all)
-			vSolutionError.Sub(vBackupB);
+			mSolutionError.Sub(mBackupB);
 
 			// solve the EQS once again but use the solution error as result vector
-			mBackupA.GaussJordanSolve(vSolutionError);
+			mBackupA.GaussJordanSolve(mSolutionError);
 
 			// subtract the solution error from the original solution
-			mB.Sub(vSolutionError);
+			mB.Sub(mSolutionError);
+#endif
 #endif
 #endif
 
@@ -168,43 +200,48 @@ namespace MathFit
 			mModel.GetValues(mFitRange, mDiff);
 
 			// now calculate the chi square and variance values
-			CVector vErr(mFitRange.GetSize());
-			mModel.GetFunctionErrors(mFitRange, vErr);
+			mError.SetSize(mFitRange.GetSize());
+			mModel.GetFunctionErrors(mFitRange, mError);
 
 			// get the sum of squares weighted by the sigma error vector
-			mChiSquare = mDiff.SquareSumErrorWeighted(vErr);
+			mChiSquare = mDiff.SquareSumErrorWeighted(mError);
 			mChiSquare += mModel.GetLinearPenalty(mChiSquare);
 
 			// calculate the normalization factor for all statistical parameters
 			TFitData fNorm = (TFitData)sqrt(mChiSquare / (mDiff.GetSize() - iParams));
 
-			// set the covariance matrix, which is the inverse of A after the Gauss Jordan elimination
+			// set the covariance matrix, which is the inverse of A after the Gauss Jordan elimination.
+			// The other methods calculate it from the factors of their decomposition.
 #if defined(MATHFIT_USELUDECOMPOSITION)
 			mA.LUInverse();
+#elif defined(MATHFIT_USECHOLESKYDECOMPOSITION)
+			mA.CholeskyInverse();
+#elif defined(MATHFIT_USEQRDECOMPOSITION)
+			mA.QRCovariance();
 #endif
-			CMatrix mCovar(mA);
+			mCovar.Copy(mA);
 
 			// set the covariance matrix
 			mModel.SetLinearCovarMatrix(mCovar);
 
 			// calculate the parameter errors
-			CVector vError(iParams);
+			mParamError.SetSize(iParams);
 			int i;
 			for(i = 0; i < iParams; i++)
-				vError.SetAt(i, (TFitData)sqrt(mCovar.GetAt(i, i)));
+				mParamError.SetAt(i, (TFitData)sqrt(mCovar.GetAt(i, i)));
 
 			// calculate the correlation matrix
-			CMatrix mCorrel(iParams, iParams);
+			mCorrel.SetSize(iParams, iParams);
 
 			int j;
 			for(i = 0; i < iParams; i++)
 				for(j = 0; j < iParams; j++)
-					mCorrel.SetAt(i, j, mCovar.GetAt(i, j) / (vError.GetAt(i) * vError.GetAt(j)));
+					mCorrel.SetAt(i, j, mCovar.GetAt(i, j) / (mParamError.GetAt(i) * mParamError.GetAt(j)));
 			mModel.SetLinearCorrelMatrix(mCorrel);
 
 			// now we have to 'normalize' the parameter errors to chi square.
-			vError.Mul(fNorm);
-			mModel.SetLinearError(vError);
+			mParamError.Mul(fNorm);
+			mModel.SetLinearError(mParamError);
 
 			return true;
 		}
@@ -230,6 +267,18 @@ namespace MathFit
 		* Contains the transposed A matrix
 		*/
 		CMatrix mTranspose;
+		/**
+		* Buffers for the iterative solution improvement, the solution of the QR decomposition and for the
+		* covariance, correlation and parameter errors of the fit. These are members so that their memory is reused in every step of the fit, and
+		* from fit to fit as long as the fit object is kept.
+		*/
+		CVector mBackupB;
+		CMatrix mBackupA;
+		CVector mSolution;
+		CVector mSolutionError;
+		CMatrix mCovar;
+		CMatrix mCorrel;
+		CVector mParamError;
 	};
 }
 #pragma warning (pop)
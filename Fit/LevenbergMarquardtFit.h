@@ -41,6 +41,8 @@ namespace MathFit
 		* @param ipfModel	The model function which parametes should be fitted.
 		*/
 		CLevenbergMarquardtFit(IParamFunction& ipfModel) : IMinimizer(ipfModel),
+			mLambda((TFitData)STARTLAMBDA),
+			mStartLambda((TFitData)STARTLAMBDA),
 			mSTARTLAMBDA((TFitData)STARTLAMBDA),
 			mMINLAMBDA((TFitData)MINLAMBDA),
 			mMAXLAMBDA((TFitData)MAXLAMBDA),
@@ -58,7 +60,7 @@ namespace MathFit
 			if(mFitRange.GetSize() <= 0)
 				throw(EXCEPTION(CNoFitRangeException));
 
-			mLambda = mSTARTLAMBDA;
+			mLambda = mStartLambda;
 			mSolutionFitSteps = mFitSteps = 0;
 
 			// set the appropriate matrix sizes
@@ -117,18 +119,74 @@ namespace MathFit
 			// the 'iterative solution improvement' as described in Numerical Recipes.
 
 			// Use the solution to calculate once again the result vector of the EQS
-			CVector vSolutionError(mBeta);
-			mAlphaOld.Mul(vSolutionError);
+			mSolutionError.Copy(mBeta);
+			mAlphaOld.Mul(mSolutionError);
 
 			// subtract the old result vector from the one calculated using the EQS result
 			// (the result should be nearly zero at all)
-			vSolutionError.Sub(mBetaOld);
+			mSolutionError.Sub(mBetaOld);
 
 			// solve the EQS once again but use the solution error as result vector
-			mAlpha.LUBacksubstitution(vSolutionError);
+			mAlpha.LUBacksubstitution(mSolutionError);
 
 			// subtract the solution error from the original solution
-			mBeta.Sub(vSolutionError);
+			mBeta.Sub(mSolutionError);
+#endif
+#elif defined(MATHFIT_USECHOLESKYDECOMPOSITION)
+			// the augmented alpha matrix should be positive definite. If it is not (numerically), we handle
+			// this like a step with a worse chi square and increase lambda instead of aborting the fit.
+			try
+			{
+				mAlpha.CholeskyDecomposition();
+			}
+			catch(CMatrixNotPositiveDefiniteException e)
+			{
+				mAlpha.Copy(mAlphaOld);
+				mBeta.Copy(mBetaOld);
+				mLambda *= 10;
+				return true;
+			}
+			mAlpha.CholeskyBacksubstitution(mBeta);
+
+#if defined(MATHFIT_IMPROVEEQSSOLVE)
+			// we want to correct the numerical errors by applying
+			// the 'iterative solution improvement' as described in Numerical Recipes.
+
+			// Use the solution to calculate once again the result vector of the EQS
+			mSolutionError.Copy(mBeta);
+			mAlphaOld.Mul(mSolutionError);
+
+			// subtract the old result vector from the one calculated using the EQS result
+			// (the result should be nearly zero at all)
+			mSolutionError.Sub(mBetaOld);
+
+			// solve the EQS once again but use the solution error as result vector
+			mAlpha.CholeskyBacksubstitution(mSolutionError);
+
+			// subtract the solution error from the original solution
+			mBeta.Sub(mSolutionError);
+#endif
+#elif defined(MATHFIT_USEQRDECOMPOSITION)
+			mAlpha.QRDecomposition();
+			mAlpha.QRBacksubstitution(mBeta, mBeta);
+
+#if defined(MATHFIT_IMPROVEEQSSOLVE)
+			// we want to correct the numerical errors by applying
+			// the 'iterative solution improvement' as described in Numerical Recipes.
+
+			// Use the solution to calculate once again the result vector of the EQS
+			mSolutionError.Copy(mBeta);
+			mAlphaOld.Mul(mSolutionError);
+
+			// subtract the old result vector from the one calculated using the EQS result
+			// (the result should be nearly zero at all)
+			mSolutionError.Sub(mBetaOld);
+
+			// solve the EQS once again but use the solution error as result vector
+			mAlpha.QRBacksubstitution(mSolutionError, mSolutionError);
+
+			// subtract the solution error from the original solution
+			mBeta.Sub(mSolutionError);
 #endif
 #else
 			mAlpha.GaussJordanSolve(mBeta);
@@ -138,19 +196,19 @@ namespace MathFit
 			// the 'iterative solution improvement' as described in Numerical Recipes.
 
 			// Use the solution to calculate once again the result vector of the EQS
-			CVector vSolutionError(mBeta);
-			mAlphaOld.Mul(vSolutionError);
+			mSolutionError.Copy(mBeta);
+			mAlphaOld.Mul(mSolutionError);
 
 			// subtract the old result vector from the one calculated using the EQS result
 			// (the result should be nearly zero at all)
-			vSolutionError.Sub(mBetaOld);
+			mSolutionError.Sub(mBetaOld);
 
 			// solve the EQS once again but use the solution error as result vector
-			CMatrix mBackupAlpha(mAlphaOld);
-			mBackupAlpha.GaussJordanSolve(vSolutionError);
+			mBackupAlpha.Copy(mAlphaOld);
+			mBackupAlpha.GaussJordanSolve(mSolutionError);
 
 			// subtract the solution error from the original solution
-			mBeta.Sub(vSolutionError);
+			mBeta.Sub(mSolutionError);
 #endif
 #endif
 
@@ -198,6 +256,31 @@ namespace MathFit
 			return true;
 		}
 
+		/**
+		* Sets the lambda value with which the next fit starts, e.g. the final lambda of a previous fit
+		* to a similar spectrum. The value is limited to [MINLAMBDA, STARTLAMBDA], so the fit
+		* never starts with more damping than with the default.
+		*
+		* @param fStartLambda	The start value of lambda. A value less or equal to zero restores STARTLAMBDA.
+		*/
+		virtual void SetStartLambda(TFitData fStartLambda)
+		{
+			if(fStartLambda <= 0)
+				mStartLambda = mSTARTLAMBDA;
+			else
+				mStartLambda = max(mMINLAMBDA, min(fStartLambda, mSTARTLAMBDA));
+		}
+
+		/**
+		* Returns the lambda value at the end of the last fit.
+		*
+		* @return The final lambda value.
+		*/
+		virtual TFitData GetLambda()
+		{
+			return mLambda;
+		}
+
 		/**
 		* Just set the covariance matrix in the model function object.
 		*
@@ -213,11 +296,11 @@ namespace MathFit
 			mModel.GetValues(mFitRange, mDiff);
 
 			// now calculate the chi square and variance values
-			CVector vErr(mFitRange.GetSize());
-			mModel.GetFunctionErrors(mFitRange, vErr);
+			mError.SetSize(mFitRange.GetSize());
+			mModel.GetFunctionErrors(mFitRange, mError);
 
 			// get the sum of squares weighted by the error vector
-			mChiSquare = mDiff.SquareSumErrorWeighted(vErr);
+			mChiSquare = mDiff.SquareSumErrorWeighted(mError);
 			mChiSquare += mModel.GetNonlinearPenalty(mChiSquare);
 
 			// calculate the normalization factor for all statistical values
@@ -228,33 +311,48 @@ namespace MathFit
 			if(!mAlpha.IsLUDecomposed())
 				mAlpha.LUDecomposition();
 			mAlpha.LUInverse();
+#elif defined(MATHFIT_USECHOLESKYDECOMPOSITION)
+			// if alpha isn't positive definite (numerically), fall back to the Gauss Jordan elimination
+			mBackupAlpha.Copy(mAlpha);
+			try
+			{
+				mAlpha.CholeskyDecomposition();
+				mAlpha.CholeskyInverse();
+			}
+			catch(CMatrixNotPositiveDefiniteException e)
+			{
+				mAlpha.Copy(mBackupAlpha);
+				mAlpha.Inverse();
+			}
+#elif defined(MATHFIT_USEQRDECOMPOSITION)
+			mAlpha.QRDecomposition();
+			mAlpha.QRInverse();
 #else
 			mAlpha.Inverse();
 #endif
 
 			// set the covariance matrix
-			CMatrix mCovar(iParams, iParams);
 			mCovar.Copy(mAlpha);
 			mModel.SetNonlinearCovarMatrix(mCovar);
 
 			// calculate the parameter errors
-			CVector vError(iParams);
+			mParamError.SetSize(iParams);
 			int i;
 			for(i = 0; i < iParams; i++)
-				vError.SetAt(i, (TFitData)sqrt(mCovar.GetAt(i, i)));
+				mParamError.SetAt(i, (TFitData)sqrt(mCovar.GetAt(i, i)));
 
 			// calculate the correlation matrix
-			CMatrix mCorrel(iParams, iParams);
+			mCorrel.SetSize(iParams, iParams);
 
 			int j;
 			for(i = 0; i < iParams; i++)
 				for(j = 0; j < iParams; j++)
-					mCorrel.SetAt(i, j, mCovar.GetAt(i, j) / (vError.GetAt(i) * vError.GetAt(j)));
+					mCorrel.SetAt(i, j, mCovar.GetAt(i, j) / (mParamError.GetAt(i) * mParamError.GetAt(j)));
 			mModel.SetNonlinearCorrelMatrix(mCorrel);
 
 			// now we have to 'normalize' the parameter errors to chi square.
-			vError.Mul(fNorm);
-			mModel.SetNonlinearError(vError);
+			mParamError.Mul(fNorm);
+			mModel.SetNonlinearError(mParamError);
 
 			return true;
 		}
@@ -280,44 +378,15 @@ namespace MathFit
 
 			mChiSquare = 0;
 
-			int i,j,k;
+			int i,j;
 
 			mDiff.SetSize(mFitRange.GetSize());
 			mModel.GetValues(mFitRange, mDiff);
-			CVector vError(mFitRange.GetSize());
-			mModel.GetFunctionErrors(mFitRange, vError);
+			mError.SetSize(mFitRange.GetSize());
+			mModel.GetFunctionErrors(mFitRange, mError);
 
-			// 1. LOOP
-			// =======
-			// summation over all data
-			const int iDiffSize = mDiff.GetSize();
-			for(i = 0; i < iDiffSize; i++)
-			{
-				// calculate the difference between the real y-values and the modelled y-values
-				TFitData fDifferenceInY = mDiff.GetAt(i) * mDiff.GetAt(i);
-
-				TFitData fSigmaSquare = vError.GetAt(i) * vError.GetAt(i);
-
-				// chiSquare
-				mChiSquare += fDifferenceInY / fSigmaSquare;
-
-				// 2. LOOP
-				// =======
-				// summation over all parameters
-				for(j = 0; j < iParamCount; j++)
-				{
-					TFitData fWT = mDyDa.GetAt(i, j) / fSigmaSquare;
-
-					// calculating coneAngle
-					mBeta.SetAt(j, mBeta.GetAt(j) + mDiff.GetAt(i) * fWT);
-
-					// 3. LOOP
-					// =======
-					// relevant only for alpha
-					for(k = 0; k <= j; k++)
-						mAlpha.SetAt(j, k, mAlpha.GetAt(j, k) + mDyDa.GetAt(i, k) * fWT);
-				} // end of second loop
-			} // end of first loop	 
+			// sum up the chi square, coneAngle and the lower triangle of alpha over all data
+			AccumulateNormalEquations(iParamCount);
 
 			// fill in the symmetric side of alpha and ensure that we do not have zeros on the diagonal. Otherwise
 			// the LEQ can't be solved!
@@ -337,6 +406,95 @@ namespace MathFit
 		}
 
 	private:
+		/**
+		* Calculates the chi square, the coneAngle vector and the lower triangle of the alpha matrix
+		* in one pass over the data.
+		*
+		* The data points are processed in blocks of ANALYZEBLOCKSIZE. The rows of DyDa in the
+		* block are first copied into a buffer where every row is contiguous, so that the inner
+		* loops over the parameters run over contiguous memory and can be vectorized by the compiler.
+		* Every element is summed up over the data points in the same order as before, so the result
+		* does not change.
+		*
+		* @param iParamCount	The number of nonlinear parameters.
+		*/
+		void AccumulateNormalEquations(const int iParamCount)
+		{
+			const int iDiffSize = mDiff.GetSize();
+
+			mAlphaSum.SetSize(iParamCount * iParamCount);
+			mAlphaSum.Zero();
+			mBetaSum.SetSize(iParamCount);
+			mBetaSum.Zero();
+			mWeightedRow.SetSize(iParamCount);
+			mDyDaBlock.SetSize(ANALYZEBLOCKSIZE * iParamCount);
+
+			TFitData* fAlpha = mAlphaSum.GetSafePtr();
+			TFitData* fBeta = mBetaSum.GetSafePtr();
+			TFitData* fWT = mWeightedRow.GetSafePtr();
+			TFitData* fBlock = mDyDaBlock.GetSafePtr();
+
+			int iBlockStart, i, j, k;
+			for(iBlockStart = 0; iBlockStart < iDiffSize; iBlockStart += ANALYZEBLOCKSIZE)
+			{
+				const int iBlockSize = min((int)ANALYZEBLOCKSIZE, iDiffSize - iBlockStart);
+
+				// copy the rows of DyDa in this block, column by column
+				for(j = 0; j < iParamCount; j++)
+					for(i = 0; i < iBlockSize; i++)
+						fBlock[i * iParamCount + j] = mDyDa.GetAt(iBlockStart + i, j);
+
+				for(i = 0; i < iBlockSize; i++)
+				{
+					const TFitData* fRow = &fBlock[i * iParamCount];
+					const TFitData fDiff = mDiff.GetAt(iBlockStart + i);
+					const TFitData fSigma = mError.GetAt(iBlockStart + i);
+
+					// calculate the difference between the real y-values and the modelled y-values
+					const TFitData fDifferenceInY = fDiff * fDiff;
+					const TFitData fSigmaSquare = fSigma * fSigma;
+
+					// chiSquare
+					mChiSquare += fDifferenceInY / fSigmaSquare;
+
+					// the weighted derivatives of this data point
+					for(j = 0; j < iParamCount; j++)
+						fWT[j] = fRow[j] / fSigmaSquare;
+
+					// coneAngle
+					for(j = 0; j < iParamCount; j++)
+						fBeta[j] += fDiff * fWT[j];
+
+					// lower triangle of alpha
+					for(j = 0; j < iParamCount; j++)
+					{
+						TFitData* fAlphaRow = &fAlpha[j * iParamCount];
+						const TFitData fWeight = fWT[j];
+						for(k = 0; k <= j; k++)
+							fAlphaRow[k] += fRow[k] * fWeight;
+					}
+				}
+			}
+
+			for(j = 0; j < iParamCount; j++)
+			{
+				mBeta.SetAt(j, fBeta[j]);
+				for(k = 0; k <= j; k++)
+					mAlpha.SetAt(j, k, fAlpha[j * iParamCount + k]);
+			}
+		}
+
+		/**
+		* Global defines.
+		*/
+		enum EDefines
+		{
+			/**
+			* The number of data points which are processed together in AccumulateNormalEquations.
+			*/
+			ANALYZEBLOCKSIZE = 64
+		};
+
 		/**
 		* Contains the coneAngle vector of the fit algorithm.
 		*/
@@ -358,10 +516,32 @@ namespace MathFit
 		*/
 		CMatrix mDyDa;
 		/**
+		* Buffers for the iterative solution improvement and for the covariance, correlation and
+		* parameter errors of the fit. These are members so that their memory is reused in every step of the fit, and
+		* from fit to fit as long as the fit object is kept.
+		*/
+		CVector mSolutionError;
+		CMatrix mBackupAlpha;
+		CMatrix mCovar;
+		CMatrix mCorrel;
+		CVector mParamError;
+		/**
+		* Buffers used by AccumulateNormalEquations: the sums of alpha (row by row) and coneAngle,
+		* the weighted derivatives of one data point and one block of DyDa rows.
+		*/
+		CVector mAlphaSum;
+		CVector mBetaSum;
+		CVector mWeightedRow;
+		CVector mDyDaBlock;
+		/**
 		* The current lambda value.
 		*/
 		TFitData mLambda;
 		/**
+		* The lambda value the next fit starts with, see \Ref{SetStartLambda}.
+		*/
+		TFitData mStartLambda;
+		/**
 		* The ChiSquare value of the last loop.
 		*/
 		TFitData mOldChiSquare;
@@ -74,6 +74,15 @@ namespace MathFit
 		CMatrixSingularException(int iLine, const char* szModule, const char* szName) : CFitException(iLine, szModule, szName, "Matrix is singular!") {}
 	};
 
+	/**
+	* Exception indicating that a matrix which should be Cholesky decomposed is not positive definite.
+	*/
+	class CMatrixNotPositiveDefiniteException : public CFitException
+	{
+	public:
+		CMatrixNotPositiveDefiniteException(int iLine, const char* szModule, const char* szName) : CFitException(iLine, szModule, szName, "Matrix is not positive definite!") {}
+	};
+
 	/**
 	* Exception indicating that the matrix is not a LU decomposed matrix.
 	*
@@ -113,16 +122,7 @@ namespace MathFit
 		*/
 		CMatrix()
 		{
-			mRows = NULL;
-			mCols = NULL;
-			mData = NULL;
-			mAutoRelease = true;
-			mSizeX = mSizeY = 0;
-			mLineOffset = 0;
-
-			mDoublePtr = NULL;
-			mFloatPtr = NULL;
-			mLUIndex = NULL;
+			Initialize();
 		}
 
 		/**
@@ -132,16 +132,7 @@ namespace MathFit
 		*/
 		CMatrix(const CMatrix &mRight)
 		{
-			mRows = NULL;
-			mCols = NULL;
-			mData = NULL;
-			mAutoRelease = true;
-			mSizeX = mSizeY = 0;
-			mLineOffset = 0;
-
-			mDoublePtr = NULL;
-			mFloatPtr = NULL;
-			mLUIndex = NULL;
+			Initialize();
 
 			Copy(mRight);
 		}
@@ -154,16 +145,7 @@ namespace MathFit
 		*/
 		CMatrix(int iCols, int iRows)
 		{
-			mRows = NULL;
-			mCols = NULL;
-			mData = NULL;
-			mAutoRelease = true;
-			mSizeX = mSizeY = 0;
-			mLineOffset = 0;
-
-			mDoublePtr = NULL;
-			mFloatPtr = NULL;
-			mLUIndex = NULL;
+			Initialize();
 
 			SetSize(iCols, iRows);
 		}
@@ -179,31 +161,19 @@ namespace MathFit
 		*/
 		CMatrix(CMatrix& mSecond, int iStartCol, int iStartRow, int iCols, int iRows)
 		{
-			MATHFIT_ASSERT((iStartCol + iCols) <= mSecond.GetNoColumns() && (iStartRow + iCols) <= mSecond.GetNoRows());
+			MATHFIT_ASSERT((iStartCol + iCols) <= mSecond.GetNoColumns() && (iStartRow + iRows) <= mSecond.GetNoRows());
 			MATHFIT_ASSERT(iCols > 0 && iRows > 0);
 
-			mDoublePtr = NULL;
-			mFloatPtr = NULL;
-			mLUIndex = NULL;
-
-			// create new vector array
-			mRows = new CVector[iRows];
-			mCols = new CVector[iCols];
+			Initialize();
 
-			// get the subvector objects and attach them to our objects
-			int i;
-			for(i = 0; i < iRows; i++)
-				mRows[i].Attach(mSecond.GetRow(iStartRow + i).SubVector(iStartCol, iCols));
-			for(i = 0; i < iCols; i++)
-				mCols[i].Attach(mSecond.GetCol(iStartCol + i).SubVector(iStartRow, iRows));
-
-			mData = mRows[0].GetSafePtr();
+			// the submatrix shares the data of the originating matrix
+			mData = &mSecond.GetSafePtr()[mSecond.Offset(iStartRow, iStartCol)];
 			mAutoRelease = false;
 
 			mSizeX = iCols;
 			mSizeY = iRows;
 
-			mLineOffset = max(mSecond.mSizeX, mSecond.mLineOffset);
+			mLineOffset = mSecond.mLineOffset;
 		}
 
 		/**
@@ -216,9 +186,15 @@ namespace MathFit
 			if(mCols)
 				delete[] mCols;
 			if(mData && mAutoRelease)
-				delete mData;
-			if(mLUIndex && mAutoRelease)
-				delete mLUIndex;
+				delete[] mData;
+			if(mLUIndex)
+				delete[] mLUIndex;
+			if(mQRCoeff)
+				delete[] mQRCoeff;
+			if(mWork)
+				delete[] mWork;
+			if(mIndexWork)
+				delete[] mIndexWork;
 
 			ReleaseDoublePtr();
 			ReleaseFloatPtr();
@@ -233,21 +209,26 @@ namespace MathFit
 		*/
 		CMatrix& Copy(const CMatrix& mOperand)
 		{
-			ClearLUDecomposed();
+			ClearDecomposition();
 
 			SetSize(mOperand.GetNoColumns(), mOperand.GetNoRows());
 
 			if(mSizeX <= 0 || mSizeY <= 0)
 				return *this;
 
-			memcpy(GetSafePtr(), mOperand.GetSafePtr(), sizeof(TFitData) * mSizeX * mSizeY);
-			if(mOperand.IsLUDecomposed())
+			if(IsContiguous() && mOperand.IsContiguous())
+				memcpy(GetSafePtr(), mOperand.GetSafePtr(), sizeof(TFitData) * mSizeX * mSizeY);
+			else
 			{
-				// okay. we also need to copy the LU index
-				mLUIndex = new int[GetNoColumns()];
-				memcpy(mLUIndex, mOperand.mLUIndex, sizeof(int) * GetNoColumns());
+				int i, j;
+				for(i = 0; i < mSizeY; i++)
+					for(j = 0; j < mSizeX; j++)
+						SetAt(i, j, mOperand.GetAt(i, j));
 			}
 
+			// okay. we also need to copy the state of the decomposition
+			CopyDecomposition(mOperand);
+
 			return *this;
 		}
 
@@ -323,20 +304,14 @@ namespace MathFit
 		CMatrix& Attach(CMatrix& mSecond, bool bAutoRelease = true)
 		{
 			// first clear the old data
-			if(mRows)
-				delete[] mRows;
-			if(mCols)
-				delete[] mCols;
 			if(mData && mAutoRelease)
-				delete mData;
-			if(mLUIndex && mAutoRelease)
-				delete mLUIndex;
+				delete[] mData;
+			ClearDecomposition();
+			InvalidateViews();
 
 			// get the data pointer
-			mRows = mSecond.mRows;
-			mCols = mSecond.mCols;
 			mData = mSecond.mData;
-			mLUIndex = mSecond.mLUIndex;
+			mCapacity = mSecond.mCapacity;
 			mSizeX = mSecond.mSizeX;
 			mSizeY = mSecond.mSizeY;
 			mLineOffset = mSecond.mLineOffset;
@@ -349,6 +324,9 @@ namespace MathFit
 			else
 				mAutoRelease = false;
 
+			// the data of the decomposition is not shared, every matrix keeps its own copy
+			CopyDecomposition(mSecond);
+
 			return *this;
 		}
 
@@ -363,41 +341,22 @@ namespace MathFit
 		CMatrix& Attach(TFitData* fData, int iRows, int iCols, bool bAutoRelease = true)
 		{
 			// first clear the old data
-			if(mRows)
-				delete[] mRows;
-			if(mCols)
-				delete[] mCols;
 			if(mData && mAutoRelease)
-				delete mData;
-			if(mLUIndex && mAutoRelease)
-				delete mLUIndex;
-			mLUIndex = NULL;
+				delete[] mData;
+			ClearDecomposition();
+			InvalidateViews();
 
 			// get the data pointer
 			mData = fData;
+			mCapacity = iCols * iRows;
 			mSizeX = iCols;
 			mSizeY = iRows;
 			mAutoRelease = bAutoRelease;
 
-			mRows = new CVector[mSizeY];
-			mCols = new CVector[mSizeX];
-
 #if defined(ROWMATRIX)
 			mLineOffset = mSizeX;
-
-			int i;
-			for(i = 0; i < mSizeY; i++)
-				mRows[i].Attach(&GetSafePtr()[i * mLineOffset], mSizeX, 1, false);
-			for(i = 0; i < mSizeX; i++)
-				mCols[i].Attach(&GetSafePtr()[i], mSizeY, mLineOffset, false);
 #else
 			mLineOffset = mSizeY;
-
-			int i;
-			for(i = 0; i < mSizeY; i++)
-				mRows[i].Attach(&GetSafePtr()[i], mSizeX, mLineOffset, false);
-			for(i = 0; i < mSizeX; i++)
-				mCols[i].Attach(&GetSafePtr()[i * mLineOffset], mSizeY, 1, false);
 #endif
 
 			return *this;
@@ -411,12 +370,13 @@ namespace MathFit
 		*/
 		CMatrix& Detach()
 		{
-			mRows = NULL;
-			mCols = NULL;
+			ClearDecomposition();
+			InvalidateViews();
+
 			mSizeX = mSizeY = 0;
 			mLineOffset = 0;
 			mData = NULL;
-			mLUIndex = NULL;
+			mCapacity = 0;
 			mAutoRelease = true;
 
 			ReleaseDoublePtr();
@@ -452,38 +412,29 @@ namespace MathFit
 		*/
 		CMatrix& Exchange(CMatrix& mSecond)
 		{
-			int iSizeX = mSecond.mSizeX;
-			int iSizeY = mSecond.mSizeY;
-			int iLineOffset = mSecond.mLineOffset;
-			CVector* vRows = mSecond.mRows;
-			CVector* vCols = mSecond.mCols;
-			TFitData* fData = mSecond.mData;
-			int* iLUIndex = mSecond.mLUIndex;
-			bool bAutoRelease = mSecond.mAutoRelease;
-			double* fDoublePtr = mSecond.mDoublePtr;
-			float* fFloatPtr = mSecond.mFloatPtr;
-
-			mSecond.mSizeX = mSizeX;
-			mSecond.mSizeY = mSizeY;
-			mSecond.mLineOffset = mLineOffset;
-			mSecond.mRows = mRows;
-			mSecond.mCols = mCols;
-			mSecond.mData = mData;
-			mSecond.mLUIndex = mLUIndex;
-			mSecond.mAutoRelease = mAutoRelease;
-			mSecond.mDoublePtr = mDoublePtr;
-			mSecond.mFloatPtr = mFloatPtr;
-
-			mSizeX = iSizeX;
-			mSizeY = iSizeY;
-			mLineOffset = iLineOffset;
-			mRows = vRows;
-			mCols = vCols;
-			mData = fData;
-			mLUIndex = iLUIndex;
-			mAutoRelease = bAutoRelease;
-			mDoublePtr = fDoublePtr;
-			mFloatPtr = fFloatPtr;
+			Swap(mSizeX, mSecond.mSizeX);
+			Swap(mSizeY, mSecond.mSizeY);
+			Swap(mLineOffset, mSecond.mLineOffset);
+			Swap(mRows, mSecond.mRows);
+			Swap(mCols, mSecond.mCols);
+			Swap(mRowCapacity, mSecond.mRowCapacity);
+			Swap(mColCapacity, mSecond.mColCapacity);
+			Swap(mRowsValid, mSecond.mRowsValid);
+			Swap(mColsValid, mSecond.mColsValid);
+			Swap(mData, mSecond.mData);
+			Swap(mCapacity, mSecond.mCapacity);
+			Swap(mAutoRelease, mSecond.mAutoRelease);
+			Swap(mLUIndex, mSecond.mLUIndex);
+			Swap(mLUCapacity, mSecond.mLUCapacity);
+			Swap(mQRCoeff, mSecond.mQRCoeff);
+			Swap(mQRCapacity, mSecond.mQRCapacity);
+			Swap(mDecomposition, mSecond.mDecomposition);
+			Swap(mWork, mSecond.mWork);
+			Swap(mWorkCapacity, mSecond.mWorkCapacity);
+			Swap(mIndexWork, mSecond.mIndexWork);
+			Swap(mIndexWorkCapacity, mSecond.mIndexWorkCapacity);
+			Swap(mDoublePtr, mSecond.mDoublePtr);
+			Swap(mFloatPtr, mSecond.mFloatPtr);
 
 			return *this;
 		}
@@ -493,20 +444,20 @@ namespace MathFit
 		*
 		* @param iFirst	The index of the first row.
 		* @param iSec		The index of the second row.
-		* 
+		*
 		* @return	A reference to the current object.
 		*/
 		CMatrix& ExchangeRows(int iFirst, int iSec)
 		{
-			// we need to physically copy the data. otherwise we get in trouble with some indicies
-			CVector& vFirst = GetRow(iFirst);
-			CVector& vSec = GetRow(iSec);
-
-			CVector vTemp(vFirst);
+			MATHFIT_ASSERT(iFirst >= 0 && iFirst < mSizeY && iSec >= 0 && iSec < mSizeY);
 
-			vFirst.Copy(vSec);
+			TFitData* fFirst = &mData[Offset(iFirst, 0)];
+			TFitData* fSec = &mData[Offset(iSec, 0)];
+			const int iStep = ColPitch();
 
-			vSec.Copy(vTemp);
+			int i;
+			for(i = 0; i < mSizeX; i++)
+				Swap(fFirst[i * iStep], fSec[i * iStep]);
 
 			return *this;
 		}
@@ -516,26 +467,28 @@ namespace MathFit
 		*
 		* @param iFirst	The index of the first column.
 		* @param iSec		The index of the second column.
-		* 
+		*
 		* @return	A reference to the current object.
 		*/
 		CMatrix& ExchangeCols(int iFirst, int iSec)
 		{
-			// we need to physically copy the data. otherwise we get in trouble with some indicies
-			CVector& vFirst = GetCol(iFirst);
-			CVector& vSec = GetCol(iSec);
-
-			CVector vTemp(vFirst);
+			MATHFIT_ASSERT(iFirst >= 0 && iFirst < mSizeX && iSec >= 0 && iSec < mSizeX);
 
-			vFirst.Copy(vSec);
+			TFitData* fFirst = &mData[Offset(0, iFirst)];
+			TFitData* fSec = &mData[Offset(0, iSec)];
+			const int iStep = RowPitch();
 
-			vSec.Copy(vTemp);
+			int i;
+			for(i = 0; i < mSizeY; i++)
+				Swap(fFirst[i * iStep], fSec[i * iStep]);
 
 			return *this;
 		}
 
 		/**
 		* Returns the desired row vector.
+		* The vector objects referencing the rows are only created when they are needed
+		* and they are kept until the matrix is resized.
 		*
 		* @param iRow	The row you want to access.
 		*
@@ -545,6 +498,22 @@ namespace MathFit
 		{
 			MATHFIT_ASSERT(iRow >= 0 && iRow < mSizeY);
 
+			if(!mRowsValid)
+			{
+				if(mRowCapacity < mSizeY)
+				{
+					if(mRows)
+						delete[] mRows;
+					mRows = new CVector[mSizeY];
+					mRowCapacity = mSizeY;
+				}
+
+				int i;
+				for(i = 0; i < mSizeY; i++)
+					mRows[i].Attach(&mData[Offset(i, 0)], mSizeX, ColPitch(), false);
+				mRowsValid = true;
+			}
+
 			return mRows[iRow];
 		}
 
@@ -552,6 +521,22 @@ namespace MathFit
 		{
 			MATHFIT_ASSERT(iCol >= 0 && iCol < mSizeX);
 
+			if(!mColsValid)
+			{
+				if(mColCapacity < mSizeX)
+				{
+					if(mCols)
+						delete[] mCols;
+					mCols = new CVector[mSizeX];
+					mColCapacity = mSizeX;
+				}
+
+				int i;
+				for(i = 0; i < mSizeX; i++)
+					mCols[i].Attach(&mData[Offset(0, i)], mSizeY, RowPitch(), false);
+				mColsValid = true;
+			}
+
 			return mCols[iCol];
 		}
 
@@ -662,8 +647,9 @@ namespace MathFit
 		}
 
 		/**
-		* Sets the size of the matrix. 
-		* If the matrxi needs to be resized the neccessary buffer is reallocated.
+		* Sets the size of the matrix.
+		* If the matrix needs to be resized the neccessary buffer is reallocated,
+		* unless the matrix owns a buffer which is large enough already.
 		*
 		* @param iXSize	The number of columns of the matrix.
 		* @param iYSize	The number of rows of the matrix.
@@ -674,44 +660,36 @@ namespace MathFit
 
 			if(iYSize != mSizeY || iXSize != mSizeX || !mData)
 			{
-				ClearLUDecomposed();
-
-				if(mRows)
-					delete[] mRows;
-				mRows = NULL;
-				if(mCols)
-					delete[] mCols;
-				mCols = NULL;
-				if(mData && mAutoRelease)
-					delete mData;
-				mData = NULL;
+				ClearDecomposition();
+				InvalidateViews();
+
+				const int iNewSize = iXSize * iYSize;
 
 				mSizeY = iYSize;
 				mSizeX = iXSize;
 
-				if(mSizeX <= 0 || mSizeY <= 0)
-					return;
+				// reuse our own buffer if it is large enough
+				if(!(mData && mAutoRelease && iNewSize > 0 && iNewSize <= mCapacity))
+				{
+					if(mData && mAutoRelease)
+						delete[] mData;
+					mData = NULL;
+					mCapacity = 0;
+
+					if(mSizeX <= 0 || mSizeY <= 0)
+						return;
+
+					mData = new TFitData[iNewSize];
+					mCapacity = iNewSize;
 
-				mRows = new CVector[iYSize];
-				mCols = new CVector[iXSize];
-				mData = new TFitData[iXSize * iYSize];
+					// indicate that we have created this data object
+					mAutoRelease = true;
+				}
 
 #if defined(ROWMATRIX)
 				mLineOffset = mSizeX;
-
-				int i;
-				for(i = 0; i < mSizeY; i++)
-					mRows[i].Attach(&GetSafePtr()[i * mLineOffset], mSizeX, 1, false);
-				for(i = 0; i < mSizeX; i++)
-					mCols[i].Attach(&GetSafePtr()[i], mSizeY, mLineOffset, false);
 #else
 				mLineOffset = mSizeY;
-
-				int i;
-				for(i = 0; i < mSizeY; i++)
-					mRows[i].Attach(&GetSafePtr()[i], mSizeX, mLineOffset, false);
-				for(i = 0; i < iXSize; i++)
-					mCols[i].Attach(&GetSafePtr()[i * mLineOffset], mSizeY, 1, false);
 #endif
 			}
 		}
@@ -749,7 +727,13 @@ namespace MathFit
 
 			int i;
 			for(i = 0; i < mSizeY; i++, fVal += fRowSlope)
-				GetRow(i).Wedge(fVal, fColSlope);
+			{
+				TFitData fColVal = fVal;
+
+				int j;
+				for(j = 0; j < mSizeX; j++, fColVal += fColSlope)
+					SetAt(i, j, fColVal);
+			}
 
 			return *this;
 		}
@@ -765,9 +749,14 @@ namespace MathFit
 		{
 			MATHFIT_ASSERT(mSizeY == mOperant.GetNoRows() && mSizeX == mOperant.GetNoColumns());
 
-			int i;
-			for(i = 0; i < mSizeY; i++)
-				GetRow(i).Add(mOperant.GetRow(i));
+			int iLine, i;
+			for(iLine = 0; iLine < GetNoLines(); iLine++)
+			{
+				TFitData* fLine = &mData[iLine * mLineOffset];
+				const TFitData* fOpLine = &mOperant.mData[iLine * mOperant.mLineOffset];
+				for(i = 0; i < GetLineLength(); i++)
+					fLine[i] = fLine[i] + fOpLine[i];
+			}
 
 			return *this;
 		}
@@ -783,9 +772,14 @@ namespace MathFit
 		{
 			MATHFIT_ASSERT(mSizeY == mOperant.GetNoRows() && mSizeX == mOperant.GetNoColumns());
 
-			int i;
-			for(i = 0; i < mSizeY; i++)
-				GetRow(i).Sub(mOperant.GetRow(i));
+			int iLine, i;
+			for(iLine = 0; iLine < GetNoLines(); iLine++)
+			{
+				TFitData* fLine = &mData[iLine * mLineOffset];
+				const TFitData* fOpLine = &mOperant.mData[iLine * mOperant.mLineOffset];
+				for(i = 0; i < GetLineLength(); i++)
+					fLine[i] = fLine[i] - fOpLine[i];
+			}
 
 			return *this;
 		}
@@ -801,24 +795,30 @@ namespace MathFit
 		{
 			MATHFIT_ASSERT(mSizeY == mOperant.GetNoColumns() && mSizeX == mOperant.GetNoRows());
 
-			CMatrix mRes(mSizeY, mSizeY);
+			const int iN = mSizeY;
+
+			// calculate the product in the workspace and copy it back afterwards
+			TFitData* fRes = GetWorkspace(iN * iN);
 
 			int i, j;
-			for(i = 0; i < mSizeY; i++)
-				for(j = 0; j < mSizeY; j++)
+			for(i = 0; i < iN; i++)
+				for(j = 0; j < iN; j++)
 				{
 					int k;
 					TFitData fSum = 0;
 					for(k = 0; k < mSizeX; k++)
 						fSum += GetAt(i, k) * mOperant.GetAt(k, j);
-					mRes.SetAt(i, j, fSum);
+					fRes[i * iN + j] = fSum;
 				}
 
-				// get data from temporary object
-				Attach(mRes);
-				mRes.Detach();
+			SetSize(iN, iN);
+			ClearDecomposition();
 
-				return *this;
+			for(i = 0; i < iN; i++)
+				for(j = 0; j < iN; j++)
+					SetAt(i, j, fRes[i * iN + j]);
+
+			return *this;
 		}
 
 		/**
@@ -832,7 +832,7 @@ namespace MathFit
 		{
 			MATHFIT_ASSERT(mSizeX == mOperant.GetSize());
 
-			CVector vTemp(mSizeY);
+			TFitData* fRes = GetWorkspace(mSizeY);
 
 			int i, j;
 			for(i = 0; i < mSizeY; i++)
@@ -840,11 +840,12 @@ namespace MathFit
 				TFitData fSum = 0;
 				for(j = 0; j < mSizeX; j++)
 					fSum += GetAt(i, j) * mOperant.GetAt(j);
-				vTemp.SetAt(i, fSum);
+				fRes[i] = fSum;
 			}
 
-			mOperant.Attach(vTemp);
-			vTemp.Detach();
+			mOperant.SetSize(mSizeY);
+			for(i = 0; i < mSizeY; i++)
+				mOperant.SetAt(i, fRes[i]);
 
 			return mOperant;
 		}
@@ -872,9 +873,13 @@ namespace MathFit
 		*/
 		CMatrix& Add(TFitData fOperant)
 		{
-			int i;
-			for(i = 0; i < mSizeY; i++)
-				GetRow(i).Add(fOperant);
+			int iLine, i;
+			for(iLine = 0; iLine < GetNoLines(); iLine++)
+			{
+				TFitData* fLine = &mData[iLine * mLineOffset];
+				for(i = 0; i < GetLineLength(); i++)
+					fLine[i] = fLine[i] + fOperant;
+			}
 
 			return *this;
 		}
@@ -888,9 +893,13 @@ namespace MathFit
 		*/
 		CMatrix& Sub(TFitData fOperant)
 		{
-			int i;
-			for(i = 0; i < mSizeY; i++)
-				GetRow(i).Sub(fOperant);
+			int iLine, i;
+			for(iLine = 0; iLine < GetNoLines(); iLine++)
+			{
+				TFitData* fLine = &mData[iLine * mLineOffset];
+				for(i = 0; i < GetLineLength(); i++)
+					fLine[i] = fLine[i] - fOperant;
+			}
 
 			return *this;
 		}
@@ -904,9 +913,13 @@ namespace MathFit
 		*/
 		CMatrix& Mul(TFitData fOperant)
 		{
-			int i;
-			for(i = 0; i < mSizeY; i++)
-				GetRow(i).Mul(fOperant);
+			int iLine, i;
+			for(iLine = 0; iLine < GetNoLines(); iLine++)
+			{
+				TFitData* fLine = &mData[iLine * mLineOffset];
+				for(i = 0; i < GetLineLength(); i++)
+					fLine[i] = fLine[i] * fOperant;
+			}
 
 			return *this;
 		}
@@ -920,9 +933,13 @@ namespace MathFit
 		*/
 		CMatrix& Div(TFitData fOperant)
 		{
-			int i;
-			for(i = 0; i < mSizeY; i++)
-				GetRow(i).Div(fOperant);
+			int iLine, i;
+			for(iLine = 0; iLine < GetNoLines(); iLine++)
+			{
+				TFitData* fLine = &mData[iLine * mLineOffset];
+				for(i = 0; i < GetLineLength(); i++)
+					fLine[i] = fLine[i] / fOperant;
+			}
 
 			return *this;
 		}
@@ -939,9 +956,14 @@ namespace MathFit
 		{
 			MATHFIT_ASSERT(mSizeY == mOperant.GetNoRows() && mSizeX == mOperant.GetNoColumns());
 
-			int i;
-			for(i = 0; i < mSizeY; i++)
-				GetRow(i).Add(mOperant.GetRow(i), fFactor);
+			int iLine, i;
+			for(iLine = 0; iLine < GetNoLines(); iLine++)
+			{
+				TFitData* fLine = &mData[iLine * mLineOffset];
+				const TFitData* fOpLine = &mOperant.mData[iLine * mOperant.mLineOffset];
+				for(i = 0; i < GetLineLength(); i++)
+					fLine[i] = fLine[i] + fFactor * fOpLine[i];
+			}
 
 			return *this;
 		}
@@ -958,9 +980,14 @@ namespace MathFit
 		{
 			MATHFIT_ASSERT(mSizeY == mOperant.GetNoRows() && mSizeX == mOperant.GetNoColumns());
 
-			int i;
-			for(i = 0; i < mSizeY; i++)
-				GetRow(i).Sub(mOperant.GetRow(i), fFactor);
+			int iLine, i;
+			for(iLine = 0; iLine < GetNoLines(); iLine++)
+			{
+				TFitData* fLine = &mData[iLine * mLineOffset];
+				const TFitData* fOpLine = &mOperant.mData[iLine * mOperant.mLineOffset];
+				for(i = 0; i < GetLineLength(); i++)
+					fLine[i] = fLine[i] - fFactor * fOpLine[i];
+			}
 
 			return *this;
 		}
@@ -1131,118 +1158,19 @@ namespace MathFit
 		*
 		* @return A reference to the given matrix object.
 		*
-		* @exception CVectorSizeMismatch 
-		* @exception CMatrixSolveFailed 
+		* @exception CVectorSizeMismatch
+		* @exception CMatrixSolveFailed
 		* @exception CMatrixNotSquare
 		*/
 		CMatrix& GaussJordanSolve(CMatrix& mBeta)
 		{
-			const int iCols = GetNoColumns();
-			const int iRows = GetNoRows();
-
-			if(iCols != iRows)
+			if(GetNoColumns() != GetNoRows())
 				throw(EXCEPTION(CMatrixNotSquareException));
 
-			if(iRows != mBeta.GetNoRows())
+			if(GetNoRows() != mBeta.GetNoRows())
 				throw(EXCEPTION(CVectorSizeMismatchException));
 
-			int* iIndexCol = new int[iCols];
-			memset(iIndexCol, 0, sizeof(int) * iCols);
-			int* iIndexRow = new int[iRows];
-			memset(iIndexRow, 0, sizeof(int) * iRows);
-			int* iPivotDone = new int[iCols];
-			memset(iPivotDone, 0, sizeof(int) * iCols);
-			int iR, iC;
-
-			int i, j;
-			for(i = 0; i < iCols; i++)
-			{
-				// find pivot
-				iR = iC = i;
-				TFitData fMag = 0;
-				for(j = 0; j < iRows; j++)
-				{
-					if(iPivotDone[j] != 1)
-					{
-						int k;
-						for(k = 0; k < iRows; k++)
-						{
-							if(iPivotDone[k] == 0)
-							{
-								if(fabs(GetAt(j, k)) >= fMag)
-								{
-									fMag = (TFitData)fabs(GetAt(j, k));
-									iR = j;
-									iC = k;
-								}
-							}
-							else if(iPivotDone[k] > 1)
-							{
-								// this pivot was selected more than once. Shit!!
-								delete(iPivotDone);
-								delete(iIndexRow);
-								delete(iIndexCol);
-
-								throw(EXCEPTION(CMatrixSolveFailedException));
-							}
-						}
-					}
-				}
-				iPivotDone[iC]++;
-
-				// move pivot row into position
-				if(iR != iC)
-				{
-					ExchangeRows(iR, iC);
-					mBeta.ExchangeRows(iR, iC);
-				}	
-
-				// store indices
-				iIndexRow[i] = iR;
-				iIndexCol[i] = iC;
-
-				// get scaling of pivot row
-				fMag = GetAt(iC, iC);
-
-				// no pivot: error
-				if(fMag == 0)
-				{
-					// zero pivot => not a singular matrix
-					delete(iPivotDone);
-					delete(iIndexRow);
-					delete(iIndexCol);
-
-					throw(EXCEPTION(CMatrixSolveFailedException));
-				}
-
-				SetAt(iC, iC, 1);
-				GetRow(iC).Div(fMag);
-				mBeta.GetRow(iC).Div(fMag);
-
-				// eliminate pivot row component from other rows
-				int i2;
-				for(i2 = 0; i2 < iRows; i2++)
-				{
-					if(i2 == iC)
-						continue;
-
-					// get factor to eliminate pivot column
-					TFitData fMag2 = GetAt(i2, iC);
-					SetAt(i2, iC, 0);
-					GetRow(i2).Sub(GetRow(iC), fMag2);
-					mBeta.GetRow(i2).Sub(mBeta.GetRow(iC), fMag2);
-				}
-			}
-
-			// reorder matrix
-			int l;
-			for(l = iRows - 1; l >= 0; l--)
-				if(iIndexRow[l] != iIndexCol[l])
-					ExchangeCols(iIndexRow[l], iIndexCol[l]);
-
-			delete(iPivotDone);
-			delete(iIndexRow);
-			delete(iIndexCol);
+			GaussJordanSolve(mBeta.GetSafePtr(), mBeta.GetNoColumns(), mBeta.RowPitch(), mBeta.ColPitch());
 
 			return mBeta;
 		}
@@ -1263,14 +1191,14 @@ namespace MathFit
 		*/
 		CVector& GaussJordanSolve(CVector& vBeta)
 		{
-			MATHFIT_ASSERT(vBeta.GetStepSize() == 1);
+			if(GetNoColumns() != GetNoRows())
+				throw(EXCEPTION(CMatrixNotSquareException));
 
-			// attach the vector to a matrix object with just a single column
-			CMatrix mBeta; 
-			mBeta.Attach(vBeta.GetSafePtr(), vBeta.GetSize(), 1, false);
+			if(GetNoRows() != vBeta.GetSize())
+				throw(EXCEPTION(CVectorSizeMismatchException));
 
-			// die geschichte lsen lassen
-			GaussJordanSolve(mBeta);
+			// the vector is solved as a matrix with just a single column
+			GaussJordanSolve(vBeta.GetSafePtr(), 1, vBeta.GetStepSize(), 0);
 
 			return vBeta;
 		}
@@ -1284,13 +1212,14 @@ namespace MathFit
 		{
 			MATHFIT_ASSERT(mSizeX == mSizeY);
 
-			CMatrix mResult;
+			if(GetNoColumns() != GetNoRows())
+				throw(EXCEPTION(CMatrixNotSquareException));
 
-			// create idendity matrix
-			mResult.SetSize(1, mSizeY);
+			// solve the LES with a dummy right hand side
+			TFitData* fBeta = GetWorkspace(mSizeY);
+			memset(fBeta, 0, sizeof(TFitData) * mSizeY);
 
-			// solve the LES
-			GaussJordanSolve(mResult);
+			GaussJordanSolve(fBeta, 1, 1, 0);
 
 			return *this;
 		}
@@ -1304,17 +1233,16 @@ namespace MathFit
 		{
 			MATHFIT_ASSERT(mData != NULL);
 
-			ClearLUDecomposed();
+			ClearDecomposition();
 
-#if defined(ROWMATRIX)
-			int i;
-			for(i = 0; i < mSizeY; i++)
-				GetRow(i).Zero();
-#else
-			int i;
-			for(i = 0; i < mSizeX; i++)
-				GetCol(i).Zero();
-#endif
+			if(IsContiguous())
+				memset(mData, 0, sizeof(TFitData) * mSizeX * mSizeY);
+			else
+			{
+				int iLine;
+				for(iLine = 0; iLine < GetNoLines(); iLine++)
+					memset(&mData[iLine * mLineOffset], 0, sizeof(TFitData) * GetLineLength());
+			}
 
 			return *this;
 		}
@@ -1326,10 +1254,14 @@ namespace MathFit
 		*/
 		bool IsZero() const
 		{
-			int i;
-			for(i = 0; i < mSizeY; i++)
-				if(!GetRow(i).IsZero())
-					return false;
+			int iLine, i;
+			for(iLine = 0; iLine < GetNoLines(); iLine++)
+			{
+				const TFitData* fLine = &mData[iLine * mLineOffset];
+				for(i = 0; i < GetLineLength(); i++)
+					if(fLine[i] != 0.0)
+						return false;
+			}
 
 			return true;
 		}
@@ -1341,15 +1273,23 @@ namespace MathFit
 		*/
 		CMatrix& Transpose()
 		{
-			CMatrix mNew(mSizeY, mSizeX);
+			const int iCols = mSizeX;
+			const int iRows = mSizeY;
+
+			// keep a copy of the elements in the workspace while the matrix changes shape
+			TFitData* fOld = GetWorkspace(iCols * iRows);
 
 			int iRow, iCol;
-			for(iRow = 0; iRow < mSizeY; iRow++)
-				for(iCol = 0; iCol < mSizeX; iCol++)
-					mNew.SetAt(iCol, iRow, GetAt(iRow, iCol));
+			for(iRow = 0; iRow < iRows; iRow++)
+				for(iCol = 0; iCol < iCols; iCol++)
+					fOld[iRow * iCols + iCol] = GetAt(iRow, iCol);
 
-			Attach(mNew);
-			mNew.Detach();
+			SetSize(iRows, iCols);
+			ClearDecomposition();
+
+			for(iRow = 0; iRow < iRows; iRow++)
+				for(iCol = 0; iCol < iCols; iCol++)
+					SetAt(iCol, iRow, fOld[iRow * iCols + iCol]);
 
 			return *this;
 		}
@@ -1363,30 +1303,34 @@ namespace MathFit
 		*/
 		CMatrix& PseudoInverse()
 		{
-			CMatrix mNew(mSizeX, mSizeX);
+			const int iN = mSizeX;
+			TFitData* fNew = GetWorkspace(iN * iN);
 
 			// fill in the upper diagonal matrix
 
 			int iRow, iCol;
-			for(iRow = 0; iRow < mSizeX; iRow++)
-				for(iCol = iRow; iCol < mSizeX; iCol++)
+			for(iRow = 0; iRow < iN; iRow++)
+				for(iCol = iRow; iCol < iN; iCol++)
 				{
 					TFitData fSum = 0;
 					int k;
 					for(k = 0; k < mSizeY; k++)
 						fSum += GetAt(k, iRow) * GetAt(k, iCol);
-					mNew.SetAt(iRow, iCol, fSum);
+					fNew[iRow * iN + iCol] = fSum;
 				}
 
-				// now we have to fill in the lowe matrix
-				for(iRow = 0; iRow < mSizeX; iRow++)
-					for(iCol = iRow; iCol < mSizeX; iCol++)
-						mNew.SetAt(iCol, iRow, mNew.GetAt(iRow, iCol));
+			SetSize(iN, iN);
+			ClearDecomposition();
 
-				Attach(mNew);
-				mNew.Detach();
+			// copy the result and fill in the lower matrix
+			for(iRow = 0; iRow < iN; iRow++)
+				for(iCol = iRow; iCol < iN; iCol++)
+				{
+					SetAt(iRow, iCol, fNew[iRow * iN + iCol]);
+					SetAt(iCol, iRow, fNew[iRow * iN + iCol]);
+				}
 
-				return *this;
+			return *this;
 		}
 
 		/**
@@ -1401,29 +1345,24 @@ namespace MathFit
 
 			int i, iMax, j, k;
 			int iN = GetNoColumns();
-			TFitData fBig, fDum, fSum, fTemp;	
+			TFitData fBig, fDum, fSum, fTemp;
 
-			if(mLUIndex && mAutoRelease)
-				delete mLUIndex;
-			mLUIndex = new int[iN];
-			CVector vV(iN);
+			ClearDecomposition();
+			int* iLUIndex = GetLUIndex(iN);
+			TFitData* fV = GetWorkspace(iN);
 
 			iMax = 0;
 			for(i = 0; i < iN; i++)
 			{
 				fBig = 0.0;
 				for(j = 0; j < iN; j++)
-					if((fTemp = (TFitData)fabs(GetAt(j, i))) > fBig) 
+					if((fTemp = (TFitData)fabs(GetAt(j, i))) > fBig)
 						fBig = fTemp;
 				if(fBig == 0.0)
-				{
-					delete mLUIndex;
-					mLUIndex = NULL;
 					throw(EXCEPTION(CMatrixSingularException));
-				}
 
 				// No nonzero largest element
-				vV.SetAt(i, (TFitData)1.0 / fBig);
+				fV[i] = (TFitData)1.0 / fBig;
 			}
 
 			for(j = 0; j < iN; j++)
@@ -1431,7 +1370,7 @@ namespace MathFit
 				for(i = 0; i < j; i++)
 				{
 					fSum = GetAt(i, j);
-					for(k = 0; k < i; k++) 
+					for(k = 0; k < i; k++)
 						fSum -= GetAt(i, k) * GetAt(k, j);
 					SetAt(i, j, fSum);
 				}
@@ -1440,10 +1379,10 @@ namespace MathFit
 				for(i = j; i < iN; i++)
 				{
 					fSum = GetAt(i, j);
-					for(k = 0; k < j; k++) 
+					for(k = 0; k < j; k++)
 						fSum -= GetAt(i, k) * GetAt(k, j);
 					SetAt(i, j, fSum);
-					if((fDum = vV.GetAt(i) * (TFitData)fabs(fSum)) >= fBig)
+					if((fDum = fV[i] * (TFitData)fabs(fSum)) >= fBig)
 					{
 						fBig = fDum;
 						iMax = i;
@@ -1459,25 +1398,26 @@ namespace MathFit
 						SetAt(j, k, fDum);
 					}
 
-					vV.SetAt(iMax, vV.GetAt(j));
+					fV[iMax] = fV[j];
 				}
 
-				mLUIndex[j] = iMax;
+				iLUIndex[j] = iMax;
 				if((GetAt(j, j)) == 0.0)
 					SetAt(j, j, MATHFIT_NEARLYZERO);
 
 				if(j != iN - 1)
 				{
 					fDum = (TFitData)1.0 / GetAt(j, j);
-					for(i = j + 1; i < iN; i++) 
+					for(i = j + 1; i < iN; i++)
 						SetAt(i, j, GetAt(i, j) * fDum);
 				}
 			}
 
+			mDecomposition = LUDECOMPOSED;
+
 			return *this;
 		}
 
-
 		/**
 		* Solves the linear equation.
 		* Given the decomposed matrix returned by LUDecomposition the linear equation system is solved, 
@@ -1536,19 +1476,379 @@ namespace MathFit
 		{
 			MATHFIT_ASSERT(IsLUDecomposed());
 
-			int iN, j;
+			int iN, i, j;
 			iN = GetNoColumns();
 
-			CMatrix mResult(iN, iN);
-			mResult.Zero();
+			// the columns of the inverse are built up in the workspace
+			TFitData* fResult = GetWorkspace(iN * iN);
+			memset(fResult, 0, sizeof(TFitData) * iN * iN);
 
+			CVector vColumn;
 			for(j = 0; j < iN; j++)
 			{
-				mResult.SetAt(j, j, 1.0);
-				LUBacksubstitution(mResult.GetCol(j));
+				fResult[j * iN + j] = 1.0;
+				vColumn.Attach(&fResult[j * iN], iN, 1, false);
+				LUBacksubstitution(vColumn);
 			}
-			Attach(mResult);
-			mResult.Detach();
+			vColumn.Detach();
+
+			ClearDecomposition();
+
+			for(j = 0; j < iN; j++)
+				for(i = 0; i < iN; i++)
+					SetAt(i, j, fResult[j * iN + i]);
+
+			return *this;
+		}
+
+		/**
+		* Decomposes the symmetric positive definite matrix into the product of a lower triangular matrix
+		* and its transposed (Cholesky decomposition). This needs about half the operations of the LU decomposition.
+		* Only the lower triangle of the matrix is used. After the decomposition the lower triangle holds the factor
+		* and the upper triangle is cleared.
+		*
+		* @return A reference to the current matrix object that now holds the lower triangular factor.
+		*
+		* @exception CMatrixNotSquare
+		* @exception CMatrixNotPositiveDefinite
+		*/
+		CMatrix& CholeskyDecomposition()
+		{
+			if(GetNoColumns() != GetNoRows())
+				throw(EXCEPTION(CMatrixNotSquareException));
+
+			ClearDecomposition();
+
+			const int iN = GetNoColumns();
+			int i, j, k;
+			TFitData fSum;
+
+			for(j = 0; j < iN; j++)
+			{
+				fSum = GetAt(j, j);
+				for(k = 0; k < j; k++)
+					fSum -= GetAt(j, k) * GetAt(j, k);
+
+				// a pivot which is not positive (or not a number) means the matrix isn't positive definite
+				if(!(fSum > 0))
+					throw(EXCEPTION(CMatrixNotPositiveDefiniteException));
+
+				const TFitData fDiag = (TFitData)sqrt(fSum);
+				SetAt(j, j, fDiag);
+
+				for(i = j + 1; i < iN; i++)
+				{
+					fSum = GetAt(i, j);
+					for(k = 0; k < j; k++)
+						fSum -= GetAt(i, k) * GetAt(j, k);
+					SetAt(i, j, fSum / fDiag);
+					SetAt(j, i, 0);
+				}
+			}
+
+			mDecomposition = CHOLESKYDECOMPOSED;
+
+			return *this;
+		}
+
+		/**
+		* Solves the linear equation system using the Cholesky decomposed matrix.
+		*
+		* @param vResult	The (b) part of the LES, that will receive the result.
+		*
+		* @return A reference to the vector object.
+		*/
+		CVector& CholeskyBacksubstitution(CVector& vResult)
+		{
+			MATHFIT_ASSERT(IsCholeskyDecomposed());
+
+			const int iN = GetNoColumns();
+			int i, k;
+			TFitData fSum;
+
+			// solve L*y=b
+			for(i = 0; i < iN; i++)
+			{
+				fSum = vResult.GetAt(i);
+				for(k = 0; k < i; k++)
+					fSum -= GetAt(i, k) * vResult.GetAt(k);
+				vResult.SetAt(i, fSum / GetAt(i, i));
+			}
+
+			// solve Lt*x=y
+			for(i = iN - 1; i >= 0; i--)
+			{
+				fSum = vResult.GetAt(i);
+				for(k = i + 1; k < iN; k++)
+					fSum -= GetAt(k, i) * vResult.GetAt(k);
+				vResult.SetAt(i, fSum / GetAt(i, i));
+			}
+
+			return vResult;
+		}
+
+		/**
+		* Calculates the inverse of the Cholesky decomposed matrix.
+		* Only the triangular factor is inverted, the inverse is then the product of the transposed
+		* inverted factor with the inverted factor. The decomposed matrix is no longer available afterwards.
+		*
+		* @return A reference to the current matrix object that now holds the inverse.
+		*/
+		CMatrix& CholeskyInverse()
+		{
+			MATHFIT_ASSERT(IsCholeskyDecomposed());
+
+			const int iN = GetNoColumns();
+			int i, j, k;
+			TFitData fSum;
+
+			// invert the lower triangular factor row by row into the workspace
+			TFitData* fInv = GetWorkspace(iN * iN);
+			memset(fInv, 0, sizeof(TFitData) * iN * iN);
+
+			for(j = 0; j < iN; j++)
+			{
+				fInv[j * iN + j] = (TFitData)1.0 / GetAt(j, j);
+				for(i = j + 1; i < iN; i++)
+				{
+					fSum = 0;
+					for(k = j; k < i; k++)
+						fSum -= GetAt(i, k) * fInv[k * iN + j];
+					fInv[i * iN + j] = fSum / GetAt(i, i);
+				}
+			}
+
+			ClearDecomposition();
+
+			// the inverse is symmetric, so only one triangle has to be calculated
+			for(i = 0; i < iN; i++)
+				for(j = 0; j <= i; j++)
+				{
+					fSum = 0;
+					for(k = i; k < iN; k++)
+						fSum += fInv[k * iN + i] * fInv[k * iN + j];
+					SetAt(i, j, fSum);
+					SetAt(j, i, fSum);
+				}
+
+			return *this;
+		}
+
+		/**
+		* Decomposes the matrix into the product of an orthogonal matrix Q and an upper triangular matrix R
+		* using Householder reflections.
+		* The matrix may have more rows than columns. In this case the decomposition solves the linear least square
+		* problem directly, without building the normal equations (At*A) whose condition is the square of the
+		* condition of the matrix itself. This is more robust for matrices with strongly correlated columns.
+		*
+		* After the decomposition the upper triangle holds R without its diagonal and the lower triangle, including the
+		* diagonal, holds the Householder vectors. The diagonal of R is kept separately.
+		*
+		* The algorithm is based on the QR decomposition from Numerical Recipes in C, p. 98-100
+		*
+		* @return A reference to the current matrix object that now holds the decomposition.
+		*
+		* @exception CMatrixSizeMismatch	If the matrix has less rows than columns.
+		* @exception CMatrixSingular
+		*/
+		CMatrix& QRDecomposition()
+		{
+			const int iRows = GetNoRows();
+			const int iCols = GetNoColumns();
+
+			if(iRows < iCols)
+				throw(EXCEPTION(CMatrixSizeMismatchException));
+
+			ClearDecomposition();
+
+			TFitData* fDiag = GetQRCoefficients(2 * iCols);
+			TFitData* fNorm = fDiag + iCols;
+
+			int i, j, k;
+			TFitData fScale, fSum, fSigma, fTau;
+
+			for(k = 0; k < iCols; k++)
+			{
+				// scale the column to avoid over- and underflows
+				fScale = 0;
+				for(i = k; i < iRows; i++)
+					fScale = max(fScale, (TFitData)fabs(GetAt(i, k)));
+				if(fScale == 0.0)
+					throw(EXCEPTION(CMatrixSingularException));
+
+				fSum = 0;
+				for(i = k; i < iRows; i++)
+				{
+					SetAt(i, k, GetAt(i, k) / fScale);
+					fSum += GetAt(i, k) * GetAt(i, k);
+				}
+
+				fSigma = (TFitData)sqrt(fSum);
+				if(GetAt(k, k) < 0)
+					fSigma = -fSigma;
+
+				SetAt(k, k, GetAt(k, k) + fSigma);
+				fNorm[k] = fSigma * GetAt(k, k);
+				fDiag[k] = -fScale * fSigma;
+
+				// apply the reflection to the remaining columns
+				for(j = k + 1; j < iCols; j++)
+				{
+					fSum = 0;
+					for(i = k; i < iRows; i++)
+						fSum += GetAt(i, k) * GetAt(i, j);
+					fTau = fSum / fNorm[k];
+					for(i = k; i < iRows; i++)
+						SetAt(i, j, GetAt(i, j) - fTau * GetAt(i, k));
+				}
+			}
+
+			mDecomposition = QRDECOMPOSED;
+
+			return *this;
+		}
+
+		/**
+		* Solves the linear equation system using the QR decomposed matrix. If the matrix has more rows than
+		* columns the solution of the linear least square problem is returned.
+		*
+		* @param vB			The (b) part of the LES. It will be overwritten with Qt*b.
+		* @param vResult	Receives the result. This may be the same object as vB if the matrix is square.
+		*
+		* @return A reference to the result vector.
+		*
+		* @exception CVectorSizeMismatch
+		*/
+		CVector& QRBacksubstitution(CVector& vB, CVector& vResult)
+		{
+			MATHFIT_ASSERT(IsQRDecomposed());
+
+			const int iRows = GetNoRows();
+			const int iCols = GetNoColumns();
+
+			if(vB.GetSize() != iRows)
+				throw(EXCEPTION(CVectorSizeMismatchException));
+
+			const TFitData* fDiag = mQRCoeff;
+			const TFitData* fNorm = mQRCoeff + iCols;
+
+			int i, j;
+			TFitData fSum, fTau;
+
+			// form Qt*b
+			for(j = 0; j < iCols; j++)
+			{
+				fSum = 0;
+				for(i = j; i < iRows; i++)
+					fSum += GetAt(i, j) * vB.GetAt(i);
+				fTau = fSum / fNorm[j];
+				for(i = j; i < iRows; i++)
+					vB.SetAt(i, vB.GetAt(i) - fTau * GetAt(i, j));
+			}
+
+			// solve R*x=Qt*b
+			if(&vResult != &vB)
+				vResult.SetSize(iCols);
+			MATHFIT_ASSERT(vResult.GetSize() == iCols);
+
+			for(i = iCols - 1; i >= 0; i--)
+			{
+				fSum = vB.GetAt(i);
+				for(j = i + 1; j < iCols; j++)
+					fSum -= GetAt(i, j) * vResult.GetAt(j);
+				vResult.SetAt(i, fSum / fDiag[i]);
+			}
+
+			return vResult;
+		}
+
+		/**
+		* Calculates the inverse of the square QR decomposed matrix.
+		* The decomposed matrix is no longer available afterwards.
+		*
+		* @return A reference to the current matrix object that now holds the inverse.
+		*
+		* @exception CMatrixNotSquare
+		*/
+		CMatrix& QRInverse()
+		{
+			MATHFIT_ASSERT(IsQRDecomposed());
+
+			if(GetNoColumns() != GetNoRows())
+				throw(EXCEPTION(CMatrixNotSquareException));
+
+			int iN, i, j;
+			iN = GetNoColumns();
+
+			// the columns of the inverse are built up in the workspace
+			TFitData* fResult = GetWorkspace(iN * iN);
+			memset(fResult, 0, sizeof(TFitData) * iN * iN);
+
+			CVector vColumn;
+			for(j = 0; j < iN; j++)
+			{
+				fResult[j * iN + j] = 1.0;
+				vColumn.Attach(&fResult[j * iN], iN, 1, false);
+				QRBacksubstitution(vColumn, vColumn);
+			}
+			vColumn.Detach();
+
+			ClearDecomposition();
+
+			for(j = 0; j < iN; j++)
+				for(i = 0; i < iN; i++)
+					SetAt(i, j, fResult[j * iN + i]);
+
+			return *this;
+		}
+
+		/**
+		* Calculates the inverse of (At*A) from the R factor of the QR decomposed matrix A.
+		* This is the covariance matrix of the linear least square problem, it is obtained without
+		* building and inverting the normal equations.
+		* The matrix is resized to a square matrix with the number of columns of A and the decomposed
+		* matrix is no longer available afterwards.
+		*
+		* @return A reference to the current matrix object that now holds the inverse of (At*A).
+		*/
+		CMatrix& QRCovariance()
+		{
+			MATHFIT_ASSERT(IsQRDecomposed());
+
+			const int iN = GetNoColumns();
+			const TFitData* fDiag = mQRCoeff;
+			int i, j, k;
+			TFitData fSum;
+
+			// invert the upper triangular R column by column into the workspace
+			TFitData* fInv = GetWorkspace(iN * iN);
+			memset(fInv, 0, sizeof(TFitData) * iN * iN);
+
+			for(j = 0; j < iN; j++)
+			{
+				fInv[j * iN + j] = (TFitData)1.0 / fDiag[j];
+				for(i = j - 1; i >= 0; i--)
+				{
+					fSum = 0;
+					for(k = i + 1; k <= j; k++)
+						fSum -= GetAt(i, k) * fInv[k * iN + j];
+					fInv[i * iN + j] = fSum / fDiag[i];
+				}
+			}
+
+			SetSize(iN, iN);
+			ClearDecomposition();
+
+			// (At*A)^-1 = R^-1 * (R^-1)t, which is symmetric
+			for(i = 0; i < iN; i++)
+				for(j = 0; j <= i; j++)
+				{
+					fSum = 0;
+					for(k = i; k < iN; k++)
+						fSum += fInv[i * iN + k] * fInv[j * iN + k];
+					SetAt(i, j, fSum);
+					SetAt(j, i, fSum);
+				}
 
 			return *this;
 		}
@@ -1605,14 +1905,25 @@ namespace MathFit
 
 		bool IsLUDecomposed() const
 		{
-			return mLUIndex != NULL ? true : false;
+			return mDecomposition == LUDECOMPOSED;
 		}
 
-		void ClearLUDecomposed()
+		bool IsCholeskyDecomposed() const
 		{
-			if(mLUIndex && mAutoRelease)
-				delete mLUIndex;
-			mLUIndex = NULL;
+			return mDecomposition == CHOLESKYDECOMPOSED;
+		}
+
+		bool IsQRDecomposed() const
+		{
+			return mDecomposition == QRDECOMPOSED;
+		}
+
+		/**
+		* Marks the matrix as not being decomposed. This is done whenever the content of the matrix changes.
+		*/
+		void ClearDecomposition()
+		{
+			mDecomposition = NOTDECOMPOSED;
 		}
 
 		/**
@@ -1647,6 +1958,312 @@ namespace MathFit
 		}
 
 	private:
+		/**
+		* Sets all members to the state of an empty matrix.
+		*/
+		void Initialize()
+		{
+			mRows = NULL;
+			mCols = NULL;
+			mRowCapacity = mColCapacity = 0;
+			mRowsValid = mColsValid = false;
+			mData = NULL;
+			mCapacity = 0;
+			mAutoRelease = true;
+			mSizeX = mSizeY = 0;
+			mLineOffset = 0;
+
+			mDoublePtr = NULL;
+			mFloatPtr = NULL;
+			mLUIndex = NULL;
+			mLUCapacity = 0;
+			mQRCoeff = NULL;
+			mQRCapacity = 0;
+			mDecomposition = NOTDECOMPOSED;
+			mWork = NULL;
+			mWorkCapacity = 0;
+			mIndexWork = NULL;
+			mIndexWorkCapacity = 0;
+		}
+
+		/**
+		* Returns the position of the given element in the data array.
+		*/
+		int Offset(const int iRow, const int iCol) const
+		{
+#if defined(ROWMATRIX)
+			return iRow * mLineOffset + iCol;
+#else
+			return iRow + iCol * mLineOffset;
+#endif
+		}
+
+		/**
+		* Returns the distance in the data array between two neighbouring rows.
+		*/
+		int RowPitch() const
+		{
+#if defined(ROWMATRIX)
+			return mLineOffset;
+#else
+			return 1;
+#endif
+		}
+
+		/**
+		* Returns the distance in the data array between two neighbouring columns.
+		*/
+		int ColPitch() const
+		{
+#if defined(ROWMATRIX)
+			return 1;
+#else
+			return mLineOffset;
+#endif
+		}
+
+		/**
+		* Returns the number of lines (rows or columns, depending on the storage order)
+		* which the data is stored in, and the number of elements in each line.
+		*/
+		int GetNoLines() const
+		{
+#if defined(ROWMATRIX)
+			return mSizeY;
+#else
+			return mSizeX;
+#endif
+		}
+
+		int GetLineLength() const
+		{
+#if defined(ROWMATRIX)
+			return mSizeX;
+#else
+			return mSizeY;
+#endif
+		}
+
+		/**
+		* Returns TRUE if the lines of the matrix follow directly after each other in the data array.
+		* This is not the case for submatrices.
+		*/
+		bool IsContiguous() const
+		{
+			return mLineOffset == GetLineLength();
+		}
+
+		/**
+		* Marks the row and column vectors as out of date, they are attached
+		* again to the data the next time they are used.
+		*/
+		void InvalidateViews()
+		{
+			mRowsValid = mColsValid = false;
+		}
+
+		/**
+		* Returns a buffer with room for at least 'iSize' elements.
+		* The buffer is kept by the matrix, so repeated operations on matrices
+		* of the same size do not need to allocate any memory.
+		*/
+		TFitData* GetWorkspace(int iSize)
+		{
+			if(iSize > mWorkCapacity)
+			{
+				if(mWork)
+					delete[] mWork;
+				mWork = new TFitData[iSize];
+				mWorkCapacity = iSize;
+			}
+
+			return mWork;
+		}
+
+		/**
+		* Returns a buffer with room for at least 'iSize' indices, used by the Gauss-Jordan elimination.
+		*/
+		int* GetIndexWorkspace(int iSize)
+		{
+			if(iSize > mIndexWorkCapacity)
+			{
+				if(mIndexWork)
+					delete[] mIndexWork;
+				mIndexWork = new int[iSize];
+				mIndexWorkCapacity = iSize;
+			}
+
+			return mIndexWork;
+		}
+
+		/**
+		* Returns the array holding the row permutation of the LU decomposition,
+		* with room for at least 'iSize' indices.
+		*/
+		int* GetLUIndex(int iSize)
+		{
+			if(iSize > mLUCapacity)
+			{
+				if(mLUIndex)
+					delete[] mLUIndex;
+				mLUIndex = new int[iSize];
+				mLUCapacity = iSize;
+			}
+
+			return mLUIndex;
+		}
+
+		/**
+		* Returns the array holding the diagonal of R and the norms of the Householder vectors of the QR decomposition,
+		* with room for at least 'iSize' elements.
+		*/
+		TFitData* GetQRCoefficients(int iSize)
+		{
+			if(iSize > mQRCapacity)
+			{
+				if(mQRCoeff)
+					delete[] mQRCoeff;
+				mQRCoeff = new TFitData[iSize];
+				mQRCapacity = iSize;
+			}
+
+			return mQRCoeff;
+		}
+
+		/**
+		* Takes over the decomposition state of the given matrix, which must have the same size.
+		*/
+		void CopyDecomposition(const CMatrix& mSource)
+		{
+			if(mSource.IsLUDecomposed())
+				memcpy(GetLUIndex(mSizeX), mSource.mLUIndex, sizeof(int) * mSizeX);
+			else if(mSource.IsQRDecomposed())
+				memcpy(GetQRCoefficients(2 * mSizeX), mSource.mQRCoeff, sizeof(TFitData) * 2 * mSizeX);
+
+			mDecomposition = mSource.mDecomposition;
+		}
+
+		/**
+		* Exchanges the contents of two variables.
+		*/
+		template<class T> static void Swap(T& first, T& second)
+		{
+			T temp = first;
+			first = second;
+			second = temp;
+		}
+
+		/**
+		* Solves the linear equation system a*x=b using the Gauss-Jordan elimination method,
+		* see the public GaussJordanSolve.
+		* The element (i,j) of the (b) part is found at fBeta[i * iBetaRowPitch + j * iBetaColPitch].
+		*
+		* @param fBeta			The (b) part of the LES, that will receive the result.
+		* @param iBetaCols		The number of columns in the (b) part.
+		* @param iBetaRowPitch	The distance in fBeta between two rows.
+		* @param iBetaColPitch	The distance in fBeta between two columns.
+		*/
+		void GaussJordanSolve(TFitData* fBeta, int iBetaCols, int iBetaRowPitch, int iBetaColPitch)
+		{
+			const int iCols = GetNoColumns();
+			const int iRows = GetNoRows();
+
+			int* iIndexCol = GetIndexWorkspace(3 * iCols);
+			int* iIndexRow = iIndexCol + iCols;
+			int* iPivotDone = iIndexRow + iCols;
+			memset(iIndexCol, 0, sizeof(int) * 3 * iCols);
+			int iR, iC;
+
+			int i, j, k;
+			for(i = 0; i < iCols; i++)
+			{
+				// find pivot
+				iR = iC = i;
+				TFitData fMag = 0;
+				for(j = 0; j < iRows; j++)
+				{
+					if(iPivotDone[j] != 1)
+					{
+						for(k = 0; k < iRows; k++)
+						{
+							if(iPivotDone[k] == 0)
+							{
+								if(fabs(GetAt(j, k)) >= fMag)
+								{
+									fMag = (TFitData)fabs(GetAt(j, k));
+									iR = j;
+									iC = k;
+								}
+							}
+							else if(iPivotDone[k] > 1)
+							{
+								// this pivot was selected more than once. Shit!!
+								throw(EXCEPTION(CMatrixSolveFailedException));
+							}
+						}
+					}
+				}
+				iPivotDone[iC]++;
+
+				// move pivot row into position
+				if(iR != iC)
+				{
+					ExchangeRows(iR, iC);
+					for(k = 0; k < iBetaCols; k++)
+						Swap(fBeta[iR * iBetaRowPitch + k * iBetaColPitch], fBeta[iC * iBetaRowPitch + k * iBetaColPitch]);
+				}
+
+				// store indices
+				iIndexRow[i] = iR;
+				iIndexCol[i] = iC;
+
+				// get scaling of pivot row
+				fMag = GetAt(iC, iC);
+
+				// no pivot: error
+				if(fMag == 0)
+				{
+					// zero pivot => not a singular matrix
+					throw(EXCEPTION(CMatrixSolveFailedException));
+				}
+
+				TFitData* fPivotRow = &mData[Offset(iC, 0)];
+				TFitData* fPivotBeta = &fBeta[iC * iBetaRowPitch];
+				const int iStep = ColPitch();
+
+				SetAt(iC, iC, 1);
+				for(k = 0; k < iCols; k++)
+					fPivotRow[k * iStep] /= fMag;
+				for(k = 0; k < iBetaCols; k++)
+					fPivotBeta[k * iBetaColPitch] /= fMag;
+
+				// eliminate pivot row component from other rows
+				int i2;
+				for(i2 = 0; i2 < iRows; i2++)
+				{
+					if(i2 == iC)
+						continue;
+
+					// get factor to eliminate pivot column
+					TFitData fMag2 = GetAt(i2, iC);
+					SetAt(i2, iC, 0);
+
+					TFitData* fRow = &mData[Offset(i2, 0)];
+					TFitData* fRowBeta = &fBeta[i2 * iBetaRowPitch];
+					for(k = 0; k < iCols; k++)
+						fRow[k * iStep] -= fMag2 * fPivotRow[k * iStep];
+					for(k = 0; k < iBetaCols; k++)
+						fRowBeta[k * iBetaColPitch] -= fMag2 * fPivotBeta[k * iBetaColPitch];
+				}
+			}
+
+			// reorder matrix
+			int l;
+			for(l = iRows - 1; l >= 0; l--)
+				if(iIndexRow[l] != iIndexCol[l])
+					ExchangeCols(iIndexRow[l], iIndexCol[l]);
+		}
+
 		/**
 		* The number of columns in the matrix.
 		*/
@@ -1657,15 +2274,52 @@ namespace MathFit
 		int mSizeY;
 		/**
 		* Array containing the row vectors.
+		* The row and column vectors are created the first time they are asked for
+		* and are kept, together with the arrays, until the matrix is destroyed.
+		*/
+		mutable CVector* mRows;
+		mutable CVector* mCols;
+		mutable int mRowCapacity;
+		mutable int mColCapacity;
+		mutable bool mRowsValid;
+		mutable bool mColsValid;
+		/**
+		* The matrix elements and the number of elements which fit into the array.
 		*/
-		CVector* mRows;
-		CVector* mCols;
 		TFitData* mData;
+		int mCapacity;
 		bool mAutoRelease;
 		int mLineOffset;
 		double* mDoublePtr;
 		float* mFloatPtr;
+		/**
+		* The possible states of the decomposition of the matrix.
+		*/
+		enum EDecomposition
+		{
+			NOTDECOMPOSED,
+			LUDECOMPOSED,
+			CHOLESKYDECOMPOSED,
+			QRDECOMPOSED
+		};
+		/**
+		* The row permutation of the LU decomposition. Only valid if the matrix is LU decomposed.
+		*/
 		int* mLUIndex;
+		int mLUCapacity;
+		/**
+		* The diagonal of R followed by the norms of the Householder vectors. Only valid if the matrix is QR decomposed.
+		*/
+		TFitData* mQRCoeff;
+		int mQRCapacity;
+		EDecomposition mDecomposition;
+		/**
+		* Workspaces which are reused by the solvers and the operations which change the shape of the matrix.
+		*/
+		TFitData* mWork;
+		int mWorkCapacity;
+		int* mIndexWork;
+		int mIndexWorkCapacity;
 	};
 }
 
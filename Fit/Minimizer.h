@@ -87,10 +87,10 @@ namespace MathFit
 			mModel.GetValues(mFitRange, mDiff);
 
 			// now calculate the chi square and variance values
-			CVector vErr(mFitRange.GetSize());
-			mModel.GetFunctionErrors(mFitRange, vErr);
+			mError.SetSize(mFitRange.GetSize());
+			mModel.GetFunctionErrors(mFitRange, mError);
 
-			mChiSquare = mDiff.SquareSumErrorWeighted(vErr);
+			mChiSquare = mDiff.SquareSumErrorWeighted(mError);
 			mChiSquare += mModel.GetLinearPenalty(mChiSquare);
 			mChiSquare += mModel.GetNonlinearPenalty(mChiSquare);
 
@@ -147,6 +147,26 @@ namespace MathFit
 			mCheckChiSquare = fMinChiSquare;
 		}
 
+		/**
+		* Sets the value of the damping parameter lambda with which the next fit starts.
+		* Minimizers without a damping parameter ignore this value.
+		*
+		* @param fStartLambda	The start value of lambda. A value less or equal to zero restores the default.
+		*/
+		virtual void SetStartLambda(TFitData fStartLambda)
+		{
+		}
+
+		/**
+		* Returns the value of the damping parameter lambda at the end of the last fit.
+		*
+		* @return The final lambda value, zero if the minimizer has no damping parameter.
+		*/
+		virtual TFitData GetLambda()
+		{
+			return 0;
+		}
+
 		/**
 		* Returns the residuum of after the fit.
 		*
@@ -211,6 +231,11 @@ namespace MathFit
 		*/
 		CStatisticVector mDiff;
 		/**
+		* Contains the errors of the function values in the fit range.
+		* Kept as a member so that the buffer can be reused in every step of the fit.
+		*/
+		CVector mError;
+		/**
 		* Contains the fit range's support values.
 		*/
 		CVector mFitRange;
@@ -157,14 +157,14 @@ namespace MathFit
 			const int iXSize = vXValues.GetSize();
 
 			// it makes more sens to first modify the X values and then call the B-Spline
-			CVector vBuffer(iXSize);
+			mXBuffer.SetSize(iXSize);
 
 			int i;
 			for(i = 0; i < iXSize; i++)
-				vBuffer.SetAt(i, mNonlinearParams.GetAllParameter().CalcPoly(vXValues.GetAt(i) - mFitRangeLow ) + mFitRangeLow);
+				mXBuffer.SetAt(i, mNonlinearParams.GetAllParameter().CalcPoly(vXValues.GetAt(i) - mFitRangeLow ) + mFitRangeLow);
 
 			// get the BSpline data
-			mBasisFunction->GetValues(vBuffer, vYTargetVector);
+			mBasisFunction->GetValues(mXBuffer, vYTargetVector);
 			vYTargetVector.Mul(mLinearParams.GetAllParameter().GetAt(0));
 
 			return vYTargetVector;
@@ -215,14 +215,14 @@ namespace MathFit
 			const int iXSize = vXValues.GetSize();
 
 			// it makes more sens to first modify the X values and then call the B-Spline
-			CVector vBuffer(iXSize);
+			mXBuffer.SetSize(iXSize);
 
 			int i;
 			for(i = 0; i < iXSize; i++)
-				vBuffer.SetAt(i, mNonlinearParams.GetAllParameter().CalcPoly(vXValues.GetAt(i) - mFitRangeLow) + mFitRangeLow);
+				mXBuffer.SetAt(i, mNonlinearParams.GetAllParameter().CalcPoly(vXValues.GetAt(i) - mFitRangeLow) + mFitRangeLow);
 
 			// get the BSpline data
-			mBasisFunction->GetSlopes(vBuffer, vSlopeVector);
+			mBasisFunction->GetSlopes(mXBuffer, vSlopeVector);
 			vSlopeVector.Mul(mLinearParams.GetAllParameter().GetAt(0));
 
 			// now multiply by the appropriate factor
@@ -291,28 +291,28 @@ namespace MathFit
 			case 0:
 				{
 					// we want the slope for the shift parameter
-					CVector vXTemp(vXValues);
+					mXBuffer.Copy(vXValues);
 
-					vXTemp.Sub(mFitRangeLow);
+					mXBuffer.Sub(mFitRangeLow);
 					int i;
 					for(i = 0; i < iXSize; i++)
-						vXTemp.SetAt(i, mNonlinearParams.GetAllParameter().CalcPoly(vXTemp.GetAt(i)));
-					vXTemp.Add(mFitRangeLow);
-					mBasisFunction->GetSlopes(vXTemp, vSlopes);
+						mXBuffer.SetAt(i, mNonlinearParams.GetAllParameter().CalcPoly(mXBuffer.GetAt(i)));
+					mXBuffer.Add(mFitRangeLow);
+					mBasisFunction->GetSlopes(mXBuffer, vSlopes);
 					vSlopes.Mul(mLinearParams.GetAllParameter().GetAt(0));
 					break;
 				}
 			case 1:
 				{
 					// and now for the squeeze parameters
-					CVector vXTemp(vXValues);
+					mXBuffer.Copy(vXValues);
 
-					vXTemp.Sub(mFitRangeLow);
+					mXBuffer.Sub(mFitRangeLow);
 					int i;
 					for(i = 0; i < iXSize; i++)
-						vXTemp.SetAt(i, mNonlinearParams.GetAllParameter().CalcPoly(vXTemp.GetAt(i)));
-					vXTemp.Add(mFitRangeLow);
-					mBasisFunction->GetSlopes(vXTemp, vSlopes);
+						mXBuffer.SetAt(i, mNonlinearParams.GetAllParameter().CalcPoly(mXBuffer.GetAt(i)));
+					mXBuffer.Add(mFitRangeLow);
+					mBasisFunction->GetSlopes(mXBuffer, vSlopes);
 					vSlopes.Mul(mLinearParams.GetAllParameter().GetAt(0));
 					vSlopes.MulSimple(vXValues);
 					break;
@@ -377,14 +377,14 @@ namespace MathFit
 
 			// we only have one linear parameter: the concentration
 			// therefore we can only fill the vector with the appropriate B-Spline coefficients
-			CVector vBuffer(iXSize);
+			mXBuffer.SetSize(iXSize);
 
 			// process shift and squeeze
 			int i;
 			for(i = 0; i < iXSize; i++)
-				vBuffer.SetAt(i, mNonlinearParams.GetAllParameter().CalcPoly(vXValues.GetAt(i) - mFitRangeLow) + mFitRangeLow);
+				mXBuffer.SetAt(i, mNonlinearParams.GetAllParameter().CalcPoly(vXValues.GetAt(i) - mFitRangeLow) + mFitRangeLow);
 
-			mBasisFunction->GetValues(vBuffer, vBasisFunctions);
+			mBasisFunction->GetValues(mXBuffer, vBasisFunctions);
 		}
 
 		/**
@@ -402,13 +402,14 @@ namespace MathFit
 			// if we have a fixed concentraction value, we only have to subtract the current function from the target vB
 			if(mLinearParams.IsParamFixed(0))
 			{
-				CVector vBuffer(iXSize);
+				mValueBuffer.SetSize(iXSize);
+				mValueBuffer.Zero();
 
 				// get the current function
-				GetValues(vXValues, vBuffer);
+				GetValues(vXValues, mValueBuffer);
 
 				// subtract it from the B vector
-				vB.Sub(vBuffer);
+				vB.Sub(mValueBuffer);
 
 				return;
 			}
@@ -545,6 +546,20 @@ namespace MathFit
 			return mAmplitudeScale;
 		}
 
+		/**
+		* Uses a basis function which already has been set up, e.g. by calling \Ref{SetData} on
+		* another reference object, instead of building a new one from the spectral data.
+		* The basis function object must exist for as long as this object is used.
+		*
+		* @param ifBasisFunction	The prepared basis function object.
+		* @param fAmplitudeScale	The amplitude scale of the normalization done when preparing the basis function.
+		*/
+		void SetPreparedBasisFunction(IFunction& ifBasisFunction, TFitData fAmplitudeScale)
+		{
+			SetBasisFunction(ifBasisFunction);
+			mAmplitudeScale = fAmplitudeScale;
+		}
+
 		/**
 		* Enables or disables the automatic normalization.
 		* If this parameter is set to true, a amplitude normalization within the specified
@@ -642,6 +657,12 @@ namespace MathFit
 		*/
 		TFitData mAmplitudeScale;
 		TFitData mFitRangeLow;
+		/**
+		* Buffers for the shifted and squeezed X values and for the function values.
+		* Kept so that they need not be allocated on every call.
+		*/
+		CVector mXBuffer;
+		CVector mValueBuffer;
 	};
 }
 
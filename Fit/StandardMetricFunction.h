@@ -67,10 +67,11 @@ namespace MathFit
 		{
 			mTarget.GetValues(vXValues, vYTargetVector);
 
-			CVector vTemp(vXValues.GetSize());
-			mModel.GetValues(vXValues, vTemp);
+			mModelValues.SetSize(vXValues.GetSize());
+			mModelValues.Zero();
+			mModel.GetValues(vXValues, mModelValues);
 
-			vYTargetVector.Sub(vTemp);
+			vYTargetVector.Sub(mModelValues);
 
 			return vYTargetVector;
 		}
@@ -477,6 +478,10 @@ namespace MathFit
 		* The target function.
 		*/
 		IFunction& mTarget;
+		/**
+		* Buffer for the values of the model function, kept so that it need not be allocated on every call.
+		*/
+		CVector mModelValues;
 	};
 }
 
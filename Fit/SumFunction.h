@@ -187,13 +187,14 @@ namespace MathFit
 			vYTargetVector.SetSize(iXSize);
 			vYTargetVector.Zero();
 
-			CVector vBuffer(iXSize);
+			mBuffer.SetSize(iXSize);
+			mBuffer.Zero();
 
 			int i;
 			for(i = 0; i < mOperandsCount; i++)
 			{
-				mOperands[i]->GetValues(vXValues, vBuffer);
-				vYTargetVector.Add(vBuffer);
+				mOperands[i]->GetValues(vXValues, mBuffer);
+				vYTargetVector.Add(mBuffer);
 			}
 
 			return vYTargetVector;
@@ -237,13 +238,14 @@ namespace MathFit
 		virtual CVector& GetSlopes(CVector& vXValues, CVector& vSlopeVector)
 		{
 			vSlopeVector.Zero();
-			CVector vBuffer(vXValues.GetSize());
+			mBuffer.SetSize(vXValues.GetSize());
+			mBuffer.Zero();
 
 			int i;
 			for(i = 0; i < mOperandsCount; i++)
 			{
-				mOperands[i]->GetSlopes(vXValues, vBuffer);
-				vSlopeVector.Add(vBuffer);
+				mOperands[i]->GetSlopes(vXValues, mBuffer);
+				vSlopeVector.Add(mBuffer);
 			}
 			return vSlopeVector;
 		}
@@ -322,7 +324,8 @@ namespace MathFit
 
 			vSlopes.Zero();
 
-			CVector vBuffer(vXValues.GetSize());
+			mBuffer.SetSize(vXValues.GetSize());
+			mBuffer.Zero();
 
 			int i;
 			for(i = 0; i < mOperandsCount; i++)
@@ -349,8 +352,8 @@ namespace MathFit
 							int iTargetParamID = pvItem.GetLinkTargetParamID(iSrcParamID, pvTarget);
 							while(iTargetParamID >= 0)
 							{
-								ipfTarget.GetNonlinearParamSlopes(vXValues, vBuffer, iTargetParamID, false);
-								vSlopes.Add(vBuffer);
+								ipfTarget.GetNonlinearParamSlopes(vXValues, mBuffer, iTargetParamID, false);
+								vSlopes.Add(mBuffer);
 
 								iTargetParamID = pvItem.GetLinkTargetParamID(iSrcParamID, pvTarget, iTargetParamID);
 							}
@@ -452,8 +455,8 @@ namespace MathFit
 
 			vBasisFunctions.Zero();
 
-			CVector vBasis(vXValues.GetSize());
-			vBasis.Zero();
+			mBasis.SetSize(vXValues.GetSize());
+			mBasis.Zero();
 
 			// the basis function if the sum of all coefficients of the reference spectra in regard
 			// to the parameter
@@ -484,8 +487,8 @@ namespace MathFit
 							int iTargetParamID = pvItem.GetLinkTargetParamID(iSrcParamID, pvTarget);
 							while(iTargetParamID >= 0)
 							{
-								ipfTarget.GetLinearBasisFunctions(vXValues, vBasis, iTargetParamID, false);
-								vBasisFunctions.Add(vBasis);
+								ipfTarget.GetLinearBasisFunctions(vXValues, mBasis, iTargetParamID, false);
+								vBasisFunctions.Add(mBasis);
 
 								iTargetParamID = pvItem.GetLinkTargetParamID(iSrcParamID, pvTarget, iTargetParamID);
 							}
@@ -511,7 +514,8 @@ namespace MathFit
 			const int iXSize = vXValues.GetSize();
 
 			// create buffer
-			CVector vBuffer(iXSize);
+			mBuffer.SetSize(iXSize);
+			mBuffer.Zero();
 
 			// process every reference given
 			int iParamID = 0;
@@ -534,8 +538,8 @@ namespace MathFit
 				else
 				{
 					// if there are no linear parameters, the reference is just a constant offset, that we have to subtract
-					ipfItem.GetValues(vXValues, vBuffer);
-					vB.Sub(vBuffer);
+					ipfItem.GetValues(vXValues, mBuffer);
+					vB.Sub(mBuffer);
 				}
 			}
 		}
@@ -821,6 +825,11 @@ namespace MathFit
 		* Maximum number of operands.
 		*/
 		int mMaxOperands;
+		/**
+		* Buffers for the values of the operands, kept so that they need not be allocated on every call.
+		*/
+		CVector mBuffer;
+		CVector mBasis;
 	};
 }
 
@@ -0,0 +1,500 @@
+/**
+* Contains the implementation of a variable projection fit.
+*
+* @version		1.0 @ 2026/10/18
+*/
+#if !defined(VARIABLEPROJECTIONFIT_H_261018)
+#define VARIABLEPROJECTIONFIT_H_261018
+
+#include "LevenbergMarquardtFit.h"
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#pragma warning (push, 3)
+
+namespace MathFit
+{
+	/**
+	* Performs a fit of the nonlinear and linear parameters of the model object using the variable projection
+	* method of Golub and Pereyra.
+	* For every set of nonlinear parameters the linear ones are given by the solution of a linear least square
+	* problem, so the Levenberg Marquardt iteration is done over the nonlinear parameters only and every trial
+	* step is judged with the best linear parameters for it. The curvature of the nonlinear parameters is taken
+	* from the derivatives projected onto the orthogonal complement of the linear basis functions (Kaufman's
+	* approximation), this accounts for the part of a change in the nonlinear parameters which the linear
+	* parameters can compensate.
+	*
+	* The object can be used in place of a \Ref{CStandardFit} object. Minimize runs the whole fit, the
+	* covariance matrices and errors are defined in the same way as by \Ref{CLeastSquareFit} and
+	* \Ref{CLevenbergMarquardtFit}.
+	*
+	* @version		1.0 @ 2026/10/18
+	*/
+	class CVariableProjectionFit : public IMinimizer
+	{
+	public:
+		/**
+		* Constructs the object and sets the model function.
+		*
+		* @param ipfModel	The model function which parametes should be fitted.
+		*/
+		CVariableProjectionFit(IParamFunction& ipfModel) : IMinimizer(ipfModel),
+			mLambda((TFitData)STARTLAMBDA),
+			mStartLambda((TFitData)STARTLAMBDA),
+			mSTARTLAMBDA((TFitData)STARTLAMBDA),
+			mMINLAMBDA((TFitData)MINLAMBDA),
+			mMAXLAMBDA((TFitData)MAXLAMBDA),
+			mEPSILON((TFitData)EPSILON),
+			mCHISQUAREMIN((TFitData)CHISQUAREMIN)
+		{
+		}
+
+		/**
+		* Nothing to do but checking the fit range.
+		*
+		* @return Always TRUE.
+		*/
+		virtual bool PrepareMinimize()
+		{
+			// if no fit range is given, we can't do the fit!
+			if(mFitRange.GetSize() <= 0)
+				throw(EXCEPTION(CNoFitRangeException));
+
+			return true;
+		}
+
+		/**
+		* Runs the whole fit.
+		* The linear parameters are solved for the start values of the nonlinear parameters, then
+		* the nonlinear parameters are iterated until the chi square does not decrease any more.
+		*
+		* @return TRUE if successful, FALSE otherwise.
+		*/
+		virtual bool Minimize()
+		{
+			mLambda = mStartLambda;
+			mSolutionFitSteps = mFitSteps = 0;
+
+			if(!Analyze())
+				return false;
+
+			// prepare a lower border for the chi square
+			if(mCheckChiSquare < 0)
+				mCheckChiSquare = mChiSquare * mCHISQUAREMIN;
+			if(!_finite(mCheckChiSquare))
+				mCheckChiSquare = mCHISQUAREMIN;
+
+			if(mMaxFitSteps < 0)
+				mMaxFitSteps = 1000;
+
+			while(Step());
+
+			return true;
+		}
+
+		/**
+		* Calculates the covariance and correlation matrices and the errors of the linear and the nonlinear
+		* parameters and sets them into the model object.
+		*
+		* @return Always TRUE.
+		*/
+		virtual bool FinishMinimize()
+		{
+			const int iLinear = mModel.GetLinearParameter().GetSize();
+			const int iNonlinear = mModel.GetNonlinearParameter().GetSize();
+
+			// the matrices of the last step may belong to a rejected set of parameters, so build them again
+			Analyze();
+
+			mDiff.SetSize(mFitRange.GetSize());
+			mModel.GetValues(mFitRange, mDiff);
+			mError.SetSize(mFitRange.GetSize());
+			mModel.GetFunctionErrors(mFitRange, mError);
+
+			// get the sum of squares weighted by the error vector
+			const TFitData fChiSquare = mDiff.SquareSumErrorWeighted(mError);
+
+			if(iLinear > 0)
+			{
+				// after the Gauss Jordan elimination the normal matrix holds its inverse, which is the covariance matrix
+				TFitData fNorm = (TFitData)sqrt((fChiSquare + mModel.GetLinearPenalty(fChiSquare)) / (mDiff.GetSize() - iLinear));
+				SetStatistics(mNormal, fNorm, true);
+			}
+
+			if(iNonlinear > 0)
+			{
+				// the errors of the nonlinear parameters are taken from the curvature matrix without the
+				// projection, like the Levenberg Marquardt fit does it
+				mAlpha.Copy(mFullAlpha);
+				mAlpha.Inverse();
+
+				TFitData fNorm = (TFitData)sqrt((fChiSquare + mModel.GetNonlinearPenalty(fChiSquare)) / (mFitRange.GetSize() - iNonlinear));
+				SetStatistics(mAlpha, fNorm, false);
+			}
+
+			return IMinimizer::FinishMinimize();
+		}
+
+		/**
+		* Sets the lambda value with which the next fit starts, see \Ref{CLevenbergMarquardtFit::SetStartLambda}.
+		*
+		* @param fStartLambda	The start value of lambda. A value less or equal to zero restores STARTLAMBDA.
+		*/
+		virtual void SetStartLambda(TFitData fStartLambda)
+		{
+			if(fStartLambda <= 0)
+				mStartLambda = mSTARTLAMBDA;
+			else
+				mStartLambda = max(mMINLAMBDA, min(fStartLambda, mSTARTLAMBDA));
+		}
+
+		/**
+		* Returns the lambda value at the end of the last fit.
+		*
+		* @return The final lambda value.
+		*/
+		virtual TFitData GetLambda()
+		{
+			return mLambda;
+		}
+
+	private:
+		/**
+		* Performs one Levenberg Marquardt step over the nonlinear parameters.
+		*
+		* @return TRUE if the minimization should be continued, FALSE otherwise.
+		*/
+		bool Step()
+		{
+			if(mModel.GetNonlinearParameter().GetSize() <= 0)
+				return false;
+
+			// check lambda
+			if(mLambda >= mMAXLAMBDA)
+				return false;
+
+			// check for already optimal solution
+			if(mCheckChiSquare > mChiSquare)
+				return false;
+
+			mOldChiSquare = mChiSquare;
+
+			// backup old values
+			mAlphaOld.Copy(mAlpha);
+			mBetaOld.Copy(mBeta);
+			mBackupNonlinear.Copy(mModel.GetNonlinearParameter());
+			mBackupLinear.Copy(mModel.GetLinearParameter());
+
+			// alter alpha by augmenting diagonal elements and solve the linear equations
+			mAlpha.MulDiag(1 + mLambda);
+			mAlpha.GaussJordanSolve(mBeta);
+
+			// set new parameter vector
+			mNonlinear.Copy(mBackupNonlinear);
+			mNonlinear.Add(mBeta);
+			mModel.SetNonlinearParameter(mNonlinear);
+
+			// analyze new parameters, this also solves the linear parameters for them
+			if(!Analyze())
+				return false;
+
+			mFitSteps++;
+
+			if(_finite(mChiSquare) && mOldChiSquare >= mChiSquare)
+			{
+				// keep the current iteration count as best steps
+				mSolutionFitSteps = mFitSteps;
+
+				if(mLambda > mMINLAMBDA)
+					mLambda /= 10;
+
+				// chi square doesn't differ to much anymore, so we're finished
+				TFitData fDiff = (mOldChiSquare - mChiSquare) / mChiSquare;
+				if(fDiff < mEPSILON)
+					return false;
+			}
+			else
+			{
+				// worse result, so restore model parameters and matrices
+				mModel.SetNonlinearParameter(mBackupNonlinear);
+				if(mBackupLinear.GetSize() > 0)
+					mModel.SetLinearParameter(mBackupLinear);
+				mAlpha.Copy(mAlphaOld);
+				mBeta.Copy(mBetaOld);
+				mChiSquare = mOldChiSquare;
+				mLambda *= 10;
+			}
+
+			// check fit steps
+			if(mMaxFitSteps > 0 && mFitSteps >= mMaxFitSteps)
+				return false;
+
+			return true;
+		}
+
+		/**
+		* Solves the linear parameters for the current nonlinear ones and calculates the chi square, the coneAngle vector
+		* and the projected alpha matrix of the nonlinear parameters.
+		*
+		* @return TRUE is successful, FALSE otherwise
+		*/
+		bool Analyze()
+		{
+			const int iPoints = mFitRange.GetSize();
+			const int iLinear = mModel.GetLinearParameter().GetSize();
+			const int iNonlinear = mModel.GetNonlinearParameter().GetSize();
+			int i, j, k, l;
+
+			mError.SetSize(iPoints);
+			mModel.GetFunctionErrors(mFitRange, mError);
+
+			if(iLinear > 0)
+			{
+				// get the A matrix and B vector weighted by the data errors
+				mA.SetSize(iLinear, iPoints);
+				mB.SetSize(iPoints);
+				mModel.GetLinearAMatrix(mFitRange, mA, mB);
+
+				for(i = 0; i < iPoints; i++)
+				{
+					for(j = 0; j < iLinear; j++)
+						mA.SetAt(i, j, mA.GetAt(i, j) / mError.GetAt(i));
+					mB.SetAt(i, mB.GetAt(i) / mError.GetAt(i));
+				}
+
+				// build the normal equations (At*A)*x = At*b
+				mNormal.SetSize(iLinear, iLinear);
+				mLinear.SetSize(iLinear);
+				for(j = 0; j < iLinear; j++)
+				{
+					TFitData fSum = 0;
+					for(i = 0; i < iPoints; i++)
+						fSum += mA.GetAt(i, j) * mB.GetAt(i);
+					mLinear.SetAt(j, fSum);
+
+					for(k = 0; k <= j; k++)
+					{
+						fSum = 0;
+						for(i = 0; i < iPoints; i++)
+							fSum += mA.GetAt(i, j) * mA.GetAt(i, k);
+						mNormal.SetAt(j, k, fSum);
+						mNormal.SetAt(k, j, fSum);
+					}
+				}
+
+				// solve them, afterwards the normal matrix holds its inverse
+				mNormal.GaussJordanSolve(mLinear);
+				mModel.SetLinearParameter(mLinear);
+			}
+
+			// the differences to the model with the new linear parameters
+			mDiff.SetSize(iPoints);
+			mModel.GetValues(mFitRange, mDiff);
+
+			mChiSquare = 0;
+			for(i = 0; i < iPoints; i++)
+				mChiSquare += (mDiff.GetAt(i) * mDiff.GetAt(i)) / (mError.GetAt(i) * mError.GetAt(i));
+
+			// add the penalty of the new linear parameters, as the linear least square fit does
+			mChiSquare += mModel.GetLinearPenalty(mChiSquare);
+
+			if(iNonlinear > 0)
+			{
+				mDyDa.SetSize(iNonlinear, iPoints);
+				mModel.GetNonlinearDyDa(mFitRange, mDyDa);
+
+				// the weighted derivatives
+				for(j = 0; j < iNonlinear; j++)
+					for(i = 0; i < iPoints; i++)
+						mDyDa.SetAt(i, j, mDyDa.GetAt(i, j) / mError.GetAt(i));
+
+				// since the weighted differences are orthogonal to the linear basis functions, the coneAngle vector
+				// is the same with and without the projection of the derivatives
+				mBeta.SetSize(iNonlinear);
+				mAlpha.SetSize(iNonlinear, iNonlinear);
+				for(j = 0; j < iNonlinear; j++)
+				{
+					TFitData fSum = 0;
+					for(i = 0; i < iPoints; i++)
+						fSum += mDiff.GetAt(i) / mError.GetAt(i) * mDyDa.GetAt(i, j);
+					mBeta.SetAt(j, fSum);
+
+					for(k = 0; k <= j; k++)
+					{
+						fSum = 0;
+						for(i = 0; i < iPoints; i++)
+							fSum += mDyDa.GetAt(i, j) * mDyDa.GetAt(i, k);
+						mAlpha.SetAt(j, k, fSum);
+						mAlpha.SetAt(k, j, fSum);
+					}
+				}
+
+				// keep the curvature without the projection for the error estimation
+				mFullAlpha.Copy(mAlpha);
+
+				if(iLinear > 0)
+				{
+					// the coupling between the linear and the nonlinear parameters: C = At * DyDa
+					mCoupling.SetSize(iNonlinear, iLinear);
+					for(l = 0; l < iLinear; l++)
+						for(j = 0; j < iNonlinear; j++)
+						{
+							TFitData fSum = 0;
+							for(i = 0; i < iPoints; i++)
+								fSum += mA.GetAt(i, l) * mDyDa.GetAt(i, j);
+							mCoupling.SetAt(l, j, fSum);
+						}
+
+					// (At*A)^-1 * C
+					mProjection.SetSize(iNonlinear, iLinear);
+					for(l = 0; l < iLinear; l++)
+						for(j = 0; j < iNonlinear; j++)
+						{
+							TFitData fSum = 0;
+							for(k = 0; k < iLinear; k++)
+								fSum += mNormal.GetAt(l, k) * mCoupling.GetAt(k, j);
+							mProjection.SetAt(l, j, fSum);
+						}
+
+					// the projected alpha matrix: alpha - Ct * (At*A)^-1 * C
+					for(j = 0; j < iNonlinear; j++)
+						for(k = 0; k < iNonlinear; k++)
+						{
+							TFitData fSum = 0;
+							for(l = 0; l < iLinear; l++)
+								fSum += mCoupling.GetAt(l, j) * mProjection.GetAt(l, k);
+							mAlpha.SetAt(j, k, mAlpha.GetAt(j, k) - fSum);
+						}
+				}
+
+				// ensure that we do not have zeros on the diagonal. Otherwise the LEQ can't be solved!
+				for(j = 0; j < iNonlinear; j++)
+				{
+					if(mAlpha.GetAt(j, j) <= 0)
+						mAlpha.SetAt(j, j, MATHFIT_NEARLYZERO);
+					if(mFullAlpha.GetAt(j, j) == 0)
+						mFullAlpha.SetAt(j, j, MATHFIT_NEARLYZERO);
+				}
+
+				// add the penalty of the new parameters
+				mChiSquare += mModel.GetNonlinearPenalty(mChiSquare);
+			}
+
+			return true;
+		}
+
+		/**
+		* Calculates the parameter errors and the correlation matrix from the given covariance matrix and sets them
+		* into the model object.
+		*
+		* @param mCovar		The covariance matrix.
+		* @param fNorm		The normalization factor of the parameter errors.
+		* @param bLinear	TRUE for the linear parameters, FALSE for the nonlinear ones.
+		*/
+		void SetStatistics(CMatrix& mCovar, TFitData fNorm, bool bLinear)
+		{
+			const int iParams = mCovar.GetNoColumns();
+			int i, j;
+
+			if(bLinear)
+				mModel.SetLinearCovarMatrix(mCovar);
+			else
+				mModel.SetNonlinearCovarMatrix(mCovar);
+
+			// calculate the parameter errors
+			mParamError.SetSize(iParams);
+			for(i = 0; i < iParams; i++)
+				mParamError.SetAt(i, (TFitData)sqrt(mCovar.GetAt(i, i)));
+
+			// calculate the correlation matrix
+			mCorrel.SetSize(iParams, iParams);
+			for(i = 0; i < iParams; i++)
+				for(j = 0; j < iParams; j++)
+					mCorrel.SetAt(i, j, mCovar.GetAt(i, j) / (mParamError.GetAt(i) * mParamError.GetAt(j)));
+
+			// now we have to 'normalize' the parameter errors to chi square.
+			mParamError.Mul(fNorm);
+
+			if(bLinear)
+			{
+				mModel.SetLinearCorrelMatrix(mCorrel);
+				mModel.SetLinearError(mParamError);
+			}
+			else
+			{
+				mModel.SetNonlinearCorrelMatrix(mCorrel);
+				mModel.SetNonlinearError(mParamError);
+			}
+		}
+
+		/**
+		* The weighted A matrix of the linear parameters and the weighted B vector.
+		*/
+		CMatrix mA;
+		CVector mB;
+		/**
+		* The normal matrix (At*A) of the linear parameters. Contains its inverse after the linear parameters are solved.
+		*/
+		CMatrix mNormal;
+		/**
+		* The solution of the linear parameters.
+		*/
+		CVector mLinear;
+		/**
+		* The weighted first derivatives of the model function in regard to the nonlinear parameters.
+		*/
+		CMatrix mDyDa;
+		/**
+		* The coupling (At*DyDa) between the linear and the nonlinear parameters and its product with the inverse normal matrix.
+		*/
+		CMatrix mCoupling;
+		CMatrix mProjection;
+		/**
+		* The projected alpha matrix, its backup and the alpha matrix without projection.
+		*/
+		CMatrix mAlpha;
+		CMatrix mAlphaOld;
+		CMatrix mFullAlpha;
+		/**
+		* The coneAngle vector and its backup.
+		*/
+		CVector mBeta;
+		CVector mBetaOld;
+		/**
+		* The trial nonlinear parameters and the backups of the parameters before a step.
+		*/
+		CVector mNonlinear;
+		CVector mBackupNonlinear;
+		CVector mBackupLinear;
+		/**
+		* Buffers for the correlation matrix and parameter errors of the fit.
+		*/
+		CMatrix mCorrel;
+		CVector mParamError;
+		/**
+		* The current lambda value.
+		*/
+		TFitData mLambda;
+		/**
+		* The lambda value the next fit starts with.
+		*/
+		TFitData mStartLambda;
+		/**
+		* The chi square value of the last step.
+		*/
+		TFitData mOldChiSquare;
+		/**
+		* The constants of the Levenberg Marquardt iteration, see \Ref{CLevenbergMarquardtFit}.
+		*/
+		const TFitData mSTARTLAMBDA;
+		const TFitData mMINLAMBDA;
+		const TFitData mMAXLAMBDA;
+		const TFitData mEPSILON;
+		const TFitData mCHISQUAREMIN;
+	};
+}
+
+#pragma warning (pop)
+#endif
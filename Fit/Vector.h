@@ -62,6 +62,7 @@ namespace MathFit
 		{
 			mData = NULL;
 			mLength = 0;
+			mCapacity = 0;
 			mStepSize = 1;
 			mAutoRelease = true;
 
@@ -78,6 +79,7 @@ namespace MathFit
 		{
 			mData = NULL;
 			mLength = 0;
+			mCapacity = 0;
 			mStepSize = 1;
 			mAutoRelease = true;
 
@@ -96,6 +98,7 @@ namespace MathFit
 		{
 			mData = NULL;
 			mLength = 0;
+			mCapacity = 0;
 			mStepSize = 1;
 			mAutoRelease = true;
 
@@ -127,6 +130,7 @@ namespace MathFit
 
 			// set new length
 			mLength = iSize;
+			mCapacity = 0;
 
 			// we are not allowed to release the buffer!
 			mAutoRelease = false;
@@ -144,6 +148,7 @@ namespace MathFit
 		{
 			mData = NULL;
 			mLength = 0;
+			mCapacity = 0;
 			mStepSize = 1;
 			mAutoRelease = true;
 
@@ -291,6 +296,7 @@ namespace MathFit
 			// get the data pointer
 			mData = vSecond.mData;
 			mLength = vSecond.mLength;
+			mCapacity = vSecond.mCapacity;
 			mStepSize = vSecond.mStepSize;
 			if(bAutoRelease)
 			{
@@ -325,6 +331,7 @@ namespace MathFit
 			// get the data pointer
 			mData = fData;
 			mLength = iSize;
+			mCapacity = (iStepSize == 1 ? iSize : 0);
 			mAutoRelease = bAutoRelease;
 			mStepSize = iStepSize;
 
@@ -340,6 +347,7 @@ namespace MathFit
 		{
 			mData = NULL;
 			mLength = 0;
+			mCapacity = 0;
 			mStepSize = 1;
 			mAutoRelease = true;
 
@@ -376,6 +384,7 @@ namespace MathFit
 		CVector& Exchange(CVector& vSecond)
 		{
 			int iLength = vSecond.mLength;
+			int iCapacity = vSecond.mCapacity;
 			int iStepSize = vSecond.mStepSize;
 			TFitData* fData = vSecond.mData;
 			bool bAutoRelease = vSecond.mAutoRelease;
@@ -383,6 +392,7 @@ namespace MathFit
 			float* fFloatPtr = vSecond.mFloatPtr;
 
 			vSecond.mLength = mLength;
+			vSecond.mCapacity = mCapacity;
 			vSecond.mStepSize = mStepSize;
 			vSecond.mData = mData;
 			vSecond.mAutoRelease = mAutoRelease;
@@ -390,6 +400,7 @@ namespace MathFit
 			vSecond.mFloatPtr = mFloatPtr;
 
 			mLength = iLength;
+			mCapacity = iCapacity;
 			mStepSize = iStepSize;
 			mData = fData;
 			mAutoRelease = bAutoRelease;
@@ -492,7 +503,9 @@ namespace MathFit
 
 		/**
 		* Sets the size of the vector. 
-		* If the vector needs to be resized the neccessary buffer is reallocated.
+		* If the vector needs to be resized the neccessary buffer is reallocated,
+		* unless the vector owns a buffer which is large enough already. The
+		* elements are set to zero when the size changes.
 		*
 		* @param iNewSize	The new number of elements.
 		*/
@@ -500,18 +513,30 @@ namespace MathFit
 		{
 			if(iNewSize != mLength || !mData)
 			{
-				if(mData != 0)
-					delete mData;
 				ReleaseFloatPtr();
 				ReleaseDoublePtr();
 
+				// reuse our own buffer if it is large enough
+				if(mData && mAutoRelease && iNewSize > 0 && iNewSize <= mCapacity)
+				{
+					mStepSize = 1;
+					mLength = iNewSize;
+					memset(mData, 0, mLength * sizeof(TFitData));
+					return;
+				}
+
+				if(mData != 0 && mAutoRelease)
+					delete mData;
+
 				mData = NULL;
+				mCapacity = 0;
 				mStepSize = 1;
 				mLength = iNewSize;
 				if(mLength <= 0)
 					return;
 
 				mData = new TFitData[mLength];
+				mCapacity = mLength;
 
 				// indicate that we have created this data object
 				mAutoRelease = true;
@@ -1191,6 +1216,11 @@ namespace MathFit
 		*/
 		int mLength;
 		/**
+		* Contains the number of elements which fit into the data array.
+		* Only used if the array is owned by the current object.
+		*/
+		int mCapacity;
+		/**
 		* Array containing the vector elements.
 		*/
 		TFitData* mData;
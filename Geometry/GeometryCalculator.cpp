@@ -390,12 +390,12 @@ bool CGeometryCalculator::CalculateGeometry(const CString &evalLog1, int scanInd
 	Common common;
 	int k;
 
-	// 1. Read the evaluation-logs
+	// 1. Read the two scans from the evaluation-logs
 	reader[0].m_evaluationLog.Format("%s", evalLog1);
 	reader[1].m_evaluationLog.Format("%s", evalLog2);
-	if(SUCCESS != reader[0].ReadEvaluationLog())
+	if(SUCCESS != reader[0].ReadEvaluationLog(scanIndex1))
 		return false;
-	if(SUCCESS != reader[1].ReadEvaluationLog())
+	if(SUCCESS != reader[1].ReadEvaluationLog(scanIndex2))
 		return false;
 
 	// 2. Get the gps-data from the eval-logs, if they don't contain any
@@ -427,9 +427,8 @@ bool CGeometryCalculator::CalculateGeometry(const CString &evalLog1, int scanInd
 	source.m_altitude  = (long)g_volcanoes.m_peakHeight[volcanoIndex1];
 
 	// 4. Get the scan-angles around which the plumes are centred
-	int index[2] = {scanIndex1, scanIndex2};
 	for(k = 0; k < 2; ++k){
-		if(false == reader[k].m_scan[index[k]].CalculatePlumeCentre("SO2", plumeCentre[k], tmp, plumeCompleteness, plumeEdge_low, plumeEdge_high))
+		if(false == reader[k].m_scan[0].CalculatePlumeCentre("SO2", plumeCentre[k], tmp, plumeCompleteness, plumeEdge_low, plumeEdge_high))
 			return false; // <-- cannot see the plume
 	}
 
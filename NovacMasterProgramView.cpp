@@ -15,9 +15,13 @@
 
 #include "Common/ReportWriter.h"
 #include "Common/FluxLogFileHandler.h"
+#include "Common/BinaryEvaluationLog.h"
+#include "Common/EvaluationLogFileHandler.h"
+#include "Common/Spectra/PakFileIndex.h"
 #include "Communication/LinkStatistics.h"
 
 #include "Evaluation/ScanResult.h"
+#include "Evaluation/Evaluation.h"
 #include "Evaluation/EvaluationController.h"
 
 #include "Geometry/GeometryResult.h"
@@ -237,6 +241,12 @@ void CNovacMasterProgramView::OnInitialUpdate()
 	FileHandler::CConfigurationFileHandler reader;
 	reader.ReadConfigurationFile(g_settings, &fileName);
 
+	// Apply the options for the evaluation
+	FileHandler::CBinaryEvaluationLog::s_writeBinaryLogs = (g_settings.evaluationSettings.writeBinaryLogs != 0);
+	Evaluation::CEvaluation::s_useVariableProjection     = (g_settings.evaluationSettings.variableProjection != 0);
+	FileHandler::CEvaluationLogFileHandler::s_useIndexFiles = (g_settings.evaluationSettings.indexFiles != 0);
+	SpectrumIO::CPakFileIndex::s_useSidecarFiles = (g_settings.evaluationSettings.pakIndexFiles != 0);
+
 	// Read the user settings
 	userSettingsFile.Format("%s\\user.ini", m_common.m_exePath);
 	g_userSettings.ReadSettings(&userSettingsFile);
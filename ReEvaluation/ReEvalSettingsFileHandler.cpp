@@ -65,6 +65,8 @@ RETURN_CODE CReEvalSettingsFileHandler::WriteSettings(const ReEvaluation::CReEva
 
 	// 5. Misc...
 	fprintf(f, "\t<Average>%d</Average>\n",									(int)reeval.m_averagedSpectra);
+	fprintf(f, "\t<WorkerThreads>%d</WorkerThreads>\n",							(int)reeval.m_workerNum);
+	fprintf(f, "\t<WarmStart>%d</WarmStart>\n",									(int)reeval.m_warmStart);
 
 
 	fprintf(f, TEXT("</ReEvalSettings_Misc>\n"));
@@ -84,6 +86,8 @@ RETURN_CODE CReEvalSettingsFileHandler::ReadSettings(ReEvaluation::CReEvaluator
 	char  skySpecStr[]				= _T("SkySpectrum");
 	char  darkSpecStr[]				= _T("DarkSpectrum");
 	char  averageStr[]				= _T("Average");
+	char  workerStr[]				= _T("WorkerThreads");
+	char  warmStartStr[]			= _T("WarmStart");
 
 	CFileException exceFile;
   CStdioFile file;
@@ -146,6 +150,20 @@ RETURN_CODE CReEvalSettingsFileHandler::ReadSettings(ReEvaluation::CReEvaluator
 			reeval.m_averagedSpectra = (tmpInt == 1)? true : false;
 			continue;
 		}
+
+		if(Equals(szToken, workerStr, strlen(workerStr))){
+			int tmpInt;
+			Parse_IntItem("/WorkerThreads", tmpInt);
+			reeval.m_workerNum = max(1, tmpInt);
+			continue;
+		}
+
+		if(Equals(szToken, warmStartStr, strlen(warmStartStr))){
+			int tmpInt;
+			Parse_IntItem("/WarmStart", tmpInt);
+			reeval.m_warmStart = (tmpInt == 1)? true : false;
+			continue;
+		}
 	}
 
 	// done
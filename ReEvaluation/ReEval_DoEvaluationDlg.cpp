@@ -274,7 +274,7 @@ LRESULT CReEval_DoEvaluationDlg::OnEvaluatedSpectrum(WPARAM wp, LPARAM lp){
 	// 2. Draws the whole fit
 	if(m_showFit == 0){
 		// copy the spectrum to the local variable
-		for(int i = 0; i < window.specLength; ++i) {
+		for(int i = 0; i < window.specLength && i < spec[0].m_length; ++i) {
 			spectrum[i] = spec[0].m_data[i];
 		}
 		DrawFit();
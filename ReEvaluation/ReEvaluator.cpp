@@ -4,8 +4,11 @@
 
 #include "../Common/Version.h"
 #include "../Evaluation/ScanEvaluation.h"
+#include "../Common/BinaryEvaluationLog.h"
 #include "../Dialogs/QueryStringDialog.h"
 
+#include <thread>
+
 using namespace ReEvaluation;
 using namespace Evaluation;
 
@@ -53,6 +56,13 @@ CReEvaluator::CReEvaluator(void)
 
 	// The default is that the spectra are summed, not averaged
 	m_averagedSpectra = false;
+
+	// The default is that every fit starts from the settings of the fit window
+	m_warmStart = false;
+
+	// The default is to evaluate one scan at a time and show each evaluated spectrum
+	m_workerNum = 1;
+	m_noMoreJobs = false;
 }
 
 CReEvaluator::~CReEvaluator(void)
@@ -73,10 +83,8 @@ bool CReEvaluator::DoEvaluation(){
 	oldMem.Checkpoint();
 #endif
 
-	long nDone		= 0;		// <-- number of scans evaluated
-	double nToDo	= (double)m_scanFileNum;	// <-- number of scans to evaluate
-
 	CString message;
+	clock_t cStart, cFinish;
 
 	/* Check the settings before we start */
 	if(!MakeInitialSanityCheck())
@@ -93,6 +101,46 @@ bool CReEvaluator::DoEvaluation(){
 	/* evaluate the spectra */
 	m_progress = 0;
 
+	// clock the time it takes to evaluate all the scans
+	cStart = clock();
+
+	// Pausing between the spectra is only possible when evaluating one scan at a time
+	bool success;
+	if(m_workerNum > 1 && m_pause == 0){
+		success = EvaluateScans_Parallel();
+	}else{
+		success = EvaluateScans_Serial();
+	}
+
+	// Check if the evaluation was aborted or if the user wants to stop
+	if(!success || !fRun) {
+		return success;
+	}
+
+	cFinish = clock();
+	message.Format("ReEvaluated %d scans in %d fit windows using %d thread(s) in %lf seconds", m_scanFileNum, m_windowNum, (m_workerNum > 1 && m_pause == 0) ? m_workerNum : 1, ((double)(cFinish - cStart) / (double)CLOCKS_PER_SEC));
+	ShowMessage(message);
+
+	if(pView != NULL)
+	{
+		pView->PostMessage(WM_DONE);
+	}
+
+	fRun = false;
+
+#ifdef _DEBUG
+	// this is for searching for memory leaks
+	newMem.Checkpoint();
+	if(diffMem.Difference(oldMem, newMem)){
+		diffMem.DumpStatistics(); 
+//		diffMem.DumpAllObjectsSince();
+	}
+#endif
+
+	return true;
+}
+
+bool CReEvaluator::EvaluateScans_Serial(){
 	// The CScanEvaluation-object handles the evaluation of one single scan.
 	CScanEvaluation ev;
 	ev.pView		= this->pView;
@@ -103,6 +151,7 @@ bool CReEvaluator::DoEvaluation(){
 	ev.SetOption_Sky(m_skyOption, m_skyIndex, &m_skySpectrum);
 	ev.SetOption_Ignore(m_ignore_Lower, m_ignore_Upper);
 	ev.SetOption_AveragedSpectra(m_averagedSpectra);
+	ev.SetOption_WarmStart(m_warmStart);
 
 	// loop through all the scan files
 	for(m_curScanFile = 0; m_curScanFile < m_scanFileNum; ++m_curScanFile)
@@ -130,41 +179,12 @@ bool CReEvaluator::DoEvaluation(){
 
 		// For each scanfile: loop through the fit windows
 		for(m_curWindow = 0; m_curWindow < m_windowNum; ++m_curWindow){
-			CFitWindow &thisWindow = m_window[m_curWindow];
-
-			// Check the interlace steps
-			CSpectrum skySpec;
-			scan.GetSky(skySpec);
-
-			if(skySpec.Channel() > MAX_CHANNEL_NUM) {
-				// We should use an interlaced window instead
-				if(-1 == Common::GetInterlaceSteps(skySpec.Channel(), skySpec.m_info.m_interlaceStep)) {
-					return 0; // WRONG!!
-				}
-
-				thisWindow.interlaceStep	= skySpec.m_info.m_interlaceStep;
-				thisWindow.specLength		= skySpec.m_length * skySpec.m_info.m_interlaceStep;
-			}
-
-			if(skySpec.m_info.m_startChannel > 0 || skySpec.m_length != thisWindow.specLength / thisWindow.interlaceStep) {
-				// If the spectra are too short or the start channel is not zero
-				//	then they are read out as partial spectra. Lets adapt the evaluator to that
-				thisWindow.specLength		= skySpec.m_length;
-				thisWindow.startChannel		= skySpec.m_info.m_startChannel;
-			}
-
-			if(skySpec.m_info.m_interlaceStep > 1) {
-				skySpec.InterpolateSpectrum();
-			}
-
-			// check the quality of the sky-spectrum
-			if(skySpec.AverageValue(thisWindow.fitLow, thisWindow.fitHigh) >= 4090 * skySpec.NumSpectra()) {
-				if(skySpec.NumSpectra() > 0){
-					message.Format("It seems like the sky-spectrum is saturated in the fit-region. Continue?");
-					if(IDNO == MessageBox(NULL, message, "Saturated sky spectrum?", MB_YESNO)){
-						break; // continue with the next scan-file
-					}
-				}
+			// Check the sky-spectrum and the interlace steps
+			int skyStatus = CheckSkySpectrum(scan, m_curWindow);
+			if(skyStatus < 0) {
+				return false; // WRONG!!
+			}else if(skyStatus > 0) {
+				break; // continue with the next scan-file
 			}
 		
 			// Evaluate the scan-file
@@ -186,23 +206,222 @@ bool CReEvaluator::DoEvaluation(){
 
 	} // end for(m_curScanFile...
 
-	if(pView != NULL)
+	return true;
+}
+
+bool CReEvaluator::EvaluateScans_Parallel(){
+	// The scans which are being evaluated, in the order of the scan-files.
+	std::deque<std::unique_ptr<PendingScan>> pending;
+
+	// The number of scan-files that we keep in memory at the same time
+	const size_t maxPending = 2 * (size_t)m_workerNum;
+
+	// Start the worker threads
+	m_jobs.clear();
+	m_noMoreJobs = false;
+	std::vector<std::thread> workers;
+	for(long k = 0; k < m_workerNum; ++k){
+		workers.push_back(std::thread(&CReEvaluator::RunWorker, this));
+	}
+
+	bool success = true;
+
+	// loop through all the scan files
+	for(m_curScanFile = 0; m_curScanFile < m_scanFileNum && fRun; ++m_curScanFile)
 	{
-		pView->PostMessage(WM_DONE);
+		std::unique_ptr<PendingScan> newScan(new PendingScan());
+		newScan->scanIndex		= m_curScanFile;
+		newScan->windowNum		= 0;
+		newScan->windowsDone	= 0;
+
+		// Check the scan file
+		if(SUCCESS != newScan->scan.CheckScanFile(&m_scanFile[m_curScanFile])){
+			CString errStr;
+			errStr.Format("Could not read scan-file %s", m_scanFile[m_curScanFile]);
+			MessageBox(NULL, errStr, "Error", MB_OK);
+			continue;
+		}
+
+		// Check the sky-spectrum for each of the fit windows, before handing
+		//	the scan over to the worker threads
+		int skyStatus = 0;
+		while(newScan->windowNum < m_windowNum){
+			skyStatus = CheckSkySpectrum(newScan->scan, newScan->windowNum);
+			if(skyStatus != 0)
+				break;
+			newScan->success[newScan->windowNum] = 0;
+			++newScan->windowNum;
+		}
+		if(skyStatus < 0){
+			success = false;
+			break;
+		}
+
+		// Hand over the scan to the worker threads, one job for each fit window
+		{
+			std::lock_guard<std::mutex> lock{ m_jobMutex };
+			for(long window = 0; window < newScan->windowNum; ++window){
+				EvaluationJob job = {newScan.get(), window};
+				m_jobs.push_back(job);
+			}
+			pending.push_back(std::move(newScan));
+		}
+		m_jobAdded.notify_all();
+
+		// Write out the scans which are done, and wait for the worker threads if
+		//	there are too many scans in memory
+		WriteFinishedScans(pending, maxPending);
 	}
 
-	fRun = false;
+	// Wait for the remaining scans to be evaluated
+	if(success){
+		WriteFinishedScans(pending, 0);
+	}
 
-#ifdef _DEBUG
-	// this is for searching for memory leaks
-	newMem.Checkpoint();
-	if(diffMem.Difference(oldMem, newMem)){
-		diffMem.DumpStatistics(); 
-//		diffMem.DumpAllObjectsSince();
+	// Stop the worker threads
+	{
+		std::lock_guard<std::mutex> lock{ m_jobMutex };
+		m_jobs.clear();
+		m_noMoreJobs = true;
+	}
+	m_jobAdded.notify_all();
+	for(size_t k = 0; k < workers.size(); ++k){
+		workers[k].join();
 	}
-#endif
 
-	return true;
+	m_curScanFile	= m_scanFileNum - 1;
+	m_curWindow		= 0;
+
+	return success;
+}
+
+void CReEvaluator::WriteFinishedScans(std::deque<std::unique_ptr<PendingScan>> &pending, size_t maxPending){
+	std::unique_lock<std::mutex> lock{ m_jobMutex };
+
+	while(!pending.empty() && fRun){
+		PendingScan *scan = pending.front().get();
+
+		if(scan->windowsDone < scan->windowNum){
+			if(pending.size() <= maxPending)
+				return;
+
+			// wait for the worker threads to finish the oldest scan
+			m_jobDone.wait(lock);
+			continue;
+		}
+
+		// All fit windows of the oldest scan are done, write them to the evaluation logs
+		//	in the same order as when evaluating the scans one at a time.
+		lock.unlock();
+
+		m_progress = (scan->scanIndex + 1) / (double)m_scanFileNum;
+		if(pView != nullptr)
+		{
+			pView->PostMessage(WM_PROGRESS, (WPARAM)m_progress);
+		}
+
+		m_statusMsg.Format("Evaluated scan number %d", scan->scanIndex);
+		ShowMessage(m_statusMsg);
+
+		for(m_curWindow = 0; m_curWindow < scan->windowNum; ++m_curWindow){
+			if(scan->success[m_curWindow] && scan->result[m_curWindow] != nullptr) {
+				AppendResultToEvaluationLog(scan->result[m_curWindow].get(), &scan->scan);
+			}
+		}
+		m_curWindow = 0;
+
+		lock.lock();
+		pending.pop_front();
+	}
+}
+
+void CReEvaluator::RunWorker(){
+	// Each worker has its own copy of the evaluators, since the evaluators
+	//	keep the state of the last fit.
+	std::vector<std::unique_ptr<CEvaluation>> evaluator;
+	for(long window = 0; window < m_windowNum; ++window){
+		evaluator.push_back(std::unique_ptr<CEvaluation>(new CEvaluation(m_evaluator[window])));
+	}
+
+	// The CScanEvaluation-object handles the evaluation of one single scan.
+	CScanEvaluation ev;
+	ev.SetOption_Sky(m_skyOption, m_skyIndex, &m_skySpectrum);
+	ev.SetOption_Ignore(m_ignore_Lower, m_ignore_Upper);
+	ev.SetOption_AveragedSpectra(m_averagedSpectra);
+	ev.SetOption_WarmStart(m_warmStart);
+
+	while(1){
+		EvaluationJob job;
+
+		// Get the next job
+		{
+			std::unique_lock<std::mutex> lock{ m_jobMutex };
+			m_jobAdded.wait(lock, [this]{ return m_noMoreJobs || !m_jobs.empty(); });
+			if(m_jobs.empty())
+				return;
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+
+		// Evaluate the scan-file
+		int success = ev.EvaluateScan(m_scanFile[job.scan->scanIndex], evaluator[job.window].get(), &fRun, &m_darkSettings);
+
+		std::unique_ptr<CScanResult> res;
+		if(success) {
+			res = ev.GetResult();
+		}
+
+		// Hand back the result
+		{
+			std::lock_guard<std::mutex> lock{ m_jobMutex };
+			job.scan->success[job.window]	= success;
+			job.scan->result[job.window]	= std::move(res);
+			++job.scan->windowsDone;
+		}
+		m_jobDone.notify_all();
+	}
+}
+
+int CReEvaluator::CheckSkySpectrum(const FileHandler::CScanFileHandler &scan, long windowIndex){
+	CString message;
+	CFitWindow &thisWindow = m_window[windowIndex];
+
+	// Check the interlace steps
+	CSpectrum skySpec;
+	scan.GetSky(skySpec);
+
+	if(skySpec.Channel() > MAX_CHANNEL_NUM) {
+		// We should use an interlaced window instead
+		if(-1 == Common::GetInterlaceSteps(skySpec.Channel(), skySpec.m_info.m_interlaceStep)) {
+			return -1;
+		}
+
+		thisWindow.interlaceStep	= skySpec.m_info.m_interlaceStep;
+		thisWindow.specLength		= skySpec.m_length * skySpec.m_info.m_interlaceStep;
+	}
+
+	if(skySpec.m_info.m_startChannel > 0 || skySpec.m_length != thisWindow.specLength / thisWindow.interlaceStep) {
+		// If the spectra are too short or the start channel is not zero
+		//	then they are read out as partial spectra. Lets adapt the evaluator to that
+		thisWindow.specLength		= skySpec.m_length;
+		thisWindow.startChannel		= skySpec.m_info.m_startChannel;
+	}
+
+	if(skySpec.m_info.m_interlaceStep > 1) {
+		skySpec.InterpolateSpectrum();
+	}
+
+	// check the quality of the sky-spectrum
+	if(skySpec.AverageValue(thisWindow.fitLow, thisWindow.fitHigh) >= 4090 * skySpec.NumSpectra()) {
+		if(skySpec.NumSpectra() > 0){
+			message.Format("It seems like the sky-spectrum is saturated in the fit-region. Continue?");
+			if(IDNO == MessageBox(NULL, message, "Saturated sky spectrum?", MB_YESNO)){
+				return 1;
+			}
+		}
+	}
+
+	return 0;
 }
 
 /* Check the settings before we start */
@@ -549,6 +768,24 @@ bool CReEvaluator::AppendResultToEvaluationLog(const CScanResult *result, const
 
 	fclose(f);
 
+	// Write the scan to the binary evaluation log as well
+	if(FileHandler::CBinaryEvaluationLog::s_writeBinaryLogs){
+		CSpectrumInfo scanInfo;
+		scanInfo.m_date[0]   = scan->m_date[0];
+		scanInfo.m_date[1]   = scan->m_date[1];
+		scanInfo.m_date[2]   = scan->m_date[2];
+		scanInfo.m_startTime = scan->m_startTime;
+		scanInfo.m_gps       = gps;
+		scanInfo.m_compass   = (float)scan->GetCompass();
+		scanInfo.m_coneAngle = skySpec.m_info.m_coneAngle;
+		scanInfo.m_pitch     = skySpec.m_info.m_pitch;
+		scanInfo.m_device    = scan->m_device;
+		scanInfo.m_specModel = skySpec.m_info.m_specModel;
+		scanInfo.m_channel   = scan->m_channel;
+		// the intensities are written to the text log as they are, do the same here
+		FileHandler::CBinaryEvaluationLog::AppendScan(m_evalLog[m_curWindow], scanInfo, *result, m_instrumentType, 0.0);
+	}
+
 	return true;
 }
 
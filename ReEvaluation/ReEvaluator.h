@@ -7,6 +7,11 @@
 #include "../Common/Spectra/ScanFileHandler.h"
 #include "../Configuration/Configuration.h"
 
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
 #define MAX_N_SCANFILES 64
 
 //using namespace Evaluation;
@@ -56,6 +61,10 @@ namespace ReEvaluation
 		/** True if the spectra that we're treating are averaged, not summed */
 		bool				m_averagedSpectra;
 
+		/** True if the fit of each spectrum in a scan should start from the result
+			of the previous spectrum (see CScanEvaluation::SetOption_WarmStart) */
+		bool				m_warmStart;
+
 		/** a string that is updated with information about progres in the calculations.
 			every time the string is changed a message is sent to 'pView' */
 		CString			m_statusMsg;
@@ -90,10 +99,50 @@ namespace ReEvaluation
 		/** The settings for how to handle the dark-measurements */
 		CConfigurationSetting::DarkSettings	m_darkSettings;
 
+		/** The number of threads used to evaluate the scans. If this is larger than one
+			then the (scan-file, fit window) pairs are evaluated in parallel, each thread
+			with its own copy of the evaluators, and the results are written to the
+			evaluation logs in the same order as when evaluating with one thread.
+			The evaluated spectra are then not shown one by one in 'pView'. */
+		long				m_workerNum;
+
 	private:
 		/** The evaluators, one for every fit window. */
 		Evaluation::CEvaluation m_evaluator[MAX_FIT_WINDOWS];
 
+		/** One scan-file which is being evaluated by the worker threads. The results
+			are kept here until all fit windows have been evaluated, so that they can be
+			written to the evaluation logs in the order of the scan-files. */
+		struct PendingScan{
+			long scanIndex;									// the index of the scan-file into m_scanFile
+			FileHandler::CScanFileHandler scan;				// the checked scan-file
+			long windowNum;									// the number of fit windows to evaluate
+			long windowsDone;								// the number of fit windows evaluated so far
+			int  success[MAX_N_WINDOWS];					// the return value from the evaluation in each window
+			std::unique_ptr<Evaluation::CScanResult> result[MAX_N_WINDOWS];
+		};
+
+		/** One fit window of one scan-file, to be evaluated by one of the worker threads */
+		struct EvaluationJob{
+			PendingScan *scan;
+			long window;
+		};
+
+		/** The jobs waiting to be picked up by the worker threads */
+		std::deque<EvaluationJob> m_jobs;
+
+		/** True when no more jobs will be added to 'm_jobs' and the worker threads should quit */
+		bool m_noMoreJobs;
+
+		/** Protects 'm_jobs', 'm_noMoreJobs' and the results in the pending scans */
+		std::mutex m_jobMutex;
+
+		/** Signalled when a new job is added to 'm_jobs' or when 'm_noMoreJobs' is set */
+		std::condition_variable m_jobAdded;
+
+		/** Signalled when a worker thread has finished one job */
+		std::condition_variable m_jobDone;
+
 	public:
 
 		// ------------------------- METHODS ------------------------------
@@ -128,5 +177,28 @@ private:
 		/** Prepares for evaluation */
 		bool PrepareEvaluation();
 
+		/** Evaluates all the scan-files, one fit window at a time, in this thread.
+			@return false if the evaluation had to be aborted */
+		bool EvaluateScans_Serial();
+
+		/** Evaluates all the scan-files using 'm_workerNum' worker threads.
+			@return false if the evaluation had to be aborted */
+		bool EvaluateScans_Parallel();
+
+		/** The main loop of one worker thread in 'EvaluateScans_Parallel' */
+		void RunWorker();
+
+		/** Writes the results of the finished scans at the front of 'pending' to the
+			evaluation logs, waiting for the worker threads until at most 'maxPending'
+			scans remain in the list. */
+		void WriteFinishedScans(std::deque<std::unique_ptr<PendingScan>> &pending, size_t maxPending);
+
+		/** Checks the sky-spectrum of the scan against the fit window 'windowIndex'
+			and adapts the window to the length of the spectra in the scan.
+			@return 0 if the scan should be evaluated in this window
+			@return 1 if the user does not want to evaluate the scan in this, or any following, window
+			@return -1 if the scan cannot be evaluated at all */
+		int CheckSkySpectrum(const FileHandler::CScanFileHandler &scan, long windowIndex);
+
 	};
 }
\ No newline at end of file
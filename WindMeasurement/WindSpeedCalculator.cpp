@@ -1,8 +1,22 @@
 #include "StdAfx.h"
 #include "windspeedcalculator.h"
 
+#include <float.h>
+
 using namespace WindSpeedMeasurement;
 
+// the sums over the windows are calculated again at every this many steps, 
+//	instead of being updated, to keep the rounding errors from growing
+static const int SUM_REFRESH_INTERVAL = 256;
+
+// the correlations calculated from the updated sums are assumed to be
+//	within half of this from the correlations calculated directly
+static const double CORRELATION_TOLERANCE = 1e-6;
+
+// windows whose variance is smaller than this, relative to the mean square,
+//	are too flat for their correlation to be calculated from the sums
+static const double MIN_RELATIVE_VARIANCE = 1e-6;
+
 CWindSpeedCalculator::CMeasurementSeries::CMeasurementSeries(){
 	column = NULL;
 	time = NULL;
@@ -120,6 +134,16 @@ RETURN_CODE CWindSpeedCalculator::CalculateDelay(
 	m_length		= modifiedDownWind.length;
 	InitializeArrays();
 
+	// 2b. Calculate the sums over the windows which are to be compared, these are
+	//		used to calculate the correlations while moving the windows
+	CorrelationSums sums;
+	CalculateWindowSums(modifiedDownWind.column,	modifiedDownWind.length,	comparisonLength, sums.s_x, sums.s_x2);
+	CalculateWindowSums(modifiedUpWind.column,		modifiedUpWind.length,		comparisonLength, sums.s_y, sums.s_y2);
+	sums.s_xy.resize(maximumShift);
+	sums.c.resize(maximumShift);
+	sums.reliable.resize(maximumShift);
+	sums.offset = -1;
+
 	// The number of datapoints skipped because we cannot see the plume.
 	int skipped = 0;
 
@@ -129,12 +153,6 @@ RETURN_CODE CWindSpeedCalculator::CalculateDelay(
 		double highestCorr;
 		int bestShift;
 		
-		// 3a. Pick out the sub-vectors
-		double	*series1						= modifiedUpWind.column + offset;
-		double	*series2						= modifiedDownWind.column	+ offset;
-		unsigned int series1Length	= modifiedUpWind.length - offset;
-		unsigned int series2Length	= comparisonLength;
-
 		// 3b. The midpoint in the subvector
 		int midPoint = (int)round(offset + comparisonLength / 2);
 
@@ -146,7 +164,7 @@ RETURN_CODE CWindSpeedCalculator::CalculateDelay(
 		}
 
 		// 3d. Do a shifting...
-		FindBestCorrelation(series1, series1Length, series2, series2Length, maximumShift, highestCorr, bestShift);
+		FindBestCorrelation(modifiedUpWind.column, modifiedUpWind.length, modifiedDownWind.column, offset, comparisonLength, maximumShift, sums, highestCorr, bestShift);
 
 		// 3e. Calculate the time-shift
 		delays[midPoint]			= bestShift * sampleInterval;
@@ -272,6 +290,89 @@ RETURN_CODE CWindSpeedCalculator::FindBestCorrelation(
 	return SUCCESS;
 }
 
+/** Shifts the window of length 'windowLength' starting at 'offset' in the down wind series
+			against the up wind series and returns the shift for which the correlation is highest. */
+RETURN_CODE CWindSpeedCalculator::FindBestCorrelation(
+	const double *upWind, long upWindLength,
+	const double *downWind, int offset, int windowLength,
+	unsigned int maximumShift,
+	CorrelationSums &sums,
+	double &highestCorr, int &bestShift){
+
+	const double *x	= downWind + offset;
+	const long L		= windowLength;
+
+	// 1. The number of shifts to test, the same as in the function above
+	const int shiftNum = min((int)maximumShift, (int)(upWindLength - offset - L));
+
+	if(L <= 0 || shiftNum <= 0 || offset < 0 || offset > (int)sums.s_x.size() - 1){
+		sums.offset = -1;
+		return FindBestCorrelation(upWind + offset, upWindLength - offset, x, L, maximumShift, highestCorr, bestShift);
+	}
+
+	// 2. Update the dot-products between the window and the shifted up wind series. 
+	//		If the window has moved one step since last time then this is done by removing
+	//		the first and adding the last product, otherwise they are calculated again.
+	const bool slide = (sums.offset == offset - 1) && (offset % SUM_REFRESH_INTERVAL != 0);
+	for(int left = 0; left < shiftNum; ++left){
+		const double *y = upWind + offset + left;
+		if(slide){
+			sums.s_xy[left] += x[L-1] * y[L-1] - x[-1] * y[-1];
+		}else{
+			double s_xy = 0.0;
+			for(int k = 0; k < L; ++k)
+				s_xy += x[k] * y[k];
+			sums.s_xy[left] = s_xy;
+		}
+	}
+	sums.offset = offset;
+
+	// 3. Calculate the correlations from the sums. If the window is (almost) flat
+	//		then the correlations cannot be calculated accurately from the sums.
+	const double s_x	= sums.s_x[offset];
+	const double s_x2	= sums.s_x2[offset];
+	if(L * s_x2 - s_x * s_x <= MIN_RELATIVE_VARIANCE * L * s_x2){
+		return FindBestCorrelation(upWind + offset, upWindLength - offset, x, L, maximumShift, highestCorr, bestShift);
+	}
+
+	double fastHighest = -DBL_MAX;
+	for(int left = 0; left < shiftNum; ++left){
+		const double s_y	= sums.s_y[offset + left];
+		const double s_y2	= sums.s_y2[offset + left];
+
+		sums.reliable[left]	= (L * s_y2 - s_y * s_y > MIN_RELATIVE_VARIANCE * L * s_y2);
+		sums.c[left]		= correlation(sums.s_xy[left], s_x, s_x2, s_y, s_y2, L);
+
+		if(sums.reliable[left] && sums.c[left] > fastHighest)
+			fastHighest = sums.c[left];
+	}
+
+	// 4. Calculate the correlation exactly for the shifts which may give the highest 
+	//		correlation, this gives the same result as testing every shift.
+	double exactHighest = -DBL_MAX;
+	highestCorr = 0;
+	bestShift		= 0;
+	for(int left = 0; left < shiftNum; ++left){
+		if(sums.reliable[left] && sums.c[left] < fastHighest - CORRELATION_TOLERANCE)
+			continue;
+
+		double C = correlation(x, upWind + offset + left, L);
+		if(C > highestCorr){
+			highestCorr = C;
+			bestShift		= left;
+		}
+		if(C > exactHighest)
+			exactHighest = C;
+	}
+
+	// 5. If the correlations calculated from the sums were not accurate enough, test every shift
+	if(exactHighest < fastHighest - 0.5 * CORRELATION_TOLERANCE){
+		return FindBestCorrelation(upWind + offset, upWindLength - offset, x, L, maximumShift, highestCorr, bestShift);
+	}
+
+	return SUCCESS;
+}
+
 /** Calculates the correlation between the two vectors 'x' and 'y', both of length 'length' 
 		@return - the correlation between the two vectors. */
 double CWindSpeedCalculator::correlation(const double *x, const double *y, long length){
@@ -280,8 +381,6 @@ double CWindSpeedCalculator::correlation(const double *x, const double *y, long
 	double s_x  = 0; // <-- sum of all elements in X
 	double s_y	= 0; // <-- sum of all elements in Y
 	double s_y2 = 0; // <-- the dot-product Y*Y
-	double c		= 0; // <-- the final correlation
-	double eps = 1e-5;
 
 	if(length <= 0)
 		return 0;
@@ -294,6 +393,14 @@ double CWindSpeedCalculator::correlation(const double *x, const double *y, long
 		s_y2 += y[k] * y[k];
 	}
 
+	return correlation(s_xy, s_x, s_x2, s_y, s_y2, length);
+}
+
+/** Calculates the correlation between two vectors of length 'length' from the sums of their elements */
+double CWindSpeedCalculator::correlation(double s_xy, double s_x, double s_x2, double s_y, double s_y2, long length){
+	double c		= 0; // <-- the final correlation
+	double eps = 1e-5;
+
 	double nom = (length * s_xy - s_x*s_y);
 	double denom = sqrt(( (length*s_x2 - s_x*s_x) * (length*s_y2 - s_y*s_y) ));
 
@@ -305,6 +412,36 @@ double CWindSpeedCalculator::correlation(const double *x, const double *y, long
 	return c;
 }
 
+/** Calculates the sum, and the sum of squares, of every window of length 'windowLength' in 'x' */
+void CWindSpeedCalculator::CalculateWindowSums(const double *x, long length, long windowLength, std::vector<double> &s, std::vector<double> &s2){
+	long windowNum = length - windowLength + 1;
+	if(windowLength <= 0 || windowNum <= 0){
+		s.clear();
+		s2.clear();
+		return;
+	}
+	s.resize(windowNum);
+	s2.resize(windowNum);
+
+	for(long i = 0; i < windowNum; ++i){
+		if(i % SUM_REFRESH_INTERVAL == 0){
+			// calculate the sums again, to keep the rounding errors from growing
+			double sum = 0.0, sum2 = 0.0;
+			for(long k = i; k < i + windowLength; ++k){
+				sum		+= x[k];
+				sum2	+= x[k] * x[k];
+			}
+			s[i]	= sum;
+			s2[i]	= sum2;
+		}else{
+			const double first	= x[i - 1];
+			const double last		= x[i + windowLength - 1];
+			s[i]	= s[i - 1]	+ last - first;
+			s2[i]	= s2[i - 1]	+ last * last - first * first;
+		}
+	}
+}
+
 void CWindSpeedCalculator::InitializeArrays(){
 	delete[]	shift, corr, used, delays;
 	shift				= new double[m_length];
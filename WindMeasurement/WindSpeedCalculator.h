@@ -3,6 +3,8 @@
 #include "../Common/Common.h"
 #include "windspeedmeassettings.h"
 
+#include <vector>
+
 namespace WindSpeedMeasurement{
 
 	/** The <b>CWindSpeedCalculator</b> class contains the basic
@@ -61,6 +63,19 @@ namespace WindSpeedMeasurement{
 
 	protected:
 
+		/** The sums needed to calculate the correlation between a window in the down wind
+				series and the shifted windows in the up wind series. These are kept between
+				the offsets in 'CalculateDelay' so that they can be updated, instead of 
+				calculated again, when the window is moved one step. */
+		struct CorrelationSums{
+			std::vector<double> s_x, s_x2;	// <-- the sum, and sum of squares, of the window starting at each point in the down wind series
+			std::vector<double> s_y, s_y2;	// <-- the sum, and sum of squares, of the window starting at each point in the up wind series
+			std::vector<double> s_xy;		// <-- the dot-product between the down wind window and the up wind window, for each shift
+			std::vector<double> c;			// <-- the correlation calculated from the sums, for each shift
+			std::vector<char> reliable;		// <-- false if the correlation for the shift cannot be calculated accurately from the sums
+			int offset;						// <-- the offset of the window for which 's_xy' was calculated, -1 if none
+		};
+
 		/** Shifts the vector 'shortVector' against the vector 'longVector' and returns the
 					shift for which the correlation between the two is highest. 
 					The length of the longVector must be larger than the length of the short vector! */
@@ -70,9 +85,30 @@ namespace WindSpeedMeasurement{
 			unsigned int maximumShift,
 			double &highestCorr, int &bestShift);
 
+		/** Shifts the window of length 'windowLength' starting at 'offset' in the down wind series
+					against the up wind series and returns the shift for which the correlation is highest. 
+					The result is the same as from the function above, but the correlations are calculated
+					from the sums in 'sums' which are updated when the window has moved one step since
+					the last call. Only the shifts which may give the highest correlation are 
+					calculated directly. */
+		static RETURN_CODE FindBestCorrelation(
+			const double *upWind, long upWindLength,
+			const double *downWind, int offset, int windowLength,
+			unsigned int maximumShift,
+			CorrelationSums &sums,
+			double &highestCorr, int &bestShift);
+
+		/** Calculates the sum, and the sum of squares, of every window of length 'windowLength' in 'x'.
+				On return s[i] is the sum of x[i] to x[i + windowLength - 1]. */
+		static void CalculateWindowSums(const double *x, long length, long windowLength, std::vector<double> &s, std::vector<double> &s2);
+
 
 		/** Calculates the correlation between the two vectors 'x' and 'y', both of length 'length' 
 				@return - the correlation between the two vectors. */
 		static double	correlation(const double *x, const double *y, long length);
+
+		/** Calculates the correlation between two vectors of length 'length' from the sums of their elements,
+				the dot-products 's_xy', 's_x2' and 's_y2' and the sums 's_x' and 's_y' */
+		static double	correlation(double s_xy, double s_x, double s_x2, double s_y, double s_y2, long length);
 	};
 }
\ No newline at end of file
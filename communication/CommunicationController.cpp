@@ -2,6 +2,7 @@
 #include "communicationcontroller.h"
 #include "../Configuration/configuration.h"
 #include "ftpCom.h"
+#include "DownloadScheduler.h"
 using namespace Communication;
 extern CFormView *pView;
 #define SMALL_NODE_SUM 5
@@ -25,6 +26,10 @@ bool g_runFlag;
 //	of the file to upload to instrument with mainIndex=i
 CArray <CString, CString &> g_fileToUpload; 
 
+// This coordinates the downloading of files from all the instruments 
+//	which are connected by FTP
+CDownloadScheduler g_downloadScheduler;
+
 CCommunicationController::CCommunicationController(void)
 {
 	//the sum of the serial connections
@@ -121,6 +126,9 @@ void CCommunicationController::StartCommunicationThreads()
 	// Allocate enough size for the buffer of files to upload
 	g_fileToUpload.SetSize(g_settings.scannerNum);
 
+	// The number of files which may be downloaded from the FTP-instruments at the same time
+	g_downloadScheduler.SetBudget(g_settings.ftpSetting.maxDownloads);
+
 	for(i = 0; i < g_settings.scannerNum; ++i)
 	{
 		CConfigurationSetting::CommunicationSetting &comm = g_settings.scanner[i].comm;
@@ -0,0 +1,88 @@
+#include "StdAfx.h"
+#include "DownloadScheduler.h"
+
+using namespace Communication;
+
+CDownloadScheduler::CDownloadScheduler(void)
+{
+	m_budget          = 0; // no limit, as before the scheduler was added
+	m_activeTransfers = 0;
+	m_nextSequence    = 0;
+}
+
+CDownloadScheduler::~CDownloadScheduler(void)
+{
+}
+
+CDownloadScheduler::CTransfer::CTransfer(CDownloadScheduler &scheduler, __int64 priority)
+	: m_scheduler(scheduler)
+{
+	m_scheduler.BeginTransfer(priority);
+}
+
+CDownloadScheduler::CTransfer::~CTransfer(void)
+{
+	m_scheduler.EndTransfer();
+}
+
+void CDownloadScheduler::SetBudget(int maxTransfers)
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	m_budget = max(0, maxTransfers);
+
+	// a larger budget may let some of the waiting files through
+	m_budgetChanged.notify_all();
+}
+
+int CDownloadScheduler::GetBudget() const
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	return m_budget;
+}
+
+int CDownloadScheduler::GetActiveTransferNum() const
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	return m_activeTransfers;
+}
+
+void CDownloadScheduler::BeginTransfer(__int64 priority)
+{
+	std::unique_lock<std::mutex> lock{ m_mutex };
+
+	Request request;
+	request.priority = priority;
+	request.sequence = m_nextSequence++;
+	m_waiting.push_back(request);
+
+	m_budgetChanged.wait(lock, [&]{ return (m_budget == 0 || m_activeTransfers < m_budget) && IsFirstInLine(request); });
+
+	for(std::list<Request>::iterator it = m_waiting.begin(); it != m_waiting.end(); ++it){
+		if(it->sequence == request.sequence){
+			m_waiting.erase(it);
+			break;
+		}
+	}
+	++m_activeTransfers;
+
+	// There may still be room in the budget for the next file in line
+	m_budgetChanged.notify_all();
+}
+
+void CDownloadScheduler::EndTransfer()
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	--m_activeTransfers;
+	m_budgetChanged.notify_all();
+}
+
+bool CDownloadScheduler::IsFirstInLine(const Request &request) const
+{
+	for(std::list<Request>::const_iterator it = m_waiting.begin(); it != m_waiting.end(); ++it){
+		if(it->priority > request.priority)
+			return false;
+		if(it->priority == request.priority && it->sequence < request.sequence)
+			return false;
+	}
+	return true;
+}
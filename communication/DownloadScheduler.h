@@ -0,0 +1,99 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <condition_variable>
+
+namespace Communication
+{
+	/** <b>CDownloadScheduler</b> coordinates the downloading of data from all the
+		instruments which are connected by FTP. Every instrument is polled from its own
+		thread and the downloads from the different instruments run concurrently. The
+		number of files which are transferred at the same time can be limited by a common
+		budget ('ftpMaxDownloads' in the configuration), since the instruments at a
+		volcano usually share the same network.
+
+		When more files are waiting than the budget allows, the file with the most
+		recent scan is transferred first. This keeps the real-time flux measurements
+		up to date while a backlog of older files is being downloaded. */
+	class CDownloadScheduler
+	{
+	public:
+		CDownloadScheduler(void);
+		~CDownloadScheduler(void);
+
+		/** <b>CTransfer</b> holds one place in the budget of a scheduler,
+			from when it is created until it is destroyed. */
+		class CTransfer
+		{
+		public:
+			/** Waits until the file with the given priority may be transferred.
+				See CDownloadScheduler::BeginTransfer. */
+			CTransfer(CDownloadScheduler &scheduler, __int64 priority);
+			~CTransfer(void);
+
+		private:
+			CDownloadScheduler &m_scheduler;
+
+			CTransfer(const CTransfer &);
+			CTransfer &operator=(const CTransfer &);
+		};
+
+		// ----------------------------------------------------------------------
+		// --------------------- PUBLIC METHODS ---------------------------------
+		// ----------------------------------------------------------------------
+
+		/** Sets the largest number of files which may be transferred at the same time,
+			zero means that there is no limit. The default is no limit. */
+		void SetBudget(int maxTransfers);
+
+		/** Returns the largest number of files which may be transferred at the same time,
+			zero if there is no limit */
+		int GetBudget() const;
+
+		/** Returns the number of files which are being transferred right now */
+		int GetActiveTransferNum() const;
+
+		/** Waits until there is room in the budget and no waiting file has
+			a higher priority, then reserves one place in the budget.
+			Every call must be followed by a call to 'EndTransfer'.
+			@param priority - the priority of the file, files with higher priority
+				are transferred first. Files with the same priority are transferred
+				in the order they were asked for. The FTP-handlers use the time when
+				the file was written (yyyymmddhhmm), which makes the newest scans
+				go first. */
+		void BeginTransfer(__int64 priority);
+
+		/** Releases the place in the budget reserved by 'BeginTransfer' */
+		void EndTransfer();
+
+	private:
+		/** A file which is waiting to be transferred */
+		typedef struct Request{
+			__int64       priority;
+			unsigned long sequence;
+		}Request;
+
+		/** The mutex which protects all the data below */
+		mutable std::mutex m_mutex;
+
+		/** Signalled when a place in the budget has become free */
+		std::condition_variable m_budgetChanged;
+
+		/** The files which are waiting to be transferred */
+		std::list<Request> m_waiting;
+
+		/** The largest number of files which may be transferred at the same time, zero if there is no limit */
+		int m_budget;
+
+		/** The number of files which are being transferred right now */
+		int m_activeTransfers;
+
+		/** The sequence number of the next request */
+		unsigned long m_nextSequence;
+
+		/** Returns true if no other waiting file should go before 'request'.
+			Must be called with m_mutex locked. */
+		bool IsFirstInLine(const Request &request) const;
+	};
+}
@@ -1,12 +1,51 @@
 #include "StdAfx.h"
 #include "ftphandler.h"
+#include "DownloadScheduler.h"
 #include "../Common/CfgTxtFileHandler.h"
 
+#include <algorithm>
+#include <vector>
+
 using namespace Communication;
 
 extern CFormView *pView;                   // <-- the main window
 extern CConfigurationSetting g_settings;   // <-- the settings
 extern CWinThread *g_comm;                 // <-- The communication controller
+extern CDownloadScheduler g_downloadScheduler; // <-- coordinates the downloads from all instruments
+
+namespace
+{
+	/** Returns the time when the file was last written, as yyyymmddhhmm, from the
+		date and time in the file-list. The server gives the year instead of the
+		time of day for old files, files without a year are from the last 12 months. */
+	__int64 GetModificationTime(const CScannerFileInfo &info)
+	{
+		static const char *monthNames[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+		char monthName[8];
+		int year = 0, month = 0, day = 0, hour = 0, minute = 0;
+
+		if(2 != sscanf(info.date, "%7s %d", monthName, &day))
+			return 0;
+		for(int k = 0; k < 12; ++k){
+			if(0 == _strnicmp(monthName, monthNames[k], 3))
+				month = k + 1;
+		}
+		if(month == 0)
+			return 0;
+
+		if(2 == sscanf(info.time, "%d:%d", &hour, &minute)){
+			CTime now = CTime::GetCurrentTime();
+			year = now.GetYear();
+			// allow for the clock in the instrument being one day ahead of ours
+			if(month * 100 + day > now.GetMonth() * 100 + now.GetDay() + 1)
+				--year;
+		}else if(1 != sscanf(info.time, "%d", &year)){
+			return 0;
+		}
+
+		return (((((__int64)year * 100 + month) * 100 + day) * 100 + hour) * 100) + minute;
+	}
+}
 
 CFTPHandler::CFTPHandler(void)
 {
@@ -112,7 +151,11 @@ bool CFTPHandler::DownloadPakFiles(const CString& folder)
 		}
 
 		m_statusMsg.Format("Begin to download %s/%s",folder,fileName);
-		downloadResult = DownloadSpectra(fileName, m_storageDirectory);
+		{
+			// wait for our turn to use the network, the newest scans go first
+			CDownloadScheduler::CTransfer transfer(g_downloadScheduler, GetModificationTime(*fileInfo));
+			downloadResult = DownloadSpectra(fileName, m_storageDirectory);
+		}
 
 		if(downloadResult)
 			m_fileInfoList.RemoveTail();
@@ -250,8 +293,6 @@ long CFTPHandler::GetPakFileList(CString& folder)
 		g_settings.scanner[m_mainIndex].electronicsBox = BOX_VERSION_2;
 	}
 
-	Sleep(100);
-
 	// Enter Rxxx folder
 	if(folder.GetLength() == 4)
 	{
@@ -291,6 +332,9 @@ long CFTPHandler::GetPakFileList(CString& folder)
 	ftpSocket->Disconnect();
 	delete ftpSocket;
 
+	// Download the newest files first
+	SortFileList();
+
 	// Count the number of files in the instrument
 	pakFileSum = m_fileInfoList.GetCount();
 	
@@ -342,6 +386,25 @@ bool CFTPHandler::GetDiskFileList(int disk)
 	}
 }
 
+void CFTPHandler::SortFileList()
+{
+	std::vector<CScannerFileInfo> files;
+	std::vector<std::pair<__int64, size_t> > order;
+
+	POSITION pos = m_fileInfoList.GetHeadPosition();
+	while(pos != NULL){
+		files.push_back(m_fileInfoList.GetNext(pos));
+		order.push_back(std::make_pair(GetModificationTime(files.back()), order.size()));
+	}
+
+	// Oldest first, files written at the same time keep their order
+	std::sort(order.begin(), order.end());
+
+	m_fileInfoList.RemoveAll();
+	for(size_t k = 0; k < order.size(); ++k)
+		m_fileInfoList.AddTail(files[order[k].second]);
+}
+
 void CFTPHandler::EmptyFileInfo()
 {
 	m_fileInfoList.RemoveAll();
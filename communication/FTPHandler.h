@@ -119,6 +119,10 @@ namespace Communication
 					m_fileInfoList and m_rFolderList */
 		void EmptyFileInfo();
 
+		/** Sorts m_fileInfoList in the order the files were written,
+				the newest file last. */
+		void SortFileList();
+
 		/* Add a folder name into m_rfolderList. 
 				Only folders of the format RXXX will be inserted */
 		void AddFolderInfo(CString& line);
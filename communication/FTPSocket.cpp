@@ -9,6 +9,10 @@ extern CConfigurationSetting g_settings;
 CFTPSocket::CFTPSocket(void)
 {
 	m_timeout = 15;
+	m_controlSocket = INVALID_SOCKET;
+	m_dataSocket = INVALID_SOCKET;
+	m_receivedNum = 0;
+	m_receiveBuf[0] = 0;
 }
 
 CFTPSocket::~CFTPSocket(void)
@@ -24,24 +28,49 @@ bool CFTPSocket::Login(const CString ftpServerIP, CString userName, CString pwd,
 	m_serverParam.password = pwd;
 
 	m_msg.Format("%s is not accessible, check the connection", ftpServerIP);	
+	m_receivedNum = 0; // nothing has been received on the new connection
+	m_receiveBuf[0] = 0;
 	if(!Connect(m_controlSocket,m_serverParam.m_serverIP,ftpPort))
 	{
 		ShowMessage(m_msg);
 		return false;
 	}
-	SendCommand("USER",userName);
-	SendCommand("PASS",pwd);
-	if(ReadResponse() == 1)
+
+	// wait for the welcome-message (220) before logging in
+	if(ReadResponse() != 1 || !IsFTPCommandDone())
 	{
-		m_msg.Format("%s is connected", ftpServerIP);
 		ShowMessage(m_msg);
-		return true;
+		return false;
 	}
-	else
+	CString loginReplies = m_serverMsg;
+
+	// the server asks for the password (331), or logs us in directly (230)
+	SendCommand("USER",userName);
+	if(ReadResponse() != 1 || !IsFTPCommandDone())
 	{
+		m_msg.Format("%s did not accept the user name", ftpServerIP);
 		ShowMessage(m_msg);
 		return false;
 	}
+	loginReplies.Append(m_serverMsg);
+
+	if(atoi(m_serverMsg) == 331)
+	{
+		SendCommand("PASS",pwd);
+		if(ReadResponse() != 1 || !IsFTPCommandDone())
+		{
+			m_msg.Format("%s did not accept the password", ftpServerIP);
+			ShowMessage(m_msg);
+			return false;
+		}
+		loginReplies.Append(m_serverMsg);
+	}
+
+	// the callers look for the type of the server in the welcome-message
+	m_serverMsg = loginReplies;
+	m_msg.Format("%s is connected", ftpServerIP);
+	ShowMessage(m_msg);
+	return true;
 }
 void CFTPSocket::GetFileName(CString& filePath)
 {
@@ -70,6 +99,7 @@ bool CFTPSocket::EnterFolder(CString& folder)
 bool CFTPSocket::GoToUpperFolder()
 {
 	SendCommand("CDUP","");
+	ReadResponse();
 	return true;
 }
 
@@ -90,7 +120,6 @@ bool CFTPSocket::EnterPassiveMode()
 		// Send the command to enter passive mode
 		SendCommand("PASV","");
 		round++;
-		Sleep(600);
 
 		// Read the response from the server
 		if(-1 == ReadResponse())
@@ -177,6 +206,9 @@ bool CFTPSocket::List()
 	{
 		m_msg.Format("Successfully read list data");
 		ShowMessage(m_msg);
+
+		// read the reply which tells that the transfer is complete
+		ReadResponse();
 		return true;
 	}	
 	else
@@ -191,6 +223,7 @@ bool CFTPSocket::UploadFile(CString fileLocalPath)
 {
 	bool result;
 	SendCommand("TYPE","I");
+	ReadResponse();
 	if(!EnterPassiveMode())
 		return false;
 
@@ -226,7 +259,6 @@ bool CFTPSocket::DeleteFTPFile(CString fileName)
 int CFTPSocket::SendCommand(CString command,CString commandText)
 {
 	char buf[100];
-	Sleep(100); // Added 2008.06.30 to work with the Axis computer
 	if(commandText.GetLength() == 0)
 		wsprintf(buf,"%s\r\n", command);
 	else
@@ -282,7 +314,6 @@ bool CFTPSocket::ReadData()
 	int count = 0;
 
 	TByteVector vLocalBuf(LOCAL_BUF_SIZE);
-	Sleep(50);
 	time(&startTime);
 	do
 	{
@@ -388,25 +419,27 @@ void CFTPSocket::StoreReceivedBytes(const TByteVector& vBuffer, long receivedByt
 		return;
 	std::copy(vBuffer.begin(), vBuffer.begin()+receivedBytes, std::back_inserter(m_vDataBuffer));
 }
-int CFTPSocket::ReadResponse()
+int CFTPSocket::ReadResponse(int replyNum)
 {
 	int bytesRecv = SOCKET_ERROR;
 	long errorNum = 0;
-	int count = 0;
-	time_t startTime, stopTime;
-	memset(m_receiveBuf,0,RESPONSE_LEN);
+	int replyLength;
+	time_t startTime, timeNow;
 	time(&startTime);
-	do
+
+	// Read until the server has sent 'replyNum' complete replies, 
+	//	the replies may already have been received in an earlier call
+	while((replyLength = FindRepliesEnd(m_receiveBuf, replyNum)) < 0 && m_receivedNum < RESPONSE_LEN - 1)
 	{
-		Sleep(100);
-		if(IsDataReady(m_controlSocket, 10))
-			bytesRecv = recv( m_controlSocket, m_receiveBuf, RESPONSE_LEN, 0 );
-		else
+		time(&timeNow);
+		long timeLeft = m_timeout - (long)(timeNow - startTime);
+		if(timeLeft <= 0 || !IsDataReady(m_controlSocket, timeLeft))
 		{
 			ShowMessage("Read data timeout");
 			return -1;
 		}
-		
+
+		bytesRecv = recv( m_controlSocket, m_receiveBuf + m_receivedNum, RESPONSE_LEN - 1 - m_receivedNum, 0 );
 		if (bytesRecv < 0)
 		{
 			errorNum = WSAGetLastError();
@@ -417,20 +450,23 @@ int CFTPSocket::ReadResponse()
 				return errorNum;
 			}
 		}
+		else if(bytesRecv == 0)
+			break; // the server has closed the connection
 		else
-			break;
-
-		count++;
-		time(&stopTime);
-		if(stopTime - startTime >= m_timeout)
 		{
-			ShowMessage("Read data timeout");
-			return -1;
+			m_receivedNum += bytesRecv;
+			m_receiveBuf[m_receivedNum] = 0;
 		}
-	}while(bytesRecv!= 0);
+	}
 
-	m_serverMsg.Format("%s",m_receiveBuf);
-	//msg.Format("%s",m_receiveBuf);
+	// Return the complete replies and keep the rest for the next call.
+	//	If the replies could not be completed then return all that we have
+	if(replyLength < 0)
+		replyLength = m_receivedNum;
+	m_serverMsg.Format("%.*s", replyLength, m_receiveBuf);
+	m_receivedNum -= replyLength;
+	memmove(m_receiveBuf, m_receiveBuf + replyLength, m_receivedNum);
+	m_receiveBuf[m_receivedNum] = 0;
 	if(errorNum == 0)
 		return 1;
 	else
@@ -441,6 +477,25 @@ int CFTPSocket::ReadResponse()
 	}
 }
 
+int CFTPSocket::FindRepliesEnd(const char *response, int replyNum)
+{
+	// A reply is complete when we have received its last line, which starts
+	//	with the three-digit reply code followed by a space. The other lines of a 
+	//	multi-line reply have a hyphen after the code.
+	int foundNum = 0;
+	const char *line = response;
+	const char *lineEnd;
+	while(foundNum < replyNum && (lineEnd = strchr(line, '\n')) != NULL)
+	{
+		if(isdigit((unsigned char)line[0]) && isdigit((unsigned char)line[1]) && isdigit((unsigned char)line[2]) && line[3] == ' ')
+			++foundNum;
+		line = lineEnd + 1;
+	}
+	if(foundNum < replyNum)
+		return -1;
+	return (int)(line - response);
+}
+
 bool CFTPSocket::Connect(SOCKET& usedSocket,char* serverIP, int serverPort)
 {
 		// Initialize Winsock.
@@ -655,6 +710,7 @@ int CFTPSocket::DownloadFile(CString remoteFileName,CString localFileName)
 	//receive file parts
 	time(&startTime);
 	SendCommand("TYPE","I");
+	ReadResponse();
 	
 	if(!EnterPassiveMode())
 		return 0;
@@ -689,6 +745,9 @@ int CFTPSocket::DownloadFile(CString remoteFileName,CString localFileName)
 		CloseHandle(m_hDownloadedFile);
 		return -1;
 	}
+	// read the reply which tells that the transfer is complete
+	ReadResponse();
+
 	//show time duration
 	time(&stopTime);
 	fileKBytes = (float)(fileSize / 1024.0);
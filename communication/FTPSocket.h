@@ -38,10 +38,13 @@ namespace Communication
 		*/
 		bool Connect(SOCKET& usedSocket,char* serverIP, int serverPort);
 
-		/**Read the control response from the server, write message to m_serverMsg
-		    @return true if there is response
+		/**Read the control response from the server, write message to m_serverMsg.
+			Waits until the server has sent 'replyNum' complete replies, or until the time-out.
+			Bytes received after the last of these replies are kept and are
+			the beginning of the response read in the next call.
+		    @return 1 if there is response
 		*/
-		int ReadResponse();
+		int ReadResponse(int replyNum = 1);
 
 		/**Read data from the FTP server*/
 		bool ReadData();
@@ -226,10 +229,17 @@ namespace Communication
 		/**buffer to store received control info from the FTP server*/
 		char m_receiveBuf[RESPONSE_LEN];
 
+		/**the number of bytes in m_receiveBuf which have not yet been returned by ReadResponse*/
+		int m_receivedNum;
+
 		/**vector to store received data from the FTP server*/
 		TByteVector m_vDataBuffer;
 
 		/**list to store the ftp codes which indicate the status of last communication */
 		CList<int,int> m_ftpCode;
+		/**Find the end of the first 'replyNum' complete replies in the given response from the server
+			@return the length of these replies [bytes]
+			@return -1 if the response does not contain 'replyNum' complete replies */
+		static int FindRepliesEnd(const char *response, int replyNum);
 	};
 }
\ No newline at end of file
@@ -48,6 +48,11 @@ long CLinkStatistics::GetDownloadNum() const{
 	return GetSuccessfulNum(m_downloads);
 }
 
+/** Returns the number of failed downloads today on this link */
+long CLinkStatistics::GetFailedDownloadNum() const{
+	return GetFailedNum(m_downloads);
+}
+
 /** Getting the successrate for the number of uploads
 		@return the portion of number of attempts to upload files
 			that have succeeded (0 -> 1) */
@@ -230,3 +235,18 @@ long CLinkStatistics::GetSuccessfulNum(const CList <CTransferInfo, CTransferInfo
 
 	return nSuccess;
 }
+
+/** Returns the number of failed transfers today on this link */
+long CLinkStatistics::GetFailedNum(const CList <CTransferInfo, CTransferInfo&>	&list) const{
+	long nFailure = 0;
+
+	POSITION pos = list.GetHeadPosition();
+	while(pos != NULL){
+		const CTransferInfo &info = list.GetNext(pos);
+
+		if(!info.success)
+			++nFailure;
+	}
+
+	return nFailure;
+}
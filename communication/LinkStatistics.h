@@ -27,6 +27,9 @@ namespace Communication{
 		/** Returns the number of successful downloads today on this link */
 		long	GetDownloadNum() const;
 
+		/** Returns the number of failed downloads today on this link */
+		long	GetFailedDownloadNum() const;
+
 		/** Getting the successrate for the number of uploads
 				@return the portion of number of attempts to upload files
 					that have succeeded (0 -> 1) */
@@ -86,6 +89,9 @@ namespace Communication{
 		/** Returns the number of successful transfers today on this link */
 		long	GetSuccessfulNum(const CList <CTransferInfo, CTransferInfo&>	&list) const;
 
+		/** Returns the number of failed transfers today on this link */
+		long	GetFailedNum(const CList <CTransferInfo, CTransferInfo&>	&list) const;
+
 		/** Appends the given data-speed to the given list */
 		void	AppendSuccessfulTransfer(double speed, CList <CTransferInfo, CTransferInfo&>	&list);
 
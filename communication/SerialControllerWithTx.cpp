@@ -42,6 +42,9 @@ CSerialControllerWithTx::CSerialControllerWithTx(void)
 	m_sleepFlag = false;
 	m_radioID.Format("");
 	m_electronicsBox = BOX_VERSION_1;
+	m_transferWindow = 1; // set from the configuration in 'SetSerialPort'
+	m_pipelineState = PIPELINE_UNKNOWN;
+	m_stopAndWaitDownloads = 0;
 }
 
 
@@ -58,6 +61,9 @@ CSerialControllerWithTx::CSerialControllerWithTx(ELECTRONICS_BOX box){
 	m_sleepFlag = false;
 	m_radioID.Format("");
 	m_electronicsBox = box;
+	m_transferWindow = 1; // set from the configuration in 'SetSerialPort'
+	m_pipelineState = PIPELINE_UNKNOWN;
+	m_stopAndWaitDownloads = 0;
 }
 
 CSerialControllerWithTx::~CSerialControllerWithTx(void)
@@ -88,6 +94,7 @@ void CSerialControllerWithTx::SetSerialPort(int serialID,int COMPort,int baudrat
 	m_spectrometerSerialNumber.Format("%s", g_settings.scanner[m_mainIndex].spec[0].serialNumber);
 	m_timeout  = g_settings.scanner[m_mainIndex].comm.timeout;
 	m_interval = g_settings.scanner[m_mainIndex].comm.queryPeriod;
+	m_transferWindow = max(g_settings.scanner[m_mainIndex].comm.transferWindow, 1);
 	
 	// Make one directory for each instrument...
 	m_storageDirectory.Format("%sTemp\\%s\\", g_settings.outputDirectory, m_spectrometerSerialNumber);
@@ -240,13 +247,8 @@ RETURN_CODE CSerialControllerWithTx::GetFile(char* fileName,CString filePath,cha
 	}else{
 		maxchunk = 8192;
 	}
-	long tmp;
-	unsigned char *mem,ok;
-	unsigned long size,retries, sendlen,start,rstart;
-	unsigned short rlen, chksum1,chksum2; 
-	time_t startTime,stopTime;
-	CString timeTxt;
-	double downloadedSize;
+	unsigned char *mem;
+	unsigned long size;
 	char fullfileName[64];
 	//set the name of the file which will be downloaded
 	if(diskName=='A' && m_electronicsBox != BOX_VERSION_2)
@@ -256,14 +258,8 @@ RETURN_CODE CSerialControllerWithTx::GetFile(char* fileName,CString filePath,cha
 	m_ErrorMsg.Format("Will download %s",fullfileName);
 	ShowMessage(m_ErrorMsg,m_connectionID);
 
-	// The number of downloaded chunks, used to calculate the average speed
-	int nChunks			= 0;
 	m_avgDownloadSpeed	= 0;
-	double curSpeed		= 0.0;
-
-	time(&startTime);
 
-	
 	//get file size for status.dat or other files which are not pak files
 	if(strstr(fullfileName,".pak")== NULL ||strstr(fileName,"UPLOAD.PAK")!= NULL)
 	{
@@ -298,129 +294,255 @@ RETURN_CODE CSerialControllerWithTx::GetFile(char* fileName,CString filePath,cha
 		ShowMessage("Could not allocate memory to save file"); 
 		return FAIL; 
 	}
-	retries=0;
+	//---- download the data -----//
+	if(SUCCESS != DownloadChunks(mem, size, maxchunk)){
+		free(mem);
+		m_linkStatistics.AppendFailedDownload();
+		return FAIL;
+	}
+	WriteSpectraFile(mem,size,filePath);
+	free(mem);
+
+	// Remember the link-speed
+	m_linkStatistics.AppendDownloadSpeed(m_avgDownloadSpeed);
+
+	return SUCCESS;
+}
+
+RETURN_CODE CSerialControllerWithTx::DownloadChunks(unsigned char *mem, unsigned long size, unsigned long maxChunk)
+{
+	std::deque<FileChunk> outstanding;	// the requested chunks, in the order the requests were sent
+	std::deque<FileChunk> retransmit;	// the chunks which have to be requested again
+	unsigned long chunkSize = GetChunkSize(maxChunk);
+	unsigned long nextStart = 0;		// the start of the first chunk which has not been requested yet
+	unsigned long downloaded = 0;
+	unsigned long rstart;
+	unsigned short rlen, chksum1, chksum2;
+	int window = max(m_transferWindow, 1);
+	int failures = 0;
+	long tmp;
+	time_t startTime, stopTime;
+	CString timeTxt;
+	double downloadedSize, curSpeed = 0.0;
+
+	// The number of downloaded chunks, used to calculate the average speed
+	int nChunks = 0;
+	m_avgDownloadSpeed = 0;
+
+	time(&startTime);
+
+	// The remote PC lost pipelined requests in a recent download, use stop-and-wait for a while
+	if(m_stopAndWaitDownloads > 0){
+		--m_stopAndWaitDownloads;
+		window = 1;
+	}
 
 	//---- loop to download data -----//
-	for(start=0;start<size;)
+	while(downloaded < size)
 	{
-	//send start point and data block size to remote PC
-		sendlen = size-start;
-		if(sendlen > maxchunk) 
-			sendlen = maxchunk;
-		rlen = sendlen;
+		// Nothing is on its way from the remote PC, clear the port before the next requests
+		if(outstanding.empty())
+			FlushSerialPort(100);
 
-		FlushSerialPort(100); 
-		SendCommand(TX_GET);
-		if(!WriteSerial(&start,4))
-			ShowMessage("Serial communication may be broken, please check");
-		if(!WriteSerial(&rlen,2))
-			ShowMessage("Serial communication may be broken, please check");
+		// send the requests for the next chunks, chunks to retransmit first
+		while((int)outstanding.size() < window && (!retransmit.empty() || nextStart < size))
+		{
+			FileChunk chunk;
+			if(!retransmit.empty()){
+				chunk = retransmit.front();
+				retransmit.pop_front();
+			}else{
+				chunk.start     = nextStart;
+				chunk.length    = (unsigned short)min(chunkSize, size - nextStart);
+				chunk.attempts  = 0;
+				nextStart      += chunk.length;
+			}
+			chunk.pipelined = !outstanding.empty();
+			RequestChunk(chunk);
+			outstanding.push_back(chunk);
+		}
 
+		// check remote PC's reply to the oldest request
+		FileChunk chunk = outstanding.front();
+		outstanding.pop_front();
+		bool inSync = true;
 		rstart = rlen = 0;
-		ok = 1;
-		//FlushSerialPort(1);
-		// check remote PC's reply
 		if(GetSerialData(&rstart,4,m_timeout)!=4) 
 		{
 			ShowMessage("No rstart"); 
-			ok=0; 
+			inSync = false;
 		}
 		else if(GetSerialData(&rlen,2,m_timeout)!=2) 
 		{
 			ShowMessage("No rlen"); 
-			ok=0; 
+			inSync = false;
 		}
-		else
+		else if(chunk.start!=rstart)
 		{
-			tmp=GetSerialData(&mem[start],sendlen,m_timeout);//100);
-			if(tmp!=sendlen)
-			{
-				ok=0;
-				m_ErrorMsg.Format("get data size %d", tmp);
-				ShowMessage(m_ErrorMsg);
-			}
-			else if(GetSerialData(&chksum1,2,m_timeout)!=2)
-			{ 
-				ShowMessage("No checksum"); 
-				ok=0; 
-			}
+			m_ErrorMsg.Format("Start does not match requested %d!= %d",chunk.start,rstart);
+			ShowMessage(m_ErrorMsg);
+			inSync = false;
 		}
-		if(start!=rstart)
+		else if(rlen!=chunk.length)
+		{ 
+			m_ErrorMsg.Format("Length does not match requested %d!= %d",rlen,chunk.length);
+			ShowMessage(m_ErrorMsg);
+			inSync = false;
+		}
+		else if((tmp=GetSerialData(&mem[chunk.start],chunk.length,m_timeout))!=chunk.length)
 		{
-			m_ErrorMsg.Format("Start does not match requested %d!= %d",start,rstart);
+			m_ErrorMsg.Format("get data size %d", tmp);
 			ShowMessage(m_ErrorMsg);
-			ok=0;
+			inSync = false;
 		}
-		if(rlen!=sendlen)
+		else if(GetSerialData(&chksum1,2,m_timeout)!=2)
 		{ 
-			m_ErrorMsg.Format("Length does not match requested %d!= %d",rlen,sendlen);
-			ShowMessage(m_ErrorMsg);
-			ok=0; 
+			ShowMessage("No checksum"); 
+			inSync = false;
 		}
-		// Resyncronize communication when error happens, max 5 times
-		if(!ok)
+
+		// The replies can no longer be matched to the requests, resyncronize
+		//	and request all the outstanding chunks again, max 5 times
+		if(!inSync)
 		{
-			retries++;
-			if(retries==5)
-			{
-				/*if(Resync()== SUCCESS)
-				{
-					SetName(fullfileName);
-					retries=0;
-				}
-				else*///get out of loop 2007.5.14
+			DiscardReplies(outstanding, ReplySize(chunk));
 
-				m_linkStatistics.AppendFailedDownload();
-				return FAIL;	//get out of loop 2007.4.30
+			if(++failures==5)
+				return FAIL;
+
+			outstanding.push_front(chunk);
+			while(!outstanding.empty()){
+				retransmit.push_front(outstanding.back());
+				outstanding.pop_back();
+			}
+
+			// If the remote PC has never replied to a request sent while another was
+			//	outstanding, then it may not handle more than one request at a time.
+			//	Use stop-and-wait for a number of downloads and then try again.
+			if(window > 1){
+				if(m_pipelineState != PIPELINE_SUPPORTED){
+					m_stopAndWaitDownloads = PIPELINE_RETRY_DOWNLOADS;
+					m_ErrorMsg.Format("Remote PC lost requests sent several at a time, using stop-and-wait transfer for the next %d files", PIPELINE_RETRY_DOWNLOADS);
+					ShowMessage(m_ErrorMsg);
+					window = 1;
+				}else{
+					window = max(window / 2, 1);
+				}
 			}
+			continue;
 		}
-		else
-		{
-			m_ErrorMsg.Format("start=%d len=%d ",rstart,rlen);
-			UpdateMessage(m_ErrorMsg);
-			// compare checksum to check data validity
-			chksum2=CalcChecksum(sendlen,&mem[start]);
-			if(chksum1!=chksum2)
-			{ 
-				m_ErrorMsg.Format("Checksum not correct 0x%0x!=0x%0x",chksum1,chksum2);
-				ShowMessage(m_ErrorMsg);
-				ok=0; 
+		if(chunk.pipelined)
+			m_pipelineState = PIPELINE_SUPPORTED;
+
+		m_ErrorMsg.Format("start=%d len=%d ",rstart,rlen);
+		UpdateMessage(m_ErrorMsg);
+
+		// compare checksum to check data validity
+		chksum2=CalcChecksum(chunk.length,&mem[chunk.start]);
+		if(chksum1!=chksum2)
+		{ 
+			m_ErrorMsg.Format("Checksum not correct 0x%0x!=0x%0x",chksum1,chksum2);
+			ShowMessage(m_ErrorMsg);
+
+			if(++chunk.attempts==5){
+				DiscardReplies(outstanding, 0);
+				return FAIL;
 			}
-			// No error in data transfer
-			if(ok)
-			{
-				start+=sendlen;
-				time(&stopTime);
-				
-				m_common.GetDateTimeText(timeTxt);
-				downloadedSize = start/1024.0;
-				if(stopTime - startTime > 0.01){
-					curSpeed			 = downloadedSize/(stopTime - startTime);
-				}
-				m_ErrorMsg.Format("<%s>:%s Have downloaded %.1lfKBytes data at %.1f KBytes/second. Duration is %d seconds. %.1lf percent is finished",
-					m_connectionID,timeTxt, downloadedSize, curSpeed, stopTime-startTime, 100.0*start/size);
-				if(nChunks == 0)
-					ShowMessage(m_ErrorMsg);
-				else
-					UpdateMessage(m_ErrorMsg);
 
-				m_avgDownloadSpeed += curSpeed;
-				++nChunks;
+			// The link is noisy, use smaller chunks from now on and request
+			//	only this chunk again, split into the smaller size
+			chunkSize = max(chunkSize / 2, (unsigned long)MIN_CHUNK);
+			for(unsigned long offset = 0; offset < chunk.length; offset += chunkSize){
+				FileChunk part = chunk;
+				part.start  = chunk.start + offset;
+				part.length = (unsigned short)min(chunkSize, (unsigned long)chunk.length - offset);
+				retransmit.push_back(part);
 			}
+			continue;
 		}
+
+		// No error in data transfer
+		downloaded += chunk.length;
+		time(&stopTime);
+
+		m_common.GetDateTimeText(timeTxt);
+		downloadedSize = downloaded/1024.0;
+		if(stopTime - startTime > 0.01){
+			curSpeed			 = downloadedSize/(stopTime - startTime);
+		}
+		m_ErrorMsg.Format("<%s>:%s Have downloaded %.1lfKBytes data at %.1f KBytes/second. Duration is %d seconds. %.1lf percent is finished",
+			m_connectionID,timeTxt, downloadedSize, curSpeed, stopTime-startTime, 100.0*downloaded/size);
+		if(nChunks == 0)
+			ShowMessage(m_ErrorMsg);
+		else
+			UpdateMessage(m_ErrorMsg);
+
+		m_avgDownloadSpeed += curSpeed;
+		++nChunks;
 	}
 	//---- end of the loop to download data -----// 
-	WriteSpectraFile(mem,size,filePath);
-	free(mem);
 
 	// Calculate the average download speed
 	m_avgDownloadSpeed /= nChunks;
 
-	// Remember the link-speed
-	m_linkStatistics.AppendDownloadSpeed(m_avgDownloadSpeed);
-
 	return SUCCESS;
 }
+
+unsigned long CSerialControllerWithTx::GetChunkSize(unsigned long maxChunk) const
+{
+	long nSuccess = m_linkStatistics.GetDownloadNum();
+	long nFailure = m_linkStatistics.GetFailedDownloadNum();
+	unsigned long chunkSize = maxChunk;
+
+	// Without any failures, use the largest chunks
+	if(nFailure == 0)
+		return maxChunk;
+
+	// Every bad chunk has to be downloaded again, on links which often 
+	//	fail smaller chunks waste less time in retransmissions
+	double successRate = nSuccess / (double)(nSuccess + nFailure);
+	if(successRate < 0.9)
+		chunkSize /= 2;
+	if(successRate < 0.5)
+		chunkSize /= 2;
+
+	// On slow links (e.g. radio-modems) every retransmission costs even more
+	if(successRate < 0.9 && nSuccess > 0 && m_linkStatistics.GetAveragedDownloadSpeed() < SLOW_LINK_SPEED)
+		chunkSize /= 2;
+
+	return max(chunkSize, (unsigned long)MIN_CHUNK);
+}
+
+void CSerialControllerWithTx::RequestChunk(const FileChunk &chunk)
+{
+	SendCommand(TX_GET);
+	if(!WriteSerial((void*)&chunk.start,4))
+		ShowMessage("Serial communication may be broken, please check");
+	if(!WriteSerial((void*)&chunk.length,2))
+		ShowMessage("Serial communication may be broken, please check");
+}
+
+void CSerialControllerWithTx::DiscardReplies(const std::deque<FileChunk> &outstanding, unsigned long partialReply)
+{
+	unsigned char buffer[512];
+	unsigned long expected = partialReply;
+
+	for(size_t k = 0; k < outstanding.size(); ++k)
+		expected += ReplySize(outstanding[k]);
+
+	// read the replies, as long as the remote PC keeps sending
+	while(expected > 0)
+	{
+		int length = (int)min(expected, (unsigned long)sizeof(buffer));
+		int received = GetSerialData(buffer, length, m_timeout);
+		expected -= received;
+		if(received < length)
+			break;
+	}
+
+	// clear what may be left on the line
+	FlushSerialPort(100);
+}
 // Write the received data into a file
 
 RETURN_CODE CSerialControllerWithTx::WriteSpectraFile(BYTE* mem, long fileSize,CString filePath)
@@ -6,6 +6,7 @@
 #include "../Common/Common.h"
 #include "../FileInfo.h"
 #include "LinkStatistics.h"
+#include <deque>
 
 #define TX_NAME 'n'
 #define TX_PUT 'p'
@@ -320,8 +321,73 @@ namespace Communication
 
 		/** The statistics for this link */
 		CLinkStatistics	m_linkStatistics;
+
+		/** The largest number of chunk-requests which are sent to the remote PC
+			before waiting for the replies when downloading files, taken from the
+			'transferWindow' of the instrument in the configuration. If this is one 
+			then every chunk is downloaded stop-and-wait, as tx.exe always did. */
+		int m_transferWindow;
+
+		/** Whether the remote PC has been seen to handle more than one outstanding
+			chunk-request at a time */
+		enum PIPELINE_STATE{
+			PIPELINE_UNKNOWN,		// not yet tested on this connection
+			PIPELINE_SUPPORTED		// replies to several outstanding requests have been received
+		};
+		PIPELINE_STATE m_pipelineState;
+
+		/** The number of downloads which are made stop-and-wait before several
+			chunk-requests are sent at a time again. This is set when requests were
+			lost before the remote PC had ever replied to a pipelined request. The
+			loss may as well have been caused by a noisy link, so pipelining is
+			tried again after 'PIPELINE_RETRY_DOWNLOADS' downloads. */
+		int m_stopAndWaitDownloads;
 		
 	private:
+
+		/** One chunk of a file which is being downloaded */
+		typedef struct FileChunk{
+			unsigned long start;	// the position of the chunk in the file
+			unsigned short length;	// the length of the chunk [bytes]
+			int attempts;			// the number of failed downloads of the chunk
+			bool pipelined;			// true if the chunk was requested while other requests were outstanding
+		}FileChunk;
+
+		/** The smallest chunk used when downloading files [bytes] */
+		static const unsigned long MIN_CHUNK = 512;
+
+		/** The number of stop-and-wait downloads before pipelining is tried again */
+		static const int PIPELINE_RETRY_DOWNLOADS = 10;
+
+		/** The highest average download speed [kBytes/second] at which a link is considered as slow */
+		static const int SLOW_LINK_SPEED = 2;
+
+		/** Downloads 'size' bytes of the file set with 'SetName' into 'mem'. Up to 
+			'm_transferWindow' chunk-requests are sent before waiting for the replies.
+			Only chunks with bad checksums are requested again and the chunks are made
+			smaller for every checksum failure. If the remote PC loses requests when
+			several are sent at a time then the rest of the transfer, and the next
+			'PIPELINE_RETRY_DOWNLOADS' transfers, are made stop-and-wait.
+			@param maxChunk - the largest chunk the remote PC can send [bytes]
+			@return SUCCESS if the whole file was downloaded */
+		RETURN_CODE DownloadChunks(unsigned char *mem, unsigned long size, unsigned long maxChunk);
+
+		/** Returns the size of the chunks to start a download with, based on the
+			failures and the speed of the previous downloads on this link. */
+		unsigned long GetChunkSize(unsigned long maxChunk) const;
+
+		/** Sends the request for one chunk to the remote PC */
+		void RequestChunk(const FileChunk &chunk);
+
+		/** Returns the size of the reply to the request for the given chunk [bytes]. 
+			The reply is the start (4 bytes), the length (2 bytes), the data and the checksum (2 bytes). */
+		static unsigned long ReplySize(const FileChunk &chunk) { return 8 + chunk.length; }
+
+		/** Reads and throws away the replies to the given requests, which may still be 
+			on their way from the remote PC, so that they are not taken as the replies 
+			to later requests. Stops when nothing has arrived for 'm_timeout' ms.
+			@param partialReply - the number of bytes which may remain of a reply which was only partly read */
+		void DiscardReplies(const std::deque<FileChunk> &outstanding, unsigned long partialReply);
 	
 		/** This function tries to download cfg.txt from this instrument. 
 				The cfg.txt file can be used to assess e.g. the motorstepscomp